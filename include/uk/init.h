@@ -120,6 +120,17 @@ typedef int (*uk_init_func_t)(void);
 extern const uk_init_func_t uk_inittab_start[];
 extern const uk_init_func_t uk_inittab_end;
 
+/*
+ * Start of the entries of each init class within uk_inittab
+ * (provided by the linker script)
+ */
+extern const uk_init_func_t uk_inittab1_start[];
+extern const uk_init_func_t uk_inittab2_start[];
+extern const uk_init_func_t uk_inittab3_start[];
+extern const uk_init_func_t uk_inittab4_start[];
+extern const uk_init_func_t uk_inittab5_start[];
+extern const uk_init_func_t uk_inittab6_start[];
+
 /**
  * Helper macro for iterating over init pointer tables
  * Please note that the table may contain NULL pointer entries
@@ -137,6 +148,96 @@ extern const uk_init_func_t uk_inittab_end;
 	     (itr) < &(inittab_end);				\
 	     (itr)++)
 
+/**
+ * Asynchronous init functions (uk_initjobs)
+ *
+ * An asynchronous init function is started as its own thread as soon as
+ * its init class is entered and all init functions of the previous
+ * classes returned. It runs concurrently to the regular init functions
+ * and to the other asynchronous init functions of its class; the boot
+ * only proceeds to the next class when all of them returned. This is
+ * meant for slow, independent initializations that spend most of their
+ * time waiting (e.g., device probing, remote filesystem mounts).
+ * Without libuksched, they are called one after another in dependency
+ * order at the beginning of their class.
+ *
+ * Ordering constraints to other asynchronous init functions are
+ * expressed with a list of their function names: the init function is
+ * not called before all of them returned successfully. Dependencies
+ * must belong to the same or an earlier init class.
+ */
+struct uk_initjob_state {
+	int status;
+	int ret;
+	unsigned int mark;
+	void *thread;
+};
+
+struct uk_initjob {
+	const char *name;
+	uk_init_func_t func;
+	int initclass;
+	unsigned int ndeps;
+	const char * const *deps;
+	struct uk_initjob_state *state;
+};
+
+#define __UK_INITJOB(fn, class, ...)					\
+	static const char * const					\
+	__uk_initjob_deps_ ## fn[] = { NULL, ## __VA_ARGS__ };		\
+	static struct uk_initjob_state __uk_initjob_state_ ## fn;	\
+	static const struct uk_initjob					\
+	__used __section(".uk_initjobs") __align(sizeof(void *))	\
+	__uk_initjob_ ## fn = {						\
+		.name      = STRINGIFY(fn),				\
+		.func      = (fn),					\
+		.initclass = (class),					\
+		.ndeps     = ARRAY_SIZE(__uk_initjob_deps_ ## fn) - 1,	\
+		.deps      = &__uk_initjob_deps_ ## fn[1],		\
+		.state     = &__uk_initjob_state_ ## fn,		\
+	}
+
+/**
+ * Register an asynchronous init function
+ *
+ * @param fn
+ *   Initialization function to be called
+ * @param class
+ *   Initialization class (1 (earliest) to 6 (latest))
+ * @param ...
+ *   Optional list of names (strings) of asynchronous init functions that
+ *   have to complete before `fn` is called
+ */
+#define uk_initcall_class_async(fn, class, ...)				\
+	__UK_INITJOB(fn, class, ## __VA_ARGS__)
+
+#define uk_early_initcall_async(fn, ...)				\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_EARLY, ## __VA_ARGS__)
+#define uk_plat_initcall_async(fn, ...)					\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_PLAT, ## __VA_ARGS__)
+#define uk_lib_initcall_async(fn, ...)					\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_LIB, ## __VA_ARGS__)
+#define uk_rootfs_initcall_async(fn, ...)				\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_ROOTFS, ## __VA_ARGS__)
+#define uk_sys_initcall_async(fn, ...)					\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_SYS, ## __VA_ARGS__)
+#define uk_late_initcall_async(fn, ...)					\
+	uk_initcall_class_async(fn, UK_INIT_CLASS_LATE, ## __VA_ARGS__)
+
+extern const struct uk_initjob uk_initjobs_start[];
+extern const struct uk_initjob uk_initjobs_end;
+
+/**
+ * Helper macro for iterating over the asynchronous init functions
+ *
+ * @param itr
+ *   Iterator variable (const struct uk_initjob *)
+ */
+#define uk_initjobs_foreach(itr)					\
+	for ((itr) = uk_initjobs_start;					\
+	     (itr) < &uk_initjobs_end;					\
+	     (itr)++)
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
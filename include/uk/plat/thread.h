@@ -107,4 +107,35 @@ void ukplat_thread_ctx_switch(struct ukplat_ctx_callbacks *cbs,
 	cbs->switch_cb(prevctx, nextctx);
 }
 
+#if CONFIG_UKPLAT_STACK_GUARD
+/**
+ * Reserves a virtual thread stack region of __STACK_SIZE bytes, aligned
+ * to its size. Only the first page of the region (which holds the thread
+ * pointer) is backed immediately; it is followed by a guard page that is
+ * never mapped. The remaining pages are backed on first access.
+ *
+ * @param allocator
+ *   Allocator used for page tables and stack pages
+ * @return
+ *   Base of the stack region, NULL on failure
+ */
+void *ukplat_stack_alloc(struct uk_alloc *allocator);
+
+/**
+ * Releases a stack region returned by ukplat_stack_alloc() together with
+ * all pages that were backing it.
+ */
+void ukplat_stack_free(struct uk_alloc *allocator, void *stack);
+
+/**
+ * Tops up the pages reserved for growing stacks once they run low. Must be
+ * called from thread context; schedulers call it regularly so that stacks
+ * of long-running threads can keep growing without any thread churn.
+ *
+ * @param allocator
+ *   Allocator used for stack pages
+ */
+void ukplat_stack_reserve_refill(struct uk_alloc *allocator);
+#endif /* CONFIG_UKPLAT_STACK_GUARD */
+
 #endif /* __UKPLAT_THREAD_H__ */
@@ -129,8 +129,8 @@ static inline int uk_refcount_acquire_if_not_zero(__atomic *ref)
 
 	__refcnt_assert(ref != __NULL && ref->counter < __U32_MAX);
 
-	old = ref->counter;
 	for (;;) {
+		old = ukarch_load_n(&ref->counter);
 		if (old == 0)
 			return 0;
 		if (ukarch_compare_exchange_sync(&ref->counter, old, (old + 1))
@@ -167,8 +167,8 @@ static inline int uk_refcount_release_if_not_last(__atomic *ref)
 
 	__refcnt_assert(ref != __NULL);
 
-	old = ref->counter;
 	for (;;) {
+		old = ukarch_load_n(&ref->counter);
 		if (old == 1)
 			return 0;
 		if (ukarch_compare_exchange_sync(&ref->counter, old, (old - 1))
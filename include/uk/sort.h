@@ -0,0 +1,510 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Typed in-place sort generator. The sort is a pattern-defeating
+ * quicksort (pdqsort, after Orson Peters): median-of-3 or ninther pivot
+ * selection, insertion sort for small ranges, detection of already
+ * partitioned input, pattern-breaking swaps on unbalanced partitions and a
+ * heapsort fallback that bounds the worst case to O(n log n). Recursion
+ * always goes into the smaller partition, so stack usage is O(log n).
+ *
+ * This header is a template and may be included any number of times. The
+ * caller defines the parameters below before each inclusion; they are
+ * undefined again at the end:
+ *
+ *   UK_SORT_NAME          Name of the generated function (required)
+ *   UK_SORT_TYPE          Element type (required)
+ *   UK_SORT_LESS(a, b)    Expression that is true if *a sorts before *b;
+ *                         a and b are `const UK_SORT_TYPE *' (required)
+ *   UK_SORT_CTX           Type of an optional context argument that is
+ *                         passed through as `ctx' and can be used by
+ *                         UK_SORT_LESS()
+ *   UK_SORT_BRANCHLESS    Use block partitioning (comparisons are recorded
+ *                         in offset buffers instead of branched on); only
+ *                         a win when UK_SORT_LESS() is cheap and inlined
+ *
+ * The generated function has the signature
+ *
+ *   static void UK_SORT_NAME(UK_SORT_TYPE *base, size_t n
+ *                            [, UK_SORT_CTX ctx]);
+ *
+ * Example:
+ *
+ *   #define UK_SORT_NAME            sort_u32
+ *   #define UK_SORT_TYPE            __u32
+ *   #define UK_SORT_LESS(a, b)      (*(a) < *(b))
+ *   #define UK_SORT_BRANCHLESS
+ *   #include <uk/sort.h>
+ */
+
+#include <stddef.h>
+#include <uk/essentials.h>
+
+#ifndef UK_SORT_NAME
+#error "UK_SORT_NAME must be defined before including uk/sort.h"
+#endif
+#ifndef UK_SORT_TYPE
+#error "UK_SORT_TYPE must be defined before including uk/sort.h"
+#endif
+#ifndef UK_SORT_LESS
+#error "UK_SORT_LESS must be defined before including uk/sort.h"
+#endif
+
+#ifndef __UK_SORT_CONSTANTS
+#define __UK_SORT_CONSTANTS
+/* Ranges below this size are insertion sorted */
+#define __UK_SORT_INSERTION_THRESHOLD	24
+/* Ranges above this size use the ninther for pivot selection */
+#define __UK_SORT_NINTHER_THRESHOLD	128
+/* Give up on a partial insertion sort after this many element moves */
+#define __UK_SORT_PARTIAL_LIMIT		8
+/* Number of elements classified per block in branchless partitioning */
+#define __UK_SORT_BLOCK			64
+#endif /* __UK_SORT_CONSTANTS */
+
+#define __UKS_FN(f)	UK_CONCAT(UK_CONCAT(UK_SORT_NAME, __), f)
+#define __UKS_T		__UKS_FN(elem_t)
+#define __UKS_LT(a, b)	(UK_SORT_LESS((const __UKS_T *)(a), \
+				      (const __UKS_T *)(b)))
+#ifdef UK_SORT_CTX
+#define __UKS_CTXP	, UK_SORT_CTX ctx
+#define __UKS_CTXA	, ctx
+#else
+#define __UKS_CTXP
+#define __UKS_CTXA
+#endif
+
+typedef UK_SORT_TYPE __UKS_T;
+
+static inline void __UKS_FN(swap)(__UKS_T *a, __UKS_T *b)
+{
+	__UKS_T t = *a;
+
+	*a = *b;
+	*b = t;
+}
+
+static inline void __UKS_FN(sort2)(__UKS_T *a, __UKS_T *b __UKS_CTXP)
+{
+	if (__UKS_LT(b, a))
+		__UKS_FN(swap)(a, b);
+}
+
+static inline void __UKS_FN(sort3)(__UKS_T *a, __UKS_T *b, __UKS_T *c
+				   __UKS_CTXP)
+{
+	__UKS_FN(sort2)(a, b __UKS_CTXA);
+	__UKS_FN(sort2)(b, c __UKS_CTXA);
+	__UKS_FN(sort2)(a, b __UKS_CTXA);
+}
+
+/*
+ * Insertion sort of [begin, end). When `guarded' is zero, the element
+ * before begin must not be greater than any element in the range so that
+ * the bounds check can be dropped from the inner loop.
+ */
+static inline void __UKS_FN(insertion)(__UKS_T *begin, __UKS_T *end,
+				       int guarded __UKS_CTXP)
+{
+	__UKS_T *cur, *sift;
+	__UKS_T tmp;
+
+	if (begin == end)
+		return;
+
+	for (cur = begin + 1; cur != end; ++cur) {
+		sift = cur;
+		if (!__UKS_LT(sift, sift - 1))
+			continue;
+
+		tmp = *sift;
+		do {
+			*sift = *(sift - 1);
+			--sift;
+		} while ((!guarded || sift != begin)
+			 && __UKS_LT(&tmp, sift - 1));
+		*sift = tmp;
+	}
+}
+
+/*
+ * Like insertion() but gives up after __UK_SORT_PARTIAL_LIMIT moves.
+ * Returns 1 if the range ended up sorted.
+ */
+static inline int __UKS_FN(partial_insertion)(__UKS_T *begin, __UKS_T *end
+					      __UKS_CTXP)
+{
+	__UKS_T *cur, *sift;
+	__UKS_T tmp;
+	size_t moves = 0;
+
+	if (begin == end)
+		return 1;
+
+	for (cur = begin + 1; cur != end; ++cur) {
+		sift = cur;
+		if (!__UKS_LT(sift, sift - 1))
+			continue;
+
+		tmp = *sift;
+		do {
+			*sift = *(sift - 1);
+			--sift;
+		} while (sift != begin && __UKS_LT(&tmp, sift - 1));
+		*sift = tmp;
+
+		moves += (size_t)(cur - sift);
+		if (moves > __UK_SORT_PARTIAL_LIMIT)
+			return 0;
+	}
+	return 1;
+}
+
+static __maybe_unused void __UKS_FN(heapsort)(__UKS_T *base, size_t n
+					      __UKS_CTXP)
+{
+	size_t start, end, root, child;
+
+	if (n < 2)
+		return;
+
+	start = n / 2;
+	end = n;
+	while (end > 1) {
+		if (start > 0) {
+			/* Heap construction */
+			--start;
+		} else {
+			/* Move the maximum behind the heap */
+			--end;
+			__UKS_FN(swap)(&base[0], &base[end]);
+		}
+
+		root = start;
+		while ((child = 2 * root + 1) < end) {
+			if (child + 1 < end
+			    && __UKS_LT(&base[child], &base[child + 1]))
+				++child;
+			if (!__UKS_LT(&base[root], &base[child]))
+				break;
+			__UKS_FN(swap)(&base[root], &base[child]);
+			root = child;
+		}
+	}
+}
+
+/*
+ * Partitions [begin, end) around the pivot at *begin. Elements equal to
+ * the pivot go to the right. Returns the final pivot position and sets
+ * `*sorted' if no elements had to be moved.
+ */
+static __maybe_unused __UKS_T *
+__UKS_FN(partition_right)(__UKS_T *begin, __UKS_T *end, int *sorted
+			  __UKS_CTXP)
+{
+	__UKS_T pivot = *begin;
+	__UKS_T *first = begin;
+	__UKS_T *last = end;
+	__UKS_T *pivot_pos;
+
+	/* The median-of-3 guarantees that these loops terminate */
+	while (__UKS_LT(++first, &pivot))
+		;
+	if (first - 1 == begin)
+		while (first < last && !__UKS_LT(--last, &pivot))
+			;
+	else
+		while (!__UKS_LT(--last, &pivot))
+			;
+
+	*sorted = first >= last;
+
+#ifdef UK_SORT_BRANCHLESS
+	if (first < last) {
+		unsigned char offsets_l[__UK_SORT_BLOCK];
+		unsigned char offsets_r[__UK_SORT_BLOCK];
+		__UKS_T *base_l, *base_r, *l, *r;
+		size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+		size_t unknown, split_l, split_r, num, i;
+
+		__UKS_FN(swap)(first, last);
+		++first;
+
+		base_l = first;
+		base_r = last;
+		while (first < last) {
+			/*
+			 * Classify up to a block of elements on each side
+			 * whose offset buffer is empty. The comparison result
+			 * only advances the fill level, there is no branch.
+			 */
+			unknown = (size_t)(last - first);
+			split_l = num_l ? 0 : (num_r ? unknown : unknown / 2);
+			split_r = num_r ? 0 : unknown - split_l;
+			split_l = MIN(split_l, (size_t)__UK_SORT_BLOCK);
+			split_r = MIN(split_r, (size_t)__UK_SORT_BLOCK);
+
+			for (i = 0; i < split_l; ++i) {
+				offsets_l[num_l] = (unsigned char)i;
+				num_l += !__UKS_LT(first, &pivot);
+				++first;
+			}
+			for (i = 0; i < split_r; ++i) {
+				offsets_r[num_r] = (unsigned char)(i + 1);
+				num_r += __UKS_LT(--last, &pivot);
+			}
+
+			/* Swap misplaced pairs, using a cyclic permutation
+			 * when the counts differ
+			 */
+			num = MIN(num_l, num_r);
+			if (num_l == num_r) {
+				for (i = 0; i < num; ++i)
+					__UKS_FN(swap)(
+						base_l + offsets_l[start_l + i],
+						base_r - offsets_r[start_r + i]);
+			} else if (num > 0) {
+				__UKS_T tmp;
+
+				l = base_l + offsets_l[start_l];
+				r = base_r - offsets_r[start_r];
+				tmp = *l;
+				*l = *r;
+				for (i = 1; i < num; ++i) {
+					l = base_l + offsets_l[start_l + i];
+					*r = *l;
+					r = base_r - offsets_r[start_r + i];
+					*l = *r;
+				}
+				*r = tmp;
+			}
+			num_l -= num;
+			num_r -= num;
+			start_l += num;
+			start_r += num;
+
+			if (num_l == 0) {
+				start_l = 0;
+				base_l = first;
+			}
+			if (num_r == 0) {
+				start_r = 0;
+				base_r = last;
+			}
+		}
+
+		/* At most one side has leftover misplaced elements */
+		if (num_l) {
+			while (num_l--)
+				__UKS_FN(swap)(base_l
+					       + offsets_l[start_l + num_l],
+					       --last);
+			first = last;
+		}
+		if (num_r) {
+			while (num_r--) {
+				__UKS_FN(swap)(base_r
+					       - offsets_r[start_r + num_r],
+					       first);
+				++first;
+			}
+		}
+	}
+#else /* !UK_SORT_BRANCHLESS */
+	while (first < last) {
+		__UKS_FN(swap)(first, last);
+		while (__UKS_LT(++first, &pivot))
+			;
+		while (!__UKS_LT(--last, &pivot))
+			;
+	}
+#endif /* !UK_SORT_BRANCHLESS */
+
+	pivot_pos = first - 1;
+	*begin = *pivot_pos;
+	*pivot_pos = pivot;
+	return pivot_pos;
+}
+
+/*
+ * Partitions [begin, end) around the pivot at *begin, putting elements
+ * equal to the pivot to the left. Used when the pivot equals the element
+ * preceding the range, in which case the left side needs no more sorting.
+ */
+static __maybe_unused __UKS_T *
+__UKS_FN(partition_left)(__UKS_T *begin, __UKS_T *end __UKS_CTXP)
+{
+	__UKS_T pivot = *begin;
+	__UKS_T *first = begin;
+	__UKS_T *last = end;
+
+	while (__UKS_LT(&pivot, --last))
+		;
+	if (last + 1 == end)
+		while (first < last && !__UKS_LT(&pivot, ++first))
+			;
+	else
+		while (!__UKS_LT(&pivot, ++first))
+			;
+
+	while (first < last) {
+		__UKS_FN(swap)(first, last);
+		while (__UKS_LT(&pivot, --last))
+			;
+		while (!__UKS_LT(&pivot, ++first))
+			;
+	}
+
+	*begin = *last;
+	*last = pivot;
+	return last;
+}
+
+/* Exchanges a few elements to break up patterns that caused a bad pivot */
+static inline void __UKS_FN(shuffle)(__UKS_T *begin, __UKS_T *end)
+{
+	size_t n = (size_t)(end - begin);
+	size_t q = n / 4;
+
+	if (n < __UK_SORT_INSERTION_THRESHOLD)
+		return;
+
+	__UKS_FN(swap)(begin, begin + q);
+	__UKS_FN(swap)(end - 1, end - q);
+	if (n > __UK_SORT_NINTHER_THRESHOLD) {
+		__UKS_FN(swap)(begin + 1, begin + (q + 1));
+		__UKS_FN(swap)(begin + 2, begin + (q + 2));
+		__UKS_FN(swap)(end - 2, end - (q + 1));
+		__UKS_FN(swap)(end - 3, end - (q + 2));
+	}
+}
+
+static __maybe_unused void __UKS_FN(loop)(__UKS_T *begin, __UKS_T *end,
+					  int bad_allowed, int leftmost
+					  __UKS_CTXP)
+{
+	__UKS_T *pivot_pos;
+	size_t size, half, l_size, r_size;
+	int sorted;
+
+	for (;;) {
+		size = (size_t)(end - begin);
+		if (size < __UK_SORT_INSERTION_THRESHOLD) {
+			__UKS_FN(insertion)(begin, end, leftmost __UKS_CTXA);
+			return;
+		}
+
+		/* Move the pivot candidate to *begin */
+		half = size / 2;
+		if (size > __UK_SORT_NINTHER_THRESHOLD) {
+			__UKS_FN(sort3)(begin, begin + half, end - 1
+					__UKS_CTXA);
+			__UKS_FN(sort3)(begin + 1, begin + (half - 1), end - 2
+					__UKS_CTXA);
+			__UKS_FN(sort3)(begin + 2, begin + (half + 1), end - 3
+					__UKS_CTXA);
+			__UKS_FN(sort3)(begin + (half - 1), begin + half,
+					begin + (half + 1) __UKS_CTXA);
+			__UKS_FN(swap)(begin, begin + half);
+		} else {
+			__UKS_FN(sort3)(begin + half, begin, end - 1
+					__UKS_CTXA);
+		}
+
+		/*
+		 * If the pivot equals the element before this range, all
+		 * elements equal to it can be skipped in one go. This keeps
+		 * inputs with many duplicates linear.
+		 */
+		if (!leftmost && !__UKS_LT(begin - 1, begin)) {
+			begin = __UKS_FN(partition_left)(begin, end
+							 __UKS_CTXA) + 1;
+			continue;
+		}
+
+		pivot_pos = __UKS_FN(partition_right)(begin, end, &sorted
+						      __UKS_CTXA);
+		l_size = (size_t)(pivot_pos - begin);
+		r_size = (size_t)(end - (pivot_pos + 1));
+
+		if (l_size < size / 8 || r_size < size / 8) {
+			/* Too many bad pivots: switch to heapsort */
+			if (--bad_allowed == 0) {
+				__UKS_FN(heapsort)(begin, size __UKS_CTXA);
+				return;
+			}
+			__UKS_FN(shuffle)(begin, pivot_pos);
+			__UKS_FN(shuffle)(pivot_pos + 1, end);
+		} else if (sorted
+			   && __UKS_FN(partial_insertion)(begin, pivot_pos
+							  __UKS_CTXA)
+			   && __UKS_FN(partial_insertion)(pivot_pos + 1, end
+							  __UKS_CTXA)) {
+			/* Input was (nearly) sorted already */
+			return;
+		}
+
+		/* Recurse into the smaller side, loop on the larger one */
+		if (l_size < r_size) {
+			__UKS_FN(loop)(begin, pivot_pos, bad_allowed, leftmost
+				       __UKS_CTXA);
+			begin = pivot_pos + 1;
+			leftmost = 0;
+		} else {
+			__UKS_FN(loop)(pivot_pos + 1, end, bad_allowed, 0
+				       __UKS_CTXA);
+			end = pivot_pos;
+		}
+	}
+}
+
+static __maybe_unused void UK_SORT_NAME(__UKS_T *base, size_t n __UKS_CTXP)
+{
+	int log2n = 0;
+
+	while (n >> log2n > 1)
+		++log2n;
+
+	if (n > 1)
+		__UKS_FN(loop)(base, base + n, log2n, 1 __UKS_CTXA);
+}
+
+#undef __UKS_CTXA
+#undef __UKS_CTXP
+#undef __UKS_LT
+#undef __UKS_T
+#undef __UKS_FN
+
+#undef UK_SORT_BRANCHLESS
+#undef UK_SORT_CTX
+#undef UK_SORT_LESS
+#undef UK_SORT_TYPE
+#undef UK_SORT_NAME
@@ -34,16 +34,20 @@
 #define __UK_9PFS__
 
 #include <stdbool.h>
+#include <uk/arch/time.h>
+#include <uk/list.h>
 #include <uk/9pdev.h>
 #include <uk/9pfid.h>
 
 #include <vfscore/prex.h>
 
 /*
- * Currently supports only the 9P2000.u variant of the protocol.
+ * Supported variants of the protocol. 9P2000.L is preferred and 9P2000.u is
+ * used if the server does not offer it.
  */
 enum uk_9pfs_proto {
 	UK_9P_PROTO_2000U,
+	UK_9P_PROTO_2000L,
 	UK_9P_PROTO_MAX
 };
 
@@ -58,6 +62,8 @@ struct uk_9pfs_mount_data {
 	const char		*uname;
 	/* File tree to access when offered multiple exported filesystems. */
 	const char		*aname;
+	/* Lifetime of cached attributes and lookups, 0 disables caching. */
+	__nsec			ttl;
 };
 
 struct uk_9pfs_file_data {
@@ -69,8 +75,8 @@ struct uk_9pfs_file_data {
 	 */
 	char                   *readdir_buf;
 	/*
-	 * Offset within the buffer where the stat of the next child can
-	 * be found.
+	 * Offset within the buffer where the stat (9P2000.u) or the directory
+	 * entry (9P2000.L) of the next child can be found.
 	 */
 	int                    readdir_off;
 	/* Total size of the data in the readdir buf. */
@@ -84,17 +90,45 @@ struct uk_9pfs_node_data {
 	int                    nb_open_files;
 	/* Is a 9P remove call required when nb_open_files reaches 0? */
 	bool                   removed;
+	/* Cached attributes of the node, valid until attr_expiry. */
+	struct uk_9p_attr      attr;
+	__nsec                 attr_expiry;
+	/* Cached lookups in this directory, most recently used first. */
+	struct uk_list_head    dcache;
+	int                    dcache_n;
+};
+
+/*
+ * Result of a lookup in a directory, valid until expiry. Positive entries
+ * hold a reference to the vnode that was found, so that a later lookup of
+ * the same name needs no round trip to the host.
+ */
+struct uk_9pfs_dcache_entry {
+	struct uk_list_head    link;
+	__nsec                 expiry;
+	/* Vnode found under this name, NULL if the name does not exist. */
+	struct vnode           *vp;
+	size_t                 len;
+	char                   name[];
 };
 
 int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid);
 void uk_9pfs_free_vnode_data(struct vnode *vp);
+void uk_9pfs_dcache_purge(struct vnode *dvp, bool recursive);
 
 /* Default readdir buffer size. */
 #define UK_9PFS_READDIR_BUFSZ	8192
 
+/* Maximum number of in-flight 9P requests for a single read or write. */
+#define UK_9PFS_IO_MAXINFLIGHT	CONFIG_LIB9PFS_IO_MAXINFLIGHT
+
+/* Maximum number of cached lookups per directory. */
+#define UK_9PFS_DCACHE_SIZE	CONFIG_LIB9PFS_DCACHE_SIZE
+
 #define UK_9PFS_FD(file) ((struct uk_9pfs_file_data *) (file)->f_data)
 #define UK_9PFS_ND(vnode) ((struct uk_9pfs_node_data *) (vnode)->v_data)
 #define UK_9PFS_VFID(vnode) (UK_9PFS_ND(vnode)->fid)
 #define UK_9PFS_MD(mount) ((struct uk_9pfs_mount_data *) (mount)->m_data)
+#define UK_9PFS_DOTL(mount) (UK_9PFS_MD(mount)->proto == UK_9P_PROTO_2000L)
 
 #endif /* __UK_9PFS__ */
@@ -30,6 +30,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include <uk/config.h>
 #include <uk/errptr.h>
 #include <uk/9p.h>
@@ -68,23 +70,45 @@ static struct vfscore_fs_type uk_9pfs_fs = {
 UK_FS_REGISTER(uk_9pfs_fs);
 
 static const char *uk_9pfs_proto_str[UK_9P_PROTO_MAX] = {
-	[UK_9P_PROTO_2000U] = "9P2000.u"
+	[UK_9P_PROTO_2000U] = "9P2000.u",
+	[UK_9P_PROTO_2000L] = "9P2000.L"
 };
 
+/*
+ * Mount options are a comma-separated list. Options that are not known here
+ * are left to the transport, which receives the same string.
+ */
 static int uk_9pfs_parse_options(struct uk_9pfs_mount_data *md,
-		const void *data __unused)
+		const void *data)
 {
+	const char *opt = data;
+	unsigned long ttl = CONFIG_LIB9PFS_CACHE_TTL;
+	char *end;
 	int rc = 0;
 
 	md->trans = uk_9pdev_trans_get_default();
 	if (!md->trans)
 		goto out;
 
-	/* Currently, no options are supported. */
+	while (opt && *opt) {
+		if (!strncmp(opt, "ttl=", 4)) {
+			ttl = strtoul(opt + 4, &end, 10);
+			if (end == opt + 4 || (*end != '\0' && *end != ',')) {
+				uk_pr_err("Invalid 9pfs cache ttl: %s\n", opt);
+				rc = EINVAL;
+				goto out;
+			}
+		}
+
+		opt = strchr(opt, ',');
+		if (opt)
+			opt++;
+	}
 
-	md->proto = UK_9P_PROTO_2000U;
+	md->proto = UK_9P_PROTO_2000L;
 	md->uname = "";
 	md->aname = "";
+	md->ttl = ukarch_time_msec_to_nsec((__nsec) ttl);
 
 out:
 	return rc;
@@ -121,17 +145,31 @@ static int uk_9pfs_mount(struct mount *mp, const char *dev,
 		goto out_free_mdata;
 	}
 
-	/* Create a new 9pfs session via a VERSION message. */
-	version_req = uk_9p_version(md->dev, uk_9pfs_proto_str[md->proto],
-			&rcvd_version);
-	if (PTRISERR(version_req)) {
-		rc = -PTR2ERR(version_req);
-		goto out_disconnect;
-	}
+	/*
+	 * Create a new 9pfs session via a VERSION message. If the server does
+	 * not offer 9P2000.L, it replies with another version (or "unknown"),
+	 * in which case a new session is attempted with 9P2000.u.
+	 */
+	for (;;) {
+		version_req = uk_9p_version(md->dev,
+				uk_9pfs_proto_str[md->proto], &rcvd_version);
+		if (PTRISERR(version_req)) {
+			rc = -PTR2ERR(version_req);
+			goto out_disconnect;
+		}
+
+		version_accepted = uk_9p_str_equal(&rcvd_version,
+				uk_9pfs_proto_str[md->proto]);
+		uk_9pdev_req_remove(md->dev, version_req);
 
-	version_accepted = uk_9p_str_equal(&rcvd_version,
-			uk_9pfs_proto_str[md->proto]);
-	uk_9pdev_req_remove(md->dev, version_req);
+		if (version_accepted || md->proto != UK_9P_PROTO_2000L)
+			break;
+
+		uk_pr_info("Server does not offer %s, falling back to %s\n",
+				uk_9pfs_proto_str[UK_9P_PROTO_2000L],
+				uk_9pfs_proto_str[UK_9P_PROTO_2000U]);
+		md->proto = UK_9P_PROTO_2000U;
+	}
 
 	if (!version_accepted) {
 		rc = EIO;
@@ -177,6 +215,9 @@ static int uk_9pfs_unmount(struct mount *mp, int flags __unused)
 {
 	struct uk_9pfs_mount_data *md = UK_9PFS_MD(mp);
 
+	/* Cached lookups hold vnodes (and their fids) alive. */
+	if (mp->m_root->d_vnode->v_data)
+		uk_9pfs_dcache_purge(mp->m_root->d_vnode, true);
 	uk_9pfs_release_tree_fids(mp->m_root);
 	vfscore_release_mp_dentries(mp);
 	uk_9pdev_disconnect(md->dev);
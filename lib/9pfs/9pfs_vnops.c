@@ -37,6 +37,7 @@
 #include <uk/config.h>
 #include <uk/9p.h>
 #include <uk/errptr.h>
+#include <uk/plat/time.h>
 #include <vfscore/mount.h>
 #include <vfscore/dentry.h>
 #include <vfscore/vnode.h>
@@ -65,6 +66,26 @@ static uint32_t uk_9pfs_open_mode_from_posix_flags(int flags)
 	return mode;
 }
 
+static uint32_t uk_9pfs_dotl_flags_from_posix_flags(int flags)
+{
+	uint32_t res = 0;
+	uint32_t flags_rw = flags & (UK_FREAD | UK_FWRITE);
+
+	if (flags_rw == UK_FREAD)
+		res = UK_9P_DOTL_RDONLY;
+	else if (flags_rw == UK_FWRITE)
+		res = UK_9P_DOTL_WRONLY;
+	else if (flags_rw == (UK_FREAD | UK_FWRITE))
+		res = UK_9P_DOTL_RDWR;
+
+	if (flags & O_TRUNC)
+		res |= UK_9P_DOTL_TRUNC;
+	if (flags & O_DSYNC)
+		res |= UK_9P_DOTL_DSYNC;
+
+	return res;
+}
+
 static int uk_9pfs_posix_perm_from_mode(int mode)
 {
 	int res;
@@ -112,11 +133,24 @@ static int uk_9pfs_posix_mode_from_mode(int mode)
 	return res;
 }
 
-static int uk_9pfs_vtype_from_mode(int mode)
+static int uk_9pfs_vtype_from_posix_mode(mode_t mode)
 {
-	if (mode & UK_9P_DMDIR)
+	switch (mode & S_IFMT) {
+	case S_IFDIR:
 		return VDIR;
-	return VREG;
+	case S_IFLNK:
+		return VLNK;
+	case S_IFCHR:
+		return VCHR;
+	case S_IFBLK:
+		return VBLK;
+	case S_IFIFO:
+		return VFIFO;
+	case S_IFSOCK:
+		return VSOCK;
+	default:
+		return VREG;
+	}
 }
 
 static uint64_t uk_9pfs_ino(struct uk_9p_stat *stat)
@@ -124,6 +158,201 @@ static uint64_t uk_9pfs_ino(struct uk_9p_stat *stat)
 	return stat->qid.path;
 }
 
+/*
+ * Fetches the attributes of a fid, independently of the protocol variant in
+ * use: 9P2000.L uses Tgetattr, whose reply has a fixed layout, while
+ * 9P2000.u uses Tstat.
+ */
+static int uk_9pfs_fetch_attr(struct mount *mp, struct uk_9pfid *fid,
+		struct uk_9p_attr *attr)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(mp)->dev;
+	struct uk_9p_stat stat;
+	struct uk_9preq *stat_req;
+
+	if (UK_9PFS_DOTL(mp))
+		return uk_9p_getattr(dev, fid, UK_9P_GETATTR_BASIC, attr);
+
+	stat_req = uk_9p_stat(dev, fid, &stat);
+	if (PTRISERR(stat_req))
+		return PTR2ERR(stat_req);
+
+	/* No stat string fields are used below. */
+	uk_9pdev_req_remove(dev, stat_req);
+
+	memset(attr, 0, sizeof(*attr));
+	attr->valid = UK_9P_GETATTR_MODE | UK_9P_GETATTR_ATIME |
+		UK_9P_GETATTR_MTIME | UK_9P_GETATTR_INO | UK_9P_GETATTR_SIZE;
+	attr->qid = stat.qid;
+	attr->mode = uk_9pfs_posix_mode_from_mode(stat.mode);
+	attr->size = stat.length;
+	attr->atime_sec = stat.atime;
+	attr->mtime_sec = stat.mtime;
+
+	return 0;
+}
+
+/*
+ * Attribute and lookup caches. Both are disabled if the mount has no ttl.
+ * Entries expire after the ttl, and operations done through this mount drop
+ * the entries they make stale. The vnode (or, for lookups, the directory
+ * vnode) must be locked.
+ */
+static inline __nsec uk_9pfs_ttl(struct vnode *vp)
+{
+	return UK_9PFS_MD(vp->v_mount)->ttl;
+}
+
+static bool uk_9pfs_attr_cached(struct vnode *vp)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(vp);
+
+	return nd->attr_expiry && ukplat_monotonic_clock() < nd->attr_expiry;
+}
+
+static void uk_9pfs_attr_cache_set(struct vnode *vp,
+		const struct uk_9p_attr *attr)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(vp);
+
+	if (!uk_9pfs_ttl(vp))
+		return;
+
+	nd->attr = *attr;
+	nd->attr_expiry = ukplat_monotonic_clock() + uk_9pfs_ttl(vp);
+
+	/* Cached vnodes live longer, keep them in sync with the host. */
+	vp->v_mode = attr->mode;
+	vp->v_size = attr->size;
+}
+
+static void uk_9pfs_attr_invalidate(struct vnode *vp)
+{
+	UK_9PFS_ND(vp)->attr_expiry = 0;
+}
+
+static void uk_9pfs_dcache_drop(struct uk_9pfs_node_data *nd,
+		struct uk_9pfs_dcache_entry *de, bool recursive)
+{
+	uk_list_del(&de->link);
+	nd->dcache_n--;
+
+	if (de->vp) {
+		if (recursive && de->vp->v_data)
+			uk_9pfs_dcache_purge(de->vp, true);
+		vrele(de->vp);
+	}
+	free(de);
+}
+
+/*
+ * Drop all cached lookups of a directory. If recursive, also those of the
+ * directories found through them.
+ */
+void uk_9pfs_dcache_purge(struct vnode *dvp, bool recursive)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(dvp);
+	struct uk_9pfs_dcache_entry *de, *den;
+
+	uk_list_for_each_entry_safe(de, den, &nd->dcache, link)
+		uk_9pfs_dcache_drop(nd, de, recursive);
+}
+
+/*
+ * Drop the expired entries of a directory, so that they do not keep their
+ * vnodes and fids alive.
+ */
+static void uk_9pfs_dcache_expire(struct uk_9pfs_node_data *nd)
+{
+	struct uk_9pfs_dcache_entry *de, *den;
+	__nsec now = ukplat_monotonic_clock();
+
+	uk_list_for_each_entry_safe(de, den, &nd->dcache, link) {
+		if (now >= de->expiry)
+			uk_9pfs_dcache_drop(nd, de, false);
+	}
+}
+
+static struct uk_9pfs_dcache_entry *
+uk_9pfs_dcache_find(struct vnode *dvp, const char *name)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(dvp);
+	struct uk_9pfs_dcache_entry *de;
+	size_t len;
+
+	if (!nd->dcache_n)
+		return NULL;
+
+	uk_9pfs_dcache_expire(nd);
+	len = strlen(name);
+	uk_list_for_each_entry(de, &nd->dcache, link) {
+		if (de->len != len || memcmp(de->name, name, len))
+			continue;
+
+		/* Keep recently used entries at the head. */
+		uk_list_del(&de->link);
+		uk_list_add(&de->link, &nd->dcache);
+		return de;
+	}
+
+	return NULL;
+}
+
+static void uk_9pfs_dcache_forget(struct vnode *dvp, const char *name)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(dvp);
+	struct uk_9pfs_dcache_entry *de;
+	size_t len;
+
+	if (!nd->dcache_n)
+		return;
+
+	len = strlen(name);
+	uk_list_for_each_entry(de, &nd->dcache, link) {
+		if (de->len == len && !memcmp(de->name, name, len)) {
+			uk_9pfs_dcache_drop(nd, de, false);
+			return;
+		}
+	}
+}
+
+/* Remember the result of a lookup, vp is NULL if the name does not exist. */
+static void uk_9pfs_dcache_enter(struct vnode *dvp, const char *name,
+		struct vnode *vp)
+{
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(dvp);
+	struct uk_9pfs_dcache_entry *de;
+	size_t len = strlen(name);
+
+	if (!uk_9pfs_ttl(dvp) || UK_9PFS_DCACHE_SIZE <= 0)
+		return;
+	/* Caching the parent in its child would keep both alive forever. */
+	if (!strcmp(name, ".") || !strcmp(name, ".."))
+		return;
+
+	uk_9pfs_dcache_expire(nd);
+	uk_9pfs_dcache_forget(dvp, name);
+	if (nd->dcache_n >= UK_9PFS_DCACHE_SIZE) {
+		/* Recycle the least recently used entry. */
+		de = uk_list_last_entry(&nd->dcache,
+				struct uk_9pfs_dcache_entry, link);
+		uk_9pfs_dcache_drop(nd, de, false);
+	}
+
+	de = malloc(sizeof(*de) + len);
+	if (!de)
+		return;
+
+	de->expiry = ukplat_monotonic_clock() + uk_9pfs_ttl(dvp);
+	de->vp = vp;
+	if (vp)
+		vref(vp);
+	de->len = len;
+	memcpy(de->name, name, len);
+	uk_list_add(&de->link, &nd->dcache);
+	nd->dcache_n++;
+}
+
 int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid)
 {
 	struct uk_9pfs_node_data *nd;
@@ -135,6 +364,9 @@ int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid)
 	nd->fid = fid;
 	nd->nb_open_files = 0;
 	nd->removed = false;
+	nd->attr_expiry = 0;
+	UK_INIT_LIST_HEAD(&nd->dcache);
+	nd->dcache_n = 0;
 	vp->v_data = nd;
 
 	return 0;
@@ -148,6 +380,8 @@ void uk_9pfs_free_vnode_data(struct vnode *vp)
 	if (!vp->v_data)
 		return;
 
+	uk_9pfs_dcache_purge(vp, false);
+
 	if (nd->removed)
 		uk_9p_remove(dev, nd->fid);
 
@@ -177,8 +411,12 @@ static int uk_9pfs_open(struct vfscore_file *file)
 	}
 
 	/* Open cloned fid. */
-	rc = uk_9p_open(dev, openedfid,
-		uk_9pfs_open_mode_from_posix_flags(file->f_flags));
+	if (UK_9PFS_DOTL(file->f_dentry->d_mount))
+		rc = uk_9p_lopen(dev, openedfid,
+			uk_9pfs_dotl_flags_from_posix_flags(file->f_flags));
+	else
+		rc = uk_9p_open(dev, openedfid,
+			uk_9pfs_open_mode_from_posix_flags(file->f_flags));
 
 	if (rc)
 		goto out_err;
@@ -214,37 +452,48 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(dvp->v_mount)->dev;
 	struct uk_9pfid *dfid = UK_9PFS_VFID(dvp);
+	struct uk_9pfs_dcache_entry *de;
 	struct uk_9pfid *fid;
-	struct uk_9p_stat stat;
-	struct uk_9preq *stat_req;
+	struct uk_9p_attr attr;
 	struct vnode *vp;
 	int rc;
 
 	if (strlen(name) > NAME_MAX)
 		return ENAMETOOLONG;
 
+	de = uk_9pfs_dcache_find(dvp, name);
+	if (de) {
+		if (!de->vp)
+			return ENOENT;
+
+		vp = de->vp;
+		vref(vp);
+		vn_lock(vp);
+		*vpp = vp;
+		return 0;
+	}
+
 	fid = uk_9p_walk(dev, dfid, name);
 	if (PTRISERR(fid)) {
 		rc = PTR2ERR(fid);
+		if (rc == -ENOENT)
+			uk_9pfs_dcache_enter(dvp, name, NULL);
 		goto out;
 	}
 
-	stat_req = uk_9p_stat(dev, fid, &stat);
-	if (PTRISERR(stat_req)) {
-		rc = PTR2ERR(stat_req);
+	rc = uk_9pfs_fetch_attr(dvp->v_mount, fid, &attr);
+	if (rc)
 		goto out_fid;
-	}
 
-	/* No stat string fields are used below. */
-	uk_9pdev_req_remove(dev, stat_req);
-
-	if (vfscore_vget(dvp->v_mount, uk_9pfs_ino(&stat), &vp)) {
+	if (vfscore_vget(dvp->v_mount, attr.qid.path, &vp)) {
 		/* Already in cache. */
 		rc = 0;
 		*vpp = vp;
 		/* if the vnode already has node data, it may be reused. */
-		if (vp->v_data)
-			goto out_fid;
+		if (vp->v_data) {
+			uk_9pfid_put(fid);
+			goto out_cache;
+		}
 	}
 
 	if (!vp) {
@@ -253,9 +502,9 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 	}
 
 	vp->v_flags = 0;
-	vp->v_mode = uk_9pfs_posix_mode_from_mode(stat.mode);
-	vp->v_type = uk_9pfs_vtype_from_mode(stat.mode);
-	vp->v_size = stat.length;
+	vp->v_mode = attr.mode;
+	vp->v_type = uk_9pfs_vtype_from_posix_mode(attr.mode);
+	vp->v_size = attr.size;
 
 	rc = uk_9pfs_allocate_vnode_data(vp, fid);
 	if (rc != 0)
@@ -263,6 +512,9 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 
 	*vpp = vp;
 
+out_cache:
+	uk_9pfs_attr_cache_set(vp, &attr);
+	uk_9pfs_dcache_enter(dvp, name, vp);
 	return 0;
 
 out_fid:
@@ -288,11 +540,26 @@ static int uk_9pfs_create_generic(struct vnode *dvp, char *name, mode_t mode)
 	if (strlen(name) > NAME_MAX)
 		return ENAMETOOLONG;
 
+	uk_9pfs_dcache_forget(dvp, name);
+	uk_9pfs_attr_invalidate(dvp);
+
+	if (UK_9PFS_DOTL(dvp->v_mount) && S_ISDIR(mode))
+		return -uk_9p_mkdir(dev, UK_9PFS_VFID(dvp), name, mode & 07777,
+				0, NULL);
+
 	/* Clone parent fid. */
 	fid = uk_9p_walk(dev, UK_9PFS_VFID(dvp), NULL);
+	if (PTRISERR(fid))
+		return -PTR2ERR(fid);
 
-	rc = uk_9p_create(dev, fid, name, uk_9pfs_perm_from_posix_mode(mode),
-			UK_9P_OTRUNC | UK_9P_OWRITE, NULL);
+	if (UK_9PFS_DOTL(dvp->v_mount))
+		rc = uk_9p_lcreate(dev, fid, name,
+				UK_9P_DOTL_CREATE | UK_9P_DOTL_TRUNC |
+				UK_9P_DOTL_WRONLY, mode & 07777, 0);
+	else
+		rc = uk_9p_create(dev, fid, name,
+				uk_9pfs_perm_from_posix_mode(mode),
+				UK_9P_OTRUNC | UK_9P_OWRITE, NULL);
 
 	uk_9pfid_put(fid);
 	return -rc;
@@ -314,12 +581,24 @@ static int uk_9pfs_remove_generic(struct vnode *dvp, struct vnode *vp)
 	return -uk_9p_remove(dev, nd->fid);
 }
 
+/* Drops what the removal of vp (named name in dvp) makes stale. */
+static void uk_9pfs_remove_invalidate(struct vnode *dvp, struct vnode *vp,
+		const char *name)
+{
+	uk_9pfs_dcache_purge(vp, false);
+	uk_9pfs_attr_invalidate(vp);
+	uk_9pfs_dcache_forget(dvp, name);
+	uk_9pfs_attr_invalidate(dvp);
+}
+
 static int uk_9pfs_remove(struct vnode *dvp, struct vnode *vp,
-		char *name __unused)
+		char *name)
 {
 	struct uk_9pfs_node_data *nd = UK_9PFS_ND(vp);
 	int rc = 0;
 
+	uk_9pfs_remove_invalidate(dvp, vp, name);
+
 	if (!nd->nb_open_files)
 		rc = uk_9pfs_remove_generic(dvp, vp);
 	else
@@ -337,11 +616,81 @@ static int uk_9pfs_mkdir(struct vnode *dvp, char *name, mode_t mode)
 }
 
 static int uk_9pfs_rmdir(struct vnode *dvp, struct vnode *vp,
-		char *name __unused)
+		char *name)
 {
+	uk_9pfs_remove_invalidate(dvp, vp, name);
 	return uk_9pfs_remove_generic(dvp, vp);
 }
 
+static int uk_9pfs_readdir_dotl(struct vnode *vp, struct vfscore_file *fp,
+		struct dirent *dir)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
+	struct uk_9pfs_file_data *fd = UK_9PFS_FD(fp);
+	struct uk_9p_dirent dirent;
+	struct uk_9preq fake_request;
+	int64_t nbytes;
+	size_t len;
+	int rc;
+
+	if (!fd->readdir_buf) {
+		fd->readdir_buf = malloc(UK_9PFS_READDIR_BUFSZ);
+		if (!fd->readdir_buf)
+			return ENOMEM;
+
+		/* Currently the readdir() buffer is empty. */
+		fd->readdir_off = 0;
+		fd->readdir_sz = 0;
+	}
+
+	if (fd->readdir_off == fd->readdir_sz) {
+		/*
+		 * The file offset is the offset of the last returned entry,
+		 * which is where the server continues from.
+		 */
+		nbytes = uk_9p_readdir(dev, fd->fid, fp->f_offset,
+				UK_9PFS_READDIR_BUFSZ, fd->readdir_buf);
+		if (nbytes < 0)
+			return -nbytes;
+
+		fd->readdir_off = 0;
+		fd->readdir_sz = nbytes;
+
+		/* End of directory. */
+		if (nbytes == 0)
+			return ENOENT;
+	}
+
+	/*
+	 * Build a fake request to use the 9P request API to read from the
+	 * buffer the directory entry.
+	 */
+	fake_request.recv.buf = fd->readdir_buf;
+	fake_request.recv.size = fd->readdir_sz;
+	fake_request.recv.offset = fd->readdir_off;
+	fake_request.state = UK_9PREQ_RECEIVED;
+	rc = uk_9preq_readdirent(&fake_request, &dirent);
+
+	/* Unlike Rread, Rreaddir never returns partial entries. */
+	if (rc) {
+		fd->readdir_off = fd->readdir_sz = 0;
+		return EIO;
+	}
+
+	fd->readdir_off = fake_request.recv.offset;
+	fp->f_offset = dirent.offset;
+
+	dir->d_type = dirent.type;
+	dir->d_ino = dirent.qid.path;
+	dir->d_off = dirent.offset;
+	/* 9P strings are not NUL-terminated. */
+	len = MIN(sizeof(dir->d_name) - 1, dirent.name.size);
+	memcpy(dir->d_name, dirent.name.data, len);
+	dir->d_name[len] = '\0';
+
+	return 0;
+}
+
 static int uk_9pfs_readdir(struct vnode *vp, struct vfscore_file *fp,
 		struct dirent *dir)
 {
@@ -350,6 +699,10 @@ static int uk_9pfs_readdir(struct vnode *vp, struct vfscore_file *fp,
 	int rc;
 	struct uk_9p_stat stat;
 	struct uk_9preq fake_request;
+	size_t len;
+
+	if (UK_9PFS_DOTL(vp->v_mount))
+		return uk_9pfs_readdir_dotl(vp, fp, dir);
 
 again:
 	if (!fd->readdir_buf) {
@@ -419,20 +772,131 @@ again:
 
 	dir->d_type = uk_9pfs_dttype_from_mode(stat.mode);
 	dir->d_ino = uk_9pfs_ino(&stat);
-	strlcpy((char *) &dir->d_name, stat.name.data,
-			MIN(sizeof(dir->d_name), stat.name.size + 1U));
+	/* 9P strings are not NUL-terminated. */
+	len = MIN(sizeof(dir->d_name) - 1, stat.name.size);
+	memcpy(dir->d_name, stat.name.data, len);
+	dir->d_name[len] = '\0';
 
 out:
 	return -rc;
 }
 
+/* Consumes n bytes from the uio, which were transferred by 9P requests. */
+static void uk_9pfs_uio_advance(struct uio *uio, size_t n)
+{
+	struct iovec *iov;
+	size_t cnt;
+
+	while (n > 0 && uio->uio_iovcnt > 0) {
+		iov = uio->uio_iov;
+		cnt = MIN(iov->iov_len, n);
+
+		iov->iov_base = (char *)iov->iov_base + cnt;
+		iov->iov_len -= cnt;
+		uio->uio_resid -= cnt;
+		uio->uio_offset += cnt;
+		n -= cnt;
+
+		if (!iov->iov_len) {
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+		}
+	}
+}
+
+/*
+ * Splits the uio into chunks that fit in one 9P message each and keeps up to
+ * UK_9PFS_IO_MAXINFLIGHT of them in flight at once, instead of waiting for
+ * every reply before sending the next request. Replies are consumed in
+ * order: a short transfer (e.g., end of file) or an error ends the
+ * operation, the remaining in-flight requests are still completed but their
+ * results are discarded.
+ */
+static int uk_9pfs_rw(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		struct uio *uio, bool write)
+{
+	struct uk_9preq *reqs[UK_9PFS_IO_MAXINFLIGHT];
+	uint32_t lens[UK_9PFS_IO_MAXINFLIGHT];
+	struct iovec *iov;
+	int iovcnt;
+	size_t iov_off;
+	uint64_t offset;
+	uint32_t maxcount, len;
+	ssize_t resid;
+	int64_t ret;
+	int nreqs, i;
+	bool done = false;
+	int rc = 0;
+
+	maxcount = write ? uk_9p_write_maxcount(dev, fid)
+			 : uk_9p_read_maxcount(dev, fid);
+	resid = uio->uio_resid;
+
+	while (!done && uio->uio_resid > 0) {
+		iov = uio->uio_iov;
+		iovcnt = uio->uio_iovcnt;
+		iov_off = 0;
+		offset = uio->uio_offset;
+
+		/* Submit a window of requests. */
+		for (nreqs = 0; nreqs < UK_9PFS_IO_MAXINFLIGHT && iovcnt > 0;) {
+			if (iov_off == iov->iov_len) {
+				iov++;
+				iovcnt--;
+				iov_off = 0;
+				continue;
+			}
+
+			len = MIN(iov->iov_len - iov_off, maxcount);
+			if (write)
+				reqs[nreqs] = uk_9p_write_submit(dev, fid,
+					offset, len,
+					(char *)iov->iov_base + iov_off);
+			else
+				reqs[nreqs] = uk_9p_read_submit(dev, fid,
+					offset, len,
+					(char *)iov->iov_base + iov_off);
+			if (PTRISERR(reqs[nreqs])) {
+				rc = PTR2ERR(reqs[nreqs]);
+				done = true;
+				break;
+			}
+
+			lens[nreqs++] = len;
+			iov_off += len;
+			offset += len;
+		}
+
+		/* Complete them in order. */
+		for (i = 0; i < nreqs; i++) {
+			ret = uk_9p_rw_complete(dev, reqs[i]);
+			if (done)
+				continue;
+
+			if (ret < 0) {
+				rc = ret;
+				done = true;
+				continue;
+			}
+
+			uk_9pfs_uio_advance(uio, ret);
+			if (ret < lens[i])
+				done = true;
+		}
+	}
+
+	/* Report partial transfers as successful, like POSIX read/write. */
+	if (uio->uio_resid != resid)
+		return 0;
+
+	return rc;
+}
+
 static int uk_9pfs_read(struct vnode *vp, struct vfscore_file *fp,
 			struct uio *uio, int ioflag __unused)
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
 	struct uk_9pfid *fid = UK_9PFS_FD(fp)->fid;
-	struct iovec *iov;
-	int rc;
 
 	if (vp->v_type == VDIR)
 		return EISDIR;
@@ -446,30 +910,13 @@ static int uk_9pfs_read(struct vnode *vp, struct vfscore_file *fp,
 	if (!uio->uio_resid)
 		return 0;
 
-	iov = uio->uio_iov;
-	while (!iov->iov_len) {
-		uio->uio_iov++;
-		uio->uio_iovcnt--;
-	}
-
-	rc = uk_9p_read(dev, fid, uio->uio_offset,
-			   iov->iov_len, iov->iov_base);
-	if (rc < 0)
-		return -rc;
-
-	iov->iov_base = (char *)iov->iov_base + rc;
-	iov->iov_len -= rc;
-	uio->uio_resid -= rc;
-	uio->uio_offset += rc;
-
-	return 0;
+	return -uk_9pfs_rw(dev, fid, uio, false);
 }
 
 static int uk_9pfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
 	struct uk_9pfid *fid;
-	struct iovec *iov;
 	int rc;
 
 	if (vp->v_type == VDIR)
@@ -491,34 +938,18 @@ static int uk_9pfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 	if (PTRISERR(fid))
 		return -PTR2ERR(fid);
 
-	rc = uk_9p_open(dev, fid, UK_9P_OWRITE);
+	if (UK_9PFS_DOTL(vp->v_mount))
+		rc = uk_9p_lopen(dev, fid, UK_9P_DOTL_WRONLY);
+	else
+		rc = uk_9p_open(dev, fid, UK_9P_OWRITE);
 	if (rc < 0)
 		goto out;
 
-	if (!uio->uio_resid)
-		return 0;
-
-	iov = uio->uio_iov;
-	while (!iov->iov_len) {
-		uio->uio_iov++;
-		uio->uio_iovcnt--;
-	}
-
-	rc = uk_9p_write(dev, fid, uio->uio_offset,
-			    iov->iov_len, iov->iov_base);
-	if (rc < 0)
-		return -rc;
-
-	iov->iov_base = (char *)iov->iov_base + rc;
-	iov->iov_len -= rc;
-	uio->uio_resid -= rc;
-	uio->uio_offset += rc;
-
+	rc = uk_9pfs_rw(dev, fid, uio, true);
+	uk_9pfs_attr_invalidate(vp);
 	if (rc < 0)
 		goto out;
 
-	rc = 0;
-
 	/*
 	 * If the uio offset after completion of the write requests is bigger
 	 * than the vnode's associated size, then the size must be updated
@@ -534,42 +965,129 @@ out:
 
 static int uk_9pfs_getattr(struct vnode *vp, struct vattr *attr)
 {
-	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
-	struct uk_9pfid *fid = UK_9PFS_VFID(vp);
-	struct uk_9p_stat stat;
-	struct uk_9preq *stat_req;
+	struct uk_9p_attr p9attr;
 	int rc = 0;
 
-	stat_req = uk_9p_stat(dev, fid, &stat);
-	if (PTRISERR(stat_req)) {
-		rc = PTR2ERR(stat_req);
-		goto out;
+	if (uk_9pfs_attr_cached(vp)) {
+		p9attr = UK_9PFS_ND(vp)->attr;
+	} else {
+		rc = uk_9pfs_fetch_attr(vp->v_mount, UK_9PFS_VFID(vp),
+				&p9attr);
+		if (rc)
+			goto out;
+		uk_9pfs_attr_cache_set(vp, &p9attr);
 	}
 
-	/* No stat string fields are used below. */
-	uk_9pdev_req_remove(dev, stat_req);
-
-	attr->va_type = uk_9pfs_vtype_from_mode(stat.mode);
-	attr->va_mode = uk_9pfs_posix_mode_from_mode(stat.mode);
+	attr->va_type = uk_9pfs_vtype_from_posix_mode(p9attr.mode);
+	attr->va_mode = p9attr.mode;
 	attr->va_nodeid = vp->v_ino;
-	attr->va_size = stat.length;
-
-	attr->va_atime.tv_sec = stat.atime;
-	attr->va_atime.tv_nsec = 0;
-	attr->va_mtime.tv_sec = stat.mtime;
-	attr->va_mtime.tv_nsec = 0;
-	attr->va_ctime.tv_sec = 0;
-	attr->va_ctime.tv_nsec = 0;
+	attr->va_size = p9attr.size;
+
+	attr->va_atime.tv_sec = p9attr.atime_sec;
+	attr->va_atime.tv_nsec = p9attr.atime_nsec;
+	attr->va_mtime.tv_sec = p9attr.mtime_sec;
+	attr->va_mtime.tv_nsec = p9attr.mtime_nsec;
+	attr->va_ctime.tv_sec = p9attr.ctime_sec;
+	attr->va_ctime.tv_nsec = p9attr.ctime_nsec;
+
+	if (UK_9PFS_DOTL(vp->v_mount)) {
+		attr->va_uid = p9attr.uid;
+		attr->va_gid = p9attr.gid;
+		attr->va_nlink = p9attr.nlink;
+		attr->va_rdev = p9attr.rdev;
+		attr->va_nblocks = p9attr.blocks;
+	}
 
 out:
 	return -rc;
 }
 
+static int uk_9pfs_setattr(struct vnode *vp, struct vattr *attr)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
+	struct uk_9p_iattr iattr;
+
+	/* 9P2000.u attributes are not changed, as before. */
+	if (!UK_9PFS_DOTL(vp->v_mount))
+		return 0;
+
+	memset(&iattr, 0, sizeof(iattr));
+	if (attr->va_mask & AT_MODE) {
+		iattr.valid |= UK_9P_SETATTR_MODE;
+		iattr.mode = attr->va_mode & 07777;
+	}
+	if (attr->va_mask & AT_UID) {
+		iattr.valid |= UK_9P_SETATTR_UID;
+		iattr.uid = attr->va_uid;
+	}
+	if (attr->va_mask & AT_GID) {
+		iattr.valid |= UK_9P_SETATTR_GID;
+		iattr.gid = attr->va_gid;
+	}
+	if (attr->va_mask & AT_SIZE) {
+		iattr.valid |= UK_9P_SETATTR_SIZE;
+		iattr.size = attr->va_size;
+	}
+	/* Without the *_SET bit, the server uses its current time. */
+	if (attr->va_mask & AT_ATIME) {
+		iattr.valid |= UK_9P_SETATTR_ATIME;
+		if (attr->va_atime.tv_nsec != UTIME_NOW) {
+			iattr.valid |= UK_9P_SETATTR_ATIME_SET;
+			iattr.atime_sec = attr->va_atime.tv_sec;
+			iattr.atime_nsec = attr->va_atime.tv_nsec;
+		}
+	}
+	if (attr->va_mask & AT_MTIME) {
+		iattr.valid |= UK_9P_SETATTR_MTIME;
+		if (attr->va_mtime.tv_nsec != UTIME_NOW) {
+			iattr.valid |= UK_9P_SETATTR_MTIME_SET;
+			iattr.mtime_sec = attr->va_mtime.tv_sec;
+			iattr.mtime_nsec = attr->va_mtime.tv_nsec;
+		}
+	}
+
+	if (!iattr.valid)
+		return 0;
+
+	uk_9pfs_attr_invalidate(vp);
+	return -uk_9p_setattr(dev, UK_9PFS_VFID(vp), &iattr);
+}
+
+static int uk_9pfs_truncate(struct vnode *vp, off_t len)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
+	struct uk_9p_iattr iattr;
+	int rc;
+
+	/* 9P2000.u files are not truncated, as before. */
+	if (!UK_9PFS_DOTL(vp->v_mount))
+		return 0;
+
+	memset(&iattr, 0, sizeof(iattr));
+	iattr.valid = UK_9P_SETATTR_SIZE;
+	iattr.size = len;
+
+	uk_9pfs_attr_invalidate(vp);
+	rc = uk_9p_setattr(dev, UK_9PFS_VFID(vp), &iattr);
+	if (rc)
+		return -rc;
+
+	vp->v_size = len;
+	return 0;
+}
+
+static int uk_9pfs_fsync(struct vnode *vp, struct vfscore_file *fp)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
+
+	if (!UK_9PFS_DOTL(vp->v_mount))
+		return 0;
+
+	return -uk_9p_fsync(dev, UK_9PFS_FD(fp)->fid, 0);
+}
+
 #define uk_9pfs_seek		((vnop_seek_t)vfscore_vop_nullop)
 #define uk_9pfs_ioctl		((vnop_ioctl_t)vfscore_vop_einval)
-#define uk_9pfs_fsync		((vnop_fsync_t)vfscore_vop_nullop)
-#define uk_9pfs_setattr		((vnop_setattr_t)vfscore_vop_nullop)
-#define uk_9pfs_truncate	((vnop_truncate_t)vfscore_vop_nullop)
 #define uk_9pfs_link		((vnop_link_t)vfscore_vop_eperm)
 #define uk_9pfs_cache		((vnop_cache_t)NULL)
 #define uk_9pfs_readlink	((vnop_readlink_t)vfscore_vop_einval)
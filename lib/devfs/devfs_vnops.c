@@ -121,6 +121,16 @@ devfs_write(struct vnode *vp, struct uio *uio, int ioflags)
 	return device_write((struct device *)vp->v_data, uio, ioflags);
 }
 
+static int
+devfs_poll(struct vnode *vp, struct vfscore_file *fp __unused,
+			struct vfscore_poll_table *pt)
+{
+	if (vp->v_type == VDIR)
+		return VFSCORE_POLL_DEFAULT;
+
+	return device_poll((struct device *)vp->v_data, pt);
+}
+
 static int
 devfs_ioctl(struct vnode *vp, struct vfscore_file *fp __unused,
 			unsigned long cmd, void *arg)
@@ -289,6 +299,7 @@ struct vnops devfs_vnops = {
 	devfs_fallocate,	/* fallocate */
 	devfs_readlink,		/* read link */
 	devfs_symlink,		/* symbolic link */
+	devfs_poll,		/* poll */
 };
 
 /*
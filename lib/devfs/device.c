@@ -374,6 +374,31 @@ device_write(struct device *dev, struct uio *uio, int ioflags)
 	return error;
 }
 
+/*
+ * device_poll - readiness query.
+ *
+ * Devices without a poll routine never block and are reported
+ * as always readable and writable.
+ */
+int
+device_poll(struct device *dev, struct vfscore_poll_table *pt)
+{
+	struct devops *ops;
+	int mask;
+
+	if (device_reference(dev) != 0)
+		return POLLNVAL;
+
+	ops = dev->driver->devops;
+	if (ops->poll)
+		mask = (*ops->poll)(dev, pt);
+	else
+		mask = VFSCORE_POLL_DEFAULT;
+
+	device_release(dev);
+	return mask;
+}
+
 /*
  * device_ioctl - I/O control request.
  *
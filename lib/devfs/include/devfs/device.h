@@ -37,6 +37,7 @@
 #include <uk/init.h>
 
 #include <vfscore/uio.h>
+#include <vfscore/poll.h>
 
 #define MAXDEVNAME	12
 #define DO_RWMASK	0x3
@@ -69,6 +70,7 @@ typedef int (*devop_write_t)  (struct device *, struct uio *, int);
 typedef int (*devop_ioctl_t)  (struct device *, unsigned long, void *);
 typedef int (*devop_devctl_t) (struct device *, unsigned long, void *);
 typedef void (*devop_strategy_t)(struct bio *);
+typedef int (*devop_poll_t)   (struct device *, struct vfscore_poll_table *);
 
 /*
  * Device operations
@@ -81,6 +83,7 @@ struct devops {
 	devop_ioctl_t	ioctl;
 	devop_devctl_t	devctl;
 	devop_strategy_t strategy;
+	devop_poll_t	poll;
 };
 
 
@@ -195,6 +198,7 @@ int device_close(struct device *dev);
 int device_read(struct device *dev, struct uio *uio, int ioflags);
 int device_write(struct device *dev, struct uio *uio, int ioflags);
 int device_ioctl(struct device *dev, unsigned long cmd, void *arg);
+int device_poll(struct device *dev, struct vfscore_poll_table *pt);
 int device_info(struct devinfo *info);
 
 int bdev_read(struct device *dev, struct uio *uio, int ioflags);
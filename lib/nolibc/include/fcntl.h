@@ -152,6 +152,8 @@ int lockf(int, int, off_t);
 #define F_OWNER_PID 1
 #define F_OWNER_PGRP 2
 #define F_OWNER_GID 2
+#define F_SETPIPE_SZ 1031
+#define F_GETPIPE_SZ 1032
 #if 0
 /* Not implemented */
 struct f_owner_ex {
@@ -63,6 +63,7 @@ extern "C" {
 
 #define PATH_MAX 4096
 #define NAME_MAX 255
+#define PIPE_BUF 4096
 
 #ifdef __cplusplus
 }
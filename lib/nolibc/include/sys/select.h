@@ -40,8 +40,10 @@ extern "C" {
 
 #define __NEED_time_t
 #define __NEED_suseconds_t
+#define __NEED_struct_timeval
 #define __NEED_struct_timespec
 #include <nolibc-internal/shareddefs.h>
+#include <signal.h>
 
 typedef unsigned long __fd_mask;
 
@@ -75,6 +77,10 @@ typedef struct fd_set {
 		_p->__fds_bits[--_n] = 0;		\
 } while (0)
 
+int select(int, fd_set *, fd_set *, fd_set *, struct timeval *);
+int pselect(int, fd_set *, fd_set *, fd_set *, const struct timespec *,
+	    const sigset_t *);
+
 #ifdef __cplusplus
 }
 #endif
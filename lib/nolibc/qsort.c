@@ -28,13 +28,47 @@
  * SUCH DAMAGE.
  */
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdlib.h>
-static inline char	*med3(char *, char *, char *, int (*)
-				(const void *, const void *));
-static inline void	 swapfunc(char *, char *, int, int);
-#define min(a, b)	((a) < (b) ? a : b)
+
+/*
+ * Pattern-defeating quicksort (introsort with heapsort fallback, insertion
+ * sort for small ranges and detection of sorted or patterned input).
+ * Aligned 64-bit and 32-bit elements are handed to typed instances of
+ * <uk/sort.h> which move elements as scalars; everything else goes
+ * through the byte-generic variant below.
+ */
+typedef int (*qsort_cmp_t)(const void *, const void *);
+
+#define UK_SORT_NAME		qsort_u32
+#define UK_SORT_TYPE		uint32_t
+#define UK_SORT_CTX		qsort_cmp_t
+#define UK_SORT_LESS(a, b)	(ctx((a), (b)) < 0)
+#include <uk/sort.h>
+
+#define UK_SORT_NAME		qsort_u64
+#define UK_SORT_TYPE		uint64_t
+#define UK_SORT_CTX		qsort_cmp_t
+#define UK_SORT_LESS(a, b)	(ctx((a), (b)) < 0)
+#include <uk/sort.h>
+
+#define INSERTION_THRESHOLD	24
+#define NINTHER_THRESHOLD	128
+#define PARTIAL_LIMIT		8
+
+struct qsort_ctx {
+	size_t es;
+	int swaptype;
+	qsort_cmp_t cmp;
+};
+
+#define LT(c, a, b)	((c)->cmp((a), (b)) < 0)
+#define AT(c, p, i)	((p) + (size_t)(i) * (c)->es)
+#define NEL(c, a, b)	((size_t)((b) - (a)) / (c)->es)
+
 /*
- * Qsort routine from Bentley & McIlroy's "Engineering a Sort Function".
+ * Swap routine from Bentley & McIlroy's "Engineering a Sort Function":
+ * swaptype 0 swaps one long, 1 swaps several longs, 2 swaps bytes.
  */
 #define swapcode(TYPE, parmi, parmj, n) {		\
 	long i = (n) / sizeof(TYPE);			\
@@ -46,112 +80,242 @@ static inline void	 swapfunc(char *, char *, int, int);
 		*pj++ = t;				\
 	} while (--i > 0);				\
 }
-#define SWAPINIT(a, es) (swaptype = ((char *)a - (char *)0) % sizeof(long) || \
-	es % sizeof(long) ? 2 : es == sizeof(long) ? 0 : 1)
+#define SWAPTYPE(a, es) (((uintptr_t)(a) % sizeof(long) ||		\
+	(es) % sizeof(long)) ? 2 : (es) == sizeof(long) ? 0 : 1)
+
 static inline void
-swapfunc(char *a, char *b, int n, int swaptype)
+swap(const struct qsort_ctx *c, char *a, char *b)
 {
-	if (swaptype <= 1)
-		swapcode(long, a, b, n)
+	if (c->swaptype == 0) {
+		long t = *(long *)a;
+		*(long *)a = *(long *)b;
+		*(long *)b = t;
+	} else if (c->swaptype == 1)
+		swapcode(long, a, b, c->es)
 	else
-		swapcode(char, a, b, n)
+		swapcode(char, a, b, c->es)
 }
-#define swap(a, b)					\
-	do {						\
-		if (swaptype == 0) {				\
-			long t = *(long *)(a);			\
-			*(long *)(a) = *(long *)(b);		\
-			*(long *)(b) = t;			\
-		} else						\
-			swapfunc(a, b, es, swaptype);		\
-	} while (0)
-
-#define vecswap(a, b, n)					\
-	do {							\
-		if ((n) > 0)					\
-			swapfunc(a, b, n, swaptype);		\
-	} while (0)
-static inline char *
-med3(char *a, char *b, char *c, int (*cmp)(const void *, const void *))
+
+static inline void
+sort2(const struct qsort_ctx *c, char *a, char *b)
 {
-	return cmp(a, b) < 0 ?
-		(cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a))
-		: (cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c));
+	if (LT(c, b, a))
+		swap(c, a, b);
 }
-void
-qsort(void *aa, size_t n, size_t es, int (*cmp)(const void *, const void *))
+
+static inline void
+sort3(const struct qsort_ctx *c, char *a, char *b, char *c3)
 {
-	char *pa, *pb, *pc, *pd, *pl, *pm, *pn;
-	int d, r, swaptype, swap_cnt;
-	char *a = aa;
-loop:
-	SWAPINIT(a, es);
-	swap_cnt = 0;
-	if (n < 7) {
-		for (pm = (char *)a + es; pm < (char *) a + n * es; pm += es)
-			for (pl = pm; pl > (char *) a && cmp(pl - es, pl) > 0;
-			     pl -= es)
-				swap(pl, pl - es);
-		return;
+	sort2(c, a, b);
+	sort2(c, b, c3);
+	sort2(c, a, b);
+}
+
+/* Returns 0 if more than `limit' swaps were needed (limit 0: unlimited) */
+static int
+insertion(const struct qsort_ctx *c, char *begin, char *end, size_t limit)
+{
+	size_t moves = 0;
+	char *cur, *sift;
+
+	if (begin == end)
+		return 1;
+	for (cur = begin + c->es; cur != end; cur += c->es) {
+		for (sift = cur; sift != begin && LT(c, sift, sift - c->es);
+		     sift -= c->es)
+			swap(c, sift, sift - c->es);
+		moves += NEL(c, sift, cur);
+		if (limit && moves > limit)
+			return 0;
 	}
-	pm = (char *)a + (n / 2) * es;
-	if (n > 7) {
-		pl = (char *)a;
-		pn = (char *)a + (n - 1) * es;
-		if (n > 40) {
-			d = (n / 8) * es;
-			pl = med3(pl, pl + d, pl + 2 * d, cmp);
-			pm = med3(pm - d, pm, pm + d, cmp);
-			pn = med3(pn - 2 * d, pn - d, pn, cmp);
+	return 1;
+}
+
+static void
+heapsort(const struct qsort_ctx *c, char *base, size_t n)
+{
+	size_t start, end, root, child;
+
+	if (n < 2)
+		return;
+	start = n / 2;
+	end = n;
+	while (end > 1) {
+		if (start > 0)
+			--start;
+		else
+			swap(c, base, AT(c, base, --end));
+		root = start;
+		while ((child = 2 * root + 1) < end) {
+			if (child + 1 < end && LT(c, AT(c, base, child),
+						  AT(c, base, child + 1)))
+				++child;
+			if (!LT(c, AT(c, base, root), AT(c, base, child)))
+				break;
+			swap(c, AT(c, base, root), AT(c, base, child));
+			root = child;
 		}
-		pm = med3(pl, pm, pn, cmp);
 	}
-	swap(a, pm);
-	pa = pb = (char *)a + es;
+}
+
+/*
+ * Partition [begin, end) around the pivot at begin, which stays in place
+ * until the end. Elements equal to the pivot go right.
+ */
+static char *
+partition_right(const struct qsort_ctx *c, char *begin, char *end,
+		int *sorted)
+{
+	char *first = begin, *last = end;
+	size_t es = c->es;
+
+	/* The median-of-3 guarantees that these loops terminate */
+	while (LT(c, first += es, begin))
+		;
+	if (first - es == begin)
+		while (first < last && !LT(c, last -= es, begin))
+			;
+	else
+		while (!LT(c, last -= es, begin))
+			;
+	*sorted = first >= last;
+	while (first < last) {
+		swap(c, first, last);
+		while (LT(c, first += es, begin))
+			;
+		while (!LT(c, last -= es, begin))
+			;
+	}
+	swap(c, begin, first - es);
+	return first - es;
+}
+
+/* Like partition_right(), but elements equal to the pivot go left */
+static char *
+partition_left(const struct qsort_ctx *c, char *begin, char *end)
+{
+	char *first = begin, *last = end;
+	size_t es = c->es;
+
+	while (LT(c, begin, last -= es))
+		;
+	if (last + es == end)
+		while (first < last && !LT(c, begin, first += es))
+			;
+	else
+		while (!LT(c, begin, first += es))
+			;
+	while (first < last) {
+		swap(c, first, last);
+		while (LT(c, begin, last -= es))
+			;
+		while (!LT(c, begin, first += es))
+			;
+	}
+	swap(c, begin, last);
+	return last;
+}
+
+static void
+shuffle(const struct qsort_ctx *c, char *begin, char *end)
+{
+	size_t n = NEL(c, begin, end), q = n / 4;
+
+	if (n < INSERTION_THRESHOLD)
+		return;
+	swap(c, begin, AT(c, begin, q));
+	swap(c, end - c->es, end - q * c->es);
+	if (n > NINTHER_THRESHOLD) {
+		swap(c, AT(c, begin, 1), AT(c, begin, q + 1));
+		swap(c, AT(c, begin, 2), AT(c, begin, q + 2));
+		swap(c, end - 2 * c->es, end - (q + 1) * c->es);
+		swap(c, end - 3 * c->es, end - (q + 2) * c->es);
+	}
+}
+
+static void
+pdqsort(const struct qsort_ctx *c, char *begin, char *end, int bad_allowed,
+	int leftmost)
+{
+	size_t n, half, l_n, r_n;
+	char *pivot;
+	int sorted;
 
-	pc = pd = (char *)a + (n - 1) * es;
 	for (;;) {
-		while (pb <= pc && (r = cmp(pb, a)) <= 0) {
-			if (r == 0) {
-				swap_cnt = 1;
-				swap(pa, pb);
-				pa += es;
-			}
-			pb += es;
+		n = NEL(c, begin, end);
+		if (n < INSERTION_THRESHOLD) {
+			insertion(c, begin, end, 0);
+			return;
+		}
+
+		half = n / 2;
+		if (n > NINTHER_THRESHOLD) {
+			sort3(c, begin, AT(c, begin, half), AT(c, begin, n - 1));
+			sort3(c, AT(c, begin, 1), AT(c, begin, half - 1),
+			      AT(c, begin, n - 2));
+			sort3(c, AT(c, begin, 2), AT(c, begin, half + 1),
+			      AT(c, begin, n - 3));
+			sort3(c, AT(c, begin, half - 1), AT(c, begin, half),
+			      AT(c, begin, half + 1));
+			swap(c, begin, AT(c, begin, half));
+		} else
+			sort3(c, AT(c, begin, half), begin, AT(c, begin, n - 1));
+
+		/* Pivot equals its left neighbour: skip all equal elements */
+		if (!leftmost && !LT(c, begin - c->es, begin)) {
+			begin = partition_left(c, begin, end) + c->es;
+			continue;
 		}
-		while (pb <= pc && (r = cmp(pc, a)) >= 0) {
-			if (r == 0) {
-				swap_cnt = 1;
-				swap(pc, pd);
-				pd -= es;
+
+		pivot = partition_right(c, begin, end, &sorted);
+		l_n = NEL(c, begin, pivot);
+		r_n = NEL(c, pivot + c->es, end);
+		if (l_n < n / 8 || r_n < n / 8) {
+			if (--bad_allowed == 0) {
+				heapsort(c, begin, n);
+				return;
 			}
-			pc -= es;
+			shuffle(c, begin, pivot);
+			shuffle(c, pivot + c->es, end);
+		} else if (sorted
+			   && insertion(c, begin, pivot, PARTIAL_LIMIT)
+			   && insertion(c, pivot + c->es, end, PARTIAL_LIMIT))
+			return;
+
+		/* Recurse into the smaller side to bound stack usage */
+		if (l_n < r_n) {
+			pdqsort(c, begin, pivot, bad_allowed, leftmost);
+			begin = pivot + c->es;
+			leftmost = 0;
+		} else {
+			pdqsort(c, pivot + c->es, end, bad_allowed, 0);
+			end = pivot;
 		}
-		if (pb > pc)
-			break;
-		swap(pb, pc);
-		swap_cnt = 1;
-		pb += es;
-		pc -= es;
 	}
-	if (swap_cnt == 0) {  /* Switch to insertion sort */
-		for (pm = (char *) a + es; pm < (char *) a + n * es; pm += es)
-			for (pl = pm; pl > (char *) a && cmp(pl - es, pl) > 0;
-			     pl -= es)
-				swap(pl, pl - es);
+}
+
+void
+qsort(void *aa, size_t n, size_t es, int (*cmp)(const void *, const void *))
+{
+	struct qsort_ctx c;
+	int log2n = 0;
+
+	if (n < 2 || es == 0)
+		return;
+
+	if (es == sizeof(uint64_t) && !((uintptr_t)aa % sizeof(uint64_t))) {
+		qsort_u64(aa, n, cmp);
 		return;
 	}
-	pn = (char *)a + n * es;
-	r = min(pa - (char *)a, pb - pa);
-	vecswap(a, pb - r, r);
-	r = min(pd - pc, pn - pd - (int)es);
-	vecswap(pb, pn - r, r);
-	if ((r = pb - pa) > (int)es)
-		qsort(a, r / es, es, cmp);
-	if ((r = pd - pc) > (int)es) {
-		/* Iterate rather than recurse to save stack space */
-		a = pn - r;
-		n = r / es;
-		goto loop;
+	if (es == sizeof(uint32_t) && !((uintptr_t)aa % sizeof(uint32_t))) {
+		qsort_u32(aa, n, cmp);
+		return;
 	}
+
+	c.es = es;
+	c.swaptype = SWAPTYPE(aa, es);
+	c.cmp = cmp;
+	while (n >> log2n > 1)
+		++log2n;
+	pdqsort(&c, aa, (char *)aa + n * es, log2n, 1);
 }
@@ -86,6 +86,8 @@ ramfs_mount(struct mount *mp, const char *dev __unused,
 	if (np == NULL)
 		return ENOMEM;
 	mp->m_root->d_vnode->v_data = np;
+	/* Contents only change through vfscore, allow negative lookups */
+	mp->m_flags |= MNT_LOCAL;
 	return 0;
 }
 
@@ -51,11 +51,14 @@
 #include <vfscore/file.h>
 
 #include "ramfs.h"
+#include <ramfs/ramfs.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <vfscore/fs.h>
+#include <uk/rwlock.h>
+#include <uk/arch/atomic.h>
 
-static struct uk_mutex ramfs_lock = UK_MUTEX_INITIALIZER(ramfs_lock);
+static struct uk_rwlock ramfs_lock = UK_RWLOCK_INITIALIZER(ramfs_lock);
 static uint64_t inode_count = 1; /* inode 0 is reserved to root */
 
 static void
@@ -125,7 +128,7 @@ ramfs_add_node(struct ramfs_node *dnp, char *name, int type)
 	if (np == NULL)
 		return NULL;
 
-	uk_mutex_lock(&ramfs_lock);
+	uk_rwlock_wlock(&ramfs_lock);
 
 	/* Link to the directory list */
 	if (dnp->rn_child == NULL) {
@@ -139,7 +142,7 @@ ramfs_add_node(struct ramfs_node *dnp, char *name, int type)
 
 	set_times_to_now(&(dnp->rn_mtime), &(dnp->rn_ctime), NULL);
 
-	uk_mutex_unlock(&ramfs_lock);
+	uk_rwlock_wunlock(&ramfs_lock);
 	return np;
 }
 
@@ -151,7 +154,7 @@ ramfs_remove_node(struct ramfs_node *dnp, struct ramfs_node *np)
 	if (dnp->rn_child == NULL)
 		return EBUSY;
 
-	uk_mutex_lock(&ramfs_lock);
+	uk_rwlock_wlock(&ramfs_lock);
 
 	/* Unlink from the directory list */
 	if (dnp->rn_child == np) {
@@ -160,7 +163,7 @@ ramfs_remove_node(struct ramfs_node *dnp, struct ramfs_node *np)
 		for (prev = dnp->rn_child; prev->rn_next != np;
 			 prev = prev->rn_next) {
 			if (prev->rn_next == NULL) {
-				uk_mutex_unlock(&ramfs_lock);
+				uk_rwlock_wunlock(&ramfs_lock);
 				return ENOENT;
 			}
 		}
@@ -170,7 +173,7 @@ ramfs_remove_node(struct ramfs_node *dnp, struct ramfs_node *np)
 
 	set_times_to_now(&(dnp->rn_mtime), &(dnp->rn_ctime), NULL);
 
-	uk_mutex_unlock(&ramfs_lock);
+	uk_rwlock_wunlock(&ramfs_lock);
 	return 0;
 }
 
@@ -214,7 +217,7 @@ ramfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 	if (*name == '\0')
 		return ENOENT;
 
-	uk_mutex_lock(&ramfs_lock);
+	uk_rwlock_rlock(&ramfs_lock);
 
 	len = strlen(name);
 	dnp = dvp->v_data;
@@ -227,17 +230,17 @@ ramfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 		}
 	}
 	if (found == 0) {
-		uk_mutex_unlock(&ramfs_lock);
+		uk_rwlock_runlock(&ramfs_lock);
 		return ENOENT;
 	}
-	if (vfscore_vget(dvp->v_mount, inode_count++, &vp)) {
+	if (vfscore_vget(dvp->v_mount, ukarch_inc(&inode_count), &vp)) {
 		/* found in cache */
 		*vpp = vp;
-		uk_mutex_unlock(&ramfs_lock);
+		uk_rwlock_runlock(&ramfs_lock);
 		return 0;
 	}
 	if (!vp) {
-		uk_mutex_unlock(&ramfs_lock);
+		uk_rwlock_runlock(&ramfs_lock);
 		return ENOMEM;
 	}
 	vp->v_data = np;
@@ -245,7 +248,7 @@ ramfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 	vp->v_type = np->rn_type;
 	vp->v_size = np->rn_size;
 
-	uk_mutex_unlock(&ramfs_lock);
+	uk_rwlock_runlock(&ramfs_lock);
 
 	*vpp = vp;
 
@@ -448,6 +451,7 @@ static int
 ramfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 {
 	struct ramfs_node *np =  vp->v_data;
+	off_t end_pos;
 
 	if (vp->v_type == VDIR)
 		return EISDIR;
@@ -463,28 +467,32 @@ ramfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 	if (ioflag & IO_APPEND)
 		uio->uio_offset = np->rn_size;
 
-	if ((size_t) uio->uio_offset + uio->uio_resid > (size_t) vp->v_size) {
-		/* Expand the file size before writing to it */
-		off_t end_pos = uio->uio_offset + uio->uio_resid;
-
-		if (end_pos > (off_t) np->rn_bufsize) {
-			// XXX: this could use a page level allocator
-			size_t new_size = round_pgup(end_pos);
-			void *new_buf = calloc(1, new_size);
-
-			if (!new_buf)
-				return EIO;
-			if (np->rn_size != 0) {
-				memcpy(new_buf, np->rn_buf, vp->v_size);
-				if (np->rn_owns_buf)
-					free(np->rn_buf);
-			}
-			np->rn_buf = (char *) new_buf;
-			np->rn_bufsize = new_size;
+	end_pos = uio->uio_offset + uio->uio_resid;
+
+	/*
+	 * Expand the buffer before writing to it. Buffers attached with
+	 * ramfs_set_file_data() are not ours to modify: copy them first.
+	 */
+	if (end_pos > (off_t) np->rn_bufsize || !np->rn_owns_buf) {
+		// XXX: this could use a page level allocator
+		size_t new_size = round_pgup(MAX(end_pos, (off_t) vp->v_size));
+		void *new_buf = calloc(1, new_size);
+
+		if (!new_buf)
+			return EIO;
+		if (np->rn_size != 0) {
+			memcpy(new_buf, np->rn_buf, vp->v_size);
+			if (np->rn_owns_buf)
+				free(np->rn_buf);
 		}
+		np->rn_buf = (char *) new_buf;
+		np->rn_bufsize = new_size;
+		np->rn_owns_buf = true;
+	}
+
+	if (end_pos > (off_t) vp->v_size) {
 		np->rn_size = end_pos;
 		vp->v_size = end_pos;
-		np->rn_owns_buf = true;
 	}
 
 	set_times_to_now(&(np->rn_mtime), &(np->rn_ctime), NULL);
@@ -540,7 +548,7 @@ ramfs_readdir(struct vnode *vp, struct vfscore_file *fp, struct dirent *dir)
 	struct ramfs_node *np, *dnp;
 	int i;
 
-	uk_mutex_lock(&ramfs_lock);
+	uk_rwlock_rlock(&ramfs_lock);
 
 	set_times_to_now(&(((struct ramfs_node *) vp->v_data)->rn_atime),
 			 NULL, NULL);
@@ -555,14 +563,14 @@ ramfs_readdir(struct vnode *vp, struct vfscore_file *fp, struct dirent *dir)
 		dnp = vp->v_data;
 		np = dnp->rn_child;
 		if (np == NULL) {
-			uk_mutex_unlock(&ramfs_lock);
+			uk_rwlock_runlock(&ramfs_lock);
 			return ENOENT;
 		}
 
 		for (i = 0; i != (fp->f_offset - 2); i++) {
 			np = np->rn_next;
 			if (np == NULL) {
-				uk_mutex_unlock(&ramfs_lock);
+				uk_rwlock_runlock(&ramfs_lock);
 				return ENOENT;
 			}
 		}
@@ -580,7 +588,7 @@ ramfs_readdir(struct vnode *vp, struct vfscore_file *fp, struct dirent *dir)
 
 	fp->f_offset++;
 
-	uk_mutex_unlock(&ramfs_lock);
+	uk_rwlock_runlock(&ramfs_lock);
 	return 0;
 }
 
@@ -671,5 +679,6 @@ struct vnops ramfs_vnops = {
 		ramfs_fallocate,        /* fallocate */
 		ramfs_readlink,         /* read link */
 		ramfs_symlink,          /* symbolic link */
+		(vnop_poll_t) NULL,     /* poll */
 };
 
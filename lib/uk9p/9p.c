@@ -45,7 +45,7 @@ UK_TRACEPOINT(uk_9p_trace_ready, "tag %u", uint16_t);
 UK_TRACEPOINT(uk_9p_trace_sent, "tag %u", uint16_t);
 UK_TRACEPOINT(uk_9p_trace_received, "tag %u", uint16_t);
 
-static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
+static inline int send_zc(struct uk_9pdev *dev, struct uk_9preq *req,
 		enum uk_9preq_zcdir zc_dir, void *zc_buf, uint32_t zc_size,
 		uint32_t zc_offset)
 {
@@ -59,6 +59,18 @@ static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
 		return rc;
 	uk_9p_trace_sent(req->tag);
 
+	return 0;
+}
+
+static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
+		enum uk_9preq_zcdir zc_dir, void *zc_buf, uint32_t zc_size,
+		uint32_t zc_offset)
+{
+	int rc;
+
+	if ((rc = send_zc(dev, req, zc_dir, zc_buf, zc_size, zc_offset)))
+		return rc;
+
 	if ((rc = uk_9preq_waitreply(req)))
 		return rc;
 	uk_9p_trace_received(req->tag);
@@ -374,64 +386,79 @@ out:
 	return rc;
 }
 
-int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
+struct uk_9preq *uk_9p_read_submit(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		uint64_t offset, uint32_t count, char *buf)
 {
 	struct uk_9preq *req;
-	int64_t rc;
+	int rc;
 
-	if (fid->iounit != 0)
-		count = MIN(count, fid->iounit);
-	count = MIN(count, dev->msize - 11);
+	count = MIN(count, uk_9p_read_maxcount(dev, fid));
 
 	uk_pr_debug("TREAD fid %u offset %lu count %u\n", fid->fid,
 			offset, count);
 
 	req = request_create(dev, UK_9P_TREAD);
 	if (PTRISERR(req))
-		return PTR2ERR(req);
+		return req;
 
 	if ((rc = uk_9preq_write32(req, fid->fid)) ||
 		(rc = uk_9preq_write64(req, offset)) ||
 		(rc = uk_9preq_write32(req, count)) ||
-		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf,
-				       count, 11)) ||
-		(rc = uk_9preq_read32(req, &count)))
+		(rc = send_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf, count,
+			      UK_9P_RREAD_HDRSZ)))
 		goto out;
 
-	uk_pr_debug("RREAD count %u\n", count);
-
-	rc = count;
+	return req;
 
 out:
 	uk_9pdev_req_remove(dev, req);
-	return rc;
+	return ERR2PTR(rc);
 }
 
-int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
-		uint64_t offset, uint32_t count, const char *buf)
+struct uk_9preq *uk_9p_write_submit(struct uk_9pdev *dev,
+		struct uk_9pfid *fid, uint64_t offset, uint32_t count,
+		const char *buf)
 {
 	struct uk_9preq *req;
-	int64_t rc;
+	int rc;
 
-	count = MIN(count, fid->iounit);
-	count = MIN(count, dev->msize - 23);
+	count = MIN(count, uk_9p_write_maxcount(dev, fid));
 
 	uk_pr_debug("TWRITE fid %u offset %lu count %u\n", fid->fid,
 			offset, count);
+
 	req = request_create(dev, UK_9P_TWRITE);
 	if (PTRISERR(req))
-		return PTR2ERR(req);
+		return req;
 
 	if ((rc = uk_9preq_write32(req, fid->fid)) ||
 		(rc = uk_9preq_write64(req, offset)) ||
 		(rc = uk_9preq_write32(req, count)) ||
-		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_WRITE,
-				(void *)buf, count, 23)) ||
-		(rc = uk_9preq_read32(req, &count)))
+		(rc = send_zc(dev, req, UK_9PREQ_ZCDIR_WRITE, (void *)buf,
+			      count, UK_9P_TWRITE_HDRSZ)))
+		goto out;
+
+	return req;
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return ERR2PTR(rc);
+}
+
+int64_t uk_9p_rw_complete(struct uk_9pdev *dev, struct uk_9preq *req)
+{
+	uint32_t count;
+	int64_t rc;
+
+	if ((rc = uk_9preq_waitreply(req)))
+		goto out;
+	uk_9p_trace_received(req->tag);
+
+	if ((rc = uk_9preq_read32(req, &count)))
 		goto out;
 
-	uk_pr_debug("RWRITE count %u\n", count);
+	uk_pr_debug("%s count %u\n",
+		    req->xmit.type == UK_9P_TREAD ? "RREAD" : "RWRITE", count);
 
 	rc = count;
 
@@ -440,6 +467,30 @@ out:
 	return rc;
 }
 
+int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf)
+{
+	struct uk_9preq *req;
+
+	req = uk_9p_read_submit(dev, fid, offset, count, buf);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	return uk_9p_rw_complete(dev, req);
+}
+
+int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, const char *buf)
+{
+	struct uk_9preq *req;
+
+	req = uk_9p_write_submit(dev, fid, offset, count, buf);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	return uk_9p_rw_complete(dev, req);
+}
+
 struct uk_9preq *uk_9p_stat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		struct uk_9p_stat *stat)
 {
@@ -499,3 +550,266 @@ out:
 	uk_9pdev_req_remove(dev, req);
 	return rc;
 }
+
+int uk_9p_lopen(struct uk_9pdev *dev, struct uk_9pfid *fid, uint32_t flags)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TLOPEN);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TLOPEN fid %u flags %o\n", fid->fid, flags);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write32(req, flags)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readqid(req, &fid->qid)) ||
+		(rc = uk_9preq_read32(req, &fid->iounit)))
+		goto out;
+
+	uk_pr_debug("RLOPEN qid type %u version %u path %lu iounit %u\n",
+			fid->qid.type, fid->qid.version, fid->qid.path,
+			fid->iounit);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_lcreate(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		const char *name, uint32_t flags, uint32_t mode, uint32_t gid)
+{
+	struct uk_9preq *req;
+	struct uk_9p_str name_str;
+	int rc = 0;
+
+	uk_9p_str_init(&name_str, name);
+
+	req = request_create(dev, UK_9P_TLCREATE);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TLCREATE fid %u name %s flags %o mode %o gid %u\n",
+			fid->fid, name, flags, mode, gid);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_writestr(req, &name_str)) ||
+		(rc = uk_9preq_write32(req, flags)) ||
+		(rc = uk_9preq_write32(req, mode)) ||
+		(rc = uk_9preq_write32(req, gid)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readqid(req, &fid->qid)) ||
+		(rc = uk_9preq_read32(req, &fid->iounit)))
+		goto out;
+
+	uk_pr_debug("RLCREATE qid type %u version %u path %lu iounit %u\n",
+			fid->qid.type, fid->qid.version, fid->qid.path,
+			fid->iounit);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_mkdir(struct uk_9pdev *dev, struct uk_9pfid *dfid,
+		const char *name, uint32_t mode, uint32_t gid,
+		struct uk_9p_qid *qid)
+{
+	struct uk_9preq *req;
+	struct uk_9p_str name_str;
+	int rc = 0;
+
+	uk_9p_str_init(&name_str, name);
+
+	req = request_create(dev, UK_9P_TMKDIR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TMKDIR dfid %u name %s mode %o gid %u\n",
+			dfid->fid, name, mode, gid);
+
+	if ((rc = uk_9preq_write32(req, dfid->fid)) ||
+		(rc = uk_9preq_writestr(req, &name_str)) ||
+		(rc = uk_9preq_write32(req, mode)) ||
+		(rc = uk_9preq_write32(req, gid)) ||
+		(rc = send_and_wait_no_zc(dev, req)))
+		goto out;
+
+	if (qid && (rc = uk_9preq_readqid(req, qid)))
+		goto out;
+
+	uk_pr_debug("RMKDIR\n");
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_getattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t request_mask, struct uk_9p_attr *attr)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TGETATTR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TGETATTR fid %u mask 0x%lx\n", fid->fid, request_mask);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write64(req, request_mask)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_read64(req, &attr->valid)) ||
+		(rc = uk_9preq_readqid(req, &attr->qid)) ||
+		(rc = uk_9preq_read32(req, &attr->mode)) ||
+		(rc = uk_9preq_read32(req, &attr->uid)) ||
+		(rc = uk_9preq_read32(req, &attr->gid)) ||
+		(rc = uk_9preq_read64(req, &attr->nlink)) ||
+		(rc = uk_9preq_read64(req, &attr->rdev)) ||
+		(rc = uk_9preq_read64(req, &attr->size)) ||
+		(rc = uk_9preq_read64(req, &attr->blksize)) ||
+		(rc = uk_9preq_read64(req, &attr->blocks)) ||
+		(rc = uk_9preq_read64(req, &attr->atime_sec)) ||
+		(rc = uk_9preq_read64(req, &attr->atime_nsec)) ||
+		(rc = uk_9preq_read64(req, &attr->mtime_sec)) ||
+		(rc = uk_9preq_read64(req, &attr->mtime_nsec)) ||
+		(rc = uk_9preq_read64(req, &attr->ctime_sec)) ||
+		(rc = uk_9preq_read64(req, &attr->ctime_nsec)) ||
+		(rc = uk_9preq_read64(req, &attr->btime_sec)) ||
+		(rc = uk_9preq_read64(req, &attr->btime_nsec)) ||
+		(rc = uk_9preq_read64(req, &attr->gen)) ||
+		(rc = uk_9preq_read64(req, &attr->data_version)))
+		goto out;
+
+	uk_pr_debug("RGETATTR valid 0x%lx mode %o size %lu\n",
+			attr->valid, attr->mode, attr->size);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_setattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		struct uk_9p_iattr *iattr)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TSETATTR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TSETATTR fid %u valid 0x%x\n", fid->fid, iattr->valid);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write32(req, iattr->valid)) ||
+		(rc = uk_9preq_write32(req, iattr->mode)) ||
+		(rc = uk_9preq_write32(req, iattr->uid)) ||
+		(rc = uk_9preq_write32(req, iattr->gid)) ||
+		(rc = uk_9preq_write64(req, iattr->size)) ||
+		(rc = uk_9preq_write64(req, iattr->atime_sec)) ||
+		(rc = uk_9preq_write64(req, iattr->atime_nsec)) ||
+		(rc = uk_9preq_write64(req, iattr->mtime_sec)) ||
+		(rc = uk_9preq_write64(req, iattr->mtime_nsec)) ||
+		(rc = send_and_wait_no_zc(dev, req)))
+		goto out;
+
+	uk_pr_debug("RSETATTR\n");
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int64_t uk_9p_readdir(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf)
+{
+	struct uk_9preq *req;
+	int64_t rc;
+
+	count = MIN(count, uk_9p_read_maxcount(dev, fid));
+
+	uk_pr_debug("TREADDIR fid %u offset %lu count %u\n", fid->fid,
+			offset, count);
+
+	req = request_create(dev, UK_9P_TREADDIR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write64(req, offset)) ||
+		(rc = uk_9preq_write32(req, count)) ||
+		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf,
+				       count, UK_9P_RREAD_HDRSZ)) ||
+		(rc = uk_9preq_read32(req, &count)))
+		goto out;
+
+	uk_pr_debug("RREADDIR count %u\n", count);
+
+	rc = count;
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_fsync(struct uk_9pdev *dev, struct uk_9pfid *fid, int datasync)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TFSYNC);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TFSYNC fid %u datasync %d\n", fid->fid, datasync);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write32(req, datasync ? 1 : 0)) ||
+		(rc = send_and_wait_no_zc(dev, req)))
+		goto out;
+
+	uk_pr_debug("RFSYNC\n");
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_lock(struct uk_9pdev *dev, struct uk_9pfid *fid, uint8_t type,
+		uint32_t flags, uint64_t start, uint64_t length,
+		uint32_t proc_id, const char *client_id, uint8_t *status)
+{
+	struct uk_9preq *req;
+	struct uk_9p_str client_id_str;
+	int rc = 0;
+
+	uk_9p_str_init(&client_id_str, client_id);
+
+	req = request_create(dev, UK_9P_TLOCK);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TLOCK fid %u type %u flags %u start %lu length %lu\n",
+			fid->fid, type, flags, start, length);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write8(req, type)) ||
+		(rc = uk_9preq_write32(req, flags)) ||
+		(rc = uk_9preq_write64(req, start)) ||
+		(rc = uk_9preq_write64(req, length)) ||
+		(rc = uk_9preq_write32(req, proc_id)) ||
+		(rc = uk_9preq_writestr(req, &client_id_str)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_read8(req, status)))
+		goto out;
+
+	uk_pr_debug("RLOCK status %u\n", *status);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
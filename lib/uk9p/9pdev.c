@@ -125,11 +125,21 @@ static void _fid_mgmt_cleanup(struct uk_9pdev_fid_mgmt *fid_mgmt)
 	ukplat_spin_unlock_irqrestore(&fid_mgmt->spinlock, flags);
 }
 
+static inline struct uk_hlist_head *
+_req_mgmt_bucket(struct uk_9pdev_req_mgmt *req_mgmt, uint16_t tag)
+{
+	return &req_mgmt->req_ht[tag & (UK_9PDEV_REQ_HT_SIZE - 1)];
+}
+
 static void _req_mgmt_init(struct uk_9pdev_req_mgmt *req_mgmt)
 {
+	int i;
+
 	ukarch_spin_lock_init(&req_mgmt->spinlock);
 	uk_bitmap_zero(req_mgmt->tag_bm, UK_9P_NUMTAGS);
-	UK_INIT_LIST_HEAD(&req_mgmt->req_list);
+	req_mgmt->tag_hint = 0;
+	for (i = 0; i < UK_9PDEV_REQ_HT_SIZE; i++)
+		UK_INIT_HLIST_HEAD(&req_mgmt->req_ht[i]);
 	UK_INIT_LIST_HEAD(&req_mgmt->req_free_list);
 }
 
@@ -137,7 +147,8 @@ static void _req_mgmt_add_req_locked(struct uk_9pdev_req_mgmt *req_mgmt,
 				struct uk_9preq *req)
 {
 	uk_bitmap_set(req_mgmt->tag_bm, req->tag, 1);
-	uk_list_add(&req->_list, &req_mgmt->req_list);
+	uk_hlist_add_head(&req->_hnode,
+			  _req_mgmt_bucket(req_mgmt, req->tag));
 }
 
 static struct uk_9preq *
@@ -159,7 +170,9 @@ static void _req_mgmt_del_req_locked(struct uk_9pdev_req_mgmt *req_mgmt,
 				struct uk_9preq *req)
 {
 	uk_bitmap_clear(req_mgmt->tag_bm, req->tag, 1);
-	uk_list_del(&req->_list);
+	if (req->tag < req_mgmt->tag_hint)
+		req_mgmt->tag_hint = req->tag;
+	uk_hlist_del(&req->_hnode);
 }
 
 static void _req_mgmt_req_to_freelist_locked(struct uk_9pdev_req_mgmt *req_mgmt,
@@ -170,31 +183,57 @@ static void _req_mgmt_req_to_freelist_locked(struct uk_9pdev_req_mgmt *req_mgmt,
 
 static uint16_t _req_mgmt_next_tag_locked(struct uk_9pdev_req_mgmt *req_mgmt)
 {
-	return uk_find_next_zero_bit(req_mgmt->tag_bm, UK_9P_NUMTAGS, 0);
+	uint32_t tag;
+
+	/* Tags below the hint are in use, no need to scan them again. */
+	tag = uk_find_next_zero_bit(req_mgmt->tag_bm, UK_9P_NUMTAGS,
+				    req_mgmt->tag_hint);
+	req_mgmt->tag_hint = tag + 1;
+
+	return tag;
+}
+
+static struct uk_9preq *
+_req_mgmt_lookup_locked(struct uk_9pdev_req_mgmt *req_mgmt, uint16_t tag)
+{
+	struct uk_9preq *req;
+
+	uk_hlist_for_each_entry(req, _req_mgmt_bucket(req_mgmt, tag), _hnode) {
+		if (req->tag == tag)
+			return req;
+	}
+
+	return NULL;
 }
 
 static void _req_mgmt_cleanup(struct uk_9pdev_req_mgmt *req_mgmt __unused)
 {
 	unsigned long flags;
 	uint16_t tag;
+	int i;
+	struct uk_hlist_node *n;
 	struct uk_9preq *req, *reqn;
 
 	ukplat_spin_lock_irqsave(&req_mgmt->spinlock, flags);
-	uk_list_for_each_entry_safe(req, reqn, &req_mgmt->req_list, _list) {
-		tag = req->tag;
-		_req_mgmt_del_req_locked(req_mgmt, req);
-		if (!uk_9preq_put(req)) {
-			/* If in the future these references get released, mark
-			 * _dev as NULL so uk_9pdev_req_to_freelist doesn't
-			 * attempt to place them in an invalid memory region.
+	for (i = 0; i < UK_9PDEV_REQ_HT_SIZE; i++) {
+		uk_hlist_for_each_entry_safe(req, n, &req_mgmt->req_ht[i],
+					     _hnode) {
+			tag = req->tag;
+			_req_mgmt_del_req_locked(req_mgmt, req);
+			if (uk_9preq_put(req))
+				continue;
+			/* If in the future these references get released,
+			 * mark _dev as NULL so uk_9pdev_req_to_freelist
+			 * doesn't attempt to place them in an invalid memory
+			 * region.
 			 *
 			 * As _dev is not used for any other purpose, this
-			 * doesn't impact any other logic related to 9p request
-			 * processing.
+			 * doesn't impact any other logic related to 9p
+			 * request processing.
 			 */
 			req->_dev = NULL;
 			uk_pr_err("Tag %d still has references on cleanup.\n",
-				tag);
+				  tag);
 		}
 	}
 	uk_list_for_each_entry_safe(req, reqn, &req_mgmt->req_free_list,
@@ -385,22 +424,17 @@ struct uk_9preq *uk_9pdev_req_lookup(struct uk_9pdev *dev, uint16_t tag)
 {
 	unsigned long flags;
 	struct uk_9preq *req;
-	int rc = -EINVAL;
 
 	ukplat_spin_lock_irqsave(&dev->_req_mgmt.spinlock, flags);
-	uk_list_for_each_entry(req, &dev->_req_mgmt.req_list, _list) {
-		if (tag != req->tag)
-			continue;
-		rc = 0;
+	req = _req_mgmt_lookup_locked(&dev->_req_mgmt, tag);
+	if (req)
 		uk_9preq_get(req);
-		break;
-	}
 	ukplat_spin_unlock_irqrestore(&dev->_req_mgmt.spinlock, flags);
 
-	if (rc == 0)
+	if (req)
 		return req;
 
-	return ERR2PTR(rc);
+	return ERR2PTR(-EINVAL);
 }
 
 int uk_9pdev_req_remove(struct uk_9pdev *dev, struct uk_9preq *req)
@@ -63,6 +63,8 @@ void uk_9preq_init(struct uk_9preq *req)
 
 	UK_INIT_LIST_HEAD(&req->_list);
 	uk_refcount_init(&req->refcount, 1);
+	req->cb = NULL;
+	req->cb_arg = NULL;
 #if CONFIG_LIBUKSCHED
 	uk_waitq_init(&req->wq);
 #endif
@@ -134,6 +136,12 @@ int uk_9preq_ready(struct uk_9preq *req, enum uk_9preq_zcdir zc_dir,
 	return 0;
 }
 
+static inline int _is_error_reply(struct uk_9preq *req)
+{
+	return req->recv.type == UK_9P_RERROR ||
+		req->recv.type == UK_9P_RLERROR;
+}
+
 int uk_9preq_receive_cb(struct uk_9preq *req, uint32_t recv_size)
 {
 	uint32_t size;
@@ -165,11 +173,23 @@ int uk_9preq_receive_cb(struct uk_9preq *req, uint32_t recv_size)
 		return -EIO;
 
 	/* Fix the receive size for zero-copy requests. */
-	if (req->recv.zc_buf && req->recv.type != UK_9P_RERROR)
+	if (req->recv.zc_buf && !_is_error_reply(req))
 		req->recv.size = req->recv.zc_offset;
 	else
 		req->recv.size = size;
 
+	/*
+	 * An error reply to a zero-copy request overflows into the zero-copy
+	 * buffer: move the error back into the receive buffer before anyone is
+	 * notified, so that uk_9preq_error() can deserialize it.
+	 */
+	if (req->recv.zc_buf && _is_error_reply(req) &&
+	    size > req->recv.zc_offset)
+		memcpy((char *)req->recv.buf + req->recv.zc_offset,
+		       req->recv.zc_buf,
+		       MIN(MIN(req->recv.zc_size, size - req->recv.zc_offset),
+			   UK_9P_BUFSIZE - req->recv.zc_offset));
+
 	/* Update the state. */
 	UK_WRITE_ONCE(req->state, UK_9PREQ_RECEIVED);
 
@@ -178,6 +198,10 @@ int uk_9preq_receive_cb(struct uk_9preq *req, uint32_t recv_size)
 	uk_waitq_wake_up(&req->wq);
 #endif
 
+	/* Notify the owner of an asynchronous request. */
+	if (req->cb)
+		req->cb(req, req->cb_arg);
+
 	return 0;
 }
 
@@ -206,7 +230,7 @@ int uk_9preq_error(struct uk_9preq *req)
 
 	if (UK_READ_ONCE(req->state) != UK_9PREQ_RECEIVED)
 		return -EIO;
-	if (req->recv.type != UK_9P_RERROR)
+	if (!_is_error_reply(req))
 		return 0;
 
 	/*
@@ -215,6 +239,18 @@ int uk_9preq_error(struct uk_9preq *req)
 	 */
 	UK_BUGON(req->recv.offset != UK_9P_HEADER_SIZE);
 
+	/* 9P2000.L servers only reply with the error code. */
+	if (req->recv.type == UK_9P_RLERROR) {
+		if ((rc = uk_9preq_read32(req, &errcode)) < 0)
+			return rc;
+
+		uk_pr_debug("RLERROR %d\n", errcode);
+		if (errcode == 0 || errcode >= 512)
+			return -EIO;
+
+		return -errcode;
+	}
+
 	if ((rc = uk_9preq_readstr(req, &error)) < 0 ||
 		(rc = uk_9preq_read32(req, &errcode)) < 0)
 		return rc;
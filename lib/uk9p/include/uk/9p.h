@@ -45,6 +45,60 @@
 extern "C" {
 #endif
 
+/*
+ * Size of the Rread header, after which the data starts: size (4), type (1),
+ * tag (2) and count (4).
+ */
+#define UK_9P_RREAD_HDRSZ               11U
+
+/*
+ * Size of the Twrite header, after which the data starts: size (4), type (1),
+ * tag (2), fid (4), offset (8) and count (4).
+ */
+#define UK_9P_TWRITE_HDRSZ              23U
+
+/**
+ * Gets the maximum number of bytes a single Tread on the given fid may
+ * transfer, as limited by the message size and the fid's iounit.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to read from.
+ * @return
+ *   Maximum count of a Tread request.
+ */
+static inline uint32_t uk_9p_read_maxcount(struct uk_9pdev *dev,
+		struct uk_9pfid *fid)
+{
+	uint32_t count = dev->msize - UK_9P_RREAD_HDRSZ;
+
+	if (fid->iounit != 0)
+		count = MIN(count, fid->iounit);
+	return count;
+}
+
+/**
+ * Gets the maximum number of bytes a single Twrite on the given fid may
+ * transfer, as limited by the message size and the fid's iounit.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to write to.
+ * @return
+ *   Maximum count of a Twrite request.
+ */
+static inline uint32_t uk_9p_write_maxcount(struct uk_9pdev *dev,
+		struct uk_9pfid *fid)
+{
+	uint32_t count = dev->msize - UK_9P_TWRITE_HDRSZ;
+
+	if (fid->iounit != 0)
+		count = MIN(count, fid->iounit);
+	return count;
+}
+
 /**
  * Negotiates the version and is the first message in a 9P session.
  *
@@ -225,6 +279,70 @@ int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
 int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		uint64_t offset, uint32_t count, const char *buf);
 
+/**
+ * Sends a Tread request without waiting for the reply. At most
+ * uk_9p_read_maxcount() bytes are requested. The data is placed into buf
+ * by the transport when the reply arrives, so buf must remain valid until
+ * the request is completed with uk_9p_rw_complete().
+ *
+ * Several requests may be submitted before completing any of them, which
+ * keeps multiple messages in flight on the transport.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to read from.
+ * @param offset
+ *   Offset at which to start reading.
+ * @param count
+ *   Maximum number of bytes to read.
+ * @param buf
+ *   Buffer to read into.
+ * @return
+ *   - (!ERRPTR): The in-flight request, to be passed to uk_9p_rw_complete().
+ *   - ERRPTR: The error returned by the API.
+ */
+struct uk_9preq *uk_9p_read_submit(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf);
+
+/**
+ * Sends a Twrite request without waiting for the reply. At most
+ * uk_9p_write_maxcount() bytes are sent. The data is read from buf by the
+ * transport, so buf must remain valid until the request is completed with
+ * uk_9p_rw_complete().
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to write to.
+ * @param offset
+ *   Offset at which to start writing.
+ * @param count
+ *   Maximum number of bytes to write.
+ * @param buf
+ *   Data to be written.
+ * @return
+ *   - (!ERRPTR): The in-flight request, to be passed to uk_9p_rw_complete().
+ *   - ERRPTR: The error returned by the API.
+ */
+struct uk_9preq *uk_9p_write_submit(struct uk_9pdev *dev,
+		struct uk_9pfid *fid, uint64_t offset, uint32_t count,
+		const char *buf);
+
+/**
+ * Waits for the reply to a request sent by uk_9p_read_submit() or
+ * uk_9p_write_submit() and removes the request.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param req
+ *   The in-flight request.
+ * @return
+ *   - (>= 0): Amount of bytes read or written.
+ *   - (< 0): An error occurred.
+ */
+int64_t uk_9p_rw_complete(struct uk_9pdev *dev, struct uk_9preq *req);
+
 /**
  * Stats the given fid and places the data into the given stat structure.
  *
@@ -256,6 +374,179 @@ struct uk_9preq *uk_9p_stat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 int uk_9p_wstat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		struct uk_9p_stat *stat);
 
+/*
+ * The following requests are only part of the 9P2000.L variant of the
+ * protocol, and must only be used if the server accepted "9P2000.L" during
+ * version negotiation.
+ */
+
+/**
+ * Opens the fid with the given Linux-style open flags (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param flags
+ *   Open flags, see UK_9P_DOTL_*.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_lopen(struct uk_9pdev *dev, struct uk_9pfid *fid, uint32_t flags);
+
+/**
+ * Creates a new regular file with the given name in the directory associated
+ * with fid, and associates fid with the newly created file, opening it with
+ * the given flags (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P directory fid.
+ * @param name
+ *   Name of the created file.
+ * @param flags
+ *   Open flags, see UK_9P_DOTL_*.
+ * @param mode
+ *   POSIX mode bits of the new file.
+ * @param gid
+ *   Group id of the new file.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_lcreate(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		const char *name, uint32_t flags, uint32_t mode, uint32_t gid);
+
+/**
+ * Creates a new directory with the given name in the directory associated
+ * with dfid (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param dfid
+ *   9P directory fid.
+ * @param name
+ *   Name of the created directory.
+ * @param mode
+ *   POSIX mode bits of the new directory.
+ * @param gid
+ *   Group id of the new directory.
+ * @param qid
+ *   (Optional) Where to store the qid of the new directory.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_mkdir(struct uk_9pdev *dev, struct uk_9pfid *dfid,
+		const char *name, uint32_t mode, uint32_t gid,
+		struct uk_9p_qid *qid);
+
+/**
+ * Gets the attributes of the given fid (9P2000.L). Unlike uk_9p_stat(), the
+ * reply has a fixed layout and no strings.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param request_mask
+ *   Attributes to request, see UK_9P_GETATTR_*. The server may return more
+ *   or fewer of them, see attr->valid.
+ * @param attr
+ *   Where to store the attributes.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_getattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t request_mask, struct uk_9p_attr *attr);
+
+/**
+ * Changes the attributes of the given fid (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param iattr
+ *   Attributes to change, selected by iattr->valid.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_setattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		struct uk_9p_iattr *iattr);
+
+/**
+ * Reads directory entries from the given directory fid, which must have been
+ * opened with uk_9p_lopen(), into the buffer (9P2000.L). The entries can be
+ * deserialized with uk_9preq_readdirent(). A return value of 0 indicates the
+ * end of the directory.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P directory fid.
+ * @param offset
+ *   Zero, or the offset of the last entry returned by the previous call.
+ * @param count
+ *   Maximum number of bytes to read.
+ * @param buf
+ *   Buffer to read into.
+ * @return
+ *   - (>= 0): Amount of bytes read.
+ *   - (< 0): An error occurred.
+ */
+int64_t uk_9p_readdir(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf);
+
+/**
+ * Commits the data (and metadata, unless datasync is set) of the given open
+ * fid to stable storage (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param datasync
+ *   If non-zero, only flush the data, as fdatasync().
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_fsync(struct uk_9pdev *dev, struct uk_9pfid *fid, int datasync);
+
+/**
+ * Acquires or releases a POSIX record lock on the given open fid (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param type
+ *   Lock type, see UK_9P_LOCK_TYPE_*.
+ * @param flags
+ *   Lock flags, see UK_9P_LOCK_FLAGS_*.
+ * @param start
+ *   Start offset of the locked range.
+ * @param length
+ *   Length of the locked range, 0 meaning up to the end of the file.
+ * @param proc_id
+ *   Identifier of the lock owner.
+ * @param client_id
+ *   Name of the client.
+ * @param status
+ *   Where to store the lock status, see UK_9P_LOCK_*.
+ * @return
+ *   - 0: Successful, the outcome is given by status.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_lock(struct uk_9pdev *dev, struct uk_9pfid *fid, uint8_t type,
+		uint32_t flags, uint64_t start, uint64_t length,
+		uint32_t proc_id, const char *client_id, uint8_t *status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -86,6 +86,12 @@ int uk_9pdev_disconnect(struct uk_9pdev *dev);
 /**
  * Send a 9P request to the given 9P device.
  *
+ * This does not wait for the reply: the caller may either block with
+ * uk_9preq_waitreply(), or be notified through the completion callback set
+ * with uk_9preq_set_cb() before sending. Any number of requests may be
+ * in-flight at the same time; this only blocks while the transport has no
+ * space left for the request.
+ *
  * @param dev
  *   The Unikraft 9P Device.
  * @param req
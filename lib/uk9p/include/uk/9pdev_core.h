@@ -107,6 +107,14 @@ struct uk_9pdev_trans_ops {
 	uk_9pdev_request_t                      request;
 };
 
+/**
+ * @internal
+ * Number of buckets of the request hash table. Tags are handed out lowest
+ * first, so as long as fewer requests than this are in flight, every bucket
+ * holds at most one request. Must be a power of two.
+ */
+#define UK_9PDEV_REQ_HT_SIZE            256
+
 /**
  * @internal
  * A structure used for 9p requests' management.
@@ -116,8 +124,10 @@ struct uk_9pdev_req_mgmt {
 	spinlock_t                      spinlock;
 	/* Bitmap of available tags. */
 	unsigned long                   tag_bm[UK_BITS_TO_LONGS(UK_9P_NUMTAGS)];
-	/* List of requests allocated and not yet removed. */
-	struct uk_list_head             req_list;
+	/* Lowest tag that may be available, all tags below it are in use. */
+	uint32_t                        tag_hint;
+	/* Requests allocated and not yet removed, hashed by tag. */
+	struct uk_hlist_head            req_ht[UK_9PDEV_REQ_HT_SIZE];
 	/* Free-list of requests. */
 	struct uk_list_head		req_free_list;
 };
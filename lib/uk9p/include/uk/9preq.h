@@ -126,6 +126,20 @@ enum uk_9preq_state {
 	UK_9PREQ_RECEIVED
 };
 
+struct uk_9preq;
+
+/**
+ * Function type used for notifying the owner of a request that its reply
+ * has been received. It is called from the receive path of the transport
+ * layer (possibly in interrupt context), so it must not block.
+ *
+ * @param req
+ *   The 9P request, in the RECEIVED state.
+ * @param cb_arg
+ *   Argument given to uk_9preq_set_cb().
+ */
+typedef void (*uk_9preq_cb_t)(struct uk_9preq *req, void *cb_arg);
+
 /**
  *  Describes a 9P request.
  *
@@ -158,14 +172,20 @@ struct uk_9preq {
 	enum uk_9preq_state             state;
 	/* Tag allocated to this request. */
 	uint16_t                        tag;
-	/* Entry into the list of requests (API-internal). */
+	/* Entry into the free-list of requests (API-internal). */
 	struct uk_list_head             _list;
+	/* Entry into the tag hash table of requests (API-internal). */
+	struct uk_hlist_node            _hnode;
 	/* @internal 9P device this request belongs to. */
 	struct uk_9pdev                 *_dev;
 	/* @internal Allocator used to allocate this request. */
 	struct uk_alloc                 *_a;
 	/* Tracks the number of references to this structure. */
 	__atomic                        refcount;
+	/* Completion callback, called when the reply is received. */
+	uk_9preq_cb_t                   cb;
+	/* Argument passed to the completion callback. */
+	void                            *cb_arg;
 #if CONFIG_LIBUKSCHED
 	/* Wait-queue for state changes. */
 	struct uk_waitq                 wq;
@@ -202,6 +222,39 @@ void uk_9preq_get(struct uk_9preq *req);
  */
 int uk_9preq_put(struct uk_9preq *req);
 
+/**
+ * Sets the completion callback of the given request. Must be called before
+ * the request is sent.
+ *
+ * @param req
+ *   Reference to the 9p request.
+ * @param cb
+ *   Completion callback, or NULL to disable it.
+ * @param cb_arg
+ *   Argument passed to the callback.
+ */
+static inline void uk_9preq_set_cb(struct uk_9preq *req, uk_9preq_cb_t cb,
+		void *cb_arg)
+{
+	req->cb = cb;
+	req->cb_arg = cb_arg;
+}
+
+/**
+ * Checks, without blocking, whether the reply to the given request has been
+ * received.
+ *
+ * @param req
+ *   Reference to the 9p request.
+ * @return
+ *   - 1: The reply has been received, uk_9preq_waitreply() will not block.
+ *   - 0: The request is still in-flight.
+ */
+static inline int uk_9preq_received(struct uk_9preq *req)
+{
+	return UK_READ_ONCE(req->state) == UK_9PREQ_RECEIVED;
+}
+
 /**
  * Marks the given request as being ready, transitioning between states
  * INITIALIZED and READY.
@@ -275,8 +328,9 @@ int uk_9preq_error(struct uk_9preq *req);
  * - uk_9preq_{read,write}qid
  * - uk_9preq_{read,write}str
  * - uk_9preq_{read,write}stat
+ * - uk_9preq_readdirent
  *
- * For qid, str and stat, read and write always take a pointer.
+ * For qid, str, stat and dirent, read and write always take a pointer.
  * For all other types, write takes the argument by value.
  *
  * Possible return values:
@@ -442,6 +496,20 @@ static inline int uk_9preq_readstat(struct uk_9preq *req,
 	return 0;
 }
 
+static inline int uk_9preq_readdirent(struct uk_9preq *req,
+		struct uk_9p_dirent *val)
+{
+	int rc;
+
+	if ((rc = uk_9preq_readqid(req, &val->qid)) ||
+		(rc = uk_9preq_read64(req, &val->offset)) ||
+		(rc = uk_9preq_read8(req, &val->type)) ||
+		(rc = uk_9preq_readstr(req, &val->name)))
+		return rc;
+
+	return 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,6 +41,7 @@
 #include <stdint.h>
 #include <errno.h>
 
+#include <uk/config.h>
 #include <uk/allocbbuddy.h>
 #include <uk/alloc_impl.h>
 #include <uk/arch/limits.h>
@@ -71,12 +72,26 @@ struct uk_bbpalloc_memr {
 	struct uk_bbpalloc_memr *next;
 	unsigned long first_page;
 	unsigned long nr_pages;
+	/*
+	 * Pages (from the beginning of the region) that were handed over
+	 * to the free lists. The remaining pages and their part of the
+	 * bitmap are not touched until they are populated.
+	 */
+	unsigned long nr_populated;
 	unsigned long mm_alloc_bitmap_size;
 	unsigned long *mm_alloc_bitmap;
 };
 
+#if CONFIG_LIBUKALLOCBBUDDY_LAZY
+#define POPULATE_CHUNK_PAGES \
+	(1UL << (CONFIG_LIBUKALLOCBBUDDY_LAZY_CHUNK_ORDER - __PAGE_SHIFT))
+#else
+#define POPULATE_CHUNK_PAGES (~0UL)
+#endif
+
 struct uk_bbpalloc {
 	unsigned long nr_free_pages;
+	unsigned long nr_unpopulated_pages;
 	chunk_head_t *free_head[FREELIST_SIZE];
 	chunk_head_t free_tail[FREELIST_SIZE];
 	struct uk_bbpalloc_memr *memr_head;
@@ -132,6 +147,10 @@ static inline unsigned long allocated_in_map(struct uk_bbpalloc *b,
 		return 1;
 
 	page_idx = (page_va - memr->first_page) >> __PAGE_SHIFT;
+	/* same for pages that are not populated yet */
+	if (page_idx >= memr->nr_populated)
+		return 1;
+
 	bm_idx = page_idx / PAGES_PER_MAPWORD;
 	bm_off = page_idx & (PAGES_PER_MAPWORD - 1);
 
@@ -221,7 +240,8 @@ static ssize_t bbuddy_availmem(struct uk_alloc *a)
 
 	UK_ASSERT(a != NULL);
 	b = (struct uk_bbpalloc *)&a->priv;
-	return (ssize_t) b->nr_free_pages << __PAGE_SHIFT;
+	return (ssize_t) (b->nr_free_pages + b->nr_unpopulated_pages)
+		<< __PAGE_SHIFT;
 }
 #endif
 
@@ -245,6 +265,87 @@ static inline unsigned long num_pages_to_order(unsigned long num_pages)
 /*********************
  * BINARY BUDDY PAGE ALLOCATOR
  */
+static void bbuddy_pfree(struct uk_alloc *a, void *obj,
+			 unsigned long num_pages);
+
+/*
+ * Hands the next `nr_pages` pages of a region over to the free lists.
+ * Free chunks are inserted with bbuddy_pfree() so that they merge with
+ * their already populated buddies.
+ */
+static unsigned long bbuddy_populate_memr(struct uk_alloc *a,
+					  struct uk_bbpalloc_memr *memr,
+					  unsigned long nr_pages)
+{
+	struct uk_bbpalloc *b = (struct uk_bbpalloc *)&a->priv;
+	unsigned long first_idx, bm_idx, bm_end, i;
+	uintptr_t min, range;
+
+	first_idx = memr->nr_populated;
+	nr_pages = MIN(nr_pages, memr->nr_pages - first_idx);
+	if (!nr_pages)
+		return 0;
+
+	/*
+	 * Bitmap words that cover the new pages only are initialized now
+	 * (all allocated). The first word may be shared with pages that
+	 * were populated before: it was set to all allocated back then.
+	 */
+	bm_idx = DIV_ROUND_UP(first_idx, PAGES_PER_MAPWORD);
+	bm_end = DIV_ROUND_UP(first_idx + nr_pages, PAGES_PER_MAPWORD);
+	if (bm_end > bm_idx)
+		memset(&memr->mm_alloc_bitmap[bm_idx], (unsigned char) ~0,
+		       (bm_end - bm_idx) * BYTES_PER_MAPWORD);
+
+	memr->nr_populated += nr_pages;
+	b->nr_unpopulated_pages -= nr_pages;
+
+	min = memr->first_page + (first_idx << __PAGE_SHIFT);
+	range = nr_pages << __PAGE_SHIFT;
+	while (range != 0) {
+		/*
+		 * Next chunk is limited by alignment of min, but also
+		 * must not be bigger than remaining range.
+		 */
+		for (i = __PAGE_SHIFT; (1UL << (i + 1)) <= range; i++)
+			if (min & (1UL << i))
+				break;
+
+		uk_pr_debug("%"__PRIuptr": Add allocate unit %"__PRIuptr" - %"__PRIuptr" (order %lu)\n",
+			    (uintptr_t)a, min, (uintptr_t)(min + (1UL << i)),
+			    (i - __PAGE_SHIFT));
+
+		bbuddy_pfree(a, (void *)min, 1UL << (i - __PAGE_SHIFT));
+		min += 1UL << i;
+		range -= 1UL << i;
+	}
+
+	return nr_pages;
+}
+
+/* Populates up to `nr_pages` pages, returns the number of added pages */
+static unsigned long bbuddy_populate(struct uk_alloc *a,
+				     unsigned long nr_pages)
+{
+	struct uk_bbpalloc *b = (struct uk_bbpalloc *)&a->priv;
+	struct uk_bbpalloc_memr *memr;
+	unsigned long count = 0;
+
+	for (memr = b->memr_head; memr && count < nr_pages;
+	     memr = memr->next)
+		count += bbuddy_populate_memr(a, memr, nr_pages - count);
+
+	return count;
+}
+
+size_t uk_allocbbuddy_populate(struct uk_alloc *a, size_t len)
+{
+	UK_ASSERT(a != NULL);
+
+	return (size_t) bbuddy_populate(a, DIV_ROUND_UP(len, __PAGE_SIZE))
+		<< __PAGE_SHIFT;
+}
+
 static void *bbuddy_palloc(struct uk_alloc *a, unsigned long num_pages)
 {
 	struct uk_bbpalloc *b;
@@ -258,12 +359,19 @@ static void *bbuddy_palloc(struct uk_alloc *a, unsigned long num_pages)
 	size_t order = (size_t)num_pages_to_order(num_pages);
 
 	/* Find smallest order which can satisfy the request. */
-	for (i = order; i < FREELIST_SIZE; i++) {
-		if (!FREELIST_EMPTY(b->free_head[i]))
+	for (;;) {
+		for (i = order; i < FREELIST_SIZE; i++) {
+			if (!FREELIST_EMPTY(b->free_head[i]))
+				break;
+		}
+		if (i < FREELIST_SIZE)
 			break;
+
+		/* Populate more memory, if there is any left */
+		if (bbuddy_populate(a, MAX(POPULATE_CHUNK_PAGES,
+					   1UL << order)) == 0)
+			goto no_memory;
 	}
-	if (i == FREELIST_SIZE)
-		goto no_memory;
 
 	/* Unlink a chunk. */
 	alloc_ch = b->free_head[i];
@@ -300,7 +408,8 @@ no_memory:
 	return NULL;
 }
 
-static void bbuddy_pfree(struct uk_alloc *a, void *obj, unsigned long num_pages)
+static void bbuddy_pfree(struct uk_alloc *a, void *obj,
+			 unsigned long num_pages)
 {
 	struct uk_bbpalloc *b;
 	chunk_head_t *freed_ch, *to_merge_ch;
@@ -367,9 +476,6 @@ static int bbuddy_addmem(struct uk_alloc *a, void *base, size_t len)
 	struct uk_bbpalloc *b;
 	struct uk_bbpalloc_memr *memr;
 	size_t memr_size;
-	unsigned long count, i;
-	chunk_head_t *ch;
-	chunk_tail_t *ct;
 	uintptr_t min, max, range;
 
 	UK_ASSERT(a != NULL);
@@ -420,48 +526,19 @@ static int bbuddy_addmem(struct uk_alloc *a, void *base, size_t len)
 	range -= memr_size;
 
 	/*
-	 * Initialize region's bitmap
+	 * Initialize region's bitmap: pages are populated (and the
+	 * according bitmap words initialized) in chunks. Without lazy
+	 * initialization, the whole region is populated right away.
 	 */
 	memr->first_page = min;
+	memr->nr_pages = MIN(memr->nr_pages, range >> __PAGE_SHIFT);
+	memr->nr_populated = 0;
+	b->nr_unpopulated_pages += memr->nr_pages;
 	/* add to list */
 	memr->next = b->memr_head;
 	b->memr_head = memr;
 
-	/* All allocated by default. */
-	memset(memr->mm_alloc_bitmap, (unsigned char) ~0,
-			memr->mm_alloc_bitmap_size);
-
-	/* free up the memory we've been given to play with */
-	map_free(b, min, memr->nr_pages);
-
-	count = 0;
-	while (range != 0) {
-		/*
-		 * Next chunk is limited by alignment of min, but also
-		 * must not be bigger than remaining range.
-		 */
-		for (i = __PAGE_SHIFT; (1UL << (i + 1)) <= range; i++)
-			if (min & (1UL << i))
-				break;
-
-		uk_pr_debug("%"__PRIuptr": Add allocate unit %"__PRIuptr" - %"__PRIuptr" (order %lu)\n",
-			    (uintptr_t)a, min, (uintptr_t)(min + (1UL << i)),
-			    (i - __PAGE_SHIFT));
-
-		ch = (chunk_head_t *)min;
-		min += 1UL << i;
-		range -= 1UL << i;
-		ct = (chunk_tail_t *)min - 1;
-		i -= __PAGE_SHIFT;
-		ch->level = i;
-		ch->next = b->free_head[i];
-		ch->pprev = &b->free_head[i];
-		ch->next->pprev = &ch->next;
-		b->free_head[i] = ch;
-		ct->level = i;
-		count++;
-	}
-
+	bbuddy_populate_memr(a, memr, POPULATE_CHUNK_PAGES);
 	return 0;
 }
 
@@ -42,6 +42,16 @@ extern "C" {
 
 struct uk_alloc *uk_allocbbuddy_init(void *base, size_t len);
 
+/**
+ * Populates up to `len` bytes of memory that was added but not yet
+ * handed over to the allocator (see CONFIG_LIBUKALLOCBBUDDY_LAZY). This
+ * can be used to prepare memory ahead of time, e.g., from an idle thread.
+ * @param a Binary buddy allocator
+ * @param len Number of bytes to populate
+ * @return Number of populated bytes, 0 if all memory is populated
+ */
+size_t uk_allocbbuddy_populate(struct uk_alloc *a, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,7 +66,12 @@
 #ifdef CONFIG_LIBUKSP
 #include <uk/sp.h>
 #endif
+#if CONFIG_LIBUKDEBUG_TRACEPOINTS
+#include <uk/trace.h>
+#endif
 #include "banner.h"
+#include "bootprof.h"
+#include "initjob.h"
 
 int main(int argc, char *argv[]) __weak;
 
@@ -77,29 +82,70 @@ struct thread_main_arg {
 	char **argv;
 };
 
+/* Boundaries of the init classes in the init table */
+static const uk_init_func_t * const inittab_class[] = {
+	uk_inittab1_start,
+	uk_inittab2_start,
+	uk_inittab3_start,
+	uk_inittab4_start,
+	uk_inittab5_start,
+	uk_inittab6_start,
+	&uk_inittab_end,
+};
+
+#if CONFIG_LIBUKSCHED
+/* Profile record of the scheduler start, ends in the main thread */
+static int prof_sched_start = -1;
+#endif
+
 static void main_thread_func(void *arg)
 {
 	int i;
 	int ret;
+	int class;
+	int prof;
 	struct thread_main_arg *tma = arg;
 	uk_ctor_func_t *ctorfn;
-	uk_init_func_t *initfn;
+	const uk_init_func_t *initfn;
+
+#if CONFIG_LIBUKSCHED
+	bootprof_end(prof_sched_start, 0);
+#if CONFIG_LIBUKDEBUG_TRACEPOINTS
+	/* From now on, all code runs in threads with TLS areas */
+	uk_trace_tls_init();
+#endif
+#endif
 
 	/**
 	 * Run init table
+	 * Asynchronous init functions of a class are started first and
+	 * have to complete before the next class is entered.
 	 */
 	uk_pr_info("Init Table @ %p - %p\n",
 		   &uk_inittab_start[0], &uk_inittab_end);
-	uk_inittab_foreach(initfn, uk_inittab_start, uk_inittab_end) {
-		UK_ASSERT(*initfn);
-		uk_pr_debug("Call init function: %p()...\n", *initfn);
-		ret = (*initfn)();
-		if (ret < 0) {
-			uk_pr_err("Init function at %p returned error %d\n",
-				  *initfn, ret);
-			ret = UKPLAT_CRASH;
-			goto exit;
+	for (class = 0; class < (int) ARRAY_SIZE(inittab_class) - 1; ++class) {
+		ret = initjobs_start(class + 1);
+		if (ret < 0)
+			goto err_init;
+
+		for (initfn = inittab_class[class];
+		     initfn < inittab_class[class + 1]; ++initfn) {
+			UK_ASSERT(*initfn);
+			uk_pr_debug("Call init function: %p()...\n", *initfn);
+			prof = bootprof_begin(NULL, (const void *) *initfn,
+					      class + 1, 0);
+			ret = (*initfn)();
+			bootprof_end(prof, ret);
+			if (ret < 0) {
+				uk_pr_err("Init function at %p returned error %d\n",
+					  *initfn, ret);
+				goto err_init;
+			}
 		}
+
+		ret = initjobs_join(class + 1);
+		if (ret < 0)
+			goto err_init;
 	}
 
 #ifdef CONFIG_LIBUKSP
@@ -126,7 +172,9 @@ static void main_thread_func(void *arg)
 			continue;
 
 		uk_pr_debug("Call pre-init constructor: %p()...\n", *ctorfn);
+		prof = bootprof_begin(NULL, (const void *) *ctorfn, 0, 0);
 		(*ctorfn)();
+		bootprof_end(prof, 0);
 	}
 
 	uk_pr_info("Constructor table at %p - %p\n",
@@ -136,9 +184,13 @@ static void main_thread_func(void *arg)
 			continue;
 
 		uk_pr_debug("Call constructor: %p()...\n", *ctorfn);
+		prof = bootprof_begin(NULL, (const void *) *ctorfn, 0, 0);
 		(*ctorfn)();
+		bootprof_end(prof, 0);
 	}
 
+	bootprof_finish();
+
 	uk_pr_info("Calling main(%d, [", tma->argc);
 	for (i = 0; i < tma->argc; ++i) {
 		uk_pr_info("'%s'", tma->argv[i]);
@@ -150,8 +202,12 @@ static void main_thread_func(void *arg)
 	ret = main(tma->argc, tma->argv);
 	uk_pr_info("main returned %d, halting system\n", ret);
 	ret = (ret != 0) ? UKPLAT_CRASH : UKPLAT_HALT;
+	goto exit;
 
+err_init:
+	ret = UKPLAT_CRASH;
 exit:
+	uk_print_flush();
 	ukplat_terminate(ret); /* does not return */
 }
 
@@ -179,6 +235,7 @@ void ukplat_entry(int argc, char *argv[])
 	struct thread_main_arg tma;
 	int kern_args = 0;
 	int rc __maybe_unused = 0;
+	int prof __maybe_unused;
 #if CONFIG_LIBUKALLOC
 	struct uk_alloc *a = NULL;
 #endif
@@ -197,11 +254,15 @@ void ukplat_entry(int argc, char *argv[])
 	uk_ctortab_foreach(ctorfn, uk_ctortab_start, uk_ctortab_end) {
 		UK_ASSERT(*ctorfn);
 		uk_pr_debug("Call constructor: %p())...\n", *ctorfn);
+		prof = bootprof_begin(NULL, (const void *) *ctorfn, 0, 0);
 		(*ctorfn)();
+		bootprof_end(prof, 0);
 	}
 
 #ifdef CONFIG_LIBUKLIBPARAM
+	prof = bootprof_begin("libparam", NULL, 0, 0);
 	rc = (argc > 1) ? uk_libparam_parse(argv[0], argc - 1, &argv[1]) : 0;
+	bootprof_end(prof, rc);
 	if (unlikely(rc < 0))
 		uk_pr_crit("Failed to parse the kernel argument\n");
 	else {
@@ -231,6 +292,8 @@ void ukplat_entry(int argc, char *argv[])
 		 * As soon we have an allocator, we simply add every
 		 * subsequent region to it
 		 */
+		prof = bootprof_begin(a ? "alloc addmem" : "alloc init",
+				      md.base, 0, 0);
 		if (!a) {
 #if CONFIG_LIBUKBOOT_INITBBUDDY
 			a = uk_allocbbuddy_init(md.base, md.len);
@@ -242,6 +305,7 @@ void ukplat_entry(int argc, char *argv[])
 		} else {
 			uk_alloc_addmem(a, md.base, md.len);
 		}
+		bootprof_end(prof, 0);
 	}
 	if (unlikely(!a))
 		uk_pr_warn("No suitable memory region for memory allocator. Continue without heap\n");
@@ -254,18 +318,24 @@ void ukplat_entry(int argc, char *argv[])
 
 #if CONFIG_LIBUKALLOC
 	uk_pr_info("Initialize IRQ subsystem...\n");
+	prof = bootprof_begin("irq init", NULL, 0, 0);
 	rc = ukplat_irq_init(a);
+	bootprof_end(prof, rc);
 	if (unlikely(rc != 0))
 		UK_CRASH("Could not initialize the platform IRQ subsystem\n");
 #endif
 
 	/* On most platforms the timer depend on an initialized IRQ subsystem */
 	uk_pr_info("Initialize platform time...\n");
+	prof = bootprof_begin("time init", NULL, 0, 0);
 	ukplat_time_init();
+	bootprof_end(prof, 0);
 
 #if CONFIG_LIBUKSCHED
 	/* Init scheduler. */
+	prof = bootprof_begin("sched init", NULL, 0, 0);
 	s = uk_sched_default_init(a);
+	bootprof_end(prof, 0);
 	if (unlikely(!s))
 		UK_CRASH("Could not initialize the scheduler\n");
 #endif
@@ -277,6 +347,7 @@ void ukplat_entry(int argc, char *argv[])
 	main_thread = uk_thread_create("main", main_thread_func, &tma);
 	if (unlikely(!main_thread))
 		UK_CRASH("Could not create main thread\n");
+	prof_sched_start = bootprof_begin("sched start", NULL, 0, 0);
 	uk_sched_start(s);
 #else
 	/* Enable interrupts before starting the application */
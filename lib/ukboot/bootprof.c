@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/config.h>
+#include <stdio.h>
+#include <errno.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/print.h>
+#include <uk/plat/time.h>
+#include <uk/bootprof.h>
+#include "bootprof.h"
+
+#define NSEC_PER_USEC 1000UL
+
+static struct uk_bootprof_entry bootprof[CONFIG_LIBUKBOOT_PROFILE_ENTRIES];
+static unsigned int bootprof_cnt;
+static unsigned int bootprof_dropped;
+
+int bootprof_begin(const char *name, const void *fn, int class,
+		   unsigned int tid)
+{
+	struct uk_bootprof_entry *e;
+
+	/* Records are only taken cooperatively, so no locking is needed */
+	if (unlikely(bootprof_cnt >= ARRAY_SIZE(bootprof))) {
+		bootprof_dropped++;
+		return -1;
+	}
+
+	e = &bootprof[bootprof_cnt];
+	e->name = name;
+	e->fn = fn;
+	e->class = class;
+	e->ret = 0;
+	e->tid = tid;
+	e->duration = 0;
+	e->start = ukplat_monotonic_clock();
+	return (int) bootprof_cnt++;
+}
+
+void bootprof_end(int handle, int ret)
+{
+	struct uk_bootprof_entry *e;
+
+	if (unlikely(handle < 0))
+		return;
+
+	UK_ASSERT((unsigned int) handle < bootprof_cnt);
+	e = &bootprof[handle];
+	e->duration = ukplat_monotonic_clock() - e->start;
+	e->ret = ret;
+}
+
+unsigned int uk_bootprof_count(void)
+{
+	return bootprof_cnt;
+}
+
+const struct uk_bootprof_entry *uk_bootprof_get(unsigned int idx)
+{
+	if (idx >= bootprof_cnt)
+		return NULL;
+	return &bootprof[idx];
+}
+
+void uk_bootprof_report(void)
+{
+	const struct uk_bootprof_entry *e;
+	__nsec first = 0, last = 0;
+	unsigned int i;
+
+	uk_pr_info("Boot profile (times in microseconds):\n");
+	uk_pr_info("%12s %10s %5s %4s %s\n",
+		   "start", "duration", "class", "tid", "step");
+	for (i = 0; i < bootprof_cnt; ++i) {
+		e = &bootprof[i];
+
+		if (e->name)
+			uk_pr_info("%8"__PRIu64".%03u %6"__PRIu64".%03u %5d %4u %s\n",
+				   (__u64) (e->start / NSEC_PER_USEC),
+				   (unsigned int) (e->start % NSEC_PER_USEC),
+				   (__u64) (e->duration / NSEC_PER_USEC),
+				   (unsigned int) (e->duration % NSEC_PER_USEC),
+				   e->class, e->tid, e->name);
+		else
+			uk_pr_info("%8"__PRIu64".%03u %6"__PRIu64".%03u %5d %4u %p()%s\n",
+				   (__u64) (e->start / NSEC_PER_USEC),
+				   (unsigned int) (e->start % NSEC_PER_USEC),
+				   (__u64) (e->duration / NSEC_PER_USEC),
+				   (unsigned int) (e->duration % NSEC_PER_USEC),
+				   e->class, e->tid, e->fn,
+				   e->ret < 0 ? " failed" : "");
+
+		if (e->start && (!first || e->start < first))
+			first = e->start;
+		if (e->start + e->duration > last)
+			last = e->start + e->duration;
+	}
+
+	uk_pr_info("Boot took %"__PRIu64" us (%u steps, %u not recorded)\n",
+		   (__u64) ((last - first) / NSEC_PER_USEC),
+		   bootprof_cnt, bootprof_dropped);
+}
+
+int uk_bootprof_trace(FILE *fp)
+{
+	const struct uk_bootprof_entry *e;
+	unsigned int i;
+	int ret;
+
+	ret = fprintf(fp, "{\"traceEvents\":[\n");
+	for (i = 0; i < bootprof_cnt && ret >= 0; ++i) {
+		e = &bootprof[i];
+
+		/* Names are C identifiers or fixed strings: no escaping */
+		ret = fprintf(fp, "%s{\"name\":\"", i ? ",\n" : "");
+		if (ret < 0)
+			break;
+		if (e->name)
+			ret = fprintf(fp, "%s", e->name);
+		else
+			ret = fprintf(fp, "%p", e->fn);
+		if (ret < 0)
+			break;
+		ret = fprintf(fp, "\",\"cat\":\"class%d\",\"ph\":\"X\","
+			      "\"pid\":0,\"tid\":%u,"
+			      "\"ts\":%"__PRIu64".%03u,\"dur\":%"__PRIu64".%03u,"
+			      "\"args\":{\"fn\":\"%p\",\"ret\":%d}}",
+			      e->class, e->tid,
+			      (__u64) (e->start / NSEC_PER_USEC),
+			      (unsigned int) (e->start % NSEC_PER_USEC),
+			      (__u64) (e->duration / NSEC_PER_USEC),
+			      (unsigned int) (e->duration % NSEC_PER_USEC),
+			      e->fn, e->ret);
+	}
+	if (ret >= 0)
+		ret = fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	if (ret >= 0)
+		ret = fflush(fp);
+
+	return (ret < 0) ? -EIO : 0;
+}
+
+void bootprof_finish(void)
+{
+#if CONFIG_LIBUKBOOT_PROFILE_REPORT
+	uk_bootprof_report();
+#endif
+#if CONFIG_LIBUKBOOT_PROFILE_TRACE
+	uk_bootprof_trace(stderr);
+#endif
+}
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _LIBUKBOOT_BOOTPROF_H_
+#define _LIBUKBOOT_BOOTPROF_H_
+
+#include <uk/config.h>
+#include <uk/essentials.h>
+
+#if CONFIG_LIBUKBOOT_PROFILE
+/*
+ * Starts a new profile record and returns a handle for bootprof_end().
+ * A negative handle is returned when the record table is full.
+ */
+int bootprof_begin(const char *name, const void *fn, int class,
+		   unsigned int tid);
+void bootprof_end(int handle, int ret);
+void bootprof_finish(void);
+#else
+static inline int bootprof_begin(const char *name __unused,
+				 const void *fn __unused,
+				 int class __unused,
+				 unsigned int tid __unused)
+{
+	return -1;
+}
+
+static inline void bootprof_end(int handle __unused, int ret __unused) { }
+static inline void bootprof_finish(void) { }
+#endif /* CONFIG_LIBUKBOOT_PROFILE */
+
+#endif /* _LIBUKBOOT_BOOTPROF_H_ */
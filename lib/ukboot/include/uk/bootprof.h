@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_BOOTPROF_H__
+#define __UK_BOOTPROF_H__
+
+#include <uk/config.h>
+#include <uk/arch/types.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Boot profile record. One record is taken for each constructor, boot
+ * step (memory allocator, IRQ, time and scheduler initialization) and
+ * init function that was called during boot.
+ * Timestamps are taken from the platform monotonic clock, so steps that
+ * run before the clock is initialized may be reported with 0.
+ */
+struct uk_bootprof_entry {
+	/* Name of the step, NULL for anonymous constructors/init functions */
+	const char *name;
+	/* Called function (if any) */
+	const void *fn;
+	/* Init class (1-6), 0 for steps outside of the init table */
+	int class;
+	/* Return code of init functions, 0 otherwise */
+	int ret;
+	/* Executing context: 0 for the boot thread, > 0 for async init */
+	unsigned int tid;
+	__nsec start;
+	__nsec duration;
+};
+
+/**
+ * Returns the number of recorded boot profile entries
+ */
+unsigned int uk_bootprof_count(void);
+
+/**
+ * Returns a recorded boot profile entry
+ * @param idx Index of the entry, in the order the steps were started
+ * @return Pointer to the entry or NULL if `idx` is out of range
+ */
+const struct uk_bootprof_entry *uk_bootprof_get(unsigned int idx);
+
+/**
+ * Prints a human-readable boot report to the kernel console
+ */
+void uk_bootprof_report(void);
+
+/**
+ * Writes the boot profile as JSON in the Trace Event Format
+ * (e.g., for chrome://tracing or Perfetto)
+ * @param fp Stream to write to
+ * @return 0 on success, < 0 on write errors
+ */
+int uk_bootprof_trace(FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_BOOTPROF_H__ */
@@ -0,0 +1,259 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/config.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/print.h>
+#include <uk/init.h>
+#if CONFIG_LIBUKSCHED
+#include <uk/thread.h>
+#include <uk/sched.h>
+#include <uk/wait.h>
+#endif
+#include "bootprof.h"
+#include "initjob.h"
+
+#define INITJOB_PENDING		0
+#define INITJOB_RUNNING		1
+#define INITJOB_DONE		2
+
+#if CONFIG_LIBUKSCHED
+static DEFINE_WAIT_QUEUE(initjob_wq);
+#endif
+
+static const struct uk_initjob *initjob_find(const char *name)
+{
+	const struct uk_initjob *job;
+
+	uk_initjobs_foreach(job) {
+		if (strcmp(job->name, name) == 0)
+			return job;
+	}
+	return NULL;
+}
+
+static inline unsigned int initjob_tid(const struct uk_initjob *job)
+{
+	return (unsigned int) (job - uk_initjobs_start) + 1;
+}
+
+/* Returns 1 if all dependencies returned, -1 if one of them failed */
+static int initjob_deps_done(const struct uk_initjob *job)
+{
+	const struct uk_initjob *dep;
+	unsigned int i;
+
+	for (i = 0; i < job->ndeps; ++i) {
+		dep = initjob_find(job->deps[i]);
+		UK_ASSERT(dep);
+
+		if (dep->state->status != INITJOB_DONE)
+			return 0;
+		if (dep->state->ret < 0)
+			return -1;
+	}
+	return 1;
+}
+
+static void initjob_call(const struct uk_initjob *job)
+{
+	int prof;
+	int ret;
+
+	if (initjob_deps_done(job) < 0) {
+		uk_pr_err("Skip init function %s(): dependency failed\n",
+			  job->name);
+		ret = -ECANCELED;
+	} else {
+		job->state->status = INITJOB_RUNNING;
+		uk_pr_debug("Call async init function: %s()...\n",
+			    job->name);
+		prof = bootprof_begin(job->name, (const void *) job->func,
+				      job->initclass, initjob_tid(job));
+		ret = job->func();
+		bootprof_end(prof, ret);
+		if (ret < 0)
+			uk_pr_err("Init function %s() returned error %d\n",
+				  job->name, ret);
+	}
+
+	job->state->ret = ret;
+	job->state->status = INITJOB_DONE;
+#if CONFIG_LIBUKSCHED
+	uk_waitq_wake_up(&initjob_wq);
+#endif
+}
+
+/*
+ * Checks the dependencies of the jobs of a class and orders them
+ * topologically: `mark` is set to the position of each job in a valid
+ * calling order. Jobs of earlier classes are completed already.
+ */
+static int initjobs_order(int class)
+{
+	const struct uk_initjob *job, *dep;
+	unsigned int left = 0, pos = 0, i;
+	int progress;
+
+	uk_initjobs_foreach(job) {
+		if (job->initclass != class)
+			continue;
+
+		for (i = 0; i < job->ndeps; ++i) {
+			dep = initjob_find(job->deps[i]);
+			if (unlikely(!dep || dep->initclass > class)) {
+				uk_pr_crit("Init function %s() depends on %s%s\n",
+					   job->name, job->deps[i],
+					   dep ? " of a later init class"
+					       : ", which is unknown");
+				return -EINVAL;
+			}
+		}
+		job->state->mark = 0;
+		left++;
+	}
+
+	do {
+		progress = 0;
+		uk_initjobs_foreach(job) {
+			if (job->initclass != class || job->state->mark)
+				continue;
+
+			for (i = 0; i < job->ndeps; ++i) {
+				dep = initjob_find(job->deps[i]);
+				if (dep->initclass == class && !dep->state->mark)
+					break;
+			}
+			if (i < job->ndeps)
+				continue;
+
+			job->state->mark = ++pos;
+			progress = 1;
+			left--;
+		}
+	} while (left && progress);
+
+	if (unlikely(left)) {
+		uk_pr_crit("Dependency cycle between %u init functions of class %d\n",
+			   left, class);
+		return -ELOOP;
+	}
+	return 0;
+}
+
+#if CONFIG_LIBUKSCHED
+static void initjob_thread(void *arg)
+{
+	const struct uk_initjob *job = arg;
+
+	uk_waitq_wait_event(&initjob_wq, initjob_deps_done(job) != 0);
+	initjob_call(job);
+}
+#endif
+
+int initjobs_start(int class)
+{
+	const struct uk_initjob *job;
+	unsigned int pos, npos = 0;
+	int ret;
+
+	ret = initjobs_order(class);
+	if (unlikely(ret < 0))
+		return ret;
+
+	uk_initjobs_foreach(job) {
+		if (job->initclass == class)
+			npos++;
+	}
+
+#if CONFIG_LIBUKSCHED
+	/* Threads are created in calling order, so that the scheduler picks
+	 * runnable ones first.
+	 */
+	for (pos = 1; pos <= npos; ++pos) {
+		uk_initjobs_foreach(job) {
+			if (job->initclass != class || job->state->mark != pos)
+				continue;
+
+			job->state->status = INITJOB_PENDING;
+			job->state->thread = uk_thread_create(job->name,
+							      initjob_thread,
+							      (void *) job);
+			if (unlikely(!job->state->thread)) {
+				uk_pr_warn("Could not create thread for %s(), calling it synchronously\n",
+					   job->name);
+				uk_waitq_wait_event(&initjob_wq,
+						    initjob_deps_done(job) != 0);
+				initjob_call(job);
+			}
+		}
+	}
+
+	/* Let the jobs run until they block, so that the boot thread
+	 * continues with the class while they wait
+	 */
+	if (npos)
+		uk_sched_yield();
+#else
+	for (pos = 1; pos <= npos; ++pos) {
+		uk_initjobs_foreach(job) {
+			if (job->initclass == class && job->state->mark == pos)
+				initjob_call(job);
+		}
+	}
+#endif
+	return 0;
+}
+
+int initjobs_join(int class)
+{
+	const struct uk_initjob *job;
+	int ret = 0;
+
+	uk_initjobs_foreach(job) {
+		if (job->initclass != class)
+			continue;
+
+#if CONFIG_LIBUKSCHED
+		if (job->state->thread) {
+			uk_thread_wait(job->state->thread);
+			job->state->thread = NULL;
+		}
+#endif
+		UK_ASSERT(job->state->status == INITJOB_DONE);
+		if (job->state->ret < 0 && !ret)
+			ret = job->state->ret;
+	}
+	return ret;
+}
@@ -137,4 +137,7 @@ static int uk_bus_lib_init(void)
 	uk_bus_probe_all();
 	return 0;
 }
-uk_initcall_class_prio(uk_bus_lib_init, UK_BUS_INIT_CLASS, UK_BUS_INIT_PRIO);
+/* Probing waits for devices or the hypervisor (e.g., xenstore requests)
+ * while the other init functions of the class can run
+ */
+uk_initcall_class_async(uk_bus_lib_init, UK_BUS_INIT_CLASS);
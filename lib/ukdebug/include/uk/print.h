@@ -154,6 +154,23 @@ static inline void uk_printk(int lvl __unused, const char *fmt __unused, ...)
 {}
 #endif /* CONFIG_LIBUKDEBUG_PRINTK */
 
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+/**
+ * Writes all buffered messages to the console synchronously. Messages
+ * are otherwise written out by a background thread.
+ */
+void uk_print_flush(void);
+
+/**
+ * Returns the number of messages that were dropped since the last
+ * flush because the print buffer was full.
+ */
+unsigned long uk_print_drops(void);
+#else
+static inline void uk_print_flush(void)
+{}
+#endif /* CONFIG_LIBUKDEBUG_PRINT_ASYNC */
+
 /*
  * Convenience wrapper for uk_printk() and uk_printd()
  * This is similar to the pr_* variants that you find in the Linux kernel
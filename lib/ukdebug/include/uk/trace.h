@@ -47,7 +47,16 @@
  */
 #define __UK_TRACE_MAX_STRLEN 80
 #define UK_TP_HEADER_MAGIC 0x64685254 /* TRhd */
+#define UK_TP_PAD_MAGIC 0x64615054 /* TPad */
 #define UK_TP_DEF_MAGIC 0x65645054 /* TPde */
+#define UK_TRACE_EXPORT_MAGIC 0x52544b55 /* UKTR */
+#define UK_TRACE_EXPORT_BUF_MAGIC 0x42544b55 /* UKTB */
+
+/* Each trace buffer is divided into chunks. A record never spans two
+ * chunks; in ring mode, the oldest chunk is overwritten as a whole.
+ */
+#define UK_TRACE_CHUNKS 8
+#define UK_TRACE_ALIGN 8
 
 enum __uk_trace_arg_type {
 	__UK_TRACE_ARG_INT = 0,
@@ -61,9 +70,114 @@ struct uk_tracepoint_header {
 	void *cookie;
 };
 
-extern size_t uk_trace_buffer_free;
-extern char *uk_trace_buffer_writep;
+/* Layout of the binary export (see uk_trace_export()): a stream header,
+ * followed by a buffer header and the records of each buffer in
+ * chronological order, without padding
+ */
+struct uk_trace_export_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ptr_size;
+	uint32_t nr_buffers;
+};
 
+struct uk_trace_export_buffer {
+	uint32_t magic;
+	uint32_t index;
+	uint64_t owner;
+	uint64_t lost;
+	uint64_t len;
+};
+
+#ifdef CONFIG_LIBUKDEBUG_TRACEPOINTS
+struct uk_trace_buffer {
+	/* Bytes reserved since boot, the write position is head modulo
+	 * the buffer size
+	 */
+	unsigned long head;
+	/* Tag of the thread that claimed the buffer, 0 if unused */
+	unsigned long owner;
+	/* Records that were dropped because the buffer was full */
+	unsigned long lost;
+	char data[CONFIG_LIBUKDEBUG_TRACE_BUFFER_SIZE] __align(UK_TRACE_ALIGN);
+};
+
+extern struct uk_trace_buffer uk_trace_buffers[];
+
+/* Item of the export at which the last uk_trace_export() call stopped */
+struct uk_trace_export_cursor {
+	size_t stream;		/* Offset of the item in the export */
+	int buf;		/* Buffer index, -1 for the stream header */
+	unsigned long pos;	/* Position of the record in the buffer */
+	size_t done;		/* Record bytes of the buffer before the item */
+};
+
+/* Layout of the buffers at the time of uk_trace_snapshot_take() */
+struct uk_trace_snapshot {
+	unsigned long start[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+	unsigned long end[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+	size_t len[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+	unsigned long owner[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+	unsigned long lost[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+	struct uk_trace_export_cursor cur;
+};
+#endif
+
+/**
+ * Reserves space for a record with `size` bytes of arguments in the trace
+ * buffer of the calling thread. Lock-free and safe to call from interrupt
+ * context.
+ *
+ * @return
+ *   Pointer to the argument area, NULL if there is no space
+ */
+char *__uk_trace_reserve(size_t size, void *cookie);
+
+/**
+ * Records the committed records of all trace buffers, which are then
+ * exported by uk_trace_export(). Records added later are not part of the
+ * export.
+ */
+void uk_trace_snapshot_take(struct uk_trace_snapshot *s);
+
+/**
+ * Copies up to `len` bytes of the binary trace export of snapshot `s`,
+ * starting at offset `off`, to `buf`. Reading the export sequentially
+ * walks the buffers once. The export can be decoded with
+ * support/scripts/uk_trace.
+ *
+ * @return
+ *   Number of bytes copied, 0 at the end of the export
+ */
+size_t uk_trace_export(struct uk_trace_snapshot *s,
+		       void *buf, size_t len, size_t off);
+
+/**
+ * Writes the binary trace export as hex lines, prefixed with "uktrace:",
+ * to the kernel console.
+ */
+void uk_trace_dump(void);
+
+/**
+ * Lets threads claim separate trace buffers. Called once all code runs
+ * in threads with a TLS area.
+ */
+void uk_trace_tls_init(void);
+
+/**
+ * Releases the trace buffer claimed by the thread with the given TLS area,
+ * so that other threads can claim it. Called when the thread is destroyed.
+ */
+void uk_trace_tls_release(void *tls_area, size_t size);
+
+static inline size_t __uk_trace_arg_size(enum __uk_trace_arg_type type,
+					 int size, long arg)
+{
+	if (type == __UK_TRACE_ARG_STRING)
+		/* The '+1' is for storing length of the string */
+		return strnlen((char *) arg, __UK_TRACE_MAX_STRLEN) + 1;
+	return size;
+}
 
 static inline void __uk_trace_save_arg(char **pbuff,
 				      size_t *pfree,
@@ -76,18 +190,14 @@ static inline void __uk_trace_save_arg(char **pbuff,
 	int len;
 
 	if (type == __UK_TRACE_ARG_STRING) {
-		len = strnlen((char *) arg, __UK_TRACE_MAX_STRLEN);
-		/* The '+1' is for storing length of the string */
+		/* The string might have changed since the record size was
+		 * computed, never write more than was reserved
+		 */
+		len = strnlen((char *) arg,
+			      MIN(free - 1, (size_t) __UK_TRACE_MAX_STRLEN));
 		size = len + 1;
 	}
 
-	if (free < (size_t) size) {
-		/* Block the next invocations of trace points */
-		*pfree = 0;
-		uk_trace_buffer_free = 0;
-		return;
-	}
-
 	switch (type) {
 	case __UK_TRACE_ARG_INT:
 		/* for simplicity we do not care about alignment */
@@ -117,6 +227,20 @@ static inline void __uk_trace_save_arg(char **pbuff,
 		sizeof(arg),				\
 		(long) arg)
 
+#define __UK_TRACE_SIZE_ONE(arg) free += __uk_trace_arg_size(	\
+		__UK_TRACE_GET_TYPE(arg),			\
+		sizeof(arg),					\
+		(long) arg)
+
+#define __UK_TRACE_SIZE_ARGS0()
+#define __UK_TRACE_SIZE_ARGS1() __UK_TRACE_SIZE_ONE(arg1)
+#define __UK_TRACE_SIZE_ARGS2() __UK_TRACE_SIZE_ARGS1(); __UK_TRACE_SIZE_ONE(arg2)
+#define __UK_TRACE_SIZE_ARGS3() __UK_TRACE_SIZE_ARGS2(); __UK_TRACE_SIZE_ONE(arg3)
+#define __UK_TRACE_SIZE_ARGS4() __UK_TRACE_SIZE_ARGS3(); __UK_TRACE_SIZE_ONE(arg4)
+#define __UK_TRACE_SIZE_ARGS5() __UK_TRACE_SIZE_ARGS4(); __UK_TRACE_SIZE_ONE(arg5)
+#define __UK_TRACE_SIZE_ARGS6() __UK_TRACE_SIZE_ARGS5(); __UK_TRACE_SIZE_ONE(arg6)
+#define __UK_TRACE_SIZE_ARGS7() __UK_TRACE_SIZE_ARGS6(); __UK_TRACE_SIZE_ONE(arg7)
+
 #define __UK_TRACE_SAVE_ARGS0()
 #define __UK_TRACE_SAVE_ARGS1() __UK_TRACE_SAVE_ONE(arg1)
 #define __UK_TRACE_SAVE_ARGS2() __UK_TRACE_SAVE_ARGS1(); __UK_TRACE_SAVE_ONE(arg2)
@@ -195,36 +319,14 @@ static inline void __uk_trace_save_arg(char **pbuff,
 		__UK_TRACE_ARG_TYPES(NR, __VA_ARGS__),		\
 		#trace_name, fmt }
 
-static inline char *__uk_trace_get_buff(size_t *free)
-{
-	struct uk_tracepoint_header *ret;
-
-	if (uk_trace_buffer_free < sizeof(*ret))
-		return 0;
-	ret = (struct uk_tracepoint_header *) uk_trace_buffer_writep;
-
-	/* In case we fail to fill the tracepoint for any reason, make
-	 * sure we do not confuse parser. We fill the header only
-	 * after the full tracepoint is completed
-	 */
-	ret->magic = 0;
-	*free = uk_trace_buffer_free - sizeof(*ret);
-	return (char *) (ret + 1);
-}
-
-static inline void __uk_trace_finalize_buff(char *new_buff_pos, void *cookie)
+static inline void __uk_trace_commit(char *buff)
 {
-	uint32_t size;
 	struct uk_tracepoint_header *head =
-		(struct uk_tracepoint_header *) uk_trace_buffer_writep;
-
-	size = new_buff_pos - uk_trace_buffer_writep;
-	uk_trace_buffer_writep += size;
-	uk_trace_buffer_free -= size;
+		(struct uk_tracepoint_header *) buff - 1;
 
-	head->time = ukplat_monotonic_clock();
-	head->size = size - sizeof(*head);
-	head->cookie = cookie;
+	/* Make the record visible to the parser only after it is
+	 * completely written
+	 */
 	barrier();
 	head->magic = UK_TP_HEADER_MAGIC;
 }
@@ -247,15 +349,14 @@ static inline void __uk_trace_finalize_buff(char *new_buff_pos, void *cookie)
 		       __VA_ARGS__);					\
 	static inline void trace_name(__UK_TRACE_ARGS_MAP(n, __VA_ARGS__)) \
 	{								\
-		unsigned long flags = ukplat_lcpu_save_irqf();		\
-		size_t free __maybe_unused;				\
-		char *buff = __uk_trace_get_buff(&free);		\
+		size_t free = 0;					\
+		char *buff, *start;					\
+		__UK_TRACE_SIZE_ARGS ## n();				\
+		buff = start = __uk_trace_reserve(free, &regdata_name);	\
 		if (buff) {						\
 			__UK_TRACE_SAVE_ARGS ## n();			\
-			__uk_trace_finalize_buff(			\
-				buff, &regdata_name);			\
+			__uk_trace_commit(start);			\
 		}							\
-		ukplat_lcpu_restore_irqf(flags);			\
 	}
 #else
 #define ____UK_TRACEPOINT(n, regdata_name, trace_name, fmt, ...)	\
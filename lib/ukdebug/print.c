@@ -44,6 +44,13 @@
 #include <uk/print.h>
 #include <uk/errptr.h>
 #include <uk/arch/lcpu.h>
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+#include <uk/arch/atomic.h>
+#include <uk/arch/time.h>
+#include <uk/init.h>
+#include <uk/sched.h>
+#include <uk/thread.h>
+#endif
 
 #if CONFIG_LIBUKDEBUG_ANSI_COLOR
 #define LVLC_RESET	UK_ANSI_MOD_RESET
@@ -109,8 +116,209 @@ static struct _vprint_console debug = { .cout = ukplat_coutd,
 					.prevlvl = INT_MIN };
 #endif
 
+/* Destination of a single message */
+struct _vprint_out {
+	struct _vprint_console *cons;
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+	char *buf;		/* NULL: write to the console directly */
+	unsigned int len;
+#endif
+};
+
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+/*
+ * Asynchronous output: messages are formatted into a lock-free ring and
+ * written to the console by a drain thread, so that printing never waits
+ * for the (slow) console device. Each record starts with a 32-bit header
+ * that carries the payload length and is marked as committed only after
+ * the payload was copied. Producers reserve space with a CAS on the head,
+ * so threads and interrupt handlers can print concurrently. When the ring
+ * is full, messages are dropped and counted.
+ *
+ * Critical messages, messages printed before the drain thread runs, and
+ * uk_print_flush() take the synchronous path.
+ */
+#define PRINTQ_SIZE		CONFIG_LIBUKDEBUG_PRINT_ASYNC_SIZE
+#define PRINTQ_MASK		(PRINTQ_SIZE - 1)
+#define PRINTQ_MSGLEN		512	/* longest buffered message */
+#define PRINTQ_HDRLEN		sizeof(__u32)
+#define PRINTQ_LEN_MASK		0x0000ffffU
+#define PRINTQ_DEBUG		0x40000000U	/* for the debug console */
+#define PRINTQ_COMMITTED	0x80000000U
+
+UK_CTASSERT((PRINTQ_SIZE & PRINTQ_MASK) == 0);
+UK_CTASSERT(PRINTQ_SIZE >= 2 * (PRINTQ_MSGLEN + PRINTQ_HDRLEN));
+
+static char printq_buf[PRINTQ_SIZE] __align(PRINTQ_HDRLEN);
+static unsigned long printq_head;	/* end of reserved records */
+static unsigned long printq_tail;	/* end of consumed records */
+static unsigned long printq_drops;
+static int printq_active;		/* drain thread is running */
+static int printq_flushing;
+
+static inline __u32 *printq_hdr(unsigned long pos)
+{
+	return (__u32 *) &printq_buf[pos & PRINTQ_MASK];
+}
+
+static void printq_copy(unsigned long pos, const char *src, unsigned int len)
+{
+	unsigned int off = pos & PRINTQ_MASK;
+	unsigned int first = MIN(len, PRINTQ_SIZE - off);
+
+	memcpy(&printq_buf[off], src, first);
+	memcpy(printq_buf, src + first, len - first);
+}
+
+static void printq_clear(unsigned long pos, unsigned int len)
+{
+	unsigned int off = pos & PRINTQ_MASK;
+	unsigned int first = MIN(len, PRINTQ_SIZE - off);
+
+	memset(&printq_buf[off], 0, first);
+	memset(printq_buf, 0, len - first);
+}
+
+static void printq_push(struct _vprint_console *cons,
+			const char *msg, unsigned int len)
+{
+	unsigned long head, next;
+	__u32 hdr = len | PRINTQ_COMMITTED;
+
+	next = ALIGN_UP(PRINTQ_HDRLEN + len, PRINTQ_HDRLEN);
+	do {
+		head = ukarch_load_n(&printq_head);
+		if (head + next - ukarch_load_n(&printq_tail) > PRINTQ_SIZE) {
+			ukarch_inc(&printq_drops);
+			return;
+		}
+	} while (ukarch_compare_exchange_sync(&printq_head, head, head + next)
+		 != head + next);
+
+	printq_copy(head + PRINTQ_HDRLEN, msg, len);
+#if !CONFIG_LIBUKDEBUG_REDIR_PRINTD
+	if (cons == &debug)
+		hdr |= PRINTQ_DEBUG;
+#else
+	(void) cons;
+#endif
+	ukarch_store_n(printq_hdr(head), hdr);
+}
+
+static inline struct _vprint_console *printq_cons(__u32 hdr __maybe_unused)
+{
+#if CONFIG_LIBUKDEBUG_REDIR_PRINTD
+	return &kern;
+#elif !CONFIG_LIBUKDEBUG_PRINTK
+	return &debug;
+#else
+	return (hdr & PRINTQ_DEBUG) ? &debug : &kern;
+#endif
+}
+
+/* Writes out committed records; there is only a single consumer at a
+ * time, an interrupted one is not waited for. The drain thread gives up
+ * consumer role while it yields, so that synchronous flushes (e.g., at
+ * shutdown or for critical messages) are never skipped because of it.
+ */
+static void printq_drain(int yield)
+{
+	struct _vprint_console *cons;
+	unsigned long tail, drops;
+	unsigned int len, off, first;
+	char buf[48];
+	__u32 hdr;
+
+	if (ukarch_compare_exchange_sync(&printq_flushing, 0, 1) != 1)
+		return;
+
+	tail = printq_tail;
+	while (tail != ukarch_load_n(&printq_head)) {
+		hdr = ukarch_load_n(printq_hdr(tail));
+		if (!(hdr & PRINTQ_COMMITTED))
+			break;
+
+		cons = printq_cons(hdr);
+		len = hdr & PRINTQ_LEN_MASK;
+		off = (tail + PRINTQ_HDRLEN) & PRINTQ_MASK;
+		first = MIN(len, PRINTQ_SIZE - off);
+		cons->cout(&printq_buf[off], first);
+		if (len > first)
+			cons->cout(printq_buf, len - first);
+
+		/* Stale payload must never be taken for a header */
+		len = ALIGN_UP(PRINTQ_HDRLEN + len, PRINTQ_HDRLEN);
+		printq_clear(tail, len);
+		tail += len;
+		ukarch_store_n(&printq_tail, tail);
+
+		if (yield) {
+			/* Do not hold off synchronous flushes while parked */
+			ukarch_store_n(&printq_flushing, 0);
+			uk_sched_yield();
+			if (ukarch_compare_exchange_sync(&printq_flushing,
+							 0, 1) != 1)
+				return;
+			tail = printq_tail;
+		}
+	}
+
+	drops = ukarch_exchange_n(&printq_drops, 0);
+	if (drops) {
+		cons = printq_cons(0);
+		len = __uk_snprintf(buf, sizeof(buf),
+				    "[%lu messages dropped]\n", drops);
+		cons->cout(buf, len);
+	}
+
+	ukarch_store_n(&printq_flushing, 0);
+}
+
+void uk_print_flush(void)
+{
+	printq_drain(0);
+}
+
+unsigned long uk_print_drops(void)
+{
+	return ukarch_load_n(&printq_drops);
+}
+
+static void printq_thread(void *arg __unused)
+{
+	for (;;) {
+		printq_drain(1);
+		uk_sched_thread_sleep(ukarch_time_msec_to_nsec(
+				CONFIG_LIBUKDEBUG_PRINT_ASYNC_INTERVAL));
+	}
+}
+
+static int printq_init(void)
+{
+	if (!uk_thread_create("printk", printq_thread, NULL))
+		return -1;
+
+	ukarch_store_n(&printq_active, 1);
+	return 0;
+}
+uk_early_initcall(printq_init);
+#endif /* CONFIG_LIBUKDEBUG_PRINT_ASYNC */
+
+static void _out(struct _vprint_out *out, const char *str, unsigned int len)
+{
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+	if (out->buf) {
+		len = MIN(len, PRINTQ_MSGLEN - out->len);
+		memcpy(&out->buf[out->len], str, len);
+		out->len += len;
+		return;
+	}
+#endif
+	out->cons->cout(DECONST(char *, str), len);
+}
+
 #if CONFIG_LIBUKDEBUG_PRINT_TIME
-static void _print_timestamp(struct _vprint_console *cons)
+static void _print_timestamp(struct _vprint_out *out)
 {
 	char buf[BUFLEN];
 	int len;
@@ -122,12 +330,12 @@ static void _print_timestamp(struct _vprint_console *cons)
 	len = __uk_snprintf(buf, BUFLEN, LVLC_RESET LVLC_TS
 			    "[%5" __PRInsec ".%06" __PRInsec "] ",
 			    sec, rem_usec);
-	cons->cout((char *)buf, len);
+	_out(out, buf, len);
 }
 #endif
 
 #if CONFIG_LIBUKDEBUG_PRINT_STACK
-static void _print_stack(struct _vprint_console *cons)
+static void _print_stack(struct _vprint_out *out)
 {
 	unsigned long stackb;
 	char buf[BUFLEN];
@@ -137,7 +345,7 @@ static void _print_stack(struct _vprint_console *cons)
 
 	len = __uk_snprintf(buf, BUFLEN, LVLC_RESET LVLC_SP
 			    "<%p> ", (void *) stackb);
-	cons->cout((char *)buf, len);
+	_out(out, buf, len);
 }
 #endif
 
@@ -152,6 +360,10 @@ static void _vprint(struct _vprint_console *cons,
 	const char *msghdr = NULL;
 	const char *lptr = NULL;
 	const char *nlptr = NULL;
+	struct _vprint_out out = { .cons = cons };
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+	char mbuf[PRINTQ_MSGLEN];
+#endif
 
 	/*
 	 * Note: We reset the console colors earlier in order to exclude
@@ -178,13 +390,23 @@ static void _vprint(struct _vprint_console *cons,
 		return;
 	}
 
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+	if (lvl != KLVL_CRIT && ukarch_load_n(&printq_active)) {
+		out.buf = mbuf;
+		out.len = 0;
+	} else {
+		/* Synchronous path: keep the order with buffered messages */
+		printq_drain(0);
+	}
+#endif
+
 	if (lvl != cons->prevlvl) {
 		/* level changed from previous call */
 		if (cons->prevlvl != INT_MIN && !cons->newline) {
 			/* level changed without closing with '\n',
 			 * enforce printing '\n', before the new message header
 			 */
-			cons->cout("\n", 1);
+			_out(&out, "\n", 1);
 		}
 		cons->prevlvl = lvl;
 		cons->newline = 1; /* enforce printing the message header */
@@ -195,32 +417,30 @@ static void _vprint(struct _vprint_console *cons,
 	while (len > 0) {
 		if (cons->newline) {
 #if CONFIG_LIBUKDEBUG_PRINT_TIME
-			_print_timestamp(cons);
+			_print_timestamp(&out);
 #endif
-			cons->cout(DECONST(char *, msghdr), strlen(msghdr));
+			_out(&out, msghdr, strlen(msghdr));
 #if CONFIG_LIBUKDEBUG_PRINT_STACK
-			_print_stack(cons);
+			_print_stack(&out);
 #endif
 			if (libname) {
-				cons->cout(LVLC_RESET LVLC_LIBNAME "[",
+				_out(&out, LVLC_RESET LVLC_LIBNAME "[",
 					   strlen(LVLC_RESET LVLC_LIBNAME) + 1);
-				cons->cout(DECONST(char *, libname),
-					   strlen(libname));
-				cons->cout("] ", 2);
+				_out(&out, libname, strlen(libname));
+				_out(&out, "] ", 2);
 			}
 #if CONFIG_LIBUKDEBUG_PRINT_SRCNAME
 			if (srcname) {
 				char lnobuf[6];
 
-				cons->cout(LVLC_RESET LVLC_SRCNAME "<",
+				_out(&out, LVLC_RESET LVLC_SRCNAME "<",
 					   strlen(LVLC_RESET LVLC_SRCNAME) + 1);
-				cons->cout(DECONST(char *, srcname),
-					   strlen(srcname));
-				cons->cout(" @ ", 3);
-				cons->cout(lnobuf,
+				_out(&out, srcname, strlen(srcname));
+				_out(&out, " @ ", 3);
+				_out(&out, lnobuf,
 					   __uk_snprintf(lnobuf, sizeof(lnobuf),
 							 "%4u", srcline));
-				cons->cout("> ", 2);
+				_out(&out, "> ", 2);
 			}
 #endif
 			cons->newline = 0;
@@ -237,22 +457,27 @@ static void _vprint(struct _vprint_console *cons,
 		/* Message body */
 		switch (lvl) {
 		case KLVL_CRIT:
-			cons->cout(LVLC_RESET LVLC_CRIT_MSG,
+			_out(&out, LVLC_RESET LVLC_CRIT_MSG,
 				   strlen(LVLC_RESET LVLC_CRIT_MSG));
 			break;
 		case KLVL_ERR:
-			cons->cout(LVLC_RESET LVLC_ERROR_MSG,
+			_out(&out, LVLC_RESET LVLC_ERROR_MSG,
 				   strlen(LVLC_RESET LVLC_ERROR_MSG));
 			break;
 		default:
-			cons->cout(LVLC_RESET, strlen(LVLC_RESET));
+			_out(&out, LVLC_RESET, strlen(LVLC_RESET));
 		}
-		cons->cout((char *)lptr, llen);
-		cons->cout(LVLC_RESET, strlen(LVLC_RESET));
+		_out(&out, lptr, llen);
+		_out(&out, LVLC_RESET, strlen(LVLC_RESET));
 
 		len -= llen;
 		lptr = nlptr + 1;
 	}
+
+#if CONFIG_LIBUKDEBUG_PRINT_ASYNC
+	if (out.buf)
+		printq_push(cons, out.buf, out.len);
+#endif
 }
 
 /*
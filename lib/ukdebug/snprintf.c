@@ -57,33 +57,11 @@
 #include <limits.h>
 #include <ctype.h>
 #include <string.h>
+#include <uk/fmt.h>
 #include "snprintf.h"
 
 /* 64 bits + 0-Byte at end */
-#define MAXNBUF 65
-
-static char const hex2ascii_data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
-/*
- * Put a NUL-terminated ASCII number (base <= 36) in a buffer in reverse
- * order; return an optional length and a pointer to the last character
- * written in the buffer (i.e., the first character of the string).
- * The buffer pointed to by `nbuf' must have length >= MAXNBUF.
- */
-static inline char *ksprintn(char *nbuf, uintmax_t num, int base, int *lenp,
-			     int upper)
-{
-	char *p, c;
-
-	p = nbuf;
-	*p = '\0';
-	do {
-		c = hex2ascii_data[num % base];
-		*++p = upper ? toupper(c) : c;
-	} while (num /= base);
-	if (lenp)
-		*lenp = p - nbuf;
-	return p;
-}
+#define MAXNBUF (UK_FMT_U64_MAXLEN + 1)
 
 /*
  * Scaled down version of printf(3).
@@ -100,13 +78,18 @@ int __uk_vsnprintf(char *str, size_t size, const char *fmt, va_list ap)
 		retval++;                                                      \
 	}
 	char nbuf[MAXNBUF];
+#if CONFIG_LIBUKFMT_FLOAT
+	/* Integer part of DBL_MAX, '.' and the maximum precision */
+	char fbuf[309 + 1 + UK_FMT_PREC_MAX + 1];
+	double dbl;
+#endif
 	const char *p, *percent;
 	int ch, n;
 	uintmax_t num;
 	int base, lflag, llflag, tmp, width, ladjust, sharpflag, neg, sign, dot;
 	int cflag, hflag, jflag, tflag, zflag;
-	int dwidth, upper;
-	char padc;
+	int dwidth, upper, plusflag, spaceflag;
+	char padc, signc;
 	int stop = 0, retval = 0;
 
 	num = 0;
@@ -132,6 +115,8 @@ int __uk_vsnprintf(char *str, size_t size, const char *fmt, va_list ap)
 		sharpflag = 0;
 		neg = 0;
 		sign = 0;
+		plusflag = 0;
+		spaceflag = 0;
 		dot = 0;
 		dwidth = 0;
 		upper = 0;
@@ -149,7 +134,10 @@ reswitch:
 			sharpflag = 1;
 			goto reswitch;
 		case '+':
-			sign = 1;
+			plusflag = 1;
+			goto reswitch;
+		case ' ':
+			spaceflag = 1;
 			goto reswitch;
 		case '-':
 			ladjust = 1;
@@ -292,6 +280,40 @@ reswitch:
 		case 'z':
 			zflag = 1;
 			goto reswitch;
+#if CONFIG_LIBUKFMT_FLOAT
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+			dbl = va_arg(ap, double);
+			neg = __builtin_signbit(dbl);
+			n = uk_fmt_double(fbuf, sizeof(fbuf), dbl, ch,
+					  dot ? dwidth : -1,
+					  sharpflag ? UK_FMT_ALT : 0);
+			/* Zero padding does not apply to INF and NAN */
+			if (!__builtin_isfinite(dbl))
+				padc = ' ';
+
+			signc = neg ? '-' : plusflag ? '+' : spaceflag ? ' ' : 0;
+
+			width -= n + (signc != 0);
+			if (!ladjust && padc == ' ')
+				while (width-- > 0)
+					PCHAR(' ');
+			if (signc)
+				PCHAR(signc);
+			if (!ladjust && padc == '0')
+				while (width-- > 0)
+					PCHAR('0');
+			for (p = fbuf; *p; p++)
+				PCHAR(*p);
+			if (ladjust)
+				while (width-- > 0)
+					PCHAR(' ');
+			break;
+#endif /* CONFIG_LIBUKFMT_FLOAT */
 handle_nosign:
 			sign = 0;
 			if (jflag)
@@ -333,7 +355,10 @@ number:
 				neg = 1;
 				num = -(intmax_t)num;
 			}
-			p = ksprintn(nbuf, num, base, &n, upper);
+			signc = neg ? '-' : !sign ? 0 : plusflag ? '+'
+				: spaceflag ? ' ' : 0;
+			n = uk_fmt_u64(nbuf, num, base, upper);
+			p = nbuf;
 			tmp = 0;
 			if (sharpflag && num != 0) {
 				if (base == 8)
@@ -341,7 +366,7 @@ number:
 				else if (base == 16)
 					tmp += 2;
 			}
-			if (neg)
+			if (signc)
 				tmp++;
 
 			if (!ladjust && padc == '0')
@@ -351,8 +376,8 @@ number:
 			if (!ladjust)
 				while (width-- > 0)
 					PCHAR(' ');
-			if (neg)
-				PCHAR('-');
+			if (signc)
+				PCHAR(signc);
 			if (sharpflag && num != 0) {
 				if (base == 8) {
 					PCHAR('0');
@@ -364,8 +389,8 @@ number:
 			while (dwidth-- > 0)
 				PCHAR('0');
 
-			while (*p)
-				PCHAR(*p--);
+			while (p < nbuf + n)
+				PCHAR(*p++);
 
 			if (ladjust)
 				while (width-- > 0)
@@ -31,17 +31,372 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <uk/essentials.h>
+#include <uk/arch/atomic.h>
+#include <uk/arch/lcpu.h>
+#include <uk/plat/console.h>
+#include <uk/print.h>
+#include <uk/trace.h>
 
-/* If the buffer is full, tracing disables itself.
- * Using a circular buffer will not make it better: in any case, losing trace
- * data is undesired and we should keep this as simple as possible.
+#define UK_TRACE_BUFFER_SIZE CONFIG_LIBUKDEBUG_TRACE_BUFFER_SIZE
+#define UK_TRACE_CHUNK_SIZE (UK_TRACE_BUFFER_SIZE / UK_TRACE_CHUNKS)
+
+UK_CTASSERT(UK_TRACE_BUFFER_SIZE % (UK_TRACE_CHUNKS * UK_TRACE_ALIGN) == 0);
+/* Largest record: seven strings of maximum length */
+UK_CTASSERT(UK_TRACE_CHUNK_SIZE >= sizeof(struct uk_tracepoint_header)
+	    + 7 * (__UK_TRACE_MAX_STRLEN + 1));
+
+/* Records are appended by reserving space with an atomic update of the
+ * buffer head and marking them valid once the arguments are written.
+ * Without CONFIG_LIBUKDEBUG_TRACE_RING, records are dropped (and counted
+ * as lost) once the buffer is full. Otherwise, the oldest chunk is
+ * overwritten.
+ *
+ * Each thread claims its own buffer on its first tracepoint, so that
+ * records of different threads are not interleaved. Buffer 0 is shared by
+ * code running before threads have TLS areas and by threads that found
+ * all buffers taken. The buffer of a thread is released when the thread
+ * is destroyed and keeps its records for the next owner.
+ */
+struct uk_trace_buffer uk_trace_buffers[CONFIG_LIBUKDEBUG_TRACE_BUFFERS];
+
+#if CONFIG_HAVE_SCHED && CONFIG_LIBUKDEBUG_TRACE_BUFFERS > 1
+static int uk_trace_have_tls;
+static __uk_tls struct uk_trace_buffer *uk_trace_tls_buffer;
+
+void uk_trace_tls_init(void)
+{
+	ukarch_store_n(&uk_trace_have_tls, 1);
+}
+
+static struct uk_trace_buffer *_uk_trace_buffer(void)
+{
+	struct uk_trace_buffer *b;
+	unsigned long tag;
+	int i;
+
+	if (unlikely(!ukarch_load_n(&uk_trace_have_tls)))
+		return &uk_trace_buffers[0];
+
+	b = uk_trace_tls_buffer;
+	if (likely(b))
+		return b;
+
+	/* The address of the TLS variable identifies the thread */
+	tag = (unsigned long) &uk_trace_tls_buffer;
+	b = &uk_trace_buffers[0];
+	for (i = 1; i < CONFIG_LIBUKDEBUG_TRACE_BUFFERS; i++) {
+		if (ukarch_compare_exchange_sync(&uk_trace_buffers[i].owner,
+						 0, tag) == tag) {
+			b = &uk_trace_buffers[i];
+			break;
+		}
+	}
+	uk_trace_tls_buffer = b;
+	return b;
+}
+
+void uk_trace_tls_release(void *tls_area, size_t size)
+{
+	unsigned long owner;
+	int i;
+
+	for (i = 1; i < CONFIG_LIBUKDEBUG_TRACE_BUFFERS; i++) {
+		owner = ukarch_load_n(&uk_trace_buffers[i].owner);
+		if (owner >= (unsigned long) tls_area
+		    && owner < (unsigned long) tls_area + size)
+			ukarch_store_n(&uk_trace_buffers[i].owner, 0UL);
+	}
+}
+#else
+void uk_trace_tls_init(void)
+{
+}
+
+void uk_trace_tls_release(void *tls_area __unused, size_t size __unused)
+{
+}
+
+static inline struct uk_trace_buffer *_uk_trace_buffer(void)
+{
+	return &uk_trace_buffers[0];
+}
+#endif
+
+char *__uk_trace_reserve(size_t size, void *cookie)
+{
+	struct uk_trace_buffer *b = _uk_trace_buffer();
+	struct uk_tracepoint_header *head;
+	unsigned long old, pos, next, off;
+	__nsec time = ukplat_monotonic_clock();
+
+	size = ALIGN_UP(sizeof(*head) + size, UK_TRACE_ALIGN);
+	if (unlikely(size > UK_TRACE_CHUNK_SIZE))
+		return NULL;
+
+	do {
+		old = ukarch_load_n(&b->head);
+		pos = old;
+		off = old % UK_TRACE_CHUNK_SIZE;
+		if (off + size > UK_TRACE_CHUNK_SIZE)
+			pos += UK_TRACE_CHUNK_SIZE - off;
+		next = pos + size;
+#if !CONFIG_LIBUKDEBUG_TRACE_RING
+		if (unlikely(next > UK_TRACE_BUFFER_SIZE)) {
+			ukarch_inc(&b->lost);
+			return NULL;
+		}
+#endif
+	} while (ukarch_compare_exchange_sync(&b->head, old, next) != next);
+
+	if (pos != old) {
+		/* Mark the unused rest of the previous chunk */
+		head = (struct uk_tracepoint_header *)
+			&b->data[old % UK_TRACE_BUFFER_SIZE];
+		head->magic = UK_TP_PAD_MAGIC;
+	}
+
+	/* In case we fail to fill the tracepoint for any reason, make
+	 * sure we do not confuse parser. The magic is set only after the
+	 * full tracepoint is completed
+	 */
+	head = (struct uk_tracepoint_header *)
+		&b->data[pos % UK_TRACE_BUFFER_SIZE];
+	head->magic = 0;
+	head->size = size - sizeof(*head);
+	head->time = time;
+	head->cookie = cookie;
+	return (char *) (head + 1);
+}
+
+/* Window of the export stream that is copied to the caller */
+struct uk_trace_export_ctx {
+	char *dst;
+	size_t off;
+	size_t len;
+	size_t pos;
+};
+
+static void _uk_trace_emit(struct uk_trace_export_ctx *ctx,
+			   const void *src, size_t len)
+{
+	size_t skip, n;
+
+	if (ctx->pos + len > ctx->off && ctx->pos < ctx->off + ctx->len) {
+		skip = ctx->off > ctx->pos ? ctx->off - ctx->pos : 0;
+		n = MIN(len - skip, ctx->off + ctx->len - ctx->pos - skip);
+		memcpy(ctx->dst + (ctx->pos + skip - ctx->off),
+		       (const char *) src + skip, n);
+	}
+	ctx->pos += len;
+}
+
+/* Position of the oldest record of a buffer filled up to `end` */
+static unsigned long _uk_trace_start(unsigned long end __maybe_unused)
+{
+#if CONFIG_LIBUKDEBUG_TRACE_RING
+	/* Skip overwritten chunks and the chunk that is being overwritten */
+	if (end / UK_TRACE_CHUNK_SIZE >= UK_TRACE_CHUNKS)
+		return (end / UK_TRACE_CHUNK_SIZE - (UK_TRACE_CHUNKS - 1))
+			* UK_TRACE_CHUNK_SIZE;
+#endif
+	return 0;
+}
+
+/*
+ * Returns the record at or after *pos and before `end`, skipping padding
+ * at the end of chunks, NULL if there is none. *pos is updated to the
+ * position of the record.
+ */
+static struct uk_tracepoint_header *_uk_trace_next(struct uk_trace_buffer *b,
+						   unsigned long *pos,
+						   unsigned long end)
+{
+	struct uk_tracepoint_header *head;
+	unsigned long off;
+
+	while (*pos < end) {
+		off = *pos % UK_TRACE_CHUNK_SIZE;
+		head = (struct uk_tracepoint_header *)
+			&b->data[*pos % UK_TRACE_BUFFER_SIZE];
+
+		if (UK_TRACE_CHUNK_SIZE - off < sizeof(*head)
+		    || head->magic == UK_TP_PAD_MAGIC
+		    || off + sizeof(*head) + head->size > UK_TRACE_CHUNK_SIZE) {
+			*pos += UK_TRACE_CHUNK_SIZE - off;
+			continue;
+		}
+		return head;
+	}
+	return NULL;
+}
+
+void uk_trace_snapshot_take(struct uk_trace_snapshot *s)
+{
+	struct uk_tracepoint_header *head;
+	struct uk_trace_buffer *b;
+	unsigned long pos, end;
+	size_t len;
+	int i;
+
+	for (i = 0; i < CONFIG_LIBUKDEBUG_TRACE_BUFFERS; i++) {
+		b = &uk_trace_buffers[i];
+		end = ukarch_load_n(&b->head);
+		pos = _uk_trace_start(end);
+		len = 0;
+
+		/* End the snapshot at the first record that is still being
+		 * written, so that the records it covers do not change
+		 * once they are committed
+		 */
+		s->start[i] = pos;
+		while ((head = _uk_trace_next(b, &pos, end))) {
+			if (head->magic != UK_TP_HEADER_MAGIC)
+				break;
+			len += sizeof(*head) + head->size;
+			pos += ALIGN_UP(sizeof(*head) + head->size,
+					UK_TRACE_ALIGN);
+		}
+		s->end[i] = head ? pos : end;
+		s->len[i] = len;
+		s->owner[i] = ukarch_load_n(&b->owner);
+		s->lost[i] = ukarch_load_n(&b->lost);
+	}
+
+	s->cur.stream = 0;
+	s->cur.buf = -1;
+}
+
+/* Buffer header item of the export, in place of a record position */
+#define UK_TRACE_CUR_BHDR (~0UL)
+
+/*
+ * The export is generated as a sequence of items (stream header, buffer
+ * headers, records, zero fill). The start of the item at which a call stops
+ * is kept in the snapshot, so that sequential reads resume there instead of
+ * walking the buffers from the beginning.
  */
-char uk_trace_buffer[CONFIG_LIBUKDEBUG_TRACE_BUFFER_SIZE];
+size_t uk_trace_export(struct uk_trace_snapshot *s,
+		       void *buf, size_t len, size_t off)
+{
+	struct uk_trace_export_ctx ctx = {
+		.dst = buf, .off = off, .len = len, .pos = 0
+	};
+	struct uk_trace_export_header hdr = {
+		.magic = UK_TRACE_EXPORT_MAGIC,
+		.version = 2,
+		.ptr_size = sizeof(void *),
+		.nr_buffers = CONFIG_LIBUKDEBUG_TRACE_BUFFERS,
+	};
+	static const char zero[sizeof(struct uk_tracepoint_header)];
+	struct uk_trace_export_cursor c = { .stream = 0, .buf = -1 };
+	struct uk_trace_export_buffer bhdr;
+	struct uk_tracepoint_header *head;
+	struct uk_trace_buffer *b;
+	size_t size;
+
+	if (len == 0)
+		return 0;
+	if (off >= s->cur.stream)
+		c = s->cur;
+	ctx.pos = c.stream;
 
-size_t uk_trace_buffer_free = CONFIG_LIBUKDEBUG_TRACE_BUFFER_SIZE;
-char *uk_trace_buffer_writep = uk_trace_buffer;
+	if (c.buf < 0) {
+		s->cur = c;
+		_uk_trace_emit(&ctx, &hdr, sizeof(hdr));
+		c.buf = 0;
+		c.pos = UK_TRACE_CUR_BHDR;
+	}
 
+	for (; c.buf < CONFIG_LIBUKDEBUG_TRACE_BUFFERS;
+	     c.buf++, c.pos = UK_TRACE_CUR_BHDR) {
+		b = &uk_trace_buffers[c.buf];
+
+		if (c.pos == UK_TRACE_CUR_BHDR) {
+			c.stream = ctx.pos;
+			if (ctx.pos >= off + len)
+				goto out;
+			s->cur = c;
+
+			bhdr.magic = UK_TRACE_EXPORT_BUF_MAGIC;
+			bhdr.index = c.buf;
+			bhdr.owner = s->owner[c.buf];
+			bhdr.lost = s->lost[c.buf];
+			bhdr.len = s->len[c.buf];
+			_uk_trace_emit(&ctx, &bhdr, sizeof(bhdr));
+			c.pos = s->start[c.buf];
+			c.done = 0;
+		}
+
+		while ((head = _uk_trace_next(b, &c.pos, s->end[c.buf]))) {
+			size = sizeof(*head) + head->size;
+			/* Records might have been overwritten since the
+			 * snapshot in ring mode
+			 */
+			if (head->magic != UK_TP_HEADER_MAGIC) {
+				c.pos += ALIGN_UP(size, UK_TRACE_ALIGN);
+				continue;
+			}
+			if (c.done + size > s->len[c.buf])
+				break;
+
+			c.stream = ctx.pos;
+			if (ctx.pos >= off + len)
+				goto out;
+			s->cur = c;
+
+			_uk_trace_emit(&ctx, head, size);
+			c.done += size;
+			c.pos += ALIGN_UP(size, UK_TRACE_ALIGN);
+		}
+
+		/* Fill up with zeros, which end the buffer for the parser,
+		 * if records went missing
+		 */
+		c.pos = s->end[c.buf];
+		while (c.done < s->len[c.buf]) {
+			size = MIN(sizeof(zero), s->len[c.buf] - c.done);
+
+			c.stream = ctx.pos;
+			if (ctx.pos >= off + len)
+				goto out;
+			s->cur = c;
+
+			_uk_trace_emit(&ctx, zero, size);
+			c.done += size;
+		}
+	}
+
+	s->cur.stream = ctx.pos;
+	s->cur.buf = CONFIG_LIBUKDEBUG_TRACE_BUFFERS;
+out:
+	return ctx.pos > off ? MIN(ctx.pos - off, len) : 0;
+}
+
+void uk_trace_dump(void)
+{
+	static const char hex[] = "0123456789abcdef";
+	static struct uk_trace_snapshot s;
+	char data[32], line[sizeof("uktrace:") + 2 * sizeof(data) + 1];
+	size_t off = 0, n, i;
+
+	/* Keep the dump apart from buffered messages */
+	uk_print_flush();
+	uk_trace_snapshot_take(&s);
+	while ((n = uk_trace_export(&s, data, sizeof(data), off)) > 0) {
+		memcpy(line, "uktrace:", sizeof("uktrace:") - 1);
+		for (i = 0; i < n; i++) {
+			line[sizeof("uktrace:") - 1 + 2 * i] =
+				hex[(data[i] >> 4) & 0xf];
+			line[sizeof("uktrace:") + 2 * i] = hex[data[i] & 0xf];
+		}
+		line[sizeof("uktrace:") - 1 + 2 * n] = '\n';
+		ukplat_coutk(line, sizeof("uktrace:") + 2 * n);
+		off += n;
+	}
+}
 
 /* Store a string in format "key = value" in the section
  * .uk_trace_keyvals. This can be anything what you want trace.py
@@ -58,4 +413,13 @@ char *uk_trace_buffer_writep = uk_trace_buffer;
 	static const char key[] __used =		\
 		#key " = " #val
 
-TRACE_DEFINE_KEY(format_version, 1);
+#define TRACE_DEFINE_KEY_EXPAND(key, val) TRACE_DEFINE_KEY(key, val)
+
+TRACE_DEFINE_KEY(format_version, 2);
+/* Needed by the gdb helper to extract records from the raw buffers */
+TRACE_DEFINE_KEY_EXPAND(chunks, UK_TRACE_CHUNKS);
+#if CONFIG_LIBUKDEBUG_TRACE_RING
+TRACE_DEFINE_KEY(ring, 1);
+#else
+TRACE_DEFINE_KEY(ring, 0);
+#endif
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/print.h>
+#include <uk/trace.h>
+#include <uk/essentials.h>
+#include <uk/mutex.h>
+#include <vfscore/uio.h>
+#include <devfs/device.h>
+
+#define DEV_TRACE_NAME "trace"
+
+/* The snapshot is taken by the first open and shared by all readers until
+ * the last close, so that reads of the export fit together
+ */
+static struct uk_mutex dev_trace_lock = UK_MUTEX_INITIALIZER(dev_trace_lock);
+static struct uk_trace_snapshot dev_trace_snapshot;
+static unsigned int dev_trace_opens;
+
+/* Reading /dev/trace returns the binary trace export */
+static int dev_trace_read(struct device *dev __unused, struct uio *uio,
+			  int flags __unused)
+{
+	struct iovec *iov;
+	size_t n;
+	int i;
+
+	uk_mutex_lock(&dev_trace_lock);
+	for (i = 0; i < uio->uio_iovcnt; i++) {
+		iov = &uio->uio_iov[i];
+		n = uk_trace_export(&dev_trace_snapshot, iov->iov_base,
+				    iov->iov_len, uio->uio_offset);
+		uio->uio_resid -= n;
+		uio->uio_offset += n;
+		if (n < iov->iov_len)
+			break;
+	}
+	uk_mutex_unlock(&dev_trace_lock);
+	return 0;
+}
+
+static int dev_trace_open(struct device *device __unused, int mode __unused)
+{
+	uk_mutex_lock(&dev_trace_lock);
+	if (dev_trace_opens++ == 0)
+		uk_trace_snapshot_take(&dev_trace_snapshot);
+	uk_mutex_unlock(&dev_trace_lock);
+	return 0;
+}
+
+static int dev_trace_close(struct device *device __unused)
+{
+	uk_mutex_lock(&dev_trace_lock);
+	dev_trace_opens--;
+	uk_mutex_unlock(&dev_trace_lock);
+	return 0;
+}
+
+static struct devops trace_devops = {
+	.read = dev_trace_read,
+	.open = dev_trace_open,
+	.close = dev_trace_close,
+};
+
+static struct driver drv_trace = {
+	.devops = &trace_devops,
+	.devsz = 0,
+	.name = DEV_TRACE_NAME
+};
+
+static int devfs_register(void)
+{
+	struct device *dev;
+
+	uk_pr_info("Register '%s' to devfs\n", DEV_TRACE_NAME);
+
+	dev = device_create(&drv_trace, DEV_TRACE_NAME, D_CHR);
+	if (dev == NULL) {
+		uk_pr_err("Failed to register '%s' to devfs\n",
+			  DEV_TRACE_NAME);
+		return -1;
+	}
+
+	return 0;
+}
+
+devfs_initcall(devfs_register);
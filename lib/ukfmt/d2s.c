@@ -0,0 +1,756 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Floating point to decimal conversion. The shortest round-trip digits
+ * come from Ryu (Ulf Adams, "Ryu: Fast Float-to-String Conversion",
+ * PLDI 2018), which needs only 64x128-bit multiplications with
+ * precomputed powers of five. printf(3)-style conversions round those
+ * digits to the requested precision. This only needs the exact binary
+ * value for the rare cases where the shortest digits cannot decide the
+ * rounding: a tie on the digit that is dropped, or a precision finer
+ * than the binary one. Those cases compare against the exact value
+ * using a small bignum.
+ */
+
+#include <uk/fmt.h>
+#include <uk/essentials.h>
+#include "d2s_tables.h"
+
+#define D2S_MANTISSA_BITS	52
+#define D2S_EXPONENT_BITS	11
+#define D2S_BIAS		1023
+
+/* Significant digits that printf conversions round correctly */
+#define D2S_DIGITS_MAX		17
+
+static const __u64 d2s_pow10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+};
+
+/* floor(log10(2^e)) for 0 <= e <= 1650 */
+static inline __u32 log10_pow2(__s32 e)
+{
+	return ((__u32)e * 78913) >> 18;
+}
+
+/* floor(log10(5^e)) for 0 <= e <= 2620 */
+static inline __u32 log10_pow5(__s32 e)
+{
+	return ((__u32)e * 732923) >> 20;
+}
+
+/* ceil(log2(5^e)) for 0 < e <= 3528, 1 for e = 0 */
+static inline __s32 pow5bits(__s32 e)
+{
+	return (__s32)(((__u32)e * 1217359) >> 19) + 1;
+}
+
+/* Conservatively checks 2^e2 < 10^r */
+static inline int pow2_lt_pow10(__s32 e2, __s32 r)
+{
+	if (e2 >= 0)
+		return (__s32)log10_pow2(e2) < r;
+	return -r < (__s32)log10_pow2(-e2);
+}
+
+static inline int multiple_of_pow5(__u64 v, __u32 p)
+{
+	__u32 count = 0;
+
+	while (v % 5 == 0) {
+		v /= 5;
+		++count;
+	}
+	return count >= p;
+}
+
+static inline int multiple_of_pow2(__u64 v, __u32 p)
+{
+	return (v & ((1ULL << p) - 1)) == 0;
+}
+
+#ifdef __SIZEOF_INT128__
+static inline __u64 mul_shift64(__u64 m, const __u64 *mul, __s32 j)
+{
+	unsigned __int128 b0 = (unsigned __int128)m * mul[0];
+	unsigned __int128 b2 = (unsigned __int128)m * mul[1];
+
+	return (__u64)(((b0 >> 64) + b2) >> (j - 64));
+}
+#else /* !__SIZEOF_INT128__ */
+static inline __u64 umul128(__u64 a, __u64 b, __u64 *hi)
+{
+	__u64 b00 = (__u64)(__u32)a * (__u32)b;
+	__u64 b01 = (__u64)(__u32)a * (__u32)(b >> 32);
+	__u64 b10 = (__u64)(__u32)(a >> 32) * (__u32)b;
+	__u64 b11 = (__u64)(__u32)(a >> 32) * (__u32)(b >> 32);
+	__u64 mid1 = b10 + (b00 >> 32);
+	__u64 mid2 = b01 + (__u32)mid1;
+
+	*hi = b11 + (mid1 >> 32) + (mid2 >> 32);
+	return (mid2 << 32) | (__u32)b00;
+}
+
+static inline __u64 mul_shift64(__u64 m, const __u64 *mul, __s32 j)
+{
+	__u64 high0, high1, low1, sum;
+
+	umul128(m, mul[0], &high0);
+	low1 = umul128(m, mul[1], &high1);
+	sum = high0 + low1;
+	if (sum < high0)
+		++high1;
+	/* 64 < j < 128 for all table entries */
+	return (high1 << (128 - j)) | (sum >> (j - 64));
+}
+#endif /* !__SIZEOF_INT128__ */
+
+/*
+ * Ryu: computes the shortest decimal `*digits * 10^*exp' that lies in
+ * the rounding interval of the double with the given mantissa and
+ * biased exponent fields (finite, non-zero).
+ */
+static void d2s_shortest(__u64 ieee_m, __u32 ieee_e, __u64 *digits,
+			 __s32 *exp)
+{
+	__s32 e2, e10, removed = 0;
+	__u64 m2, mv, vr, vp, vm, out;
+	__u32 mm_shift, q, last_removed = 0, mod;
+	const __u64 *mul;
+	__s32 i, j, k;
+	int accept_bounds, vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+	int round_up = 0;
+
+	if (ieee_e == 0) {
+		e2 = 1 - D2S_BIAS - D2S_MANTISSA_BITS - 2;
+		m2 = ieee_m;
+	} else {
+		e2 = (__s32)ieee_e - D2S_BIAS - D2S_MANTISSA_BITS - 2;
+		m2 = (1ULL << D2S_MANTISSA_BITS) | ieee_m;
+	}
+	accept_bounds = (m2 & 1) == 0;
+
+	/* Interval of values that round to this double, times 4:
+	 * [mv - 1 - mm_shift, mv + 2]; the lower gap is narrower at
+	 * powers of two
+	 */
+	mv = 4 * m2;
+	mm_shift = ieee_m != 0 || ieee_e <= 1;
+
+	/* Convert the interval bounds to decimal */
+	if (e2 >= 0) {
+		q = log10_pow2(e2) - (e2 > 3);
+		e10 = (__s32)q;
+		k = D2S_POW5_INV_BITCOUNT + pow5bits((__s32)q) - 1;
+		i = -e2 + (__s32)q + k;
+		mul = d2s_pow5_inv_split[q];
+		vr = mul_shift64(4 * m2, mul, i);
+		vp = mul_shift64(4 * m2 + 2, mul, i);
+		vm = mul_shift64(4 * m2 - 1 - mm_shift, mul, i);
+		if (q <= 21) {
+			/* Only one of mp, mv and mm can be a multiple of 5 */
+			if (mv % 5 == 0)
+				vr_trailing_zeros = multiple_of_pow5(mv, q);
+			else if (accept_bounds)
+				vm_trailing_zeros = multiple_of_pow5(
+					mv - 1 - mm_shift, q);
+			else
+				vp -= multiple_of_pow5(mv + 2, q);
+		}
+	} else {
+		q = log10_pow5(-e2) - (-e2 > 1);
+		e10 = (__s32)q + e2;
+		i = -e2 - (__s32)q;
+		k = pow5bits(i) - D2S_POW5_BITCOUNT;
+		j = (__s32)q - k;
+		mul = d2s_pow5_split[i];
+		vr = mul_shift64(4 * m2, mul, j);
+		vp = mul_shift64(4 * m2 + 2, mul, j);
+		vm = mul_shift64(4 * m2 - 1 - mm_shift, mul, j);
+		if (q <= 1) {
+			/* mv has at least q trailing zero bits */
+			vr_trailing_zeros = 1;
+			if (accept_bounds)
+				vm_trailing_zeros = mm_shift == 1;
+			else
+				--vp;
+		} else if (q < 63) {
+			vr_trailing_zeros = multiple_of_pow2(mv, q);
+		}
+	}
+
+	/* Drop digits while the interval still contains a shorter number */
+	if (vm_trailing_zeros || vr_trailing_zeros) {
+		/* Rare: exact values need round-half-even and bounds care */
+		while (vp / 10 > vm / 10) {
+			vm_trailing_zeros &= vm % 10 == 0;
+			vr_trailing_zeros &= last_removed == 0;
+			last_removed = (__u32)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		if (vm_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_trailing_zeros &= last_removed == 0;
+				last_removed = (__u32)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				++removed;
+			}
+		}
+		if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+			last_removed = 4;
+		out = vr + ((vr == vm && (!accept_bounds
+					  || !vm_trailing_zeros))
+			    || last_removed >= 5);
+	} else {
+		/* Common case: two digits at a time first */
+		if (vp / 100 > vm / 100) {
+			mod = (__u32)(vr % 100);
+			round_up = mod >= 50;
+			vr /= 100;
+			vp /= 100;
+			vm /= 100;
+			removed += 2;
+		}
+		while (vp / 10 > vm / 10) {
+			mod = (__u32)(vr % 10);
+			round_up = mod >= 5;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		out = vr + (vr == vm || round_up);
+	}
+
+	*digits = out;
+	*exp = e10 + removed;
+}
+
+/*
+ * Minimal unsigned bignum, large enough to hold the exact value of any
+ * double scaled by the powers of ten that the rounding code needs.
+ */
+#define D2S_BN_LIMBS	40
+
+struct d2s_bn {
+	unsigned int len;
+	__u32 l[D2S_BN_LIMBS];
+};
+
+static void bn_set(struct d2s_bn *b, __u64 v)
+{
+	b->l[0] = (__u32)v;
+	b->l[1] = (__u32)(v >> 32);
+	b->len = b->l[1] ? 2 : (b->l[0] ? 1 : 0);
+}
+
+static void bn_mul32(struct d2s_bn *b, __u32 f)
+{
+	__u64 t, carry = 0;
+	unsigned int i;
+
+	for (i = 0; i < b->len; ++i) {
+		t = (__u64)b->l[i] * f + carry;
+		b->l[i] = (__u32)t;
+		carry = t >> 32;
+	}
+	if (carry)
+		b->l[b->len++] = (__u32)carry;
+}
+
+static void bn_mul_pow5(struct d2s_bn *b, unsigned int n)
+{
+	static const __u32 pow5[] = {
+		1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125,
+		9765625, 48828125, 244140625, 1220703125
+	};
+
+	while (n >= 13) {
+		bn_mul32(b, pow5[13]);
+		n -= 13;
+	}
+	if (n)
+		bn_mul32(b, pow5[n]);
+}
+
+static void bn_shl(struct d2s_bn *b, unsigned int n)
+{
+	unsigned int words = n / 32, bits = n % 32;
+	unsigned int i;
+
+	if (!b->len)
+		return;
+
+	b->l[b->len + words] = 0;
+	for (i = b->len; i > 0; --i) {
+		if (bits)
+			b->l[i + words] |= b->l[i - 1] >> (32 - bits);
+		b->l[i - 1 + words] = b->l[i - 1] << bits;
+	}
+	for (i = 0; i < words; ++i)
+		b->l[i] = 0;
+	b->len += words + 1;
+	while (b->len && !b->l[b->len - 1])
+		--b->len;
+}
+
+/* dst = src * n */
+static void bn_mul64(struct d2s_bn *dst, const struct d2s_bn *src, __u64 n)
+{
+	__u32 lo = (__u32)n, hi = (__u32)(n >> 32);
+	__u64 t, carry = 0;
+	unsigned int i;
+
+	for (i = 0; i < src->len; ++i) {
+		t = (__u64)src->l[i] * lo + carry;
+		dst->l[i] = (__u32)t;
+		carry = t >> 32;
+	}
+	dst->l[i] = (__u32)carry;
+	dst->l[i + 1] = 0;
+
+	carry = 0;
+	for (i = 0; i < src->len; ++i) {
+		t = (__u64)src->l[i] * hi + dst->l[i + 1] + carry;
+		dst->l[i + 1] = (__u32)t;
+		carry = t >> 32;
+	}
+	dst->l[i + 1] += (__u32)carry;
+
+	dst->len = src->len + 2;
+	while (dst->len && !dst->l[dst->len - 1])
+		--dst->len;
+}
+
+static int bn_cmp(const struct d2s_bn *a, const struct d2s_bn *b)
+{
+	unsigned int i;
+
+	if (a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	for (i = a->len; i > 0; --i)
+		if (a->l[i - 1] != b->l[i - 1])
+			return a->l[i - 1] < b->l[i - 1] ? -1 : 1;
+	return 0;
+}
+
+/* A decomposed finite double */
+struct d2s_val {
+	__u64 m;	/* Exact value is m * 2^e2 */
+	__s32 e2;
+	__u64 sd;	/* Shortest decimal is sd * 10^sk ... */
+	__s32 sk;
+	__u32 sl;	/* ... with sl digits */
+	__s32 e10;	/* Decimal exponent of the leading digit */
+};
+
+/*
+ * Exact comparison of the value with multiples of 10^r / 2:
+ * sign(v - n * 10^r / 2) = sign(x - n * c)
+ */
+struct d2s_exact {
+	struct d2s_bn x;
+	struct d2s_bn c;
+};
+
+static void d2s_exact_init(struct d2s_exact *ex, const struct d2s_val *v,
+			   __s32 r)
+{
+	__s32 sx = v->e2 + 1;
+
+	bn_set(&ex->x, v->m);
+	bn_set(&ex->c, 1);
+	if (r >= 0)
+		bn_mul_pow5(&ex->c, (unsigned int)r);
+	else
+		bn_mul_pow5(&ex->x, (unsigned int)-r);
+	if (sx > r)
+		bn_shl(&ex->x, (unsigned int)(sx - r));
+	else
+		bn_shl(&ex->c, (unsigned int)(r - sx));
+}
+
+static int d2s_exact_cmp(const struct d2s_exact *ex, __u64 n)
+{
+	struct d2s_bn nc;
+
+	bn_mul64(&nc, &ex->c, n);
+	return bn_cmp(&ex->x, &nc);
+}
+
+static __u64 d2s_round_half(const struct d2s_exact *ex, __u64 q)
+{
+	int c = d2s_exact_cmp(ex, 2 * q + 1);
+
+	return (c > 0 || (c == 0 && (q & 1))) ? q + 1 : q;
+}
+
+/*
+ * Returns the value divided by 10^r, rounded to nearest with ties to
+ * even. The result must have at most 18 digits.
+ */
+static __u64 d2s_round(const struct d2s_val *v, __s32 r)
+{
+	struct d2s_exact ex;
+	__u64 q, p, rem, lo, hi, mid, span;
+
+	if (r <= v->sk) {
+		q = v->sd * d2s_pow10[v->sk - r];
+
+		/*
+		 * The shortest digits are off the exact value by at most
+		 * half an ulp (2^e2 / 2). If an ulp is smaller than 10^r,
+		 * that is less than half a unit, so q is correctly rounded.
+		 */
+		if (pow2_lt_pow10(v->e2, r))
+			return q;
+
+		/*
+		 * Otherwise find floor(v / 10^r) within the error bound:
+		 * an ulp is about q / m units
+		 */
+		span = q / v->m + 2;
+		lo = q > span ? q - span : 0;
+		hi = q + span;
+		d2s_exact_init(&ex, v, r);
+		while (lo < hi) {
+			mid = lo + (hi - lo + 1) / 2;
+			if (d2s_exact_cmp(&ex, 2 * mid) >= 0)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		return d2s_round_half(&ex, lo);
+	}
+
+	if ((__u32)(r - v->sk) > v->sl)
+		return 0;
+
+	p = d2s_pow10[r - v->sk];
+	q = v->sd / p;
+	rem = v->sd % p;
+	if (rem != p / 2)
+		return rem > p / 2 ? q + 1 : q;
+
+	/*
+	 * The shortest digits end in a 5 right at the rounding position;
+	 * the exact value may be slightly below, above or on the tie.
+	 * No other rounding boundary can lie between the exact value and
+	 * the shortest digits, otherwise it would be a shorter or closer
+	 * representation.
+	 */
+	d2s_exact_init(&ex, v, r);
+	return d2s_round_half(&ex, q);
+}
+
+/* Decomposes a finite, non-zero double */
+static void d2s_decompose(struct d2s_val *v, __u64 ieee_m, __u32 ieee_e)
+{
+	struct d2s_exact ex;
+
+	if (ieee_e == 0) {
+		v->m = ieee_m;
+		v->e2 = 1 - D2S_BIAS - D2S_MANTISSA_BITS;
+	} else {
+		v->m = (1ULL << D2S_MANTISSA_BITS) | ieee_m;
+		v->e2 = (__s32)ieee_e - D2S_BIAS - D2S_MANTISSA_BITS;
+	}
+
+	d2s_shortest(ieee_m, ieee_e, &v->sd, &v->sk);
+	while (v->sd % 10 == 0) {
+		v->sd /= 10;
+		++v->sk;
+	}
+	for (v->sl = 1; v->sl < ARRAY_SIZE(d2s_pow10)
+		     && v->sd >= d2s_pow10[v->sl]; ++v->sl)
+		;
+	v->e10 = v->sk + (__s32)v->sl - 1;
+
+	/* A power of ten as shortest representation can be the rounded
+	 * form of a value just below it (e.g., 1e23)
+	 */
+	if (v->sd == 1) {
+		d2s_exact_init(&ex, v, v->sk);
+		if (d2s_exact_cmp(&ex, 2) < 0)
+			--v->e10;
+	}
+}
+
+struct d2s_out {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static void out_c(struct d2s_out *o, char c)
+{
+	if (o->len + 1 < o->size)
+		o->buf[o->len] = c;
+	++o->len;
+}
+
+static void out_s(struct d2s_out *o, const char *s)
+{
+	while (*s)
+		out_c(o, *s++);
+}
+
+static void out_exp(struct d2s_out *o, __s32 e, int upper)
+{
+	char buf[UK_FMT_U64_MAXLEN];
+	unsigned int n, i;
+
+	out_c(o, upper ? 'E' : 'e');
+	out_c(o, e < 0 ? '-' : '+');
+	if (e < 0)
+		e = -e;
+	if (e < 10)
+		out_c(o, '0');
+	n = uk_fmt_u64(buf, (__u64)e, 10, 0);
+	for (i = 0; i < n; ++i)
+		out_c(o, buf[i]);
+}
+
+/*
+ * Significant digits `dig[0..nd-1]' where dig[0] has the decimal
+ * exponent `top'. Positions outside of that range read as zero.
+ */
+struct d2s_digits {
+	char dig[UK_FMT_U64_MAXLEN];
+	__s32 nd;
+	__s32 top;
+};
+
+static char digit_at(const struct d2s_digits *d, __s32 pos)
+{
+	__s32 idx = d->top - pos;
+
+	return (idx >= 0 && idx < d->nd) ? d->dig[idx] : '0';
+}
+
+static void digits_set(struct d2s_digits *d, __u64 q, __s32 r)
+{
+	if (q == 0) {
+		d->nd = 0;
+		d->top = r - 1;
+		return;
+	}
+	d->nd = (__s32)uk_fmt_u64(d->dig, q, 10, 0);
+	d->top = r + d->nd - 1;
+}
+
+/* Rounds to n (<= D2S_DIGITS_MAX) significant digits */
+static void digits_sig(struct d2s_digits *d, const struct d2s_val *v,
+		       __s32 n)
+{
+	__u64 q;
+	__s32 r;
+
+	if (!v) {
+		/* Zero */
+		d->dig[0] = '0';
+		d->nd = 1;
+		d->top = 0;
+		return;
+	}
+
+	r = v->e10 - n + 1;
+	q = d2s_round(v, r);
+	if (q >= d2s_pow10[n]) {
+		/* Rounded up to the next power of ten */
+		q /= 10;
+		++r;
+	}
+	digits_set(d, q, r);
+}
+
+/* Emits positions top..0 '.' -1..-frac */
+static void emit_fixed(struct d2s_out *o, const struct d2s_digits *d,
+		       __s32 frac, int alt)
+{
+	__s32 pos;
+
+	if (d->top < 0)
+		out_c(o, '0');
+	for (pos = d->top; pos >= 0; --pos)
+		out_c(o, digit_at(d, pos));
+	if (frac > 0 || alt)
+		out_c(o, '.');
+	for (pos = -1; pos >= -frac; --pos)
+		out_c(o, digit_at(d, pos));
+}
+
+/* Emits d.ddd with `frac' fraction digits and the exponent */
+static void emit_exp(struct d2s_out *o, const struct d2s_digits *d,
+		     __s32 frac, int alt, int upper)
+{
+	__s32 pos;
+
+	out_c(o, digit_at(d, d->top));
+	if (frac > 0 || alt)
+		out_c(o, '.');
+	for (pos = d->top - 1; pos >= d->top - frac; --pos)
+		out_c(o, digit_at(d, pos));
+	out_exp(o, d->top, upper);
+}
+
+int uk_fmt_double(char *buf, size_t size, double v, char conv, int prec,
+		  int flags)
+{
+	struct d2s_out o = { .buf = buf, .size = size, .len = 0 };
+	int upper = conv >= 'A' && conv <= 'Z';
+	int alt = flags & UK_FMT_ALT;
+	struct d2s_val val, *vp = __NULL;
+	struct d2s_digits d;
+	__u64 bits, ieee_m;
+	__u32 ieee_e;
+	__s32 n, r, x, frac;
+
+	if (upper)
+		conv = (char)(conv - 'A' + 'a');
+	if (prec < 0)
+		prec = 6;
+	if (prec > UK_FMT_PREC_MAX)
+		prec = UK_FMT_PREC_MAX;
+
+	__builtin_memcpy(&bits, &v, sizeof(bits));
+	ieee_m = bits & ((1ULL << D2S_MANTISSA_BITS) - 1);
+	ieee_e = (__u32)(bits >> D2S_MANTISSA_BITS)
+		 & ((1U << D2S_EXPONENT_BITS) - 1);
+
+	if (ieee_e == (1U << D2S_EXPONENT_BITS) - 1) {
+		out_s(&o, ieee_m ? (upper ? "NAN" : "nan")
+				 : (upper ? "INF" : "inf"));
+		goto out;
+	}
+	if (ieee_e || ieee_m) {
+		d2s_decompose(&val, ieee_m, ieee_e);
+		vp = &val;
+	}
+
+	switch (conv) {
+	case 'e':
+		digits_sig(&d, vp, MIN(prec + 1, D2S_DIGITS_MAX));
+		emit_exp(&o, &d, prec, alt, upper);
+		break;
+	case 'f':
+		if (vp) {
+			/* Round at 10^-prec, but to no more than
+			 * D2S_DIGITS_MAX significant digits
+			 */
+			r = MAX(-prec, vp->e10 - D2S_DIGITS_MAX + 1);
+			digits_set(&d, d2s_round(vp, r), r);
+		} else {
+			digits_set(&d, 0, 0);
+		}
+		emit_fixed(&o, &d, prec, alt);
+		break;
+	default:
+		/* 'g': P significant digits, style by the exponent X */
+		n = prec ? prec : 1;
+		digits_sig(&d, vp, MIN(n, D2S_DIGITS_MAX));
+		x = d.top;
+		if (n > x && x >= -4) {
+			frac = n - 1 - x;
+			if (!alt)
+				while (frac > 0 && digit_at(&d, -frac) == '0')
+					--frac;
+			emit_fixed(&o, &d, frac, alt);
+		} else {
+			frac = n - 1;
+			if (!alt)
+				while (frac > 0
+				       && digit_at(&d, x - frac) == '0')
+					--frac;
+			emit_exp(&o, &d, frac, alt, upper);
+		}
+		break;
+	}
+
+out:
+	if (size)
+		buf[MIN(o.len, size - 1)] = '\0';
+	return (int)o.len;
+}
+
+int uk_fmt_double_shortest(char *buf, double v)
+{
+	struct d2s_out o = { .buf = buf, .size = UK_FMT_SHORTEST_MAXLEN + 1,
+			     .len = 0 };
+	struct d2s_digits d;
+	__u64 bits, ieee_m, sd;
+	__u32 ieee_e;
+	__s32 sk, e;
+
+	__builtin_memcpy(&bits, &v, sizeof(bits));
+	ieee_m = bits & ((1ULL << D2S_MANTISSA_BITS) - 1);
+	ieee_e = (__u32)(bits >> D2S_MANTISSA_BITS)
+		 & ((1U << D2S_EXPONENT_BITS) - 1);
+
+	if (ieee_e == (1U << D2S_EXPONENT_BITS) - 1 && ieee_m) {
+		out_s(&o, "nan");
+		goto out;
+	}
+	if (bits >> 63)
+		out_c(&o, '-');
+	if (ieee_e == (1U << D2S_EXPONENT_BITS) - 1) {
+		out_s(&o, "inf");
+		goto out;
+	}
+	if (!ieee_e && !ieee_m) {
+		out_c(&o, '0');
+		goto out;
+	}
+
+	d2s_shortest(ieee_m, ieee_e, &sd, &sk);
+	digits_set(&d, sd, sk);
+	/* Drop trailing zeros */
+	while (d.nd > 1 && d.dig[d.nd - 1] == '0')
+		--d.nd;
+	e = d.top;
+	if (e >= -4 && e < D2S_DIGITS_MAX)
+		emit_fixed(&o, &d, MAX(d.nd - 1 - e, 0), 0);
+	else
+		emit_exp(&o, &d, d.nd - 1, 0, 0);
+
+out:
+	buf[o.len] = '\0';
+	return (int)o.len;
+}
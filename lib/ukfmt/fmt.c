@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/fmt.h>
+#include <uk/arch/limits.h>
+#include <uk/essentials.h>
+
+static const char fmt_digits_lower[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static const char fmt_digits_upper[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/* "00" to "99", so that one division yields two decimal digits */
+static const char fmt_dec2[200] = {
+	'0', '0', '0', '1', '0', '2', '0', '3', '0', '4',
+	'0', '5', '0', '6', '0', '7', '0', '8', '0', '9',
+	'1', '0', '1', '1', '1', '2', '1', '3', '1', '4',
+	'1', '5', '1', '6', '1', '7', '1', '8', '1', '9',
+	'2', '0', '2', '1', '2', '2', '2', '3', '2', '4',
+	'2', '5', '2', '6', '2', '7', '2', '8', '2', '9',
+	'3', '0', '3', '1', '3', '2', '3', '3', '3', '4',
+	'3', '5', '3', '6', '3', '7', '3', '8', '3', '9',
+	'4', '0', '4', '1', '4', '2', '4', '3', '4', '4',
+	'4', '5', '4', '6', '4', '7', '4', '8', '4', '9',
+	'5', '0', '5', '1', '5', '2', '5', '3', '5', '4',
+	'5', '5', '5', '6', '5', '7', '5', '8', '5', '9',
+	'6', '0', '6', '1', '6', '2', '6', '3', '6', '4',
+	'6', '5', '6', '6', '6', '7', '6', '8', '6', '9',
+	'7', '0', '7', '1', '7', '2', '7', '3', '7', '4',
+	'7', '5', '7', '6', '7', '7', '7', '8', '7', '9',
+	'8', '0', '8', '1', '8', '2', '8', '3', '8', '4',
+	'8', '5', '8', '6', '8', '7', '8', '8', '8', '9',
+	'9', '0', '9', '1', '9', '2', '9', '3', '9', '4',
+	'9', '5', '9', '6', '9', '7', '9', '8', '9', '9',
+};
+
+static unsigned int fmt_dec_len(__u64 num)
+{
+	unsigned int len = 1;
+
+	for (;;) {
+		if (num < 10)
+			return len;
+		if (num < 100)
+			return len + 1;
+		if (num < 1000)
+			return len + 2;
+		if (num < 10000)
+			return len + 3;
+		num /= 10000;
+		len += 4;
+	}
+}
+
+/* Writes two digits of `num' (< 100) right before `end' */
+static inline char *fmt_dec2_put(char *end, __u32 num)
+{
+	*--end = fmt_dec2[num * 2 + 1];
+	*--end = fmt_dec2[num * 2];
+	return end;
+}
+
+/* Writes the decimal digits of `num' backwards, ending right before `end' */
+static void fmt_dec(char *end, __u64 num)
+{
+	__u32 num32, low;
+
+	/* One 64-bit division per eight digits; on 32-bit architectures
+	 * these are library calls
+	 */
+	while (num > __U32_MAX) {
+		low = (__u32)(num % 100000000);
+		num /= 100000000;
+		end = fmt_dec2_put(end, low % 100);
+		low /= 100;
+		end = fmt_dec2_put(end, low % 100);
+		low /= 100;
+		end = fmt_dec2_put(end, low % 100);
+		end = fmt_dec2_put(end, low / 100);
+	}
+
+	num32 = (__u32)num;
+	while (num32 >= 100) {
+		end = fmt_dec2_put(end, num32 % 100);
+		num32 /= 100;
+	}
+	if (num32 >= 10)
+		fmt_dec2_put(end, num32);
+	else
+		*--end = (char)('0' + num32);
+}
+
+unsigned int uk_fmt_u64(char *buf, __u64 num, unsigned int base, int upper)
+{
+	const char *digits = upper ? fmt_digits_upper : fmt_digits_lower;
+	char tmp[UK_FMT_U64_MAXLEN];
+	unsigned int len, shift, i;
+	__u64 mask;
+
+	if (base == 10) {
+		len = fmt_dec_len(num);
+		fmt_dec(buf + len, num);
+		return len;
+	}
+
+	if ((base & (base - 1)) == 0) {
+		shift = (unsigned int)__builtin_ctz(base);
+		mask = base - 1;
+		len = (64 - (unsigned int)__builtin_clzll(num | 1)
+		       + shift - 1) / shift;
+		for (i = len; i > 0; --i) {
+			buf[i - 1] = digits[num & mask];
+			num >>= shift;
+		}
+		return len;
+	}
+
+	i = sizeof(tmp);
+	do {
+		tmp[--i] = digits[num % base];
+		num /= base;
+	} while (num);
+	for (len = 0; i < sizeof(tmp); ++len, ++i)
+		buf[len] = tmp[i];
+	return len;
+}
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_FMT_H__
+#define __UK_FMT_H__
+
+#include <stddef.h>
+#include <uk/config.h>
+#include <uk/arch/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of characters produced by uk_fmt_u64() (base 2) */
+#define UK_FMT_U64_MAXLEN	64
+
+/**
+ * Converts an unsigned integer to its digits in the given base, most
+ * significant digit first. Decimal conversion emits two digits per
+ * division, power-of-two bases use shifts only. No terminating NUL
+ * character is written.
+ *
+ * @param buf
+ *   Destination; must provide room for UK_FMT_U64_MAXLEN characters
+ * @param num
+ *   Value to convert
+ * @param base
+ *   Base between 2 and 36
+ * @param upper
+ *   Use upper case letters for digits above 9
+ * @return
+ *   Number of characters written
+ */
+unsigned int uk_fmt_u64(char *buf, __u64 num, unsigned int base, int upper);
+
+#if CONFIG_LIBUKFMT_FLOAT
+/* Flags for uk_fmt_double() */
+#define UK_FMT_ALT	0x1	/* `#': keep decimal point and zeros */
+
+/* Precisions above this are clamped by uk_fmt_double() */
+#define UK_FMT_PREC_MAX	64
+
+/* Maximum length of uk_fmt_double_shortest() output, without NUL */
+#define UK_FMT_SHORTEST_MAXLEN	24
+
+/**
+ * Formats the absolute value of a double like the printf(3) conversions
+ * %e, %f and %g. The result is correctly rounded for up to 17 significant
+ * digits; further digits are printed as zeros. The sign is not emitted;
+ * callers use signbit() to place it together with their padding.
+ *
+ * @param buf
+ *   Destination buffer
+ * @param size
+ *   Size of `buf'; at most size - 1 characters and a NUL are stored
+ * @param v
+ *   Value to format
+ * @param conv
+ *   Conversion: 'e', 'f', 'g', or their upper case variants which
+ *   print the exponent, INF and NAN in upper case
+ * @param prec
+ *   Precision as for printf(3)
+ * @param flags
+ *   UK_FMT_* flags
+ * @return
+ *   Length of the complete result, which may exceed `size - 1'
+ */
+int uk_fmt_double(char *buf, size_t size, double v, char conv, int prec,
+		  int flags);
+
+/**
+ * Formats a double with the shortest sequence of decimal digits that
+ * reads back as the same value (Ryu algorithm). Values with a decimal
+ * exponent between -4 and 16 are printed in positional notation,
+ * others in exponential notation (e.g., "1e+23").
+ *
+ * @param buf
+ *   Destination; must provide room for UK_FMT_SHORTEST_MAXLEN + 1
+ *   characters
+ * @param v
+ *   Value to format
+ * @return
+ *   Number of characters written, without the terminating NUL
+ */
+int uk_fmt_double_shortest(char *buf, double v);
+#endif /* CONFIG_LIBUKFMT_FLOAT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_FMT_H__ */
@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_LOCKSTAT_H__
+#define __UK_LOCKSTAT_H__
+
+#include <uk/config.h>
+#include <uk/essentials.h>
+#include <uk/arch/types.h>
+#include <uk/arch/lcpu.h>
+#include <uk/list.h>
+
+#if CONFIG_LIBUKLOCK_STATS
+#include <stdio.h>
+#include <uk/plat/time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_LIBUKLOCK_STATS
+/*
+ * Contention statistics of a single lock. Locks are registered on their
+ * first acquisition, all registered locks can be dumped at runtime.
+ * Locks in memory that is released have to be unregistered before (see
+ * uk_mutex_fini()). Hold times are only taken for exclusive acquisitions.
+ */
+struct uk_lock_stats {
+	const char *name;
+	const void *lock;
+	struct uk_list_head link;
+	int registered;
+
+	__u64 acquisitions;
+	__u64 contended;
+	__nsec wait_total;
+	__nsec wait_max;
+	__nsec hold_total;
+	__nsec hold_max;
+	__nsec hold_start;
+};
+
+#define UK_LOCK_STATS_INITIALIZER(lockname)				\
+	.stats = { .name = STRINGIFY(lockname) },
+
+void _uk_lock_stats_register(struct uk_lock_stats *st, const void *lock);
+void _uk_lock_stats_unregister(struct uk_lock_stats *st);
+
+static inline void _uk_lock_stats_acquired(struct uk_lock_stats *st,
+					   const void *lock,
+					   __nsec wait_start, int exclusive)
+{
+	__nsec now = ukplat_monotonic_clock();
+	__nsec wait;
+
+	if (unlikely(!st->registered))
+		_uk_lock_stats_register(st, lock);
+
+	st->acquisitions++;
+	if (wait_start) {
+		wait = now - wait_start;
+		st->contended++;
+		st->wait_total += wait;
+		if (wait > st->wait_max)
+			st->wait_max = wait;
+	}
+	if (exclusive)
+		st->hold_start = now;
+}
+
+static inline void _uk_lock_stats_released(struct uk_lock_stats *st)
+{
+	__nsec hold = ukplat_monotonic_clock() - st->hold_start;
+
+	st->hold_total += hold;
+	if (hold > st->hold_max)
+		st->hold_max = hold;
+}
+
+/* Timestamp for the beginning of a contended acquisition */
+#define uk_lockstat_wait_begin()	ukplat_monotonic_clock()
+#define uk_lockstat_acquired(l, wait_start)				\
+	_uk_lock_stats_acquired(&(l)->stats, (l), (wait_start), 1)
+#define uk_lockstat_acquired_shared(l, wait_start)			\
+	_uk_lock_stats_acquired(&(l)->stats, (l), (wait_start), 0)
+#define uk_lockstat_released(l)						\
+	_uk_lock_stats_released(&(l)->stats)
+#define uk_lockstat_fini(l)						\
+	_uk_lock_stats_unregister(&(l)->stats)
+
+/**
+ * Prints the statistics of all locks that were acquired so far,
+ * times are given in microseconds
+ * @param fp Stream to print to
+ */
+void uk_lock_stats_dump(FILE *fp);
+
+/**
+ * Resets the statistics of all registered locks
+ */
+void uk_lock_stats_reset(void);
+
+#else /* !CONFIG_LIBUKLOCK_STATS */
+
+#define UK_LOCK_STATS_INITIALIZER(lockname)
+#define uk_lockstat_wait_begin()		((__nsec) 0)
+#define uk_lockstat_acquired(l, wait_start)	do { } while (0)
+#define uk_lockstat_acquired_shared(l, wait_start) do { } while (0)
+#define uk_lockstat_released(l)			do { } while (0)
+#define uk_lockstat_fini(l)			do { } while (0)
+
+#endif /* !CONFIG_LIBUKLOCK_STATS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_LOCKSTAT_H__ */
@@ -42,6 +42,9 @@
 #include <uk/wait.h>
 #include <uk/wait_types.h>
 #include <uk/plat/time.h>
+#include <uk/sched.h>
+#include <uk/arch/atomic.h>
+#include <uk/lockstat.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,22 +58,37 @@ struct uk_mutex {
 	int lock_count;
 	struct uk_thread *owner;
 	struct uk_waitq wait;
+#if CONFIG_LIBUKLOCK_STATS
+	struct uk_lock_stats stats;
+#endif
 };
 
 #define	UK_MUTEX_INITIALIZER(name)				\
-	{ 0, NULL, __WAIT_QUEUE_INITIALIZER((name).wait) }
+	{							\
+		.lock_count = 0,				\
+		.owner = NULL,					\
+		.wait = __WAIT_QUEUE_INITIALIZER((name).wait),	\
+		UK_LOCK_STATS_INITIALIZER(name)			\
+	}
 
 void uk_mutex_init(struct uk_mutex *m);
 
+/* Called before the memory of a mutex is released */
+void uk_mutex_fini(struct uk_mutex *m);
+
 static inline void uk_mutex_lock(struct uk_mutex *m)
 {
 	struct uk_thread *current;
 	unsigned long irqf;
+	__nsec wait_start __maybe_unused = 0;
 
 	UK_ASSERT(m);
 
 	current = uk_thread_current();
 
+	if (m->lock_count != 0 && m->owner != current)
+		wait_start = uk_lockstat_wait_begin();
+
 	for (;;) {
 		uk_waitq_wait_event(&m->wait,
 			m->lock_count == 0 || m->owner == current);
@@ -79,7 +97,8 @@ static inline void uk_mutex_lock(struct uk_mutex *m)
 			break;
 		ukplat_lcpu_restore_irqf(irqf);
 	}
-	m->lock_count++;
+	if (m->lock_count++ == 0)
+		uk_lockstat_acquired(m, wait_start);
 	m->owner = current;
 	ukplat_lcpu_restore_irqf(irqf);
 }
@@ -97,7 +116,8 @@ static inline int uk_mutex_trylock(struct uk_mutex *m)
 	irqf = ukplat_lcpu_save_irqf();
 	if (m->lock_count == 0 || m->owner == current) {
 		ret = 1;
-		m->lock_count++;
+		if (m->lock_count++ == 0)
+			uk_lockstat_acquired(m, 0);
 		m->owner = current;
 	}
 	ukplat_lcpu_restore_irqf(irqf);
@@ -118,12 +138,104 @@ static inline void uk_mutex_unlock(struct uk_mutex *m)
 	irqf = ukplat_lcpu_save_irqf();
 	UK_ASSERT(m->lock_count > 0);
 	if (--m->lock_count == 0) {
+		uk_lockstat_released(m);
 		m->owner = NULL;
 		uk_waitq_wake_up(&m->wait);
 	}
 	ukplat_lcpu_restore_irqf(irqf);
 }
 
+/*
+ * Adaptive mutex for short critical sections (not recursive)
+ * The uncontended case takes and releases the lock with a single atomic
+ * operation and does not touch the wait queue. A contended lock is first
+ * retried a few times by yielding the CPU (with the cooperative scheduler,
+ * busy-waiting would prevent the owner from releasing the lock), and
+ * only then the thread is put to sleep.
+ */
+struct uk_amutex {
+	struct uk_thread *owner;
+	struct uk_waitq wait;
+#if CONFIG_LIBUKLOCK_STATS
+	struct uk_lock_stats stats;
+#endif
+};
+
+#define	UK_AMUTEX_INITIALIZER(name)				\
+	{							\
+		.owner = NULL,					\
+		.wait = __WAIT_QUEUE_INITIALIZER((name).wait),	\
+		UK_LOCK_STATS_INITIALIZER(name)			\
+	}
+
+void uk_amutex_init(struct uk_amutex *m);
+void uk_amutex_fini(struct uk_amutex *m);
+
+static inline int uk_amutex_trylock(struct uk_amutex *m)
+{
+	struct uk_thread *current = uk_thread_current();
+
+	UK_ASSERT(m);
+	UK_ASSERT(m->owner != current);
+
+	if (ukarch_compare_exchange_sync(&m->owner, NULL, current)
+	    != current)
+		return 0;
+
+	uk_lockstat_acquired(m, 0);
+	return 1;
+}
+
+static inline void uk_amutex_lock(struct uk_amutex *m)
+{
+	struct uk_thread *current = uk_thread_current();
+	__nsec wait_start __maybe_unused;
+	int spins;
+
+	UK_ASSERT(m);
+	UK_ASSERT(m->owner != current);
+
+	if (likely(ukarch_compare_exchange_sync(&m->owner, NULL, current)
+		   == current)) {
+		uk_lockstat_acquired(m, 0);
+		return;
+	}
+
+	wait_start = uk_lockstat_wait_begin();
+	for (spins = 0; spins < CONFIG_LIBUKLOCK_AMUTEX_SPINS; ++spins) {
+		uk_sched_yield();
+		if (ukarch_compare_exchange_sync(&m->owner, NULL, current)
+		    == current)
+			goto out;
+	}
+
+	for (;;) {
+		uk_waitq_wait_event(&m->wait,
+				    UK_READ_ONCE(m->owner) == NULL);
+		if (ukarch_compare_exchange_sync(&m->owner, NULL, current)
+		    == current)
+			break;
+	}
+out:
+	uk_lockstat_acquired(m, wait_start);
+}
+
+static inline int uk_amutex_is_locked(struct uk_amutex *m)
+{
+	return UK_READ_ONCE(m->owner) != NULL;
+}
+
+static inline void uk_amutex_unlock(struct uk_amutex *m)
+{
+	UK_ASSERT(m);
+	UK_ASSERT(m->owner == uk_thread_current());
+
+	uk_lockstat_released(m);
+	ukarch_store_n(&m->owner, NULL);
+	if (!uk_waitq_empty(&m->wait))
+		uk_waitq_wake_up(&m->wait);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_RWLOCK_H__
+#define __UK_RWLOCK_H__
+
+#include <uk/config.h>
+
+#if CONFIG_LIBUKLOCK_RWLOCK
+#include <uk/assert.h>
+#include <uk/plat/lcpu.h>
+#include <uk/thread.h>
+#include <uk/wait.h>
+#include <uk/wait_types.h>
+#include <uk/lockstat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader-writer lock that relies on a scheduler (not recursive)
+ * Writers are preferred: as soon as a writer waits for the lock, new
+ * readers are blocked until all waiting writers are done.
+ */
+struct uk_rwlock {
+	unsigned int nr_readers;
+	unsigned int nr_writers_waiting;
+	struct uk_thread *writer;
+	struct uk_waitq readers_wait;
+	struct uk_waitq writers_wait;
+#if CONFIG_LIBUKLOCK_STATS
+	struct uk_lock_stats stats;
+#endif
+};
+
+#define	UK_RWLOCK_INITIALIZER(name)					\
+	{								\
+		.nr_readers = 0,					\
+		.nr_writers_waiting = 0,				\
+		.writer = NULL,						\
+		.readers_wait = __WAIT_QUEUE_INITIALIZER((name).readers_wait), \
+		.writers_wait = __WAIT_QUEUE_INITIALIZER((name).writers_wait), \
+		UK_LOCK_STATS_INITIALIZER(name)				\
+	}
+
+void uk_rwlock_init(struct uk_rwlock *rwl);
+
+/* Called before the memory of a rwlock is released */
+void uk_rwlock_fini(struct uk_rwlock *rwl);
+
+#define __uk_rwlock_can_read(rwl) \
+	((rwl)->writer == NULL && (rwl)->nr_writers_waiting == 0)
+#define __uk_rwlock_can_write(rwl) \
+	((rwl)->writer == NULL && (rwl)->nr_readers == 0)
+
+static inline void uk_rwlock_rlock(struct uk_rwlock *rwl)
+{
+	unsigned long irqf;
+	__nsec wait_start __maybe_unused = 0;
+
+	UK_ASSERT(rwl);
+	UK_ASSERT(rwl->writer != uk_thread_current());
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (!__uk_rwlock_can_read(rwl)) {
+		wait_start = uk_lockstat_wait_begin();
+		do {
+			ukplat_lcpu_restore_irqf(irqf);
+			uk_waitq_wait_event(&rwl->readers_wait,
+					    __uk_rwlock_can_read(rwl));
+			irqf = ukplat_lcpu_save_irqf();
+		} while (!__uk_rwlock_can_read(rwl));
+	}
+	rwl->nr_readers++;
+	uk_lockstat_acquired_shared(rwl, wait_start);
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+static inline int uk_rwlock_tryrlock(struct uk_rwlock *rwl)
+{
+	unsigned long irqf;
+	int ret = 0;
+
+	UK_ASSERT(rwl);
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (__uk_rwlock_can_read(rwl)) {
+		rwl->nr_readers++;
+		uk_lockstat_acquired_shared(rwl, 0);
+		ret = 1;
+	}
+	ukplat_lcpu_restore_irqf(irqf);
+	return ret;
+}
+
+static inline void uk_rwlock_runlock(struct uk_rwlock *rwl)
+{
+	unsigned long irqf;
+
+	UK_ASSERT(rwl);
+
+	irqf = ukplat_lcpu_save_irqf();
+	UK_ASSERT(rwl->nr_readers > 0);
+	if (--rwl->nr_readers == 0 && rwl->nr_writers_waiting)
+		uk_waitq_wake_up(&rwl->writers_wait);
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+static inline void uk_rwlock_wlock(struct uk_rwlock *rwl)
+{
+	struct uk_thread *current = uk_thread_current();
+	unsigned long irqf;
+	__nsec wait_start __maybe_unused = 0;
+
+	UK_ASSERT(rwl);
+	UK_ASSERT(rwl->writer != current);
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (!__uk_rwlock_can_write(rwl)) {
+		wait_start = uk_lockstat_wait_begin();
+		rwl->nr_writers_waiting++;
+		do {
+			ukplat_lcpu_restore_irqf(irqf);
+			uk_waitq_wait_event(&rwl->writers_wait,
+					    __uk_rwlock_can_write(rwl));
+			irqf = ukplat_lcpu_save_irqf();
+		} while (!__uk_rwlock_can_write(rwl));
+		rwl->nr_writers_waiting--;
+	}
+	rwl->writer = current;
+	uk_lockstat_acquired(rwl, wait_start);
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+static inline int uk_rwlock_trywlock(struct uk_rwlock *rwl)
+{
+	unsigned long irqf;
+	int ret = 0;
+
+	UK_ASSERT(rwl);
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (__uk_rwlock_can_write(rwl)) {
+		rwl->writer = uk_thread_current();
+		uk_lockstat_acquired(rwl, 0);
+		ret = 1;
+	}
+	ukplat_lcpu_restore_irqf(irqf);
+	return ret;
+}
+
+static inline void uk_rwlock_wunlock(struct uk_rwlock *rwl)
+{
+	unsigned long irqf;
+
+	UK_ASSERT(rwl);
+
+	irqf = ukplat_lcpu_save_irqf();
+	UK_ASSERT(rwl->writer == uk_thread_current());
+	uk_lockstat_released(rwl);
+	rwl->writer = NULL;
+	if (rwl->nr_writers_waiting)
+		uk_waitq_wake_up(&rwl->writers_wait);
+	else
+		uk_waitq_wake_up(&rwl->readers_wait);
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+static inline int uk_rwlock_is_wlocked(struct uk_rwlock *rwl)
+{
+	return rwl->writer != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_LIBUKLOCK_RWLOCK */
+
+#endif /* __UK_RWLOCK_H__ */
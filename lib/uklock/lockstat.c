@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <uk/lockstat.h>
+#include <uk/plat/lcpu.h>
+
+#define NSEC_PER_USEC 1000UL
+
+static UK_LIST_HEAD(lock_stats_list);
+/* Incremented whenever a lock is unregistered */
+static unsigned long lock_stats_gen;
+
+void _uk_lock_stats_register(struct uk_lock_stats *st, const void *lock)
+{
+	unsigned long irqf;
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (!st->registered) {
+		st->lock = lock;
+		uk_list_add_tail(&st->link, &lock_stats_list);
+		st->registered = 1;
+	}
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+void _uk_lock_stats_unregister(struct uk_lock_stats *st)
+{
+	unsigned long irqf;
+
+	irqf = ukplat_lcpu_save_irqf();
+	if (st->registered) {
+		uk_list_del(&st->link);
+		st->registered = 0;
+		lock_stats_gen++;
+	}
+	ukplat_lcpu_restore_irqf(irqf);
+}
+
+void uk_lock_stats_dump(FILE *fp)
+{
+	struct uk_lock_stats st;
+	struct uk_list_head *pos;
+	unsigned long irqf, gen;
+	size_t n = 0, i;
+
+	fprintf(fp, "%-24s %18s %10s %10s %12s %10s %12s %10s\n",
+		"lock", "address", "acquired", "contended",
+		"wait total", "wait max", "hold total", "hold max");
+
+	irqf = ukplat_lcpu_save_irqf();
+	pos = lock_stats_list.next;
+	gen = lock_stats_gen;
+	ukplat_lcpu_restore_irqf(irqf);
+
+	/* Printing may block, so each record is copied with interrupts
+	 * disabled. If locks were unregistered in the meantime, our position
+	 * might be gone and is looked up again by index
+	 */
+	for (;; n++) {
+		irqf = ukplat_lcpu_save_irqf();
+		if (gen != lock_stats_gen) {
+			gen = lock_stats_gen;
+			pos = lock_stats_list.next;
+			for (i = 0; i < n && pos != &lock_stats_list; i++)
+				pos = pos->next;
+		}
+		if (pos == &lock_stats_list) {
+			ukplat_lcpu_restore_irqf(irqf);
+			break;
+		}
+		st = *uk_list_entry(pos, struct uk_lock_stats, link);
+		pos = pos->next;
+		ukplat_lcpu_restore_irqf(irqf);
+
+		fprintf(fp, "%-24s %18p %10"__PRIu64" %10"__PRIu64
+			" %12"__PRIu64" %10"__PRIu64" %12"__PRIu64
+			" %10"__PRIu64"\n",
+			st.name ? st.name : "-", st.lock,
+			st.acquisitions, st.contended,
+			(__u64) (st.wait_total / NSEC_PER_USEC),
+			(__u64) (st.wait_max / NSEC_PER_USEC),
+			(__u64) (st.hold_total / NSEC_PER_USEC),
+			(__u64) (st.hold_max / NSEC_PER_USEC));
+	}
+}
+
+void uk_lock_stats_reset(void)
+{
+	struct uk_lock_stats *st;
+	unsigned long irqf;
+
+	irqf = ukplat_lcpu_save_irqf();
+	uk_list_for_each_entry(st, &lock_stats_list, link) {
+		st->acquisitions = 0;
+		st->contended = 0;
+		st->wait_total = 0;
+		st->wait_max = 0;
+		st->hold_total = 0;
+		st->hold_max = 0;
+	}
+	ukplat_lcpu_restore_irqf(irqf);
+}
@@ -5,4 +5,26 @@ void uk_mutex_init(struct uk_mutex *m)
 	m->lock_count = 0;
 	m->owner = NULL;
 	uk_waitq_init(&m->wait);
+#if CONFIG_LIBUKLOCK_STATS
+	m->stats = (struct uk_lock_stats) { .name = NULL };
+#endif
+}
+
+void uk_mutex_fini(struct uk_mutex *m __maybe_unused)
+{
+	uk_lockstat_fini(m);
+}
+
+void uk_amutex_init(struct uk_amutex *m)
+{
+	m->owner = NULL;
+	uk_waitq_init(&m->wait);
+#if CONFIG_LIBUKLOCK_STATS
+	m->stats = (struct uk_lock_stats) { .name = NULL };
+#endif
+}
+
+void uk_amutex_fini(struct uk_amutex *m __maybe_unused)
+{
+	uk_lockstat_fini(m);
 }
@@ -48,6 +48,7 @@ extern "C" {
 struct uk_mbox;
 
 struct uk_mbox *uk_mbox_create(struct uk_alloc *a, size_t size);
+struct uk_mbox *uk_mbox_create_spsc(struct uk_alloc *a, size_t size);
 void uk_mbox_free(struct uk_alloc *a, struct uk_mbox *m);
 
 void uk_mbox_post(struct uk_mbox *m, void *msg);
@@ -58,6 +59,11 @@ void uk_mbox_recv(struct uk_mbox *m, void **msg);
 int uk_mbox_recv_try(struct uk_mbox *m, void **msg);
 __nsec uk_mbox_recv_to(struct uk_mbox *m, void **msg, __nsec timeout);
 
+unsigned int uk_mbox_recv_batch(struct uk_mbox *m, void **msgs,
+				unsigned int count);
+unsigned int uk_mbox_recv_batch_try(struct uk_mbox *m, void **msgs,
+				    unsigned int count);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
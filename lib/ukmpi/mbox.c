@@ -1,13 +1,32 @@
 #include <uk/mbox.h>
 #include <uk/assert.h>
+#include <uk/essentials.h>
+#include <uk/wait.h>
 #include <uk/arch/limits.h>
+#include <uk/arch/atomic.h>
 
 struct uk_mbox {
 	size_t len;
-	struct uk_semaphore readsem;
-	long readpos;
-	struct uk_semaphore writesem;
-	long writepos;
+	bool spsc;
+	union {
+		/* Default mode: any number of producers and consumers */
+		struct {
+			struct uk_semaphore readsem;
+			struct uk_semaphore writesem;
+		};
+		/* Single-producer/single-consumer mode */
+		struct {
+			struct uk_waitq readwq;
+			struct uk_waitq writewq;
+		};
+	};
+	/*
+	 * In SPSC mode, the positions are free-running counters:
+	 * `readpos` is only written by the consumer, `writepos` only by
+	 * the producer, `len` is a power of two.
+	 */
+	unsigned long readpos;
+	unsigned long writepos;
 
 	void *msgs[];
 };
@@ -23,6 +42,7 @@ struct uk_mbox *uk_mbox_create(struct uk_alloc *a, size_t size)
 		return NULL;
 
 	m->len = size + 1;
+	m->spsc = false;
 
 	uk_semaphore_init(&m->readsem, 0);
 	m->readpos = 0;
@@ -34,6 +54,88 @@ struct uk_mbox *uk_mbox_create(struct uk_alloc *a, size_t size)
 	return m;
 }
 
+/* Creates a lock-free mailbox for exactly one producer (which can be an
+ * interrupt handler, as long as it uses the non-blocking post) and exactly
+ * one consumer thread. The capacity is rounded up to a power of two.
+ */
+struct uk_mbox *uk_mbox_create_spsc(struct uk_alloc *a, size_t size)
+{
+	struct uk_mbox *m;
+	size_t len;
+
+	UK_ASSERT(size > 0 && size <= __L_MAX / 2);
+
+	len = 1;
+	while (len < size)
+		len <<= 1;
+
+	m = uk_malloc(a, sizeof(*m) + (sizeof(void *) * len));
+	if (!m)
+		return NULL;
+
+	m->len = len;
+	m->spsc = true;
+	uk_waitq_init(&m->readwq);
+	uk_waitq_init(&m->writewq);
+	m->readpos = 0;
+	m->writepos = 0;
+
+	uk_pr_debug("Created SPSC mailbox %p\n", m);
+	return m;
+}
+
+static inline bool _spsc_full(struct uk_mbox *m)
+{
+	return m->writepos - ukarch_load_n(&m->readpos) == m->len;
+}
+
+static inline bool _spsc_empty(struct uk_mbox *m)
+{
+	return ukarch_load_n(&m->writepos) == m->readpos;
+}
+
+/* Enqueues a message, called by the producer only. Waiting consumers are
+ * only woken up when the mailbox was empty before.
+ */
+static inline int _spsc_post(struct uk_mbox *m, void *msg)
+{
+	unsigned long w = m->writepos;
+	unsigned long r = __atomic_load_n(&m->readpos, __ATOMIC_ACQUIRE);
+
+	if (unlikely(w - r == m->len))
+		return -ENOBUFS;
+
+	m->msgs[w & (m->len - 1)] = msg;
+	__atomic_store_n(&m->writepos, w + 1, __ATOMIC_RELEASE);
+	uk_pr_debug("Posted message %p to mailbox %p\n", msg, m);
+
+	if (w == r && !uk_waitq_empty(&m->readwq))
+		uk_waitq_wake_up(&m->readwq);
+	return 0;
+}
+
+/* Dequeues up to `count` messages, called by the consumer only. A waiting
+ * producer is only woken up when the mailbox was full before.
+ */
+static inline unsigned int _spsc_recv(struct uk_mbox *m, void **msgs,
+				      unsigned int count)
+{
+	unsigned long r = m->readpos;
+	unsigned long w = __atomic_load_n(&m->writepos, __ATOMIC_ACQUIRE);
+	unsigned int i, n;
+
+	n = (unsigned int) MIN(w - r, (unsigned long) count);
+	if (msgs) {
+		for (i = 0; i < n; ++i)
+			msgs[i] = m->msgs[(r + i) & (m->len - 1)];
+	}
+	__atomic_store_n(&m->readpos, r + n, __ATOMIC_RELEASE);
+
+	if (n && w - r == m->len && !uk_waitq_empty(&m->writewq))
+		uk_waitq_wake_up(&m->writewq);
+	return n;
+}
+
 /* Deallocates a mailbox. If there are messages still present in the
  * mailbox when the mailbox is deallocated, it is an indication of a
  * programming error in lwIP and the developer should be notified.
@@ -80,6 +182,12 @@ void uk_mbox_post(struct uk_mbox *m, void *msg)
 	 */
 	UK_ASSERT(m);
 
+	if (m->spsc) {
+		uk_waitq_wait_event(&m->writewq, !_spsc_full(m));
+		_spsc_post(m, msg);
+		return;
+	}
+
 	uk_semaphore_down(&m->writesem);
 	_do_mbox_post(m, msg);
 }
@@ -88,6 +196,9 @@ int uk_mbox_post_try(struct uk_mbox *m, void *msg)
 {
 	UK_ASSERT(m);
 
+	if (m->spsc)
+		return _spsc_post(m, msg);
+
 	if (!uk_semaphore_down_try(&m->writesem))
 		return -ENOBUFS;
 	_do_mbox_post(m, msg);
@@ -100,6 +211,17 @@ __nsec uk_mbox_post_to(struct uk_mbox *m, void *msg, __nsec timeout)
 
 	UK_ASSERT(m);
 
+	if (m->spsc) {
+		__nsec then = ukplat_monotonic_clock();
+		__nsec deadline = then + timeout;
+
+		uk_waitq_wait_event_deadline(&m->writewq, !_spsc_full(m),
+					     deadline);
+		if (_spsc_post(m, msg) < 0)
+			return __NSEC_MAX;
+		return ukplat_monotonic_clock() - then;
+	}
+
 	ret = uk_semaphore_down_to(&m->writesem, timeout);
 	if (ret != __NSEC_MAX)
 		_do_mbox_post(m, msg);
@@ -137,12 +259,64 @@ void uk_mbox_recv(struct uk_mbox *m, void **msg)
 
 	UK_ASSERT(m);
 
+	if (m->spsc) {
+		uk_waitq_wait_event(&m->readwq, !_spsc_empty(m));
+		_spsc_recv(m, msg, 1);
+		return;
+	}
+
 	uk_semaphore_down(&m->readsem);
 	rmsg =  _do_mbox_recv(m);
 	if (msg)
 		*msg = rmsg;
 }
 
+/* Blocks the thread until at least one message arrives in the mailbox and
+ * receives up to `count` messages at once. Returns the number of messages
+ * stored to `msgs`.
+ */
+unsigned int uk_mbox_recv_batch(struct uk_mbox *m, void **msgs,
+				unsigned int count)
+{
+	unsigned int n = 0;
+
+	UK_ASSERT(m);
+	UK_ASSERT(msgs);
+
+	if (unlikely(!count))
+		return 0;
+
+	if (m->spsc) {
+		uk_waitq_wait_event(&m->readwq, !_spsc_empty(m));
+		return _spsc_recv(m, msgs, count);
+	}
+
+	uk_semaphore_down(&m->readsem);
+	do {
+		msgs[n++] = _do_mbox_recv(m);
+	} while (n < count && uk_semaphore_down_try(&m->readsem));
+	return n;
+}
+
+/* Non-blocking version of uk_mbox_recv_batch(): returns 0 if the mailbox
+ * is empty.
+ */
+unsigned int uk_mbox_recv_batch_try(struct uk_mbox *m, void **msgs,
+				    unsigned int count)
+{
+	unsigned int n = 0;
+
+	UK_ASSERT(m);
+	UK_ASSERT(msgs);
+
+	if (m->spsc)
+		return _spsc_recv(m, msgs, count);
+
+	while (n < count && uk_semaphore_down_try(&m->readsem))
+		msgs[n++] = _do_mbox_recv(m);
+	return n;
+}
+
 
 /* This is similar to uk_mbox_fetch, however if a message is not
  * present in the mailbox, it immediately returns with the code
@@ -161,6 +335,9 @@ int uk_mbox_recv_try(struct uk_mbox *m, void **msg)
 
 	UK_ASSERT(m);
 
+	if (m->spsc)
+		return _spsc_recv(m, msg, 1) ? 0 : -ENOMSG;
+
 	if (!uk_semaphore_down_try(&m->readsem))
 		return -ENOMSG;
 
@@ -189,6 +366,21 @@ __nsec uk_mbox_recv_to(struct uk_mbox *m, void **msg, __nsec timeout)
 
 	UK_ASSERT(m);
 
+	if (m->spsc) {
+		__nsec then = ukplat_monotonic_clock();
+		__nsec deadline = then + timeout;
+
+		uk_waitq_wait_event_deadline(&m->readwq, !_spsc_empty(m),
+					     deadline);
+		if (!_spsc_recv(m, &rmsg, 1))
+			ret = __NSEC_MAX;
+		else
+			ret = ukplat_monotonic_clock() - then;
+		if (msg)
+			*msg = rmsg;
+		return ret;
+	}
+
 	ret = uk_semaphore_down_to(&m->readsem, timeout);
 	if (ret != __NSEC_MAX)
 		rmsg = _do_mbox_recv(m);
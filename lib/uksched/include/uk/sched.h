@@ -100,6 +100,11 @@ struct uk_sched {
 	struct uk_alloc *allocator;
 	struct uk_sched *next;
 	void *prv;
+#if CONFIG_LIBUKSCHED_THREAD_CACHE
+	/* Destroyed threads with their stacks and TLS areas for reuse */
+	struct uk_thread_list cached_threads;
+	unsigned int cached_count;
+#endif
 };
 
 /* wrapper functions over scheduler callbacks */
@@ -255,6 +260,24 @@ void uk_sched_thread_destroy(struct uk_sched *sched,
 void uk_sched_thread_kill(struct uk_sched *sched,
 		struct uk_thread *thread);
 
+#if CONFIG_LIBUKSCHED_THREAD_CACHE
+/**
+ * Pre-allocates threads (stack, TLS area and thread structure) into the
+ * thread cache of a scheduler until it holds `count` entries (limited by
+ * CONFIG_LIBUKSCHED_THREAD_CACHE_HIGH).
+ *
+ * @return Number of threads in the cache afterwards
+ */
+unsigned int uk_sched_thread_cache_fill(struct uk_sched *sched,
+		unsigned int count);
+
+/**
+ * Releases cached threads to the allocator until at most `count`
+ * entries are left in the thread cache of a scheduler.
+ */
+void uk_sched_thread_cache_trim(struct uk_sched *sched, unsigned int count);
+#endif
+
 static inline
 void uk_sched_thread_switch(struct uk_sched *sched,
 		struct uk_thread *prev, struct uk_thread *next)
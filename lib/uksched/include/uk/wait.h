@@ -46,6 +46,16 @@ void uk_waitq_entry_init(struct uk_waitq_entry *entry,
 		struct uk_thread *thread)
 {
 	entry->thread = thread;
+	entry->wake = NULL;
+	entry->waiting = 0;
+}
+
+static inline
+void uk_waitq_entry_init_func(struct uk_waitq_entry *entry,
+		uk_waitq_wake_func_t wake)
+{
+	entry->thread = NULL;
+	entry->wake = wake;
 	entry->waiting = 0;
 }
 
@@ -134,8 +144,12 @@ void uk_waitq_wake_up(struct uk_waitq *wq)
 	struct uk_waitq_entry *curr, *tmp;
 
 	flags = ukplat_lcpu_save_irqf();
-	UK_STAILQ_FOREACH_SAFE(curr, wq, thread_list, tmp)
-		uk_thread_wake(curr->thread);
+	UK_STAILQ_FOREACH_SAFE(curr, wq, thread_list, tmp) {
+		if (curr->wake)
+			curr->wake(curr);
+		else
+			uk_thread_wake(curr->thread);
+	}
 	ukplat_lcpu_restore_irqf(flags);
 }
 
@@ -32,9 +32,19 @@
 extern "C" {
 #endif
 
+struct uk_waitq_entry;
+
+/*
+ * Optional wake-up function of a wait queue entry. If set, it is called
+ * by uk_waitq_wake_up() instead of waking up the entry's thread. It runs
+ * with interrupts disabled and must not block.
+ */
+typedef void (*uk_waitq_wake_func_t)(struct uk_waitq_entry *entry);
+
 struct uk_waitq_entry {
 	int waiting;
 	struct uk_thread *thread;
+	uk_waitq_wake_func_t wake;
 	UK_STAILQ_ENTRY(struct uk_waitq_entry) thread_list;
 };
 
@@ -50,6 +60,7 @@ UK_STAILQ_HEAD(uk_waitq, struct uk_waitq_entry);
 struct uk_waitq_entry name = { \
 	.waiting      = 0, \
 	.thread       = uk_thread_current(), \
+	.wake         = NULL, \
 	.thread_list  = { NULL } \
 }
 
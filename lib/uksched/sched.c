@@ -35,6 +35,7 @@
 #include <uk/plat/config.h>
 #include <uk/plat/thread.h>
 #include <uk/alloc.h>
+#include <uk/essentials.h>
 #include <uk/sched.h>
 #include <uk/arch/tls.h>
 #if CONFIG_LIBUKSCHEDCOOP
@@ -133,6 +134,12 @@ struct uk_sched *uk_sched_create(struct uk_alloc *a, size_t prv_size)
 	UK_TAILQ_INIT(&sched->exited_threads);
 	sched->prv = (void *) sched + sizeof(struct uk_sched);
 
+#if CONFIG_LIBUKSCHED_THREAD_CACHE
+	UK_TAILQ_INIT(&sched->cached_threads);
+	sched->cached_count = 0;
+	uk_sched_thread_cache_fill(sched, CONFIG_LIBUKSCHED_THREAD_CACHE_LOW);
+#endif
+
 	return sched;
 }
 
@@ -146,15 +153,28 @@ static void *create_stack(struct uk_alloc *allocator)
 {
 	void *stack;
 
+#if CONFIG_UKPLAT_STACK_GUARD
+	stack = ukplat_stack_alloc(allocator);
+#else
 	if (uk_posix_memalign(allocator, &stack,
 			      STACK_SIZE, STACK_SIZE) != 0) {
 		uk_pr_err("Failed to allocate thread stack: Not enough memory\n");
 		return NULL;
 	}
+#endif
 
 	return stack;
 }
 
+static void destroy_stack(struct uk_alloc *allocator, void *stack)
+{
+#if CONFIG_UKPLAT_STACK_GUARD
+	ukplat_stack_free(allocator, stack);
+#else
+	uk_free(allocator, stack);
+#endif
+}
+
 static void *uk_thread_tls_create(struct uk_alloc *allocator)
 {
 	void *tls;
@@ -198,33 +218,134 @@ out_crash:
 	UK_CRASH("Failed to initialize `idle` thread\n");
 }
 
-struct uk_thread *uk_sched_thread_create(struct uk_sched *sched,
-		const char *name, const uk_thread_attr_t *attr,
-		void (*function)(void *), void *arg)
+/* Allocates a thread structure together with its stack and TLS area */
+static struct uk_thread *thread_alloc(struct uk_sched *sched)
 {
-	struct uk_thread *thread = NULL;
-	void *stack = NULL;
-	int rc;
-	void *tls = NULL;
+	struct uk_thread *thread;
 
 	thread = uk_malloc(sched->allocator, sizeof(struct uk_thread));
 	if (thread == NULL) {
 		uk_pr_err("Failed to allocate thread\n");
-		goto err;
+		return NULL;
 	}
 
 	/* We can't use lazy allocation here
 	 * since the trap handler runs on the stack
 	 */
-	stack = create_stack(sched->allocator);
-	if (stack == NULL)
-		goto err;
-	if (have_tls_area() && !(tls = uk_thread_tls_create(sched->allocator)))
-		goto err;
+	thread->stack = create_stack(sched->allocator);
+	if (thread->stack == NULL)
+		goto err_free_thread;
+
+	thread->tls = NULL;
+	if (have_tls_area()) {
+		thread->tls = uk_thread_tls_create(sched->allocator);
+		if (thread->tls == NULL)
+			goto err_free_stack;
+	}
+
+	return thread;
+
+err_free_stack:
+	destroy_stack(sched->allocator, thread->stack);
+err_free_thread:
+	uk_free(sched->allocator, thread);
+	return NULL;
+}
+
+static void thread_free(struct uk_sched *sched, struct uk_thread *thread)
+{
+	destroy_stack(sched->allocator, thread->stack);
+	if (thread->tls)
+		uk_free(sched->allocator, thread->tls);
+	uk_free(sched->allocator, thread);
+}
+
+#if CONFIG_LIBUKSCHED_THREAD_CACHE
+/*
+ * Destroyed threads keep their stack and TLS area and are put into a
+ * per-scheduler cache, so that creating a thread does not need to go
+ * through the allocator. The cache holds at most
+ * CONFIG_LIBUKSCHED_THREAD_CACHE_HIGH threads.
+ */
+static struct uk_thread *thread_get(struct uk_sched *sched)
+{
+	struct uk_thread *thread;
+
+	thread = UK_TAILQ_FIRST(&sched->cached_threads);
+	if (thread == NULL)
+		return thread_alloc(sched);
+
+	UK_TAILQ_REMOVE(&sched->cached_threads, thread, thread_list);
+	sched->cached_count--;
+
+	/* Reset the TLS area to its initial image */
+	if (thread->tls)
+		ukarch_tls_area_copy(thread->tls);
+	return thread;
+}
+
+static void thread_put(struct uk_sched *sched, struct uk_thread *thread)
+{
+	if (sched->cached_count >= CONFIG_LIBUKSCHED_THREAD_CACHE_HIGH) {
+		thread_free(sched, thread);
+		return;
+	}
+
+	UK_TAILQ_INSERT_HEAD(&sched->cached_threads, thread, thread_list);
+	sched->cached_count++;
+}
+
+unsigned int uk_sched_thread_cache_fill(struct uk_sched *sched,
+					unsigned int count)
+{
+	struct uk_thread *thread;
+
+	UK_ASSERT(sched != NULL);
+
+	count = MIN(count, (unsigned int) CONFIG_LIBUKSCHED_THREAD_CACHE_HIGH);
+	while (sched->cached_count < count) {
+		thread = thread_alloc(sched);
+		if (thread == NULL)
+			break;
+		UK_TAILQ_INSERT_HEAD(&sched->cached_threads, thread,
+				     thread_list);
+		sched->cached_count++;
+	}
+	return sched->cached_count;
+}
+
+void uk_sched_thread_cache_trim(struct uk_sched *sched, unsigned int count)
+{
+	struct uk_thread *thread;
+
+	UK_ASSERT(sched != NULL);
+
+	while (sched->cached_count > count) {
+		thread = UK_TAILQ_FIRST(&sched->cached_threads);
+		UK_TAILQ_REMOVE(&sched->cached_threads, thread, thread_list);
+		sched->cached_count--;
+		thread_free(sched, thread);
+	}
+}
+#else
+#define thread_get(sched) thread_alloc(sched)
+#define thread_put(sched, thread) thread_free(sched, thread)
+#endif /* CONFIG_LIBUKSCHED_THREAD_CACHE */
+
+struct uk_thread *uk_sched_thread_create(struct uk_sched *sched,
+		const char *name, const uk_thread_attr_t *attr,
+		void (*function)(void *), void *arg)
+{
+	struct uk_thread *thread = NULL;
+	int rc;
+
+	thread = thread_get(sched);
+	if (thread == NULL)
+		return NULL;
 
 	rc = uk_thread_init(thread,
 			&sched->plat_ctx_cbs, sched->allocator,
-			name, stack, tls, function, arg);
+			name, thread->stack, thread->tls, function, arg);
 	if (rc)
 		goto err;
 
@@ -237,12 +358,7 @@ struct uk_thread *uk_sched_thread_create(struct uk_sched *sched,
 err_add:
 	uk_thread_fini(thread, sched->allocator);
 err:
-	if (tls)
-		uk_free(sched->allocator, tls);
-	if (stack)
-		uk_free(sched->allocator, stack);
-	if (thread)
-		uk_free(sched->allocator, thread);
+	thread_put(sched, thread);
 
 	return NULL;
 }
@@ -257,10 +373,7 @@ void uk_sched_thread_destroy(struct uk_sched *sched, struct uk_thread *thread)
 
 	UK_TAILQ_REMOVE(&sched->exited_threads, thread, thread_list);
 	uk_thread_fini(thread, sched->allocator);
-	uk_free(sched->allocator, thread->stack);
-	if (thread->tls)
-		uk_free(sched->allocator, thread->tls);
-	uk_free(sched->allocator, thread);
+	thread_put(sched, thread);
 }
 
 void uk_sched_thread_kill(struct uk_sched *sched, struct uk_thread *thread)
@@ -40,6 +40,9 @@
 #include <uk/print.h>
 #include <uk/assert.h>
 #include <uk/arch/tls.h>
+#if CONFIG_LIBUKDEBUG_TRACEPOINTS
+#include <uk/trace.h>
+#endif
 
 /* Pushes the specified value onto the stack of the specified thread */
 static void stack_push(unsigned long *sp, unsigned long value)
@@ -140,6 +143,10 @@ void uk_thread_fini(struct uk_thread *thread, struct uk_alloc *allocator)
 	UK_ASSERT(thread != NULL);
 #if CONFIG_LIBUKSIGNAL
 	uk_thread_sig_uninit(&thread->signals_container);
+#endif
+#if CONFIG_LIBUKDEBUG_TRACEPOINTS
+	if (thread->tls)
+		uk_trace_tls_release(thread->tls, ukarch_tls_area_size());
 #endif
 	ukplat_thread_ctx_destroy(allocator, thread->ctx);
 }
@@ -128,6 +128,11 @@ static void schedcoop_schedule(struct uk_sched *s)
 	if (prev != next)
 		uk_sched_thread_switch(s, prev, next);
 
+#if CONFIG_UKPLAT_STACK_GUARD
+	/* Stacks grow in the page fault handler, which cannot allocate */
+	ukplat_stack_reserve_refill(s->allocator);
+#endif
+
 	UK_TAILQ_FOREACH_SAFE(thread, &s->exited_threads, thread_list, tmp) {
 		if (!thread->detached)
 			/* someone will eventually wait for it */
@@ -60,13 +60,56 @@ struct uk_sglist_seg {
 	size_t      ss_len;   /* Length of the buffer */
 };
 
+struct uk_sglist_arena;
+
 struct uk_sglist {
 	struct uk_sglist_seg *sg_segs; /* Segment management */
 	__atomic    sg_refs; /* Reference count for the sg list */
 	uint16_t    sg_nseg; /* Number of segment in the sg list */
 	uint16_t    sg_maxseg; /* Maximum number of segment in the sg list */
+	struct uk_sglist_arena *sg_arena; /* Spill-over storage (optional) */
+};
+
+/**
+ * Bump allocator for scatter gather lists and segment arrays. Memory handed
+ * out from an arena is never released individually; all of it is returned
+ * at once with uk_sglist_arena_reset(). An arena is typically embedded in a
+ * device queue and reset before each request is built.
+ */
+struct uk_sglist_arena {
+	uintptr_t   sa_base; /* Start of the backing memory */
+	size_t      sa_size; /* Size of the backing memory */
+	size_t      sa_used; /* Bytes handed out since the last reset */
 };
 
+/**
+ * Initialize a sg list arena.
+ * @param ar
+ *	A reference to the arena.
+ * @param mem
+ *	The backing memory of the arena.
+ * @param size
+ *	The size of the backing memory.
+ */
+static inline void uk_sglist_arena_init(struct uk_sglist_arena *ar,
+					void *mem, size_t size)
+{
+	ar->sa_base = (uintptr_t) mem;
+	ar->sa_size = size;
+	ar->sa_used = 0;
+}
+
+/**
+ * Release everything that was handed out from the arena. Lists allocated
+ * from the arena or spilled over into it must not be used afterwards.
+ * @param ar
+ *	A reference to the arena.
+ */
+static inline void uk_sglist_arena_reset(struct uk_sglist_arena *ar)
+{
+	ar->sa_used = 0;
+}
+
 /**
  * Initialize the sg list.
  * @param sg
@@ -82,9 +125,31 @@ static inline void uk_sglist_init(struct uk_sglist *sg,
 	sg->sg_segs = segs;
 	sg->sg_nseg = 0;
 	sg->sg_maxseg = maxsegs;
+	sg->sg_arena = NULL;
 	uk_refcount_init(&sg->sg_refs, 1);
 }
 
+/**
+ * Initialize the sg list with a small, typically inline, array of
+ * segments. When an append needs more than `maxsegs` segments, the list
+ * spills over into a larger array taken from the arena instead of failing.
+ * @param sg
+ *	A reference to sg list.
+ * @param maxsegs
+ *	The nr of segments in `segs`.
+ * @param segs
+ *	An array of segments.
+ * @param ar
+ *	The arena to spill over into.
+ */
+static inline void uk_sglist_init_arena(struct uk_sglist *sg,
+				uint16_t maxsegs, struct uk_sglist_seg *segs,
+				struct uk_sglist_arena *ar)
+{
+	uk_sglist_init(sg, maxsegs, segs);
+	sg->sg_arena = ar;
+}
+
 /**
  * Reset the sg list.
  * @param sg
@@ -166,6 +231,36 @@ size_t uk_sglist_length(struct uk_sglist *sg);
  */
 int uk_sglist_join(struct uk_sglist *first, struct uk_sglist *second);
 
+/**
+ * Allocate a scatter/gather list along with 'nsegs' segments from an arena.
+ * The list is released with the next reset of the arena and must not be
+ * passed to uk_sglist_free(). It can be handed to uk_sglist_split() or
+ * uk_sglist_slice() as a preallocated destination list.
+ *
+ * @param ar
+ *	The arena to allocate the scatter gather list from.
+ * @param nsegs
+ *	The max number of segments.
+ * @return
+ *	- NULL:  The arena is exhausted.
+ *	- (struct uk_sglist *): reference to scatter/gather list.
+ */
+struct uk_sglist *uk_sglist_arena_alloc(struct uk_sglist_arena *ar,
+					uint16_t nsegs);
+
+/**
+ * Clone a scatter/gather list into an arena.
+ * @param ar
+ *	The arena to allocate the new list from.
+ * @param sg
+ *	A reference to the sg list to be cloned.
+ * @return
+ *	NULL: The arena is exhausted.
+ *	(struct uk_sglist *): reference to the sg list.
+ */
+struct uk_sglist *uk_sglist_arena_clone(struct uk_sglist_arena *ar,
+					const struct uk_sglist *sg);
+
 #ifdef CONFIG_LIBUKALLOC
 /**
  * Allocate a scatter/gather list along with 'nsegs' segments.
@@ -235,6 +330,7 @@ struct uk_sglist *uk_sglist_clone(struct uk_sglist *sg,
  *
  * @return
  *	EINVAL: Invalid  sg list.
+ *	EBUSY: The original list is shared.
  *	ENOMEM: Allocation fails.
  *	EFBIG: Insufficient space.
  *	0: Successful split of the list.
@@ -271,14 +367,17 @@ int uk_sglist_slice(struct uk_sglist *original, struct uk_sglist **slice,
 
 #ifdef CONFIG_LIBUKNETDEV
 /**
- * The function create a scatter gather list from the netbuf
+ * The function create a scatter gather list from the netbuf chain. When
+ * the list has room for the worst case of the whole chain, the segments are
+ * appended without checking the bounds of the list for each of them.
  * @param sg
  *	A reference to the scatter gather list.
- * @param m0
- *	A reference to the netbuf
+ * @param netbuf
+ *	A reference to the head of the netbuf chain
  * @return
  *	0, on successful creation of the scatter gather list
  *	-EINVAL, Invalid sg list.
+ *	-EFBIG, Insufficient segments.
  */
 int uk_sglist_append_netbuf(struct uk_sglist *sg, struct uk_netbuf *netbuf);
 #endif /* CONFIG_LIBUKNET */
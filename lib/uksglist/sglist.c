@@ -40,6 +40,7 @@
 #include <uk/plat/io.h>
 #include <uk/arch/types.h>
 #include <uk/arch/limits.h>
+#include <uk/essentials.h>
 #include <uk/refcount.h>
 #include <uk/assert.h>
 #ifdef CONFIG_LIBUKALLOC
@@ -78,17 +79,70 @@ struct sgsave {
 
 static inline int _sglist_append_range(struct uk_sglist *sg,
 			struct uk_sglist_seg **ssp, __phys_addr paddr,
-			size_t len);
+			size_t len, int checked);
 static inline int _sglist_append_buf(struct uk_sglist *sg, void *buf,
-				size_t len, size_t *donep);
+				size_t len, size_t *donep, int checked);
+
+/**
+ * Hand out `size` bytes from the arena. Returns NULL if the arena is
+ * exhausted.
+ */
+static void *_sglist_arena_get(struct uk_sglist_arena *ar, size_t size)
+{
+	size_t off;
+
+	off = ALIGN_UP(ar->sa_used, __alignof__(struct uk_sglist));
+	if (unlikely(off > ar->sa_size || size > ar->sa_size - off))
+		return NULL;
+	ar->sa_used = off + size;
+	return (void *)(ar->sa_base + off);
+}
+
+/**
+ * Give a full sglist more segments from its arena. If the segment array
+ * ends right where the free space of the arena starts (i.e., it was the
+ * last allocation), the array is extended in place. Otherwise the segments
+ * are moved to an array twice as large.
+ */
+static int _sglist_grow(struct uk_sglist *sg)
+{
+	struct uk_sglist_arena *ar = sg->sg_arena;
+	struct uk_sglist_seg *segs;
+	size_t nmax, avail;
+
+	if (!ar || sg->sg_maxseg == __U16_MAX)
+		return -EFBIG;
+
+	nmax = MIN((size_t)sg->sg_maxseg * 2, (size_t)__U16_MAX);
+	if ((uintptr_t)(sg->sg_segs + sg->sg_maxseg)
+	    == ar->sa_base + ar->sa_used) {
+		avail = (ar->sa_size - ar->sa_used) / sizeof(*segs);
+		if (avail == 0)
+			return -EFBIG;
+		avail = MIN(avail, nmax - sg->sg_maxseg);
+		ar->sa_used += avail * sizeof(*segs);
+		sg->sg_maxseg += avail;
+		return 0;
+	}
+
+	segs = _sglist_arena_get(ar, nmax * sizeof(*segs));
+	if (!segs)
+		return -EFBIG;
+	memcpy(segs, sg->sg_segs, sg->sg_nseg * sizeof(*segs));
+	sg->sg_segs = segs;
+	sg->sg_maxseg = nmax;
+	return 0;
+}
+
 /**
  * Append a single (paddr, len) to a sglist.  sg is the list and ss is
- * the current segment in the list.  If we run out of segments then
- * EFBIG will be returned.
+ * the current segment in the list.  If we run out of segments and the list
+ * cannot spill over into its arena then EFBIG will be returned. With
+ * `checked` cleared, the caller guarantees that the list has room.
  */
 static inline int _sglist_append_range(struct uk_sglist *sg,
 			struct uk_sglist_seg **ssp, __phys_addr paddr,
-			size_t len)
+			size_t len, int checked)
 {
 	struct uk_sglist_seg *ss;
 
@@ -96,8 +150,11 @@ static inline int _sglist_append_range(struct uk_sglist *sg,
 	if (ss->ss_paddr + ss->ss_len == paddr)
 		ss->ss_len += len;
 	else {
-		if (sg->sg_nseg == sg->sg_maxseg)
-			return -EFBIG;
+		if (checked && unlikely(sg->sg_nseg == sg->sg_maxseg)) {
+			if (_sglist_grow(sg))
+				return -EFBIG;
+			ss = &sg->sg_segs[sg->sg_nseg - 1];
+		}
 		ss++;
 		ss->ss_paddr = paddr;
 		ss->ss_len = len;
@@ -112,7 +169,7 @@ static inline int _sglist_append_range(struct uk_sglist *sg,
  * user) to a scatter/gather list.
  */
 static inline int _sglist_append_buf(struct uk_sglist *sg, void *buf,
-				size_t len, size_t *donep)
+				size_t len, size_t *donep, int checked)
 {
 	struct uk_sglist_seg *ss;
 	__vm_offset vaddr, offset;
@@ -137,7 +194,7 @@ static inline int _sglist_append_buf(struct uk_sglist *sg, void *buf,
 		sg->sg_nseg = 1;
 	} else {
 		ss = &sg->sg_segs[sg->sg_nseg - 1];
-		error = _sglist_append_range(sg, &ss, paddr, seglen);
+		error = _sglist_append_range(sg, &ss, paddr, seglen, checked);
 		if (error)
 			return error;
 	}
@@ -149,7 +206,7 @@ static inline int _sglist_append_buf(struct uk_sglist *sg, void *buf,
 	while (len > 0) {
 		seglen = MIN(len, __PAGE_SIZE);
 		paddr = ukplat_virt_to_phys((void *)vaddr);
-		error = _sglist_append_range(sg, &ss, paddr, seglen);
+		error = _sglist_append_range(sg, &ss, paddr, seglen, checked);
 		if (error)
 			return error;
 		vaddr += seglen;
@@ -196,7 +253,7 @@ int uk_sglist_append(struct uk_sglist *sg, void *buf, size_t len)
 		return -EINVAL;
 
 	SGLIST_SAVE(sg, save);
-	error = _sglist_append_buf(sg, buf, len,  NULL);
+	error = _sglist_append_buf(sg, buf, len, NULL, 1);
 	if (error)
 		SGLIST_RESTORE(sg, save);
 
@@ -228,7 +285,7 @@ int uk_sglist_append_sglist(struct uk_sglist *sg,
 		if (seglen > length)
 			seglen = length;
 		error = _sglist_append_range(sg, &ss,
-		    source->sg_segs[i].ss_paddr + offset, seglen);
+		    source->sg_segs[i].ss_paddr + offset, seglen, 1);
 		if (error)
 			break;
 		offset = 0;
@@ -272,29 +329,67 @@ int uk_sglist_join(struct uk_sglist *first, struct uk_sglist *second)
 	 * in 'first' then set append to '1'.
 	 */
 	append = 0;
-	flast = &first->sg_segs[first->sg_nseg - 1];
 	sfirst = &second->sg_segs[0];
-	if (first->sg_nseg != 0 &&
-	    flast->ss_paddr + flast->ss_len == sfirst->ss_paddr)
-		append = 1;
+	if (first->sg_nseg != 0) {
+		flast = &first->sg_segs[first->sg_nseg - 1];
+		if (flast->ss_paddr + flast->ss_len == sfirst->ss_paddr)
+			append = 1;
+	}
 
 	/* Make sure 'first' has enough room. */
-	if (first->sg_nseg + second->sg_nseg - append > first->sg_maxseg)
-		return -EFBIG;
+	while (first->sg_nseg + second->sg_nseg - append > first->sg_maxseg)
+		if (_sglist_grow(first))
+			return -EFBIG;
 
 	/* Merge last in 'first' and first in 'second' if needed. */
 	if (append)
-		flast->ss_len += sfirst->ss_len;
+		first->sg_segs[first->sg_nseg - 1].ss_len += sfirst->ss_len;
 
 	/* Append new segments from 'second' to 'first'. */
-	memmove(second->sg_segs + append, first->sg_segs + first->sg_nseg,
+	memmove(first->sg_segs + first->sg_nseg, second->sg_segs + append,
 	    (second->sg_nseg - append) * sizeof(struct uk_sglist_seg));
 	first->sg_nseg += second->sg_nseg - append;
 	uk_sglist_reset(second);
 	return 0;
 }
 
-#ifdef CONFIG_UKALLOC
+struct uk_sglist *uk_sglist_arena_alloc(struct uk_sglist_arena *ar,
+					uint16_t nsegs)
+{
+	struct uk_sglist *sg;
+
+	UK_ASSERT(ar);
+
+	sg = _sglist_arena_get(ar, sizeof(struct uk_sglist) +
+			(nsegs * sizeof(struct uk_sglist_seg)));
+	if (unlikely(!sg))
+		return NULL;
+
+	uk_sglist_init_arena(sg, nsegs, (struct uk_sglist_seg *)(sg + 1), ar);
+	return sg;
+}
+
+struct uk_sglist *uk_sglist_arena_clone(struct uk_sglist_arena *ar,
+					const struct uk_sglist *sg)
+{
+	struct uk_sglist *new;
+
+	UK_ASSERT(ar);
+
+	if (!sg)
+		return NULL;
+
+	new = uk_sglist_arena_alloc(ar, sg->sg_nseg);
+	if (unlikely(!new))
+		return NULL;
+
+	new->sg_nseg = sg->sg_nseg;
+	memcpy(new->sg_segs, sg->sg_segs,
+	       sizeof(struct uk_sglist_seg) * sg->sg_nseg);
+	return new;
+}
+
+#ifdef CONFIG_LIBUKALLOC
 struct uk_sglist *uk_sglist_alloc(struct uk_alloc *a, int nsegs)
 {
 	struct uk_sglist *sg;
@@ -379,7 +474,7 @@ int uk_sglist_split(struct uk_sglist *original, struct uk_sglist **head,
 	int count, i;
 
 	if (uk_refcount_read(&original->sg_refs) > 1)
-		return -EDOOFUS;
+		return -EBUSY;
 
 	/* Figure out how big of a sglist '*head' has to hold. */
 	count = 0;
@@ -439,7 +534,7 @@ int uk_sglist_split(struct uk_sglist *original, struct uk_sglist **head,
 	/* Trim 'count' entries from the front of 'original'. */
 	original->sg_nseg -= count;
 	memmove(original->sg_segs, original->sg_segs + count,
-			count * sizeof(struct uk_sglist_seg));
+			original->sg_nseg * sizeof(struct uk_sglist_seg));
 	return 0;
 }
 
@@ -530,23 +625,46 @@ int uk_sglist_slice(struct uk_sglist *original, struct uk_sglist **slice,
 	}
 	return 0;
 }
-#endif /* CONFIG_UKALLOC */
+#endif /* CONFIG_LIBUKALLOC */
 
 #ifdef CONFIG_LIBUKNETDEV
 int uk_sglist_append_netbuf(struct uk_sglist *sg, struct uk_netbuf *netbuf)
 {
 	struct sgsave save;
 	struct uk_netbuf *nb;
+	size_t nsegs;
 	int error;
 
+	UK_ASSERT(sg);
+
 	if (sg->sg_maxseg == 0)
 		return -EINVAL;
 
-	error = 0;
+	/*
+	 * A buffer never needs more segments than the number of pages it
+	 * touches. If the whole chain fits in the worst case, append without
+	 * bounds checks and without having to roll back.
+	 */
+	nsegs = 0;
+	UK_NETBUF_CHAIN_FOREACH(nb, netbuf) {
+		if (likely(nb->len > 0))
+			nsegs += (page_off(nb->data) + nb->len
+				  + __PAGE_SIZE - 1) >> __PAGE_SHIFT;
+	}
+	if (likely(nsegs <= (size_t)(sg->sg_maxseg - sg->sg_nseg))) {
+		UK_NETBUF_CHAIN_FOREACH(nb, netbuf) {
+			if (likely(nb->len > 0))
+				_sglist_append_buf(sg, nb->data, nb->len,
+						   NULL, 0);
+		}
+		return 0;
+	}
+
 	SGLIST_SAVE(sg, save);
 	UK_NETBUF_CHAIN_FOREACH(nb, netbuf) {
 		if (likely(nb->len > 0)) {
-			error = uk_sglist_append(sg, nb->data, nb->len);
+			error = _sglist_append_buf(sg, nb->data, nb->len,
+						   NULL, 1);
 			if (unlikely(error)) {
 				SGLIST_RESTORE(sg, save);
 				return error;
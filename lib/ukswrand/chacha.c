@@ -30,129 +30,281 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * ChaCha20 based generator with fast key erasure: every refill runs the
+ * ChaCha20 block function for several consecutive counter values at once,
+ * the first 32 bytes of the keystream replace the key and the remaining
+ * bytes are handed out (and wiped afterwards). Earlier output can thus
+ * not be reconstructed from the generator state.
+ *
+ * The block function computes CHACHA_LANES blocks in parallel. It is
+ * written with GCC vector extensions, which map to SSE2 (or AVX2) on
+ * x86_64 and NEON on arm64; without SIMD support the compiler lowers the
+ * vectors to scalar code.
+ */
+
 #include <string.h>
 #include <uk/swrand.h>
 #include <uk/print.h>
 #include <uk/assert.h>
 #include <uk/ctors.h>
+#include <uk/essentials.h>
+#include <uk/plat/lcpu.h>
+#include <uk/arch/atomic.h>
+#include "chacha.h"
+#if CONFIG_LIBUKSWRAND_ENTROPY
+#include "entropy.h"
+#endif
+
+#if defined(__AVX2__)
+#define CHACHA_LANES		8
+#else
+#define CHACHA_LANES		4
+#endif
+#define CHACHA_BLOCK_WORDS	16
+#define CHACHA_BLOCK_SIZE	(CHACHA_BLOCK_WORDS * sizeof(__u32))
+#define CHACHA_KEY_WORDS	8
+
+/* Keystream words produced by one refill */
+#define SWRAND_BUF_WORDS	(CHACHA_LANES * CHACHA_BLOCK_WORDS)
+
+/* Requests of at least this size are written directly to the caller */
+#define SWRAND_BULK_MIN		(CHACHA_LANES * CHACHA_BLOCK_SIZE)
+
+typedef __u32 chacha_vec_t __attribute__((vector_size(CHACHA_LANES * 4)));
 
 struct uk_swrand {
-	int k;
-	__u32 input[16], output[16];
+	__u32 key[CHACHA_KEY_WORDS];
+	__u32 nonce[2];
+	/* Next unused word in buf */
+	unsigned int pos;
+	__u32 buf[SWRAND_BUF_WORDS];
 };
 
 struct uk_swrand uk_swrand_def;
+unsigned long uk_swrand_generation = 1;
 
 /* This value isn't important, as long as it's sufficiently asymmetric */
 static const char sigma[16] = "expand 32-byte k";
 
-static inline __u32 _uk_rotl32(__u32 v, int c)
+/*
+ * Computes CHACHA_LANES consecutive keystream blocks, starting at block
+ * number `counter`, and stores them to `out`.
+ */
+static void _uk_chacha20_blocks(const __u32 key[CHACHA_KEY_WORDS],
+				const __u32 nonce[2], __u64 counter,
+				__u32 out[SWRAND_BUF_WORDS])
 {
-	return (v << c) | (v >> (32 - c));
-}
+	chacha_vec_t x[CHACHA_BLOCK_WORDS], in[CHACHA_BLOCK_WORDS];
+	chacha_vec_t lane;
+	unsigned int i, j;
 
-static inline void _uk_quarterround(__u32 x[16], int a, int b, int c, int d)
-{
-	x[a] = x[a] + x[b];
-	x[d] = _uk_rotl32(x[d] ^ x[a], 16);
+	for (j = 0; j < CHACHA_LANES; j++)
+		lane[j] = j;
+
+	for (i = 0; i < 4; i++)
+		in[i] = (chacha_vec_t) {} + ((const __u32 *) sigma)[i];
+	for (i = 0; i < CHACHA_KEY_WORDS; i++)
+		in[i + 4] = (chacha_vec_t) {} + key[i];
+	in[12] = ((chacha_vec_t) {} + (__u32) counter) + lane;
+	/* Carry of the per-lane counter increment (comparison yields -1) */
+	in[13] = ((chacha_vec_t) {} + (__u32) (counter >> 32))
+		 - (chacha_vec_t) (in[12] < lane);
+	in[14] = (chacha_vec_t) {} + nonce[0];
+	in[15] = (chacha_vec_t) {} + nonce[1];
 
-	x[c] = x[c] + x[d];
-	x[b] = _uk_rotl32(x[b] ^ x[c], 12);
+	for (i = 0; i < CHACHA_BLOCK_WORDS; i++)
+		x[i] = in[i];
 
-	x[a] = x[a] + x[b];
-	x[d] = _uk_rotl32(x[d] ^ x[a], 8);
+	for (i = 0; i < 10; i++)
+		CHACHA_DOUBLEROUND(x);
 
-	x[c] = x[c] + x[d];
-	x[b] = _uk_rotl32(x[b] ^ x[c], 7);
+	for (i = 0; i < CHACHA_BLOCK_WORDS; i++)
+		x[i] += in[i];
+
+	/* Transpose lanes into consecutive blocks */
+	for (j = 0; j < CHACHA_LANES; j++)
+		for (i = 0; i < CHACHA_BLOCK_WORDS; i++)
+			out[j * CHACHA_BLOCK_WORDS + i] = x[i][j];
 }
 
-static inline void
-_uk_salsa20_wordtobyte(__u32 output[16], const __u32 input[16])
+/* Wipes memory in a way that is not optimized away */
+static inline void _uk_swrand_wipe(void *p, size_t len)
 {
-	__u32 i;
-
-	for (i = 0; i < 16; i++)
-		output[i] = input[i];
-
-	for (i = 8; i > 0; i -= 2) {
-		_uk_quarterround(output, 0, 4, 8, 12);
-		_uk_quarterround(output, 1, 5, 9, 13);
-		_uk_quarterround(output, 2, 6, 10, 14);
-		_uk_quarterround(output, 3, 7, 11, 15);
-		_uk_quarterround(output, 0, 5, 10, 15);
-		_uk_quarterround(output, 1, 6, 11, 12);
-		_uk_quarterround(output, 2, 7, 8, 13);
-		_uk_quarterround(output, 3, 4, 9, 14);
-	}
+	memset(p, 0, len);
+	__asm__ __volatile__("" : : "r"(p) : "memory");
+}
 
-	for (i = 0; i < 16; i++)
-		output[i] += input[i];
+/* Refills the output buffer and replaces the key with fresh keystream */
+static void _uk_swrand_refill(struct uk_swrand *r)
+{
+	_uk_chacha20_blocks(r->key, r->nonce, 0, r->buf);
+	memcpy(r->key, r->buf, sizeof(r->key));
+	_uk_swrand_wipe(r->buf, sizeof(r->key));
+	r->pos = CHACHA_KEY_WORDS;
 }
 
-static inline void _uk_key_setup(struct uk_swrand *r, __u32 k[8])
+void uk_swrand_init_r(struct uk_swrand *r, unsigned int seedc,
+		const __u32 seedv[])
 {
-	int i;
+	unsigned int i;
+
+	UK_ASSERT(r);
+	UK_ASSERT(seedc == 0 || seedv);
 
-	for (i = 0; i < 8; i++)
-		r->input[i + 4] = k[i];
+	memset(r, 0, sizeof(*r));
 
-	for (i = 0; i < 4; i++)
-		r->input[i] = ((__u32 *)sigma)[i];
+	/* The first 8 words of the seed form the key, the next two the
+	 * nonce. Longer seeds are folded into the key.
+	 */
+	for (i = 0; i < seedc; i++) {
+		if (i >= CHACHA_KEY_WORDS && i < CHACHA_KEY_WORDS + 2)
+			r->nonce[i - CHACHA_KEY_WORDS] = seedv[i];
+		else
+			r->key[i % CHACHA_KEY_WORDS] ^= seedv[i];
+	}
+
+	_uk_swrand_refill(r);
 }
 
-static inline void _uk_iv_setup(struct uk_swrand *r, __u32 iv[2])
+__u32 uk_swrand_randr_r(struct uk_swrand *r)
 {
-	r->input[12] = 0;
-	r->input[13] = 0;
-	r->input[14] = iv[0];
-	r->input[15] = iv[1];
+	__u32 res;
+
+	UK_ASSERT(r);
+
+	if (unlikely(r->pos >= SWRAND_BUF_WORDS))
+		_uk_swrand_refill(r);
+
+	res = r->buf[r->pos];
+	r->buf[r->pos++] = 0;
+	return res;
 }
 
-static inline __u32 _infvec_val(unsigned int c, const __u32 v[],
-		unsigned int pos)
+void uk_swrand_reseed_r(struct uk_swrand *r, unsigned int seedc,
+		const __u32 seedv[])
 {
-	if (c == 0)
-		return 0x0;
-	return v[pos % c];
+	unsigned int i;
+
+	UK_ASSERT(r);
+	UK_ASSERT(seedc == 0 || seedv);
+
+	for (i = 0; i < seedc; i++)
+		r->key[i % CHACHA_KEY_WORDS] ^= seedv[i];
+
+	/* Drop output that was generated with the old key */
+	_uk_swrand_wipe(r->buf, sizeof(r->buf));
+	_uk_swrand_refill(r);
 }
 
-void uk_swrand_init_r(struct uk_swrand *r, unsigned int seedc,
-		const __u32 seedv[])
+ssize_t uk_swrand_fill_buffer_r(struct uk_swrand *r, void *buf, size_t buflen)
 {
-	__u32 i;
+	__u32 key[CHACHA_KEY_WORDS], tail[SWRAND_BUF_WORDS];
+	__u8 *dst = buf;
+	size_t len = buflen, n;
+	__u64 counter;
 
 	UK_ASSERT(r);
-	/* Initialize chacha */
-	__u32 k[8], iv[2];
+	UK_ASSERT(buf || !buflen);
 
-	for (i = 0; i < 8; i++)
-		k[i] = _infvec_val(10, seedv, i);
+	/* Hand out buffered keystream first */
+	n = MIN(len, (SWRAND_BUF_WORDS - r->pos) * sizeof(__u32));
+	if (n) {
+		memcpy(dst, &r->buf[r->pos], n);
+		_uk_swrand_wipe(&r->buf[r->pos], ALIGN_UP(n, sizeof(__u32)));
+		r->pos += DIV_ROUND_UP(n, sizeof(__u32));
+		dst += n;
+		len -= n;
+	}
 
-	iv[0] = _infvec_val(seedc, seedv, i);
-	iv[1] = _infvec_val(seedc, seedv, i + 1);
+	if (len >= SWRAND_BULK_MIN) {
+		/* Bulk request: take the current key for the caller's
+		 * keystream and rekey the generator. The refill consumes
+		 * blocks 0 to CHACHA_LANES - 1 under that key (the new key
+		 * and the buffered output), so the caller's keystream
+		 * starts at block CHACHA_LANES and never overlaps them.
+		 */
+		memcpy(key, r->key, sizeof(key));
+		_uk_swrand_refill(r);
 
-	_uk_key_setup(r, k);
-	_uk_iv_setup(r, iv);
+		counter = CHACHA_LANES;
+		while (len >= SWRAND_BUF_WORDS * sizeof(__u32)) {
+			_uk_chacha20_blocks(key, r->nonce, counter,
+					    (__u32 *) dst);
+			counter += CHACHA_LANES;
+			dst += SWRAND_BUF_WORDS * sizeof(__u32);
+			len -= SWRAND_BUF_WORDS * sizeof(__u32);
+		}
+		if (len) {
+			_uk_chacha20_blocks(key, r->nonce, counter, tail);
+			memcpy(dst, tail, len);
+			_uk_swrand_wipe(tail, sizeof(tail));
+			len = 0;
+		}
+		_uk_swrand_wipe(key, sizeof(key));
+	}
 
-	r->k = 16;
+	while (len) {
+		_uk_swrand_refill(r);
+		n = MIN(len, (SWRAND_BUF_WORDS - r->pos) * sizeof(__u32));
+		memcpy(dst, &r->buf[r->pos], n);
+		_uk_swrand_wipe(&r->buf[r->pos], ALIGN_UP(n, sizeof(__u32)));
+		r->pos += DIV_ROUND_UP(n, sizeof(__u32));
+		dst += n;
+		len -= n;
+	}
+
+	return buflen;
 }
 
-__u32 uk_swrand_randr_r(struct uk_swrand *r)
+#if CONFIG_HAVE_SCHED
+/*
+ * Per-thread generators: each thread derives its own key from the default
+ * generator on first use and after every reseed of the default generator,
+ * so that bulk requests do not need to disable interrupts and threads do
+ * not share any generator state.
+ */
+static __uk_tls struct uk_swrand uk_swrand_tls;
+static __uk_tls unsigned long uk_swrand_tls_generation;
+
+ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
 {
-	__u32 res;
+	__u32 seed[CHACHA_KEY_WORDS + 2];
+	unsigned long iflags, generation;
+	unsigned int i;
 
-	for (;;) {
-		_uk_salsa20_wordtobyte(r->output, r->input);
-		r->input[12] = r->input[12] + 1;
-		if (r->input[12] == 0)
-			r->input[13]++;
+#if CONFIG_LIBUKSWRAND_ENTROPY
+	uk_swrand_entropy_poll();
+#endif
 
-		if (r->k < 16) {
-			res = r->output[r->k];
-			r->k += 1;
-			return res;
-		}
+	generation = ukarch_load_n(&uk_swrand_generation);
+	if (unlikely(uk_swrand_tls_generation != generation)) {
+		iflags = ukplat_lcpu_save_irqf();
+		for (i = 0; i < ARRAY_SIZE(seed); i++)
+			seed[i] = uk_swrand_randr_r(&uk_swrand_def);
+		generation = uk_swrand_generation;
+		ukplat_lcpu_restore_irqf(iflags);
 
-		r->k = 0;
+		uk_swrand_init_r(&uk_swrand_tls, ARRAY_SIZE(seed), seed);
+		_uk_swrand_wipe(seed, sizeof(seed));
+		uk_swrand_tls_generation = generation;
 	}
+
+	return uk_swrand_fill_buffer_r(&uk_swrand_tls, buf, buflen);
+}
+#else
+ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
+{
+	unsigned long iflags;
+	ssize_t ret;
+
+#if CONFIG_LIBUKSWRAND_ENTROPY
+	uk_swrand_entropy_poll();
+#endif
+
+	iflags = ukplat_lcpu_save_irqf();
+	ret = uk_swrand_fill_buffer_r(&uk_swrand_def, buf, buflen);
+	ukplat_lcpu_restore_irqf(iflags);
+	return ret;
 }
+#endif /* CONFIG_HAVE_SCHED */
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UKSWRAND_CHACHA_H__
+#define __UKSWRAND_CHACHA_H__
+
+#include <uk/arch/types.h>
+
+#define CHACHA_ROTL(v, c) (((v) << (c)) | ((v) >> (32 - (c))))
+
+#define CHACHA_QUARTERROUND(x, a, b, c, d)				\
+	do {								\
+		x[a] += x[b]; x[d] = CHACHA_ROTL(x[d] ^ x[a], 16);	\
+		x[c] += x[d]; x[b] = CHACHA_ROTL(x[b] ^ x[c], 12);	\
+		x[a] += x[b]; x[d] = CHACHA_ROTL(x[d] ^ x[a], 8);	\
+		x[c] += x[d]; x[b] = CHACHA_ROTL(x[b] ^ x[c], 7);	\
+	} while (0)
+
+#define CHACHA_DOUBLEROUND(x)						\
+	do {								\
+		CHACHA_QUARTERROUND(x, 0, 4, 8, 12);			\
+		CHACHA_QUARTERROUND(x, 1, 5, 9, 13);			\
+		CHACHA_QUARTERROUND(x, 2, 6, 10, 14);			\
+		CHACHA_QUARTERROUND(x, 3, 7, 11, 15);			\
+		CHACHA_QUARTERROUND(x, 0, 5, 10, 15);			\
+		CHACHA_QUARTERROUND(x, 1, 6, 11, 12);			\
+		CHACHA_QUARTERROUND(x, 2, 7, 8, 13);			\
+		CHACHA_QUARTERROUND(x, 3, 4, 9, 14);			\
+	} while (0)
+
+/* ChaCha20 permutation of a single state, without the final addition */
+static inline void chacha_permute(__u32 x[16])
+{
+	int i;
+
+	for (i = 0; i < 10; i++)
+		CHACHA_DOUBLEROUND(x);
+}
+
+/*
+ * Incremented every time uk_swrand_def is reseeded. Per-thread generators
+ * derive a new key from uk_swrand_def when they notice a change.
+ */
+extern unsigned long uk_swrand_generation;
+
+#endif /* __UKSWRAND_CHACHA_H__ */
@@ -47,15 +47,15 @@
 int dev_random_read(struct device *dev __unused, struct uio *uio,
 			int flags __unused)
 {
-	size_t count;
-	char *buf;
-
-	buf = uio->uio_iov->iov_base;
-	count = uio->uio_iov->iov_len;
-
-	uk_swrand_fill_buffer(buf, count);
-
-	uio->uio_resid = 0;
+	struct iovec *iov;
+	int i;
+
+	/* Keystream is written directly into each of the caller's buffers */
+	for (i = 0; i < uio->uio_iovcnt; i++) {
+		iov = &uio->uio_iov[i];
+		uk_swrand_fill_buffer(iov->iov_base, iov->iov_len);
+		uio->uio_resid -= iov->iov_len;
+	}
 	return 0;
 }
 
@@ -0,0 +1,463 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Entropy pool for the ChaCha20 generator. Inputs (CPU random number
+ * instructions, registered sources like virtio-rng, interrupt timing and
+ * CPU timing jitter) are absorbed into a sponge built on the ChaCha20
+ * permutation. Reseeding squeezes 256 bits out of the pool and mixes them
+ * into the key of uk_swrand_def; per-thread generators follow on their
+ * next request. Reseeds happen at exponentially growing intervals up to
+ * CONFIG_LIBUKSWRAND_ENTROPY_RESEED_INTERVAL ms and as soon as the pool
+ * collected enough entropy for the first full seed.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <uk/swrand.h>
+#include <uk/print.h>
+#include <uk/assert.h>
+#include <uk/essentials.h>
+#include <uk/arch/lcpu.h>
+#include <uk/arch/atomic.h>
+#include <uk/plat/lcpu.h>
+#include <uk/plat/time.h>
+#if CONFIG_LIBUKSCHED
+#include <uk/sched.h>
+#endif
+#include "chacha.h"
+#include "entropy.h"
+
+#define POOL_WORDS		16
+/* Input is absorbed into and output squeezed from words 4 to 11 */
+#define POOL_RATE_OFF		4
+#define POOL_RATE_WORDS		8
+#define POOL_RATE_SIZE		(POOL_RATE_WORDS * sizeof(__u32))
+
+/* Credited bits required for the first full seed */
+#define POOL_READY_BITS		256U
+#define POOL_MAX_BITS		(2 * POOL_READY_BITS)
+
+/* Interrupts per credited bit of entropy */
+#define IRQ_PER_BIT		64
+/* Timing jitter samples per credited bit of entropy */
+#define JITTER_PER_BIT		8
+#define JITTER_BLOCK		64U
+
+#define RESEED_INTERVAL_MIN	(1000UL * 1000UL * 1000UL)
+#define RESEED_INTERVAL_MAX	((__nsec) CONFIG_LIBUKSWRAND_ENTROPY_RESEED_INTERVAL \
+				 * 1000UL * 1000UL)
+
+/* Number of words fetched from CPU random number instructions per reseed */
+#define HW_WORDS		4
+#define HW_RETRIES		10
+
+/* All pool state is protected by disabling interrupts */
+static __u32 pool[POOL_WORDS];
+static unsigned int pool_bits;
+static int pool_ready;
+static int reseed_pending;
+static __nsec reseed_interval = RESEED_INTERVAL_MIN;
+static __nsec next_reseed = RESEED_INTERVAL_MIN;
+
+static struct uk_swrand_source *sources;
+
+#if CONFIG_LIBUKSWRAND_ENTROPY_IRQ
+static __u32 irq_pool[4];
+static unsigned int irq_count;
+#endif
+
+static inline void _entropy_wipe(void *p, size_t len)
+{
+	memset(p, 0, len);
+	__asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+static inline __u64 _entropy_cycles(void)
+{
+#if CONFIG_ARCH_X86_64
+	__u32 lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((__u64) hi << 32) | lo;
+#elif CONFIG_ARCH_ARM_64
+	__u64 v;
+
+	__asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v));
+	return v;
+#else
+	return ukplat_monotonic_clock();
+#endif
+}
+
+/*
+ * CPU random number instructions: RDSEED (full credit) or RDRAND on x86_64,
+ * RNDRRS (full credit) or RNDR on arm64. The latter are DRBG outputs and get
+ * a quarter of the credit.
+ */
+static int hw_seed, hw_rand;
+
+#if CONFIG_ARCH_X86_64
+static void _hw_detect(void)
+{
+	__u32 eax, ebx, ecx, edx;
+
+	__asm__ __volatile__("cpuid"
+			     : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+			     : "a"(1), "c"(0));
+	hw_rand = !!(ecx & (1U << 30));
+
+	__asm__ __volatile__("cpuid"
+			     : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+			     : "a"(0), "c"(0));
+	if (eax >= 7) {
+		__asm__ __volatile__("cpuid"
+				     : "=a"(eax), "=b"(ebx), "=c"(ecx),
+				       "=d"(edx)
+				     : "a"(7), "c"(0));
+		hw_seed = !!(ebx & (1U << 18));
+	}
+}
+
+static inline int _hw_read_seed(__u64 *v)
+{
+	__u8 ok;
+
+	__asm__ __volatile__("rdseed %0; setc %1"
+			     : "=r"(*v), "=qm"(ok) : : "cc");
+	return ok;
+}
+
+static inline int _hw_read_rand(__u64 *v)
+{
+	__u8 ok;
+
+	__asm__ __volatile__("rdrand %0; setc %1"
+			     : "=r"(*v), "=qm"(ok) : : "cc");
+	return ok;
+}
+#elif CONFIG_ARCH_ARM_64
+#define ID_AA64ISAR0_RNDR_SHIFT	60
+
+static void _hw_detect(void)
+{
+	__u64 isar0;
+
+	__asm__ __volatile__("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+	hw_seed = hw_rand = ((isar0 >> ID_AA64ISAR0_RNDR_SHIFT) & 0xf) != 0;
+}
+
+/* RNDRRS and RNDR are encoded by number for older assemblers */
+static inline int _hw_read_seed(__u64 *v)
+{
+	int ok;
+
+	__asm__ __volatile__("mrs %0, s3_3_c2_c4_1; cset %w1, ne"
+			     : "=r"(*v), "=r"(ok) : : "cc");
+	return ok;
+}
+
+static inline int _hw_read_rand(__u64 *v)
+{
+	int ok;
+
+	__asm__ __volatile__("mrs %0, s3_3_c2_c4_0; cset %w1, ne"
+			     : "=r"(*v), "=r"(ok) : : "cc");
+	return ok;
+}
+#else
+static void _hw_detect(void)
+{
+}
+
+static inline int _hw_read_seed(__u64 *v __unused)
+{
+	return 0;
+}
+
+static inline int _hw_read_rand(__u64 *v __unused)
+{
+	return 0;
+}
+#endif
+
+/* Fills buf with up to HW_WORDS words, returns the credited bits */
+static unsigned int _hw_gather(__u64 buf[HW_WORDS])
+{
+	unsigned int i, retry, bits = 0;
+
+	for (i = 0; i < HW_WORDS; i++) {
+		for (retry = 0; retry < HW_RETRIES; retry++) {
+			if (hw_seed && _hw_read_seed(&buf[i])) {
+				bits += 64;
+				break;
+			}
+			if (hw_rand && _hw_read_rand(&buf[i])) {
+				bits += 16;
+				break;
+			}
+		}
+	}
+	return bits;
+}
+
+/* Caller has to disable interrupts */
+static void _pool_mix(const void *buf, size_t len, unsigned int bits)
+{
+	const __u8 *src = buf;
+	__u8 *rate = (__u8 *) &pool[POOL_RATE_OFF];
+	size_t i, n;
+
+	while (len) {
+		n = MIN(len, POOL_RATE_SIZE);
+		for (i = 0; i < n; i++)
+			rate[i] ^= src[i];
+		chacha_permute(pool);
+		src += n;
+		len -= n;
+	}
+
+	pool_bits = MIN(pool_bits + bits, POOL_MAX_BITS);
+	if (!pool_ready && pool_bits >= POOL_READY_BITS)
+		reseed_pending = 1;
+}
+
+/* Squeezes 256 bits out of the pool; caller has to disable interrupts */
+static void _pool_extract(__u32 out[POOL_RATE_WORDS])
+{
+	chacha_permute(pool);
+	memcpy(out, &pool[POOL_RATE_OFF], POOL_RATE_SIZE);
+
+	/* Overwrite the output so that it cannot be recomputed from a later
+	 * pool state
+	 */
+	memset(&pool[POOL_RATE_OFF], 0, POOL_RATE_SIZE);
+	chacha_permute(pool);
+}
+
+void uk_swrand_add_entropy(const void *buf, size_t len, unsigned int bits)
+{
+	unsigned long iflags;
+
+	UK_ASSERT(buf || !len);
+
+	iflags = ukplat_lcpu_save_irqf();
+	_pool_mix(buf, len, MIN(bits, len * 8));
+	ukplat_lcpu_restore_irqf(iflags);
+}
+
+void uk_swrand_add_irq_timing(unsigned long irq __maybe_unused)
+{
+#if CONFIG_LIBUKSWRAND_ENTROPY_IRQ
+	__u64 c = _entropy_cycles();
+	unsigned int i = irq_count++ & 3;
+
+	/* Cheap mixing only; the samples are absorbed into the pool with the
+	 * next reseed
+	 */
+	irq_pool[i] ^= (__u32) c ^ (__u32) (c >> 32) ^ (__u32) irq;
+	irq_pool[(i + 1) & 3] += CHACHA_ROTL(irq_pool[i], 7);
+
+	if (unlikely(!pool_ready
+		     && irq_count >= POOL_READY_BITS * IRQ_PER_BIT))
+		reseed_pending = 1;
+#endif
+}
+
+/* Caller has to disable interrupts */
+static void _irq_pool_fold(void)
+{
+#if CONFIG_LIBUKSWRAND_ENTROPY_IRQ
+	_pool_mix(irq_pool, sizeof(irq_pool),
+		  MIN(irq_count / IRQ_PER_BIT, sizeof(irq_pool) * 8));
+	irq_count = 0;
+#endif
+}
+
+/*
+ * Measures the execution time of a small memory workload. Variations are
+ * caused by caches, pipelines, interrupts and the hypervisor. Only samples
+ * with varying first and second order deltas are credited.
+ */
+static void _jitter_collect(unsigned int samples)
+{
+	static __u8 mem[256];
+	__u32 buf[POOL_RATE_WORDS];
+	__u64 t0, t1, delta, last = 0, last2 = 0;
+	unsigned long iflags;
+	unsigned int i, j, idx = 0, varying;
+
+	while (samples) {
+		memset(buf, 0, sizeof(buf));
+		varying = 0;
+		for (i = 0; i < JITTER_BLOCK; i++) {
+			t0 = _entropy_cycles();
+			for (j = 0; j < 16; j++) {
+				idx = (idx + 67 + (__u32) t0) & (sizeof(mem) - 1);
+				mem[idx] += (__u8) t0 + j;
+			}
+			t1 = _entropy_cycles();
+
+			delta = t1 - t0;
+			if (delta != last && delta - last != last2)
+				varying++;
+			last2 = delta - last;
+			last = delta;
+
+			buf[i % POOL_RATE_WORDS] =
+				CHACHA_ROTL(buf[i % POOL_RATE_WORDS], 5)
+				^ (__u32) delta ^ (__u32) t1;
+		}
+
+		iflags = ukplat_lcpu_save_irqf();
+		_pool_mix(buf, sizeof(buf), varying / JITTER_PER_BIT);
+		ukplat_lcpu_restore_irqf(iflags);
+
+		samples -= MIN(samples, JITTER_BLOCK);
+	}
+	_entropy_wipe(buf, sizeof(buf));
+}
+
+int uk_swrand_source_register(struct uk_swrand_source *src)
+{
+	unsigned long iflags;
+
+	UK_ASSERT(src);
+	UK_ASSERT(src->request);
+
+	iflags = ukplat_lcpu_save_irqf();
+	src->next = sources;
+	sources = src;
+	ukplat_lcpu_restore_irqf(iflags);
+
+	uk_pr_info("Registered entropy source %s\n", src->name);
+
+	/* Ask for data right away for a quick first full seed */
+	src->request(src);
+	return 0;
+}
+
+int uk_swrand_reseed(void)
+{
+	struct uk_swrand_source *src;
+	__u32 seed[POOL_RATE_WORDS];
+	__u64 hw[HW_WORDS];
+	unsigned long iflags;
+	unsigned int bits;
+	__nsec now;
+	int ready;
+
+	/* Data from asynchronous sources is used by the next reseed */
+	for (src = sources; src; src = src->next)
+		src->request(src);
+
+	bits = _hw_gather(hw);
+	now = ukplat_monotonic_clock();
+
+	iflags = ukplat_lcpu_save_irqf();
+	_pool_mix(hw, sizeof(hw), bits);
+	_pool_mix(&now, sizeof(now), 0);
+	_irq_pool_fold();
+	_pool_extract(seed);
+
+	if (pool_bits >= POOL_READY_BITS) {
+		if (!pool_ready)
+			uk_pr_info("Random number generator fully seeded\n");
+		pool_ready = 1;
+	}
+	if (pool_ready)
+		pool_bits = 0;
+	reseed_pending = 0;
+
+	uk_swrand_reseed_r(&uk_swrand_def, ARRAY_SIZE(seed), seed);
+	ukarch_inc(&uk_swrand_generation);
+
+	reseed_interval = MIN(reseed_interval * 2, RESEED_INTERVAL_MAX);
+	next_reseed = now + reseed_interval;
+	ready = pool_ready;
+	ukplat_lcpu_restore_irqf(iflags);
+
+	_entropy_wipe(seed, sizeof(seed));
+	_entropy_wipe(hw, sizeof(hw));
+	return ready;
+}
+
+void uk_swrand_entropy_poll(void)
+{
+	if (likely(!UK_READ_ONCE(reseed_pending)
+		   && ukplat_monotonic_clock() < UK_READ_ONCE(next_reseed)))
+		return;
+
+	uk_swrand_reseed();
+}
+
+int uk_swrand_is_ready(void)
+{
+	if (likely(UK_READ_ONCE(pool_ready)))
+		return 1;
+
+	/* Sources might have delivered enough data in the meantime */
+	if (UK_READ_ONCE(reseed_pending))
+		return uk_swrand_reseed();
+	return 0;
+}
+
+void uk_swrand_wait_ready(void)
+{
+	unsigned int rounds = 0;
+
+	while (!uk_swrand_is_ready()) {
+		_jitter_collect(POOL_READY_BITS * JITTER_PER_BIT);
+		if (uk_swrand_reseed())
+			break;
+
+		if (++rounds == 16)
+			uk_pr_warn("Waiting for entropy, the cycle counter seems to provide little jitter\n");
+#if CONFIG_LIBUKSCHED
+		/* Give interrupt driven sources a chance */
+		uk_sched_yield();
+#endif
+	}
+}
+
+void uk_swrand_entropy_init(void)
+{
+	_hw_detect();
+	uk_pr_info("Entropy sources: %s%s%sinterrupt timing, timing jitter\n",
+		   hw_seed ? "seed instruction, " : "",
+		   hw_rand ? "random instruction, " : "",
+		   sources ? "registered devices, " : "");
+
+	/* A short jitter measurement does not delay boot noticeably; the
+	 * generator might not be fully seeded afterwards though
+	 */
+	_jitter_collect(JITTER_BLOCK * 4);
+	uk_swrand_reseed();
+}
@@ -31,12 +31,31 @@
  */
 
 #include <string.h>
+#include <errno.h>
 #include <sys/random.h>
 #include <uk/essentials.h>
 #include <uk/swrand.h>
 
 
-ssize_t getrandom(void *buf, size_t buflen, unsigned int flags __unused)
+ssize_t getrandom(void *buf, size_t buflen, unsigned int flags)
 {
+	if (flags & ~(GRND_NONBLOCK | GRND_RANDOM | GRND_INSECURE)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+#if CONFIG_LIBUKSWRAND_ENTROPY
+	/* Like Linux, only block until the generator is fully seeded once;
+	 * GRND_RANDOM does not use a separate pool.
+	 */
+	if (!(flags & GRND_INSECURE) && !uk_swrand_is_ready()) {
+		if (flags & GRND_NONBLOCK) {
+			errno = EAGAIN;
+			return -1;
+		}
+		uk_swrand_wait_ready();
+	}
+#endif
+
 	return uk_swrand_fill_buffer(buf, buflen);
 }
@@ -69,8 +69,55 @@ static inline __u32 uk_swrand_randr(void)
 	return ret;
 }
 
+/* Fills buf with random bytes from the generator r; the caller has to
+ * serialize accesses to r
+ */
+ssize_t uk_swrand_fill_buffer_r(struct uk_swrand *r, void *buf, size_t buflen);
+/* Fills buf with random bytes. With ChaCha20 and a scheduler, each thread
+ * uses its own generator which is seeded from the default one on first use
+ */
 ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen);
 
+#if CONFIG_LIBUKSWRAND_CHACHA
+/* Mixes seedv into the key of r and discards buffered output */
+void uk_swrand_reseed_r(struct uk_swrand *r, unsigned int seedc,
+			const __u32 seedv[]);
+#endif /* CONFIG_LIBUKSWRAND_CHACHA */
+
+#if CONFIG_LIBUKSWRAND_ENTROPY
+/*
+ * Entropy source that delivers its data asynchronously (e.g., a device).
+ * `request` is called on every reseed to ask for more input. It must not
+ * block; the data is handed over later with uk_swrand_add_entropy().
+ */
+struct uk_swrand_source {
+	const char *name;
+	void (*request)(struct uk_swrand_source *src);
+	struct uk_swrand_source *next;
+};
+
+int uk_swrand_source_register(struct uk_swrand_source *src);
+
+/* Mixes len bytes into the entropy pool and credits them with `bits` bits
+ * of entropy. Can be called from interrupt context.
+ */
+void uk_swrand_add_entropy(const void *buf, size_t len, unsigned int bits);
+
+/* Samples the cycle counter on interrupt arrival; called by the platform */
+void uk_swrand_add_irq_timing(unsigned long irq);
+
+/* Reseeds the default generator from the entropy pool. Returns 1 if the
+ * generator has been seeded with enough entropy at least once, 0 otherwise
+ */
+int uk_swrand_reseed(void);
+
+/* Returns 1 if the generator has been fully seeded */
+int uk_swrand_is_ready(void);
+
+/* Collects CPU timing jitter until the generator is fully seeded */
+void uk_swrand_wait_ready(void);
+#endif /* CONFIG_LIBUKSWRAND_ENTROPY */
+
 #ifdef __cplusplus
 }
 #endif
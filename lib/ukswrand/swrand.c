@@ -32,6 +32,9 @@
 #include <uk/config.h>
 #include <uk/print.h>
 #include <uk/init.h>
+#if CONFIG_LIBUKSWRAND_ENTROPY
+#include "entropy.h"
+#endif
 
 __u32 uk_swrandr_gen_seed32(void)
 {
@@ -53,6 +56,28 @@ __u32 uk_swrandr_gen_seed32(void)
 	return val;
 }
 
+#ifndef CONFIG_LIBUKSWRAND_CHACHA
+/* The ChaCha20 generator comes with its own block-wise implementation */
+ssize_t uk_swrand_fill_buffer_r(struct uk_swrand *r, void *buf, size_t buflen)
+{
+	size_t step, chunk_size, i;
+	__u32 rd;
+
+	step = sizeof(__u32);
+	chunk_size = buflen % step;
+
+	for (i = 0; i < buflen - chunk_size; i += step)
+		*(__u32 *)((char *) buf + i) = uk_swrand_randr_r(r);
+
+	/* fill the remaining bytes of the buffer */
+	if (chunk_size > 0) {
+		rd = uk_swrand_randr_r(r);
+		memcpy(buf + i, &rd, chunk_size);
+	}
+
+	return buflen;
+}
+
 ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
 {
 	size_t step, chunk_size, i;
@@ -72,6 +97,7 @@ ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
 
 	return buflen;
 }
+#endif /* !CONFIG_LIBUKSWRAND_CHACHA */
 
 static int _uk_swrand_init(void)
 {
@@ -89,6 +115,9 @@ static int _uk_swrand_init(void)
 		seedv[i] = uk_swrandr_gen_seed32();
 
 	uk_swrand_init_r(&uk_swrand_def, seedc, seedv);
+#if CONFIG_LIBUKSWRAND_ENTROPY
+	uk_swrand_entropy_init();
+#endif
 
 	return seedc;
 }
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Extraction of "newc" cpio archives (as generated by `cpio -H newc`)
+ * to a ramfs. File contents are not copied: they are attached to the
+ * ramfs nodes in place, so the archive has to stay in memory as long
+ * as the files exist.
+ */
+
+#define _GNU_SOURCE
+#include <uk/config.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/print.h>
+#include <vfscore/file.h>
+#include <vfscore/vnode.h>
+#include <ramfs/ramfs.h>
+#include "vfs.h"
+
+#define CPIO_NEWC_MAGIC		"070701"
+#define CPIO_NEWCRC_MAGIC	"070702"
+#define CPIO_TRAILER		"TRAILER!!!"
+#define CPIO_ALIGN(x)		ALIGN_UP((x), 4)
+
+struct cpio_newc_header {
+	char c_magic[6];
+	char c_ino[8];
+	char c_mode[8];
+	char c_uid[8];
+	char c_gid[8];
+	char c_nlink[8];
+	char c_mtime[8];
+	char c_filesize[8];
+	char c_devmajor[8];
+	char c_devminor[8];
+	char c_rdevmajor[8];
+	char c_rdevminor[8];
+	char c_namesize[8];
+	char c_check[8];
+};
+
+static int cpio_hex(const char field[8], __u32 *val)
+{
+	__u32 v = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		char c = field[i];
+
+		v <<= 4;
+		if (c >= '0' && c <= '9')
+			v |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			v |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			v |= c - 'A' + 10;
+		else
+			return EINVAL;
+	}
+
+	*val = v;
+	return 0;
+}
+
+static int cpio_create_file(char *path, mode_t mode,
+			    const void *data, size_t size)
+{
+	struct vfscore_file *fp;
+	struct vnode *vp;
+	int error;
+
+	error = sys_open(path, O_CREAT | O_EXCL | O_WRONLY, mode, &fp);
+	if (error)
+		return error;
+
+	if (size) {
+		vp = fp->f_dentry->d_vnode;
+		vn_lock(vp);
+		error = ramfs_set_file_data(vp, data, size);
+		vn_unlock(vp);
+	}
+
+	fdrop(fp);
+	return error;
+}
+
+static int cpio_create_symlink(char *path, const char *target, size_t size)
+{
+	char buf[PATH_MAX];
+
+	if (size >= sizeof(buf))
+		return ENAMETOOLONG;
+
+	memcpy(buf, target, size);
+	buf[size] = '\0';
+
+	return sys_symlink(buf, path);
+}
+
+static int cpio_extract_entry(const char *dest, const char *name,
+			      mode_t mode, const void *data, size_t size)
+{
+	char path[PATH_MAX];
+	int len, error;
+
+	/* Entry names are relative to the archive root */
+	while (name[0] == '/' || (name[0] == '.' && name[1] == '/'))
+		name += (name[0] == '/') ? 1 : 2;
+	if (name[0] == '\0' || !strcmp(name, "."))
+		return 0;
+
+	len = snprintf(path, sizeof(path), "%s%s%s", dest,
+		       (dest[strlen(dest) - 1] == '/') ? "" : "/", name);
+	if (len < 0 || (size_t) len >= sizeof(path))
+		return ENAMETOOLONG;
+
+	switch (mode & S_IFMT) {
+	case S_IFDIR:
+		error = sys_mkdir(path, mode & ~S_IFMT);
+		if (error == EEXIST)
+			error = 0;
+		break;
+	case S_IFREG:
+		error = cpio_create_file(path, mode & ~S_IFMT, data, size);
+		break;
+	case S_IFLNK:
+		error = cpio_create_symlink(path, data, size);
+		break;
+	default:
+		uk_pr_warn("%s: Unsupported file type 0%o, skipped\n",
+			   path, mode & S_IFMT);
+		error = 0;
+		break;
+	}
+
+	if (error)
+		uk_pr_err("%s: Failed to extract: %d\n", path, error);
+	return error;
+}
+
+int vfscore_cpio_extract(const char *dest, const void *archive, size_t len)
+{
+	const char *base = archive;
+	const struct cpio_newc_header *hdr;
+	const char *name;
+	__u32 mode, filesize, namesize;
+	size_t off = 0, data_off;
+	int error;
+
+	UK_ASSERT(dest && dest[0] != '\0');
+
+	while (off + sizeof(*hdr) <= len) {
+		hdr = (const struct cpio_newc_header *) (base + off);
+
+		if (memcmp(hdr->c_magic, CPIO_NEWC_MAGIC, 6) &&
+		    memcmp(hdr->c_magic, CPIO_NEWCRC_MAGIC, 6)) {
+			uk_pr_err("Invalid cpio header at offset %zu\n", off);
+			return EINVAL;
+		}
+
+		if (cpio_hex(hdr->c_mode, &mode) ||
+		    cpio_hex(hdr->c_filesize, &filesize) ||
+		    cpio_hex(hdr->c_namesize, &namesize))
+			return EINVAL;
+
+		name = base + off + sizeof(*hdr);
+		data_off = CPIO_ALIGN(off + sizeof(*hdr) + namesize);
+		if (namesize == 0 || data_off > len ||
+		    filesize > len - data_off ||
+		    name[namesize - 1] != '\0') {
+			uk_pr_err("Truncated cpio entry at offset %zu\n", off);
+			return EINVAL;
+		}
+
+		if (!strcmp(name, CPIO_TRAILER))
+			return 0;
+
+		error = cpio_extract_entry(dest, name, mode,
+					   base + data_off, filesize);
+		if (error)
+			return error;
+
+		off = CPIO_ALIGN(data_off + filesize);
+	}
+
+	/* Archives are terminated by a trailer entry */
+	uk_pr_warn("cpio archive without trailer\n");
+	return 0;
+}
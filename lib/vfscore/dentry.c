@@ -39,31 +39,145 @@
 #include <vfscore/dentry.h>
 #include <vfscore/vnode.h>
 #include <uk/mutex.h>
+#include <uk/arch/atomic.h>
+#include <uk/arch/lcpu.h>
 #include "vfs.h"
 
-#define DENTRY_BUCKETS 32
+#define DENTRY_BUCKETS 256
 
-static struct uk_hlist_head dentry_hash_table[DENTRY_BUCKETS];
-static UK_HLIST_HEAD(fake);
-static struct uk_mutex dentry_hash_lock = UK_MUTEX_INITIALIZER(dentry_hash_lock);
+/* Number of lock-free attempts before dentry_lookup() takes the lock */
+#define DENTRY_LOOKUP_RETRIES 4
 
 /*
- * Get the hash value from the mount point and path name.
- * XXX: replace with a better hash for 64-bit pointers.
+ * Dentry hash table, indexed by (parent dentry, component name), so that
+ * path lookups only need to hash one component at a time.
+ *
+ * Lookups traverse a bucket without taking any lock. Writers (insert and
+ * remove) serialize on the per-bucket mutex and bump the bucket sequence
+ * counter before and after modifying the chain, so that it is odd while an
+ * update is in progress. A reader that observes an odd or changed sequence
+ * number retries, and eventually falls back to taking the bucket lock.
+ *
+ * Removed dentries keep their `next` pointer (see dentry_unhash()), so that
+ * a concurrent reader can always finish walking the chain. Reclamation
+ * relies on read sections never blocking: with the cooperative scheduler,
+ * no reader can be inside a bucket while a dentry is freed.
+ * TODO: Defer freeing to a grace period when preemption and/or smp is here.
+ */
+struct dentry_bucket {
+	struct uk_hlist_head head;
+	struct uk_mutex lock;		/* serializes insert and remove */
+	unsigned long seq;		/* odd while the chain is updated */
+};
+
+static struct dentry_bucket dentry_hash_table[DENTRY_BUCKETS];
+
+/*
+ * Get the hash value from the parent dentry and component name.
  */
 static unsigned int
-dentry_hash(struct mount *mp, const char *path)
+dentry_hash(struct dentry *parent_dp, const char *name, size_t len)
 {
 	unsigned int val = 0;
+	unsigned long m = (unsigned long) parent_dp;
 
-	if (path) {
-		while (*path) {
-			val = ((val << 5) + val) + *path++;
-		}
+	while (len--) {
+		val = ((val << 5) + val) + *name++;
 	}
-	return (val ^ (unsigned long) mp) & (DENTRY_BUCKETS - 1);
+	/* Fold in the parent pointer, skipping the always-zero low bits */
+	return val ^ (unsigned int) (m >> 4);
 }
 
+/*
+ * Point d_name to the last component of d_path.
+ */
+static void
+dentry_set_name(struct dentry *dp)
+{
+	const char *name = strrchr(dp->d_path, '/');
+
+	dp->d_name = name ? name + 1 : dp->d_path;
+	dp->d_namelen = strlen(dp->d_name);
+}
+
+static inline struct dentry_bucket *
+dentry_bucket(unsigned int hash)
+{
+	return &dentry_hash_table[hash & (DENTRY_BUCKETS - 1)];
+}
+
+static inline void
+dentry_write_begin(struct dentry_bucket *b)
+{
+	UK_WRITE_ONCE(b->seq, b->seq + 1);
+	wmb();
+}
+
+static inline void
+dentry_write_end(struct dentry_bucket *b)
+{
+	wmb();
+	UK_WRITE_ONCE(b->seq, b->seq + 1);
+}
+
+/*
+ * Insert dp into the bucket matching its d_hash. Dentries without a parent
+ * (mount roots, pipes) are never looked up by name and stay unhashed.
+ */
+static void
+dentry_hash_insert(struct dentry *dp)
+{
+	struct dentry_bucket *b = dentry_bucket(dp->d_hash);
+
+	if (!dp->d_parent)
+		return;
+
+	uk_mutex_lock(&b->lock);
+	dentry_write_begin(b);
+	uk_hlist_add_head(&dp->d_link, &b->head);
+	dentry_write_end(b);
+	uk_mutex_unlock(&b->lock);
+}
+
+/*
+ * Remove dp from the hash table, if it is still hashed. Unlike
+ * uk_hlist_del_init(), the `next` pointer is preserved for lock-free
+ * readers that may currently be looking at dp.
+ */
+static void
+dentry_unhash(struct dentry *dp)
+{
+	struct dentry_bucket *b = dentry_bucket(dp->d_hash);
+
+	uk_mutex_lock(&b->lock);
+	if (!uk_hlist_unhashed(&dp->d_link)) {
+		dentry_write_begin(b);
+		uk_hlist_del(&dp->d_link);
+		dp->d_link.pprev = NULL;
+		dentry_write_end(b);
+	}
+	uk_mutex_unlock(&b->lock);
+}
+
+/*
+ * Walk a bucket without taking its lock. The result is only valid if the
+ * bucket sequence number did not change meanwhile.
+ */
+static struct dentry *
+__dentry_lookup(struct dentry_bucket *b, struct dentry *parent_dp,
+		const char *name, size_t len, unsigned int hash)
+{
+	struct uk_hlist_node *n;
+	struct dentry *dp;
+
+	for (n = UK_READ_ONCE(b->head.first); n; n = UK_READ_ONCE(n->next)) {
+		dp = uk_hlist_entry(n, struct dentry, d_link);
+		if (dp->d_hash == hash && dp->d_parent == parent_dp
+		    && dp->d_namelen == len && !memcmp(dp->d_name, name, len))
+			return dp;
+	}
+	return NULL;
+}
 
 struct dentry *
 dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
@@ -83,9 +197,12 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 
 	vref(vp);
 
-	dp->d_refcnt = 1;
+	uk_refcount_init(&dp->d_refcnt, 1);
+	dentry_set_name(dp);
+	dp->d_hash = dentry_hash(parent_dp, dp->d_name, dp->d_namelen);
 	dp->d_vnode = vp;
 	dp->d_mount = mp;
+	uk_mutex_init(&dp->d_lock);
 	UK_INIT_LIST_HEAD(&dp->d_child_list);
 
 	if (parent_dp) {
@@ -100,28 +217,47 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 
 	vn_add_name(vp, dp);
 
-	uk_mutex_lock(&dentry_hash_lock);
-	uk_hlist_add_head(&dp->d_link,
-			  &dentry_hash_table[dentry_hash(mp, path)]);
-	uk_mutex_unlock(&dentry_hash_lock);
+	dentry_hash_insert(dp);
 	return dp;
 };
 
+/*
+ * Find the child @name (not necessarily NUL-terminated) of @parent_dp,
+ * and take a reference to it. The caller must hold a reference to
+ * @parent_dp.
+ */
 struct dentry *
-dentry_lookup(struct mount *mp, char *path)
+dentry_lookup(struct dentry *parent_dp, const char *name, size_t len)
 {
+	unsigned int hash = dentry_hash(parent_dp, name, len);
+	struct dentry_bucket *b = dentry_bucket(hash);
 	struct dentry *dp;
+	unsigned long seq;
+	int i;
 
-	uk_mutex_lock(&dentry_hash_lock);
-	uk_hlist_for_each_entry(dp, &dentry_hash_table[dentry_hash(mp, path)], d_link) {
-		if (dp->d_mount == mp && !strncmp(dp->d_path, path, PATH_MAX)) {
-			dp->d_refcnt++;
-			uk_mutex_unlock(&dentry_hash_lock);
+	for (i = 0; i < DENTRY_LOOKUP_RETRIES; i++) {
+		seq = UK_READ_ONCE(b->seq);
+		if (seq & 1)
+			continue;
+		rmb();
+		dp = __dentry_lookup(b, parent_dp, name, len, hash);
+		rmb();
+		if (UK_READ_ONCE(b->seq) != seq)
+			continue;
+		if (!dp)
+			return NULL;	/* not found */
+		if (uk_refcount_acquire_if_not_zero(&dp->d_refcnt))
 			return dp;
-		}
+		/* dp is being released, let the writer finish */
+		break;
 	}
-	uk_mutex_unlock(&dentry_hash_lock);
-	return NULL;                /* not found */
+
+	uk_mutex_lock(&b->lock);
+	dp = __dentry_lookup(b, parent_dp, name, len, hash);
+	if (dp && !uk_refcount_acquire_if_not_zero(&dp->d_refcnt))
+		dp = NULL;
+	uk_mutex_unlock(&b->lock);
+	return dp;
 }
 
 static void dentry_children_remove(struct dentry *dp)
@@ -131,8 +267,8 @@ static void dentry_children_remove(struct dentry *dp)
 	uk_mutex_lock(&dp->d_lock);
 	uk_list_for_each_entry(entry, &dp->d_child_list, d_child_link) {
 		UK_ASSERT(entry);
-		UK_ASSERT(entry->d_refcnt > 0);
-		uk_hlist_del(&entry->d_link);
+		UK_ASSERT(uk_refcount_read(&entry->d_refcnt) > 0);
+		dentry_unhash(entry);
 	}
 	uk_mutex_unlock(&dp->d_lock);
 
@@ -166,19 +302,17 @@ dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path)
 		uk_mutex_unlock(&parent_dp->d_lock);
 	}
 
-	uk_mutex_lock(&dentry_hash_lock);
 	// Remove all dp's child dentries from the hashtable.
 	dentry_children_remove(dp);
 	// Remove dp with outdated hash info from the hashtable.
-	uk_hlist_del(&dp->d_link);
+	dentry_unhash(dp);
 	// Update dp.
 	dp->d_path = new_path;
-
 	dp->d_parent = parent_dp;
+	dentry_set_name(dp);
+	dp->d_hash = dentry_hash(parent_dp, dp->d_name, dp->d_namelen);
 	// Insert dp updated hash info into the hashtable.
-	uk_hlist_add_head(&dp->d_link,
-			  &dentry_hash_table[dentry_hash(dp->d_mount, path)]);
-	uk_mutex_unlock(&dentry_hash_lock);
+	dentry_hash_insert(dp);
 
 	if (old_pdp) {
 		drele(old_pdp);
@@ -191,39 +325,29 @@ dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path)
 void
 dentry_remove(struct dentry *dp)
 {
-	uk_mutex_lock(&dentry_hash_lock);
-	uk_hlist_del(&dp->d_link);
-	/* put it on a fake list for drele() to work*/
-	uk_hlist_add_head(&dp->d_link, &fake);
-	uk_mutex_unlock(&dentry_hash_lock);
+	dentry_unhash(dp);
 }
 
 void
 dref(struct dentry *dp)
 {
 	UK_ASSERT(dp);
-	UK_ASSERT(dp->d_refcnt > 0);
+	UK_ASSERT(uk_refcount_read(&dp->d_refcnt) > 0);
 
-	uk_mutex_lock(&dentry_hash_lock);
-	dp->d_refcnt++;
-	uk_mutex_unlock(&dentry_hash_lock);
+	uk_refcount_acquire(&dp->d_refcnt);
 }
 
 void
 drele(struct dentry *dp)
 {
 	UK_ASSERT(dp);
-	UK_ASSERT(dp->d_refcnt > 0);
+	UK_ASSERT(uk_refcount_read(&dp->d_refcnt) > 0);
 
-	uk_mutex_lock(&dentry_hash_lock);
-	if (--dp->d_refcnt) {
-		uk_mutex_unlock(&dentry_hash_lock);
+	if (!uk_refcount_release(&dp->d_refcnt))
 		return;
-	}
-	uk_hlist_del(&dp->d_link);
-	vn_del_name(dp->d_vnode, dp);
 
-	uk_mutex_unlock(&dentry_hash_lock);
+	dentry_unhash(dp);
+	vn_del_name(dp->d_vnode, dp);
 
 	if (dp->d_parent) {
 		uk_mutex_lock(&dp->d_parent->d_lock);
@@ -236,6 +360,7 @@ drele(struct dentry *dp)
 
 	vrele(dp->d_vnode);
 
+	uk_mutex_fini(&dp->d_lock);
 	free(dp->d_path);
 	free(dp);
 }
@@ -246,6 +371,8 @@ dentry_init(void)
 	int i;
 
 	for (i = 0; i < DENTRY_BUCKETS; i++) {
-		UK_INIT_HLIST_HEAD(&dentry_hash_table[i]);
+		UK_INIT_HLIST_HEAD(&dentry_hash_table[i].head);
+		uk_mutex_init(&dentry_hash_table[i].lock);
+		dentry_hash_table[i].seq = 0;
 	}
 }
@@ -0,0 +1,745 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/config.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/list.h>
+#include <uk/mutex.h>
+#include <uk/plat/lcpu.h>
+#include <uk/plat/time.h>
+#include <uk/wait.h>
+#include <uk/syscall.h>
+#include <vfscore/file.h>
+#include <vfscore/fs.h>
+#include <vfscore/mount.h>
+#include <vfscore/vnode.h>
+#include <vfscore/poll.h>
+
+#define EP_HASH_SIZE	64
+#define EP_HASH(fd)	((unsigned int) (fd) & (EP_HASH_SIZE - 1))
+
+/* Flags that only affect how an item is reported */
+#define EP_PRIVATE_BITS \
+	(EPOLLWAKEUP | EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
+
+/*
+ * Ready items are queued from wait queue callbacks, which run with
+ * interrupts disabled. `rdllist` and `epitem.ready` are therefore only
+ * touched with interrupts disabled. Everything else is protected by
+ * `lock`.
+ */
+struct eventpoll {
+	struct uk_mutex lock;
+	/* Items that may have events to report */
+	struct uk_list_head rdllist;
+	/* Threads waiting in epoll_wait() */
+	struct uk_waitq wq;
+	/* Pollers of the epoll file itself */
+	struct uk_waitq poll_wq;
+	/* Registered items, hashed by fd */
+	struct uk_hlist_head items[EP_HASH_SIZE];
+};
+
+struct eppoll_entry;
+
+struct epitem {
+	struct uk_hlist_node hnode;	/* in eventpoll.items */
+	struct uk_list_head rdllink;	/* in eventpoll.rdllist */
+	struct uk_hlist_node fllink;	/* in vfscore_file.f_ep_links */
+	struct eventpoll *ep;
+	struct vfscore_file *fp;
+	int fd;
+	int ready;
+	/* Set if registering a wait queue failed */
+	int nwait_err;
+	struct epoll_event event;
+	struct eppoll_entry *pwqlist;
+};
+
+/* Wait queue registration of an item */
+struct eppoll_entry {
+	struct eppoll_entry *next;
+	struct epitem *epi;
+	struct uk_waitq *wq;
+	struct uk_waitq_entry wait;
+};
+
+struct ep_pqueue {
+	struct vfscore_poll_table pt;
+	struct epitem *epi;
+};
+
+/* Serializes changes to the f_ep_links lists of all files */
+static struct uk_mutex epmutex = UK_MUTEX_INITIALIZER(epmutex);
+
+static struct vnops eventpoll_vnops;
+
+static inline int ep_is_eventpoll(struct vfscore_file *fp)
+{
+	return fp->f_dentry->d_vnode->v_op == &eventpoll_vnops;
+}
+
+/* Must be called with interrupts disabled */
+static void ep_set_ready(struct eventpoll *ep, struct epitem *epi)
+{
+	if (epi->ready)
+		return;
+
+	uk_list_add_tail(&epi->rdllink, &ep->rdllist);
+	epi->ready = 1;
+
+	/*
+	 * Wake up only on the transition to ready, this also bounds the
+	 * recursion when epoll instances watch each other.
+	 */
+	uk_waitq_wake_up(&ep->wq);
+	uk_waitq_wake_up(&ep->poll_wq);
+}
+
+/* Must be called with interrupts disabled */
+static void ep_clear_ready(struct epitem *epi)
+{
+	if (!epi->ready)
+		return;
+
+	uk_list_del_init(&epi->rdllink);
+	epi->ready = 0;
+}
+
+static void ep_poll_callback(struct uk_waitq_entry *wait)
+{
+	struct eppoll_entry *pwq;
+	struct epitem *epi;
+
+	pwq = __containerof(wait, struct eppoll_entry, wait);
+	epi = pwq->epi;
+
+	/* Disabled by EPOLLONESHOT until re-armed with EPOLL_CTL_MOD */
+	if (!(epi->event.events & ~EP_PRIVATE_BITS))
+		return;
+
+	ep_set_ready(epi->ep, epi);
+}
+
+static void ep_ptable_queue_proc(struct vfscore_poll_table *pt,
+				 struct uk_waitq *wq)
+{
+	struct ep_pqueue *epq = __containerof(pt, struct ep_pqueue, pt);
+	struct epitem *epi = epq->epi;
+	struct eppoll_entry *pwq;
+	unsigned long flags;
+
+	pwq = malloc(sizeof(*pwq));
+	if (!pwq) {
+		epi->nwait_err = 1;
+		return;
+	}
+
+	pwq->epi = epi;
+	pwq->wq = wq;
+	uk_waitq_entry_init_func(&pwq->wait, ep_poll_callback);
+
+	flags = ukplat_lcpu_save_irqf();
+	uk_waitq_add(wq, &pwq->wait);
+	ukplat_lcpu_restore_irqf(flags);
+
+	pwq->next = epi->pwqlist;
+	epi->pwqlist = pwq;
+}
+
+static void ep_unregister_pollwait(struct epitem *epi)
+{
+	struct eppoll_entry *pwq;
+	unsigned long flags;
+
+	while ((pwq = epi->pwqlist) != NULL) {
+		epi->pwqlist = pwq->next;
+
+		flags = ukplat_lcpu_save_irqf();
+		uk_waitq_remove(pwq->wq, &pwq->wait);
+		ukplat_lcpu_restore_irqf(flags);
+
+		free(pwq);
+	}
+}
+
+static struct epitem *ep_find(struct eventpoll *ep,
+			      struct vfscore_file *fp, int fd)
+{
+	struct epitem *epi;
+
+	uk_hlist_for_each_entry(epi, &ep->items[EP_HASH(fd)], hnode) {
+		if (epi->fd == fd && epi->fp == fp)
+			return epi;
+	}
+
+	return NULL;
+}
+
+static inline int ep_item_poll(struct epitem *epi,
+			       struct vfscore_poll_table *pt)
+{
+	return vfscore_poll(epi->fp, pt) &
+		(epi->event.events | EPOLLERR | EPOLLHUP);
+}
+
+/* Called with epmutex and ep->lock held */
+static void ep_remove(struct epitem *epi)
+{
+	unsigned long flags;
+
+	ep_unregister_pollwait(epi);
+
+	uk_hlist_del(&epi->fllink);
+	uk_hlist_del(&epi->hnode);
+
+	flags = ukplat_lcpu_save_irqf();
+	ep_clear_ready(epi);
+	ukplat_lcpu_restore_irqf(flags);
+
+	free(epi);
+}
+
+/* Called with epmutex and ep->lock held */
+static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
+		     struct vfscore_file *fp, int fd)
+{
+	struct ep_pqueue epq;
+	struct epitem *epi;
+	unsigned long flags;
+	int revents;
+
+	epi = calloc(1, sizeof(*epi));
+	if (!epi)
+		return -ENOMEM;
+
+	UK_INIT_LIST_HEAD(&epi->rdllink);
+	epi->ep = ep;
+	epi->fp = fp;
+	epi->fd = fd;
+	epi->event = *event;
+
+	epq.pt.queue = ep_ptable_queue_proc;
+	epq.epi = epi;
+	revents = ep_item_poll(epi, &epq.pt);
+
+	if (epi->nwait_err) {
+		ep_unregister_pollwait(epi);
+		free(epi);
+		return -ENOMEM;
+	}
+
+	uk_hlist_add_head(&epi->fllink, &fp->f_ep_links);
+	uk_hlist_add_head(&epi->hnode, &ep->items[EP_HASH(fd)]);
+
+	if (revents) {
+		flags = ukplat_lcpu_save_irqf();
+		ep_set_ready(ep, epi);
+		ukplat_lcpu_restore_irqf(flags);
+	}
+
+	return 0;
+}
+
+/* Called with ep->lock held */
+static int ep_modify(struct eventpoll *ep, struct epitem *epi,
+		     struct epoll_event *event)
+{
+	unsigned long flags;
+
+	epi->event.events = event->events;
+	epi->event.data = event->data;
+
+	/* Re-arm, the item may have become ready while it was disabled */
+	if (ep_item_poll(epi, NULL)) {
+		flags = ukplat_lcpu_save_irqf();
+		ep_set_ready(ep, epi);
+		ukplat_lcpu_restore_irqf(flags);
+	}
+
+	return 0;
+}
+
+/*
+ * Moves the ready list aside and re-polls every item on it. Items that
+ * are level triggered and still ready are queued again, so that the
+ * next epoll_wait() reports them as well. Called with ep->lock held.
+ */
+static int ep_send_events(struct eventpoll *ep, struct epoll_event *events,
+			  int maxevents)
+{
+	UK_LIST_HEAD(txlist);
+	struct epitem *epi, *tmp;
+	unsigned long flags;
+	int revents;
+	int count = 0;
+
+	flags = ukplat_lcpu_save_irqf();
+	uk_list_splice_init(&ep->rdllist, &txlist);
+	ukplat_lcpu_restore_irqf(flags);
+
+	/* Items on txlist stay marked ready, callbacks leave them alone */
+	uk_list_for_each_entry_safe(epi, tmp, &txlist, rdllink) {
+		if (count == maxevents)
+			break;
+
+		flags = ukplat_lcpu_save_irqf();
+		ep_clear_ready(epi);
+		ukplat_lcpu_restore_irqf(flags);
+
+		revents = ep_item_poll(epi, NULL);
+		if (!revents)
+			continue;
+
+		events[count].events = revents;
+		events[count].data = epi->event.data;
+		count++;
+
+		if (epi->event.events & EPOLLONESHOT) {
+			epi->event.events &= EP_PRIVATE_BITS;
+		} else if (!(epi->event.events & EPOLLET)) {
+			flags = ukplat_lcpu_save_irqf();
+			ep_set_ready(ep, epi);
+			ukplat_lcpu_restore_irqf(flags);
+		}
+	}
+
+	/* Items that did not fit are reported first next time */
+	flags = ukplat_lcpu_save_irqf();
+	uk_list_splice(&txlist, &ep->rdllist);
+	ukplat_lcpu_restore_irqf(flags);
+
+	return count;
+}
+
+static inline int ep_events_available(struct eventpoll *ep)
+{
+	return !uk_list_empty(&ep->rdllist);
+}
+
+static int ep_poll(struct eventpoll *ep, struct epoll_event *events,
+		   int maxevents, __nsec deadline, int block)
+{
+	int count;
+
+	for (;;) {
+		uk_mutex_lock(&ep->lock);
+		count = ep_send_events(ep, events, maxevents);
+		uk_mutex_unlock(&ep->lock);
+
+		if (count || !block)
+			return count;
+		if (deadline && ukplat_monotonic_clock() >= deadline)
+			return 0;
+
+		uk_waitq_wait_event_deadline(&ep->wq, ep_events_available(ep),
+					     deadline);
+	}
+}
+
+void vfscore_eventpoll_release(struct vfscore_file *fp)
+{
+	struct uk_hlist_node *n;
+	struct eventpoll *ep;
+	struct epitem *epi;
+
+	uk_mutex_lock(&epmutex);
+	while ((n = fp->f_ep_links.first) != NULL) {
+		epi = uk_hlist_entry(n, struct epitem, fllink);
+		ep = epi->ep;
+
+		uk_mutex_lock(&ep->lock);
+		ep_remove(epi);
+		uk_mutex_unlock(&ep->lock);
+	}
+	uk_mutex_unlock(&epmutex);
+}
+
+static struct eventpoll *ep_alloc(void)
+{
+	struct eventpoll *ep;
+	int i;
+
+	ep = malloc(sizeof(*ep));
+	if (!ep)
+		return NULL;
+
+	uk_mutex_init(&ep->lock);
+	UK_INIT_LIST_HEAD(&ep->rdllist);
+	uk_waitq_init(&ep->wq);
+	uk_waitq_init(&ep->poll_wq);
+	for (i = 0; i < EP_HASH_SIZE; i++)
+		UK_INIT_HLIST_HEAD(&ep->items[i]);
+
+	return ep;
+}
+
+static void ep_free(struct eventpoll *ep)
+{
+	struct uk_hlist_node *n;
+	int i;
+
+	uk_mutex_lock(&epmutex);
+	uk_mutex_lock(&ep->lock);
+	for (i = 0; i < EP_HASH_SIZE; i++) {
+		while ((n = ep->items[i].first) != NULL)
+			ep_remove(uk_hlist_entry(n, struct epitem, hnode));
+	}
+	uk_mutex_unlock(&ep->lock);
+	uk_mutex_unlock(&epmutex);
+
+	uk_mutex_fini(&ep->lock);
+	free(ep);
+}
+
+static int eventpoll_close(struct vnode *vnode,
+			   struct vfscore_file *vfscore_file __unused)
+{
+	ep_free(vnode->v_data);
+	vnode->v_data = NULL;
+	return 0;
+}
+
+static int eventpoll_poll(struct vnode *vnode,
+			  struct vfscore_file *vfscore_file __unused,
+			  struct vfscore_poll_table *pt)
+{
+	struct eventpoll *ep = vnode->v_data;
+
+	vfscore_poll_wait(pt, &ep->poll_wq);
+	if (ep_events_available(ep))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+#define eventpoll_open      ((vnop_open_t) vfscore_vop_einval)
+#define eventpoll_read      ((vnop_read_t) vfscore_vop_einval)
+#define eventpoll_write     ((vnop_write_t) vfscore_vop_einval)
+#define eventpoll_seek      ((vnop_seek_t) vfscore_vop_einval)
+#define eventpoll_ioctl     ((vnop_ioctl_t) vfscore_vop_einval)
+#define eventpoll_fsync     ((vnop_fsync_t) vfscore_vop_einval)
+#define eventpoll_readdir   ((vnop_readdir_t) vfscore_vop_einval)
+#define eventpoll_lookup    ((vnop_lookup_t) vfscore_vop_einval)
+#define eventpoll_create    ((vnop_create_t) vfscore_vop_einval)
+#define eventpoll_remove    ((vnop_remove_t) vfscore_vop_einval)
+#define eventpoll_rename    ((vnop_rename_t) vfscore_vop_einval)
+#define eventpoll_mkdir     ((vnop_mkdir_t) vfscore_vop_einval)
+#define eventpoll_rmdir     ((vnop_rmdir_t) vfscore_vop_einval)
+#define eventpoll_getattr   ((vnop_getattr_t) vfscore_vop_einval)
+#define eventpoll_setattr   ((vnop_setattr_t) vfscore_vop_nullop)
+#define eventpoll_inactive  ((vnop_inactive_t) vfscore_vop_einval)
+#define eventpoll_truncate  ((vnop_truncate_t) vfscore_vop_einval)
+#define eventpoll_link      ((vnop_link_t) vfscore_vop_eperm)
+#define eventpoll_cache     ((vnop_cache_t) NULL)
+#define eventpoll_readlink  ((vnop_readlink_t) vfscore_vop_einval)
+#define eventpoll_symlink   ((vnop_symlink_t) vfscore_vop_eperm)
+#define eventpoll_fallocate ((vnop_fallocate_t) vfscore_vop_einval)
+
+static struct vnops eventpoll_vnops = {
+	.vop_open      = eventpoll_open,
+	.vop_close     = eventpoll_close,
+	.vop_read      = eventpoll_read,
+	.vop_write     = eventpoll_write,
+	.vop_seek      = eventpoll_seek,
+	.vop_ioctl     = eventpoll_ioctl,
+	.vop_fsync     = eventpoll_fsync,
+	.vop_readdir   = eventpoll_readdir,
+	.vop_lookup    = eventpoll_lookup,
+	.vop_create    = eventpoll_create,
+	.vop_remove    = eventpoll_remove,
+	.vop_rename    = eventpoll_rename,
+	.vop_mkdir     = eventpoll_mkdir,
+	.vop_rmdir     = eventpoll_rmdir,
+	.vop_getattr   = eventpoll_getattr,
+	.vop_setattr   = eventpoll_setattr,
+	.vop_inactive  = eventpoll_inactive,
+	.vop_truncate  = eventpoll_truncate,
+	.vop_link      = eventpoll_link,
+	.vop_cache     = eventpoll_cache,
+	.vop_fallocate = eventpoll_fallocate,
+	.vop_readlink  = eventpoll_readlink,
+	.vop_symlink   = eventpoll_symlink,
+	.vop_poll      = eventpoll_poll
+};
+
+#define eventpoll_vget  ((vfsop_vget_t) vfscore_vop_nullop)
+
+static struct vfsops eventpoll_vfsops = {
+	.vfs_vget = eventpoll_vget,
+	.vfs_vnops = &eventpoll_vnops
+};
+
+static uint64_t ep_inode;
+
+/*
+ * Bogus mount point used by all epoll instances
+ */
+static struct mount ep_mount = {
+	.m_op = &eventpoll_vfsops
+};
+
+static int ep_fd_alloc(struct eventpoll *ep, int flags)
+{
+	int ret = 0;
+	int vfs_fd;
+	struct vfscore_file *vfs_file = NULL;
+	struct dentry *ep_dentry;
+	struct vnode *ep_vnode;
+
+	/* Reserve file descriptor number */
+	vfs_fd = vfscore_alloc_fd();
+	if (vfs_fd < 0) {
+		ret = -ENFILE;
+		goto ERR_EXIT;
+	}
+
+	/* Allocate file, dentry, and vnode */
+	vfs_file = calloc(1, sizeof(*vfs_file));
+	if (!vfs_file) {
+		ret = -ENOMEM;
+		goto ERR_MALLOC_VFS_FILE;
+	}
+
+	ret = vfscore_vget(&ep_mount, ep_inode++, &ep_vnode);
+	UK_ASSERT(ret == 0); /* we should not find it in cache */
+
+	if (!ep_vnode) {
+		ret = -ENOMEM;
+		goto ERR_ALLOC_VNODE;
+	}
+
+	uk_mutex_unlock(&ep_vnode->v_lock);
+
+	ep_dentry = dentry_alloc(NULL, ep_vnode, "/");
+	if (!ep_dentry) {
+		ret = -ENOMEM;
+		goto ERR_ALLOC_DENTRY;
+	}
+
+	/* Fill out necessary fields. */
+	vfs_file->fd = vfs_fd;
+	vfs_file->f_flags = UK_FREAD | flags;
+	vfs_file->f_count = 1;
+	vfs_file->f_data = ep;
+	vfs_file->f_dentry = ep_dentry;
+	vfs_file->f_vfs_flags = UK_VFSCORE_NOPOS;
+
+	ep_vnode->v_data = ep;
+	ep_vnode->v_type = VNON;
+
+	ret = vfscore_install_fd(vfs_fd, vfs_file);
+	if (ret)
+		goto ERR_VFS_INSTALL;
+
+	/* Only the dentry should hold a reference; release ours */
+	vrele(ep_vnode);
+
+	return vfs_fd;
+
+ERR_VFS_INSTALL:
+	drele(ep_dentry);
+ERR_ALLOC_DENTRY:
+	vrele(ep_vnode);
+ERR_ALLOC_VNODE:
+	free(vfs_file);
+ERR_MALLOC_VFS_FILE:
+	vfscore_put_fd(vfs_fd);
+ERR_EXIT:
+	UK_ASSERT(ret < 0);
+	return ret;
+}
+
+UK_SYSCALL_R_DEFINE(int, epoll_create1, int, flags)
+{
+	struct eventpoll *ep;
+	int fd;
+
+	if (flags & ~EPOLL_CLOEXEC)
+		return -EINVAL;
+
+	ep = ep_alloc();
+	if (!ep)
+		return -ENOMEM;
+
+	fd = ep_fd_alloc(ep, flags & EPOLL_CLOEXEC);
+	if (fd < 0) {
+		uk_mutex_fini(&ep->lock);
+		free(ep);
+	}
+
+	return fd;
+}
+
+UK_SYSCALL_R_DEFINE(int, epoll_create, int, size)
+{
+	/* The size is only a hint, but has to be positive */
+	if (size <= 0)
+		return -EINVAL;
+
+	return uk_syscall_r_epoll_create1(0);
+}
+
+static inline int ep_op_has_event(int op)
+{
+	return op != EPOLL_CTL_DEL;
+}
+
+UK_SYSCALL_R_DEFINE(int, epoll_ctl, int, epfd, int, op, int, fd,
+		    struct epoll_event *, event)
+{
+	struct vfscore_file *epfp, *fp;
+	struct epoll_event epds;
+	struct eventpoll *ep;
+	struct epitem *epi;
+	int error;
+
+	if (ep_op_has_event(op)) {
+		if (!event)
+			return -EFAULT;
+		epds = *event;
+	}
+
+	epfp = vfscore_get_file(epfd);
+	if (!epfp)
+		return -EBADF;
+
+	fp = vfscore_get_file(fd);
+	if (!fp) {
+		error = -EBADF;
+		goto out_drop_epfp;
+	}
+
+	/* Files that never block cannot be watched */
+	if (!fp->f_dentry->d_vnode->v_op->vop_poll) {
+		error = -EPERM;
+		goto out_drop_fp;
+	}
+
+	if (!ep_is_eventpoll(epfp) || epfp == fp) {
+		error = -EINVAL;
+		goto out_drop_fp;
+	}
+
+	ep = epfp->f_data;
+
+	uk_mutex_lock(&epmutex);
+	uk_mutex_lock(&ep->lock);
+
+	epi = ep_find(ep, fp, fd);
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (epi) {
+			error = -EEXIST;
+			break;
+		}
+		error = ep_insert(ep, &epds, fp, fd);
+		break;
+	case EPOLL_CTL_DEL:
+		if (!epi) {
+			error = -ENOENT;
+			break;
+		}
+		ep_remove(epi);
+		error = 0;
+		break;
+	case EPOLL_CTL_MOD:
+		if (!epi) {
+			error = -ENOENT;
+			break;
+		}
+		error = ep_modify(ep, epi, &epds);
+		break;
+	default:
+		error = -EINVAL;
+		break;
+	}
+
+	uk_mutex_unlock(&ep->lock);
+	uk_mutex_unlock(&epmutex);
+
+out_drop_fp:
+	fdrop(fp);
+out_drop_epfp:
+	fdrop(epfp);
+	return error;
+}
+
+static int do_epoll_wait(int epfd, struct epoll_event *events,
+			 int maxevents, int timeout)
+{
+	struct vfscore_file *epfp;
+	__nsec deadline = 0;
+	int error;
+
+	if (maxevents <= 0)
+		return -EINVAL;
+	if (!events)
+		return -EFAULT;
+
+	epfp = vfscore_get_file(epfd);
+	if (!epfp)
+		return -EBADF;
+
+	if (!ep_is_eventpoll(epfp)) {
+		error = -EINVAL;
+		goto out;
+	}
+
+	if (timeout > 0)
+		deadline = ukplat_monotonic_clock() +
+			ukarch_time_msec_to_nsec((__nsec) timeout);
+
+	error = ep_poll(epfp->f_data, events, maxevents, deadline,
+			timeout != 0);
+
+out:
+	fdrop(epfp);
+	return error;
+}
+
+UK_SYSCALL_R_DEFINE(int, epoll_wait, int, epfd, struct epoll_event *, events,
+		    int, maxevents, int, timeout)
+{
+	return do_epoll_wait(epfd, events, maxevents, timeout);
+}
+
+/* Signal masks are not supported and ignored */
+UK_SYSCALL_R_DEFINE(int, epoll_pwait, int, epfd, struct epoll_event *, events,
+		    int, maxevents, int, timeout,
+		    const sigset_t *, sigmask)
+{
+	return do_epoll_wait(epfd, events, maxevents, timeout);
+}
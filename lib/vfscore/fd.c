@@ -32,9 +32,11 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include <uk/essentials.h>
 #include <uk/bitmap.h>
 #include <uk/assert.h>
+#include <uk/arch/atomic.h>
 #include <vfscore/file.h>
 #include <uk/plat/lcpu.h>
 #include <errno.h>
@@ -42,30 +44,107 @@
 
 void init_stdio(void);
 
+/*
+ * The file pointers are stored in fixed-size chunks that are allocated on
+ * first use and never freed or moved. This lets the table grow up to
+ * FDTABLE_MAX_FILES while readers access it without any locking.
+ */
+#define FDTABLE_CHUNK_SHIFT	8
+#define FDTABLE_CHUNK		(1U << FDTABLE_CHUNK_SHIFT)
+#define FDTABLE_NR_CHUNKS	DIV_ROUND_UP(FDTABLE_MAX_FILES, FDTABLE_CHUNK)
+#define FDTABLE_NR_BITS		(FDTABLE_NR_CHUNKS * FDTABLE_CHUNK)
+#define FDTABLE_NR_WORDS	UK_BITS_TO_LONGS(FDTABLE_NR_BITS)
+
+/*
+ * Allocated fds are tracked by a two-level bitmap: `full` has a bit set
+ * for every word of `bitmap` that has no free fd left, so finding the
+ * lowest free fd only scans FDTABLE_NR_WORDS bits.
+ *
+ * Updates to the bitmaps and to file pointers are done with interrupts
+ * disabled. Lookups (vfscore_get_file()) are lock-free.
+ */
 struct fdtable {
-	unsigned long bitmap[UK_BITS_TO_LONGS(FDTABLE_MAX_FILES)];
+	unsigned long bitmap[FDTABLE_NR_WORDS];
+	unsigned long full[UK_BITS_TO_LONGS(FDTABLE_NR_WORDS)];
 	uint32_t fd_start;
-	struct vfscore_file *files[FDTABLE_MAX_FILES];
+	struct vfscore_file **files[FDTABLE_NR_CHUNKS];
 };
 struct fdtable fdtable;
 
+static inline struct vfscore_file **fdtable_slot(int fd)
+{
+	struct vfscore_file **chunk;
+
+	chunk = UK_READ_ONCE(fdtable.files[fd >> FDTABLE_CHUNK_SHIFT]);
+	if (!chunk)
+		return NULL;
+	return &chunk[fd & (FDTABLE_CHUNK - 1)];
+}
+
+/*
+ * Make sure the chunk holding fd exists. Chunks are never freed, so this
+ * does not have to be done atomically with the fd allocation.
+ */
+static int fdtable_expand(int fd)
+{
+	struct vfscore_file **chunk, **old;
+	unsigned int idx = fd >> FDTABLE_CHUNK_SHIFT;
+
+	if (UK_READ_ONCE(fdtable.files[idx]))
+		return 0;
+
+	chunk = calloc(FDTABLE_CHUNK, sizeof(*chunk));
+	if (!chunk)
+		return -ENOMEM;
+
+	old = ukarch_compare_exchange_sync(&fdtable.files[idx], NULL, chunk);
+	if (old != chunk)
+		free(chunk); /* somebody else was faster */
+	return 0;
+}
+
+/* Locking: interrupts must be disabled */
+static void fdtable_set(int fd)
+{
+	unsigned long w = UK_BIT_WORD(fd);
+
+	__uk_set_bit(fd, fdtable.bitmap);
+	if (fdtable.bitmap[w] == ~0UL)
+		__uk_set_bit(w, fdtable.full);
+}
+
+/* Locking: interrupts must be disabled */
+static void fdtable_clear(int fd)
+{
+	unsigned long w = UK_BIT_WORD(fd);
+
+	__uk_clear_bit(fd, fdtable.bitmap);
+	__uk_clear_bit(w, fdtable.full);
+}
+
 int vfscore_alloc_fd(void)
 {
 	unsigned long flags;
+	unsigned long w;
 	int ret;
 
 	flags = ukplat_lcpu_save_irqf();
-	ret = uk_find_next_zero_bit(fdtable.bitmap, FDTABLE_MAX_FILES, 0);
-
-	if (ret == FDTABLE_MAX_FILES) {
-		ret = -ENFILE;
-		goto exit;
+	w = uk_find_first_zero_bit(fdtable.full, FDTABLE_NR_WORDS);
+	if (w >= FDTABLE_NR_WORDS) {
+		ukplat_lcpu_restore_irqf(flags);
+		return -ENFILE;
 	}
 
-	uk_bitmap_set(fdtable.bitmap, ret, 1);
-
-exit:
+	ret = w * UK_BITS_PER_LONG + ukarch_ffsl(~fdtable.bitmap[w]);
+	fdtable_set(ret);
 	ukplat_lcpu_restore_irqf(flags);
+
+	if (fdtable_expand(ret) < 0) {
+		flags = ukplat_lcpu_save_irqf();
+		fdtable_clear(ret);
+		ukplat_lcpu_restore_irqf(flags);
+		return -ENOMEM;
+	}
 	return ret;
 }
 
@@ -74,13 +153,20 @@ int vfscore_reserve_fd(int fd)
 	unsigned long flags;
 	int ret = 0;
 
+	if ((fd < 0) || (fd >= (int) FDTABLE_MAX_FILES))
+		return -EBADF;
+
+	ret = fdtable_expand(fd);
+	if (ret < 0)
+		return ret;
+
 	flags = ukplat_lcpu_save_irqf();
 	if (uk_test_bit(fd, fdtable.bitmap)) {
 		ret = -EBUSY;
 		goto exit;
 	}
 
-	uk_bitmap_set(fdtable.bitmap, fd, 1);
+	fdtable_set(fd);
 
 exit:
 	ukplat_lcpu_restore_irqf(flags);
@@ -90,9 +176,10 @@ exit:
 int vfscore_put_fd(int fd)
 {
 	struct vfscore_file *fp;
+	struct vfscore_file **slot;
 	unsigned long flags;
 
-	UK_ASSERT(fd < (int) FDTABLE_MAX_FILES);
+	UK_ASSERT(fd >= 0 && fd < (int) FDTABLE_MAX_FILES);
 
 	/* FIXME Currently it is not allowed to free std(in|out|err):
 	 * if (fd <= 2) return -EBUSY;
@@ -103,10 +190,14 @@ int vfscore_put_fd(int fd)
 	 * dragons.
 	 */
 
+	slot = fdtable_slot(fd);
+	if (!slot)
+		return 0;
+
 	flags = ukplat_lcpu_save_irqf();
-	uk_bitmap_clear(fdtable.bitmap, fd, 1);
-	fp = fdtable.files[fd];
-	fdtable.files[fd] = NULL;
+	fp = *slot;
+	UK_WRITE_ONCE(*slot, NULL);
+	fdtable_clear(fd);
 	ukplat_lcpu_restore_irqf(flags);
 
 	/*
@@ -123,8 +214,13 @@ int vfscore_install_fd(int fd, struct vfscore_file *file)
 {
 	unsigned long flags;
 	struct vfscore_file *orig;
+	struct vfscore_file **slot;
 
-	if ((fd >= (int) FDTABLE_MAX_FILES) || (!file))
+	if ((fd < 0) || (fd >= (int) FDTABLE_MAX_FILES) || (!file))
+		return -EBADF;
+
+	slot = fdtable_slot(fd);
+	if (!slot)
 		return -EBADF;
 
 	fhold(file);
@@ -132,8 +228,8 @@ int vfscore_install_fd(int fd, struct vfscore_file *file)
 	file->fd = fd;
 
 	flags = ukplat_lcpu_save_irqf();
-	orig = fdtable.files[fd];
-	fdtable.files[fd] = file;
+	orig = *slot;
+	UK_WRITE_ONCE(*slot, file);
 	ukplat_lcpu_restore_irqf(flags);
 
 	fdrop(file);
@@ -144,22 +240,53 @@ int vfscore_install_fd(int fd, struct vfscore_file *file)
 	return 0;
 }
 
-struct vfscore_file *vfscore_get_file(int fd)
+/*
+ * Take a reference to fp, unless its last reference is already gone.
+ */
+static int fhold_if_not_zero(struct vfscore_file *fp)
 {
-	unsigned long flags;
-	struct vfscore_file *ret = NULL;
-
-	UK_ASSERT(fd < (int) FDTABLE_MAX_FILES);
-
-	flags = ukplat_lcpu_save_irqf();
-	if (!uk_test_bit(fd, fdtable.bitmap))
-		goto exit;
-	ret = fdtable.files[fd];
-	fhold(ret);
+	int cnt;
+
+	for (;;) {
+		cnt = ukarch_load_n(&fp->f_count);
+		if (cnt == 0)
+			return 0;
+		if (ukarch_compare_exchange_sync(&fp->f_count, cnt, cnt + 1)
+		    == cnt + 1)
+			return 1;
+	}
+}
 
-exit:
-	ukplat_lcpu_restore_irqf(flags);
-	return ret;
+/*
+ * Lock-free lookup: the table owns a reference to every installed file,
+ * so a file whose count dropped to zero has already been replaced in its
+ * slot and the slot can simply be read again. As for the dentry cache, a
+ * file that is concurrently freed is not reused before the reader is
+ * done with it, since readers never block.
+ */
+struct vfscore_file *vfscore_get_file(int fd)
+{
+	struct vfscore_file **slot;
+	struct vfscore_file *ret;
+
+	if ((fd < 0) || (fd >= (int) FDTABLE_MAX_FILES))
+		return NULL;
+
+	slot = fdtable_slot(fd);
+	if (!slot)
+		return NULL;
+
+	for (;;) {
+		ret = UK_READ_ONCE(*slot);
+		if (!ret)
+			return NULL;
+		if (!fhold_if_not_zero(ret))
+			continue;
+		if (UK_READ_ONCE(*slot) == ret)
+			return ret;
+		/* The fd was closed or replaced meanwhile */
+		fdrop(ret);
+	}
 }
 
 void vfscore_put_file(struct vfscore_file *file)
@@ -206,8 +333,14 @@ exit:
 /* TODO: move this constructor to main.c */
 static void fdtable_init(void)
 {
+	int fd;
+
 	memset(&fdtable, 0, sizeof(fdtable));
 
+	/* Never hand out the padding fds of the last chunk */
+	for (fd = FDTABLE_MAX_FILES; fd < (int) FDTABLE_NR_BITS; fd++)
+		fdtable_set(fd);
+
 	init_stdio();
 }
 
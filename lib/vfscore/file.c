@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <uk/print.h>
 #include <vfscore/file.h>
+#include <vfscore/poll.h>
 #include <uk/assert.h>
 #include "vfs.h"
 
@@ -51,6 +52,9 @@ int fdrop(struct vfscore_file *fp)
 		UK_CRASH("Unbalanced fhold/fdrop");
 
 	if (prev == 1) {
+		if (!uk_hlist_empty(&fp->f_ep_links))
+			vfscore_eventpoll_release(fp);
+
 		/*
 		 * we free the file even in case of an error
 		 * so release the dentry too
@@ -58,6 +62,7 @@ int fdrop(struct vfscore_file *fp)
 		if (vfs_close(fp) != 0)
 			drele(fp->f_dentry);
 
+		uk_mutex_fini(&fp->f_lock);
 		free(fp);
 
 		return 1;
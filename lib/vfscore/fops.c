@@ -35,6 +35,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <vfscore/file.h>
+#include <vfscore/poll.h>
 #include "vfs.h"
 
 #include <uk/assert.h>
@@ -100,6 +101,8 @@ int vfs_write(struct vfscore_file *fp, struct uio *uio, int flags)
 		ioflags |= IO_APPEND;
 	if (fp->f_flags & (O_DSYNC|O_SYNC))
 		ioflags |= IO_SYNC;
+	if (fp->f_flags & O_NONBLOCK)
+		ioflags |= IO_NDELAY;
 
 	if ((flags & FOF_OFFSET) == 0)
 		uio->uio_offset = fp->f_offset;
@@ -128,6 +131,20 @@ int vfs_ioctl(struct vfscore_file *fp, unsigned long com, void *data)
 	return error;
 }
 
+/*
+ * The vnode is not locked: pollers may have marked themselves blocked
+ * already and vop_poll must not sleep.
+ */
+int vfscore_poll(struct vfscore_file *fp, struct vfscore_poll_table *pt)
+{
+	struct vnode *vp = fp->f_dentry->d_vnode;
+
+	if (!vp->v_op->vop_poll)
+		return VFSCORE_POLL_DEFAULT;
+
+	return VOP_POLL(vp, fp, pt);
+}
+
 int vfs_stat(struct vfscore_file *fp, struct stat *st)
 {
 	struct vnode *vp = fp->f_dentry->d_vnode;
@@ -34,15 +34,20 @@
 #ifndef _OSV_DENTRY_H
 #define _OSV_DENTRY_H 1
 
+#include <stddef.h>
 #include <uk/mutex.h>
 #include <uk/list.h>
+#include <uk/refcount.h>
 
 struct vnode;
 
 struct dentry {
 	struct uk_hlist_node d_link;	/* link for hash list */
-	int		d_refcnt;	/* reference count */
+	__atomic	d_refcnt;	/* reference count */
+	unsigned int	d_hash;		/* hash of (d_parent, d_name) */
 	char		*d_path;	/* pointer to path in fs */
+	const char	*d_name;	/* last component of d_path */
+	size_t		d_namelen;	/* length of d_name */
 	struct vnode	*d_vnode;
 	struct mount	*d_mount;
 	struct dentry   *d_parent; /* pointer to parent */
@@ -53,7 +58,8 @@ struct dentry {
 };
 
 struct dentry *dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path);
-struct dentry *dentry_lookup(struct mount *mp, char *path);
+struct dentry *dentry_lookup(struct dentry *parent_dp, const char *name,
+			     size_t len);
 int dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path);
 void dentry_remove(struct dentry *dp);
 void dref(struct dentry *dp);
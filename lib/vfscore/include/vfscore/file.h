@@ -36,6 +36,7 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <uk/config.h>
 #include <vfscore/dentry.h>
 
 #ifdef __cplusplus
@@ -58,6 +59,7 @@ struct vfscore_file {
 	int		f_vfs_flags;    /* internal implementation flags */
 	struct dentry   *f_dentry;
 	struct uk_mutex f_lock;
+	struct uk_hlist_head f_ep_links; /* epoll items watching this file */
 };
 
 #define FD_LOCK(fp)       uk_mutex_lock(&(fp->f_lock))
@@ -79,7 +81,7 @@ int fdrop(struct vfscore_file* fp);
 #define FOF_OFFSET  0x0800    /* Use the offset in uio argument */
 
 /* Also used from posix-sysinfo to determine sysconf(_SC_OPEN_MAX). */
-#define FDTABLE_MAX_FILES 1024
+#define FDTABLE_MAX_FILES CONFIG_LIBVFSCORE_MAX_FILES
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __VFSCORE_POLL_H__
+#define __VFSCORE_POLL_H__
+
+#include <poll.h>
+#include <uk/list.h>
+#include <uk/wait.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct vfscore_file;
+struct vfscore_poll_table;
+
+typedef void (*vfscore_poll_queue_t)(struct vfscore_poll_table *pt,
+				     struct uk_waitq *wq);
+
+/**
+ * Poll table passed to vop_poll. A vnode that can become ready registers
+ * every wait queue that it wakes up on readiness changes with
+ * vfscore_poll_wait(). The table is NULL when the caller is only
+ * interested in the current readiness state.
+ */
+struct vfscore_poll_table {
+	vfscore_poll_queue_t queue;
+};
+
+/* Returned by files without a vop_poll: they never block */
+#define VFSCORE_POLL_DEFAULT \
+	(POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM)
+
+/**
+ * Registers a wait queue with a poll table.
+ *
+ * @param pt
+ *	Poll table as passed to vop_poll, can be NULL
+ * @param wq
+ *	Wait queue that is woken up when the readiness of the file changes
+ */
+static inline void vfscore_poll_wait(struct vfscore_poll_table *pt,
+				     struct uk_waitq *wq)
+{
+	if (pt && pt->queue)
+		pt->queue(pt, wq);
+}
+
+/**
+ * Returns the events (POLL*) that are ready on a file, registering
+ * its wait queues with a poll table.
+ *
+ * @param fp
+ *	File to poll
+ * @param pt
+ *	Poll table, or NULL to only query the current state
+ * @return
+ *	Mask of ready events
+ */
+int vfscore_poll(struct vfscore_file *fp, struct vfscore_poll_table *pt);
+
+/**
+ * Removes a file from all epoll instances that monitor it.
+ * Called when the last reference to the file is dropped.
+ */
+void vfscore_eventpoll_release(struct vfscore_file *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VFSCORE_POLL_H__ */
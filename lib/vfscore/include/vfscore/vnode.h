@@ -46,6 +46,7 @@ struct vfsops;
 struct vnops;
 struct vnode;
 struct vfscore_file;
+struct vfscore_poll_table;
 
 /*
  * Vnode types.
@@ -78,6 +79,8 @@ struct vnode {
 	off_t		v_size;		/* file size */
 	struct uk_mutex	v_lock;		/* lock for this vnode */
 	struct uk_list_head v_names;	/* directory entries pointing at this */
+	struct uk_list_head v_negnames;	/* names known to be missing (VDIR) */
+	int		v_nnegnames;	/* number of entries in v_negnames */
 	void		*v_data;	/* private data for fs */
 };
 
@@ -137,6 +140,7 @@ struct vattr {
 
 #define IO_APPEND	0x0001
 #define IO_SYNC		0x0002
+#define IO_NDELAY	0x0004
 
 /*
  * ARC actions
@@ -171,6 +175,8 @@ typedef int (*vnop_cache_t) (struct vnode *, struct vfscore_file *, struct uio *
 typedef int (*vnop_fallocate_t) (struct vnode *, int, off_t, off_t);
 typedef int (*vnop_readlink_t)  (struct vnode *, struct uio *);
 typedef int (*vnop_symlink_t)   (struct vnode *, char *, char *);
+typedef int (*vnop_poll_t)      (struct vnode *, struct vfscore_file *,
+				 struct vfscore_poll_table *);
 
 /*
  * vnode operations
@@ -199,6 +205,7 @@ struct vnops {
 	vnop_fallocate_t	vop_fallocate;
 	vnop_readlink_t		vop_readlink;
 	vnop_symlink_t		vop_symlink;
+	vnop_poll_t		vop_poll;
 };
 
 /*
@@ -228,6 +235,7 @@ struct vnops {
 #define VOP_FALLOCATE(VP, M, OFF, LEN) ((VP)->v_op->vop_fallocate)(VP, M, OFF, LEN)
 #define VOP_READLINK(VP, U)        ((VP)->v_op->vop_readlink)(VP, U)
 #define VOP_SYMLINK(DVP, OP, NP)   ((DVP)->v_op->vop_symlink)(DVP, OP, NP)
+#define VOP_POLL(VP, FP, PT)       ((VP)->v_op->vop_poll)(VP, FP, PT)
 
 int	 vfscore_vop_nullop(void);
 int	 vfscore_vop_einval(void);
@@ -247,6 +255,9 @@ void	 vrele(struct vnode *);
 void	 vflush(struct mount *);
 void vn_add_name(struct vnode *, struct dentry *);
 void vn_del_name(struct vnode *, struct dentry *);
+int  vn_neg_lookup(struct vnode *, const char *);
+void vn_neg_enter(struct vnode *, const char *);
+void vn_neg_purge(struct vnode *, const char *);
 
 extern enum vtype iftovt_tab[];
 extern int vttoif_tab[];
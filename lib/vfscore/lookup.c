@@ -62,177 +62,214 @@ read_link(struct vnode *vp, char *buf, size_t bufsz, ssize_t *sz)
 	return (0);
 }
 
-int
-namei_follow_link(struct dentry *dp, char *node, char *name, char *fp, size_t mountpoint_len)
+/*
+ * Replace the symbolic link @dp in the full path @fp by its target.
+ *
+ * @name: start of the link component in @fp.
+ * @rest: remainder of @fp after the link component.
+ */
+static int
+namei_follow_link(struct dentry *dp, char *fp, char *name, const char *rest)
 {
 	char link[PATH_MAX];
+	char dir[PATH_MAX];
 	char t[PATH_MAX];
 	int     error;
 	ssize_t sz;
-	char    *p;
-	int     c;
+	size_t  len;
 
-	error = read_link(dp->d_vnode, link, PATH_MAX, &sz);
+	error = read_link(dp->d_vnode, link, PATH_MAX - 1, &sz);
 	if (error != 0) {
 		return (error);
 	}
 	link[sz] = 0;
 
-	p = fp + mountpoint_len + strlen(node);
-	c = strlen(node) - strlen(name) - 1;
-	node[c] = 0;
-
+	strlcpy(t, rest, PATH_MAX);
 	if (link[0] == '/') {
-		strlcat(link, p, PATH_MAX);
 		strlcpy(fp, link, PATH_MAX);
 	} else {
-		strlcpy(t, p, PATH_MAX);
-		strlcpy(node, fp, mountpoint_len + c + 1);
-		path_conv(node, link, fp);
-		strlcat(fp, t, PATH_MAX);
+		/* Resolve the target relative to the directory of the link */
+		len = name - fp;
+		while (len > 1 && fp[len - 1] == '/') {
+			len--;
+		}
+		strlcpy(dir, fp, len + 1);
+		path_conv(dir, link, fp);
+	}
+	if (strlcat(fp, t, PATH_MAX) >= PATH_MAX) {
+		return (ENAMETOOLONG);
 	}
-	node[0] = 0;
-	name[0] = 0;
 	return (0);
 }
+
+/*
+ * Look up @name in the locked directory @dvp, consulting the negative
+ * name cache of the directory first.
+ */
+static int
+namei_vop_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
+{
+	int error;
+
+	if (vn_neg_lookup(dvp, name))
+		return ENOENT;
+
+	error = VOP_LOOKUP(dvp, name, vpp);
+	if (error == ENOENT)
+		vn_neg_enter(dvp, name);
+	return error;
+}
+
+/*
+ * Look up @name (of length @len) in the directory @ddp on a dentry cache
+ * miss, and allocate a dentry for it.
+ *
+ * @dpp: dentry to be returned.
+ */
+static int
+namei_lookup_child(struct dentry *ddp, const char *name, size_t len,
+		   struct dentry **dpp)
+{
+	char cname[NAME_MAX + 1];
+	char node[PATH_MAX];
+	struct dentry *dp;
+	struct vnode *dvp, *vp;
+	int error = 0;
+
+	if (len > NAME_MAX) {
+		return ENAMETOOLONG;
+	}
+	memcpy(cname, name, len);
+	cname[len] = '\0';
+
+	/* Path of the child within its file system */
+	if (strlcpy(node, ddp->d_path, sizeof(node)) > 1 || node[0] != '/') {
+		strlcat(node, "/", sizeof(node));
+	}
+	if (strlcat(node, cname, sizeof(node)) >= sizeof(node)) {
+		return ENAMETOOLONG;
+	}
+
+	dvp = ddp->d_vnode;
+	vn_lock(dvp);
+	/* Someone else may have added it while we waited for the lock */
+	dp = dentry_lookup(ddp, name, len);
+	if (dp == NULL) {
+		/* Find a vnode in this directory. */
+		error = namei_vop_lookup(dvp, cname, &vp);
+		if (error) {
+			goto out;
+		}
+
+		dp = dentry_alloc(ddp, vp, node);
+		vput(vp);
+
+		if (!dp) {
+			error = ENOMEM;
+		}
+	}
+out:
+	vn_unlock(dvp);
+	*dpp = dp;
+	return error;
+}
+
 /*
  * Convert a pathname into a pointer to a dentry
  *
+ * The path is resolved one component at a time, starting from the root
+ * of its mount point. Each step looks up the (parent, component) pair in
+ * the dentry cache, so that resolution is linear in the path length and
+ * only cache misses copy strings.
+ *
  * @path: full path name.
  * @dpp:  dentry to be returned.
  */
 int
 namei(const char *path, struct dentry **dpp)
 {
-	char *p;
-	char node[PATH_MAX];
-	char name[PATH_MAX];
+	char *p, *name;
 	char fp[PATH_MAX];
 	struct mount *mp;
 	struct dentry *dp, *ddp;
-	struct vnode *dvp, *vp;
-	int error, i;
+	size_t len;
+	int error;
 	int links_followed;
-	int need_continue;
 
 	DPRINTF(VFSDB_VNODE, ("namei: path=%s\n", path));
 
 	links_followed = 0;
 	strlcpy(fp, path, PATH_MAX);
 
-	do {
-		need_continue = 0;
+restart:
+	/*
+	 * Convert a full path name to its mount point and
+	 * the local node in the file system.
+	 */
+	if (vfs_findroot(fp, &mp, &p)) {
+		return ENOTDIR;
+	}
+
+	/*
+	 * Find target vnode, started from root directory.
+	 * This is done to attach the fs specific data to
+	 * the target vnode.
+	 */
+	ddp = mp->m_root;
+	if (!ddp) {
+		UK_CRASH("VFS: no root");
+	}
+	dref(ddp);
+
+	for (;;) {
 		/*
-		 * Convert a full path name to its mount point and
-		 * the local node in the file system.
+		 * Get lower directory/file name.
 		 */
-		if (vfs_findroot(fp, &mp, &p)) {
-			return ENOTDIR;
+		while (*p == '/') {
+			p++;
 		}
-		int mountpoint_len = p - fp - 1;
-		strlcpy(node, "/", sizeof(node));
-		strlcat(node, p, sizeof(node));
-		dp = dentry_lookup(mp, node);
-		if (dp) {
-			/* vnode is already active. */
-			*dpp = dp;
-			return 0;
+		if (*p == '\0') {
+			break;
 		}
-		/*
-		 * Find target vnode, started from root directory.
-		 * This is done to attach the fs specific data to
-		 * the target vnode.
-		 */
-		ddp = mp->m_root;
-		if (!ddp) {
-			UK_CRASH("VFS: no root");
+		name = p;
+		while (*p != '\0' && *p != '/') {
+			p++;
 		}
-		dref(ddp);
-
-		node[0] = '\0';
+		len = p - name;
 
-		while (*p != '\0') {
-			/*
-			 * Get lower directory/file name.
-			 */
-			while (*p == '/') {
-				p++;
-			}
-
-			if (*p == '\0') {
-				break;
+		/*
+		 * Get a dentry for the target.
+		 */
+		dp = dentry_lookup(ddp, name, len);
+		if (dp == NULL) {
+			error = namei_lookup_child(ddp, name, len, &dp);
+			if (error) {
+				drele(ddp);
+				return error;
 			}
+		}
+		drele(ddp);
 
-			for (i = 0; i < PATH_MAX; i++) {
-				if (*p == '\0' || *p == '/') {
-					break;
-				}
-				name[i] = *p++;
-			}
-			name[i] = '\0';
-
-			/*
-			 * Get a vnode for the target.
-			 */
-			strlcat(node, "/", sizeof(node));
-			strlcat(node, name, sizeof(node));
-			dvp = ddp->d_vnode;
-			vn_lock(dvp);
-			dp = dentry_lookup(mp, node);
-			if (dp == NULL) {
-				/* Find a vnode in this directory. */
-				error = VOP_LOOKUP(dvp, name, &vp);
-				if (error) {
-					vn_unlock(dvp);
-					drele(ddp);
-					return error;
-				}
-
-				dp = dentry_alloc(ddp, vp, node);
-				vput(vp);
-
-				if (!dp) {
-					vn_unlock(dvp);
-					drele(ddp);
-					return ENOMEM;
-				}
+		if (dp->d_vnode->v_type == VLNK) {
+			error = namei_follow_link(dp, fp, name, p);
+			drele(dp);
+			if (error) {
+				return (error);
 			}
-			vn_unlock(dvp);
-			drele(ddp);
-			ddp = dp;
-
-			if (dp->d_vnode->v_type == VLNK) {
-				error = namei_follow_link(dp, node, name, fp, mountpoint_len);
-				if (error) {
-					drele(dp);
-					return (error);
-				}
-
-				drele(dp);
-
-				p       = fp;
-				dp      = NULL;
-				ddp     = NULL;
-				vp      = NULL;
-				dvp     = NULL;
-				name[0] = 0;
-				node[0] = 0;
-
-				if (++links_followed >= MAXSYMLINKS) {
-					return (ELOOP);
-				}
-				need_continue = 1;
-				break;
+			if (++links_followed >= MAXSYMLINKS) {
+				return (ELOOP);
 			}
+			goto restart;
+		}
 
-			if (*p == '/' && ddp->d_vnode->v_type != VDIR) {
-				drele(ddp);
-				return ENOTDIR;
-			}
+		if (*p == '/' && dp->d_vnode->v_type != VDIR) {
+			drele(dp);
+			return ENOTDIR;
 		}
-	} while (need_continue);
+		ddp = dp;
+	}
 
-	*dpp = dp;
+	*dpp = ddp;
 	return 0;
 }
 
@@ -247,66 +284,51 @@ int
 namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dpp)
 {
 	char          *name;
+	size_t        len;
 	int           error;
 	struct mount  *mp;
 	char          *p;
 	struct dentry *dp;
-	struct vnode  *dvp;
-	struct vnode  *vp;
-	char node[PATH_MAX];
-
-	dvp  = NULL;
 
 	if (path[0] != '/') {
 		return (ENOTDIR);
 	}
 
-	name = strrchr(path, '/');
-	if (name == NULL) {
-		return (ENOENT);
-	}
-	name++;
-
 	error = vfs_findroot(path, &mp, &p);
 	if (error != 0) {
 		return (ENOTDIR);
 	}
 
-	strlcpy(node, "/", PATH_MAX);
-	strlcat(node, p, PATH_MAX);
-
 	// We want to treat things like /tmp/ the same as /tmp. Best way to do that
-	// is to ignore the last character, except when we're stating the root.
-	int l = strlen(node) - 1;
-	if (l && node[l] == '/') {
-		node[l] = '\0';
+	// is to ignore trailing slashes, except when we're stating the root.
+	len = strlen(p);
+	while (len && p[len - 1] == '/') {
+		len--;
+	}
+	if (len == 0) {
+		/* The path names the root of a mount point */
+		dp = mp->m_root;
+		dref(dp);
+		*dpp = dp;
+		return (0);
 	}
 
-	dvp = ddp->d_vnode;
-	vn_lock(dvp);
-	dp = dentry_lookup(mp, node);
+	name = p + len;
+	while (name > p && name[-1] != '/') {
+		name--;
+	}
+	len = p + len - name;
+
+	dp = dentry_lookup(ddp, name, len);
 	if (dp == NULL) {
-		error = VOP_LOOKUP(dvp, name, &vp);
+		error = namei_lookup_child(ddp, name, len, &dp);
 		if (error != 0) {
-			goto out;
-		}
-
-		dp = dentry_alloc(ddp, vp, node);
-		vput(vp);
-
-		if (dp == NULL) {
-			error = ENOMEM;
-			goto out;
+			return (error);
 		}
 	}
 
 	*dpp  = dp;
-	error = 0;
-out:
-	if (dvp != NULL) {
-		vn_unlock(dvp);
-	}
-	return (error);
+	return (0);
 }
 
 /*
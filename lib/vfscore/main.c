@@ -902,6 +902,16 @@ int closedir(DIR *dir)
 	return 0;
 }
 
+typedef int (*scandir_cmp_t)(const struct dirent **,
+			     const struct dirent **);
+
+#define UK_SORT_NAME		scandir_sort
+#define UK_SORT_TYPE		struct dirent *
+#define UK_SORT_CTX		scandir_cmp_t
+#define UK_SORT_LESS(a, b)	(ctx((const struct dirent **)(a), \
+				     (const struct dirent **)(b)) < 0)
+#include <uk/sort.h>
+
 int scandir(const char *path, struct dirent ***res,
 	int (*sel)(const struct dirent *),
 	int (*cmp)(const struct dirent **, const struct dirent **))
@@ -944,7 +954,7 @@ int scandir(const char *path, struct dirent ***res,
 	errno = old_errno;
 
 	if (cmp)
-		qsort(names, cnt, sizeof *names, (int (*)(const void *, const void *))cmp);
+		scandir_sort(names, cnt, cmp);
 	*res = names;
 	return cnt;
 }
@@ -1762,6 +1772,12 @@ int fcntl(int fd, int cmd, ...)
 	case F_SETOWN:
 		uk_pr_warn("fcntl(F_SETOWN) stubbed\n");
 		break;
+#if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+	case F_SETPIPE_SZ:
+	case F_GETPIPE_SZ:
+		error = pipe_fcntl(fp, cmd, arg, &ret);
+		break;
+#endif
 	default:
 		uk_pr_err("unsupported fcntl cmd 0x%x\n", cmd);
 		error = EINVAL;
@@ -31,18 +31,27 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
 #include <uk/config.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <vfscore/file.h>
 #include <vfscore/fs.h>
 #include <vfscore/mount.h>
 #include <vfscore/vnode.h>
+#include <vfscore/poll.h>
 #include <uk/wait.h>
+#include <uk/syscall.h>
 #include <sys/ioctl.h>
+#include "vfs.h"
 
 /* We use the default size in Linux kernel */
-#define PIPE_MAX_SIZE	(1 << CONFIG_LIBVFSCORE_PIPE_SIZE_ORDER)
+#define PIPE_DEFAULT_SIZE	(1UL << CONFIG_LIBVFSCORE_PIPE_SIZE_ORDER)
+/* Limits for F_SETPIPE_SZ */
+#define PIPE_MIN_SIZE		(1UL << __PAGE_SHIFT)
+#define PIPE_MAX_SIZE		(1UL << CONFIG_LIBVFSCORE_PIPE_MAX_SIZE_ORDER)
 
 struct pipe_buf {
 	/* The buffer */
@@ -80,8 +89,9 @@ struct pipe_file {
 	int flags;
 };
 
+static struct vnops pipe_vnops;
 
-static struct pipe_buf *pipe_buf_alloc(int capacity)
+static struct pipe_buf *pipe_buf_alloc(unsigned long capacity)
 {
 	struct pipe_buf *pipe_buf;
 
@@ -110,6 +120,8 @@ static struct pipe_buf *pipe_buf_alloc(int capacity)
 
 void pipe_buf_free(struct pipe_buf *pipe_buf)
 {
+	uk_mutex_fini(&pipe_buf->rdlock);
+	uk_mutex_fini(&pipe_buf->wrlock);
 	free(pipe_buf->data);
 	free(pipe_buf);
 }
@@ -134,86 +146,122 @@ static int pipe_buf_can_read(struct pipe_buf *pipe_buf)
 	return pipe_buf_get_available(pipe_buf) > 0;
 }
 
-static unsigned long pipe_buf_write(struct pipe_buf *pipe_buf,
-		struct iovec *iovec, size_t iovec_off)
+/*
+ * Describes up to `len` bytes of the ring as at most two contiguous
+ * segments: the stored data starting at the consumer if `data` is set,
+ * the free space starting at the producer otherwise. The segments can
+ * be handed to uiomove() or to another file's read/write directly.
+ */
+static int pipe_buf_segments(struct pipe_buf *pipe_buf, bool data,
+		size_t len, struct iovec seg[2])
 {
-	unsigned long prod_idx, to_write;
-	void *iovec_data = iovec->iov_base + iovec_off;
-	size_t iov_len = iovec->iov_len - iovec_off;
+	unsigned long idx, avail, first;
+
+	if (data) {
+		idx = PIPE_BUF_CONS_IDX(pipe_buf);
+		avail = pipe_buf_get_available(pipe_buf);
+	} else {
+		idx = PIPE_BUF_PROD_IDX(pipe_buf);
+		avail = pipe_buf_get_free_space(pipe_buf);
+	}
 
-	prod_idx = PIPE_BUF_PROD_IDX(pipe_buf);
-	to_write = MIN(pipe_buf_get_free_space(pipe_buf), iov_len);
-	if (to_write == 0)
-		goto out;
+	avail = MIN(avail, len);
+	if (avail == 0)
+		return 0;
 
-	/* Copy in one piece */
-	if (prod_idx + to_write <= pipe_buf->capacity)
-		memcpy(pipe_buf->data + prod_idx, iovec_data, to_write);
+	first = MIN(avail, pipe_buf->capacity - idx);
+	seg[0].iov_base = pipe_buf->data + idx;
+	seg[0].iov_len = first;
+	if (first == avail)
+		return 1;
 
-	else {
-		int first_copy_bytes, second_copy_bytes;
+	seg[1].iov_base = pipe_buf->data;
+	seg[1].iov_len = avail - first;
+	return 2;
+}
 
-		/* Copy the first part */
-		first_copy_bytes = pipe_buf->capacity - prod_idx;
-		memcpy(pipe_buf->data + prod_idx,
-				iovec_data,
-				first_copy_bytes);
+/* Copies as much as fits from `uio` (UIO_WRITE) into the pipe */
+static unsigned long pipe_buf_write(struct pipe_buf *pipe_buf,
+		struct uio *uio)
+{
+	struct iovec seg[2];
+	ssize_t resid = uio->uio_resid;
+	unsigned long written;
+	int i, nseg;
 
-		/* Copy the second part */
-		second_copy_bytes = prod_idx + to_write - pipe_buf->capacity;
-		memcpy(pipe_buf->data,
-				iovec_data + first_copy_bytes,
-				second_copy_bytes);
-	}
+	UK_ASSERT(uio->uio_rw == UIO_WRITE);
+
+	nseg = pipe_buf_segments(pipe_buf, false, uio->uio_resid, seg);
+	for (i = 0; i < nseg; i++)
+		vfscore_uiomove(seg[i].iov_base, seg[i].iov_len, uio);
+
+	written = resid - uio->uio_resid;
 
 	/* Update producer */
-	pipe_buf->prod += to_write;
+	pipe_buf->prod += written;
 
-out:
-	return to_write;
+	return written;
 }
 
+/* Copies as much as available from the pipe into `uio` (UIO_READ) */
 static unsigned long pipe_buf_read(struct pipe_buf *pipe_buf,
-		struct iovec *iovec, size_t iovec_off)
+		struct uio *uio)
 {
-	unsigned long cons_idx, to_read;
-	void *iovec_data = iovec->iov_base + iovec_off;
-	size_t iov_len = iovec->iov_len - iovec_off;
+	struct iovec seg[2];
+	ssize_t resid = uio->uio_resid;
+	unsigned long read;
+	int i, nseg;
 
-	cons_idx = PIPE_BUF_CONS_IDX(pipe_buf);
-	to_read = MIN(pipe_buf_get_available(pipe_buf), iov_len);
-	if (to_read == 0)
-		goto out;
+	UK_ASSERT(uio->uio_rw == UIO_READ);
 
-	/* Copy in one piece */
-	if (cons_idx + to_read <= pipe_buf->capacity)
-		memcpy(iovec_data, pipe_buf->data + cons_idx, to_read);
-
-	else {
-		int first_copy_bytes;
-		int second_copy_bytes;
-
-		/* Copy the first part */
-		first_copy_bytes = pipe_buf->capacity - pipe_buf->cons;
-		memcpy(iovec_data,
-				pipe_buf->data + cons_idx,
-				first_copy_bytes);
-
-		/* Copy the second part */
-		second_copy_bytes = cons_idx + to_read - pipe_buf->capacity;
-		memcpy(iovec_data + first_copy_bytes,
-				pipe_buf->data,
-				second_copy_bytes);
-	}
+	nseg = pipe_buf_segments(pipe_buf, true, uio->uio_resid, seg);
+	for (i = 0; i < nseg; i++)
+		vfscore_uiomove(seg[i].iov_base, seg[i].iov_len, uio);
+
+	read = resid - uio->uio_resid;
 
 	/* Update consumer */
-	pipe_buf->cons += to_read;
+	pipe_buf->cons += read;
 
-out:
-	return to_read;
+	return read;
 }
 
-struct pipe_file *pipe_file_alloc(int capacity, int flags)
+/* Called with both locks held */
+static int pipe_buf_resize(struct pipe_buf *pipe_buf, unsigned long capacity)
+{
+	unsigned long avail = pipe_buf_get_available(pipe_buf);
+	struct iovec seg[2];
+	char *data, *p;
+	int i, nseg;
+
+	UK_ASSERT(POWER_OF_2(capacity));
+
+	if (capacity == pipe_buf->capacity)
+		return 0;
+	if (avail > capacity)
+		return EBUSY;
+
+	data = malloc(capacity);
+	if (!data)
+		return ENOMEM;
+
+	p = data;
+	nseg = pipe_buf_segments(pipe_buf, true, avail, seg);
+	for (i = 0; i < nseg; i++) {
+		memcpy(p, seg[i].iov_base, seg[i].iov_len);
+		p += seg[i].iov_len;
+	}
+
+	free(pipe_buf->data);
+	pipe_buf->data = data;
+	pipe_buf->capacity = capacity;
+	pipe_buf->cons = 0;
+	pipe_buf->prod = avail;
+
+	return 0;
+}
+
+struct pipe_file *pipe_file_alloc(unsigned long capacity, int flags)
 {
 	struct pipe_file *pipe_file;
 
@@ -240,119 +288,137 @@ void pipe_file_free(struct pipe_file *pipe_file)
 	free(pipe_file);
 }
 
-static int pipe_write(struct vnode *vnode,
-		struct uio *buf, int ioflag __unused)
+static struct pipe_file *pipe_file_get(struct vfscore_file *vfscore_file)
+{
+	struct vnode *vnode = vfscore_file->f_dentry->d_vnode;
+
+	if (vnode->v_op != &pipe_vnops)
+		return NULL;
+
+	return vnode->v_data;
+}
+
+/*
+ * Waits until the pipe has data or there are no writers left, in which
+ * case the caller finds the pipe empty (end of file).
+ * Called and returns with the read lock held.
+ */
+static int pipe_wait_readable(struct pipe_file *pipe_file, bool nonblocking)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+
+	while (!pipe_buf_can_read(pipe_buf)) {
+		if (!pipe_file->w_refcount)
+			return 0;
+		if (nonblocking)
+			return EAGAIN;
+
+		uk_mutex_unlock(&pipe_buf->rdlock);
+		uk_waitq_wait_event(&pipe_buf->rdwq,
+			pipe_buf_can_read(pipe_buf) || !pipe_file->w_refcount);
+		uk_mutex_lock(&pipe_buf->rdlock);
+	}
+
+	return 0;
+}
+
+/*
+ * Waits until `need` bytes can be written.
+ * Called and returns with the write lock held.
+ */
+static int pipe_wait_writable(struct pipe_file *pipe_file,
+		unsigned long need, bool nonblocking)
 {
-	struct pipe_file *pipe_file = vnode->v_data;
 	struct pipe_buf *pipe_buf = pipe_file->buf;
-	bool nonblocking = false; /* TODO handle nonblocking */
-	bool data_available = true;
-	int uio_idx = 0;
 
-	if (!pipe_file->r_refcount) {
-		/* TODO before returning the error, send a SIGPIPE signal */
-		return -EPIPE;
+	for (;;) {
+		if (!pipe_file->r_refcount) {
+			/* TODO before returning the error, send a SIGPIPE */
+			return EPIPE;
+		}
+		if (pipe_buf_get_free_space(pipe_buf) >= need)
+			return 0;
+		if (nonblocking)
+			return EAGAIN;
+
+		uk_mutex_unlock(&pipe_buf->wrlock);
+		uk_waitq_wait_event(&pipe_buf->wrwq,
+			pipe_buf_get_free_space(pipe_buf) >= need ||
+			!pipe_file->r_refcount);
+		uk_mutex_lock(&pipe_buf->wrlock);
 	}
+}
+
+/*
+ * Readers are woken up once per call, or before sleeping on a full
+ * pipe, instead of after every copy.
+ */
+static int pipe_do_write(struct pipe_file *pipe_file, struct uio *uio,
+		bool nonblocking)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	ssize_t total = uio->uio_resid;
+	unsigned long need;
+	bool wake = false;
+	int error = 0;
 
 	uk_mutex_lock(&pipe_buf->wrlock);
-	while (data_available && uio_idx < buf->uio_iovcnt) {
-		struct iovec *iovec = &buf->uio_iov[uio_idx];
-		unsigned long off = 0;
-
-		while (off < iovec->iov_len) {
-			unsigned long written_bytes;
-
-			written_bytes = pipe_buf_write(pipe_buf, iovec, off);
-			if (written_bytes == 0) {
-				/* No data */
-				if (nonblocking) {
-					data_available = false;
-					break;
-
-				} else {
-					/* Wait until data available */
-					while (!pipe_buf_can_write(pipe_buf)) {
-						uk_mutex_unlock(&pipe_buf->wrlock);
-						uk_waitq_wait_event(&pipe_buf->wrwq,
-							pipe_buf_can_write(pipe_buf));
-						uk_mutex_lock(&pipe_buf->wrlock);
-					}
-				}
-
-			} else {
-				/* Update bytes written_bytes. */
-				buf->uio_resid -= written_bytes;
-
-				off += written_bytes;
-
-				/* wake some readers */
-				uk_waitq_wake_up(&pipe_buf->rdwq);
-			}
+	while (uio->uio_resid > 0) {
+		/* Writes of up to PIPE_BUF bytes must not be split */
+		need = (total <= PIPE_BUF) ? (unsigned long) total : 1;
+
+		if (wake && pipe_buf_get_free_space(pipe_buf) < need) {
+			uk_waitq_wake_up(&pipe_buf->rdwq);
+			wake = false;
 		}
 
-		uio_idx++;
+		error = pipe_wait_writable(pipe_file, need, nonblocking);
+		if (error)
+			break;
+
+		if (pipe_buf_write(pipe_buf, uio))
+			wake = true;
 	}
+
+	if (wake)
+		uk_waitq_wake_up(&pipe_buf->rdwq);
 	uk_mutex_unlock(&pipe_buf->wrlock);
 
-	return 0;
+	/* A partial write is a success */
+	if (uio->uio_resid < total)
+		return 0;
+
+	return error;
 }
 
-static int pipe_read(struct vnode *vnode,
-		struct vfscore_file *vfscore_file,
-		struct uio *buf, int ioflag __unused)
+/* Returns as soon as some data was read, like read(2) on Linux */
+static int pipe_do_read(struct pipe_file *pipe_file, struct uio *uio,
+		bool nonblocking)
 {
-	struct pipe_file *pipe_file = vnode->v_data;
 	struct pipe_buf *pipe_buf = pipe_file->buf;
-	bool nonblocking = (vfscore_file->f_flags & O_NONBLOCK);
-	bool data_available = true;
-	int uio_idx = 0;
+	int error;
 
 	uk_mutex_lock(&pipe_buf->rdlock);
-	if (nonblocking && !pipe_buf_can_read(pipe_buf)) {
-		uk_mutex_unlock(&pipe_buf->rdlock);
-		return EAGAIN;
-	}
+	error = pipe_wait_readable(pipe_file, nonblocking);
+	if (!error && pipe_buf_read(pipe_buf, uio))
+		uk_waitq_wake_up(&pipe_buf->wrwq);
+	uk_mutex_unlock(&pipe_buf->rdlock);
 
-	while (data_available && uio_idx < buf->uio_iovcnt) {
-		struct iovec *iovec = &buf->uio_iov[uio_idx];
-		unsigned long off = 0;
-
-		while (off < iovec->iov_len) {
-			unsigned long read_bytes;
-
-			read_bytes = pipe_buf_read(pipe_buf, iovec, off);
-			if (read_bytes == 0) {
-				/* No data */
-				if (nonblocking) {
-					data_available = false;
-					break;
-
-				} else {
-					/* Wait until data available */
-					while (!pipe_buf_can_read(pipe_buf)) {
-						uk_mutex_unlock(&pipe_buf->rdlock);
-						uk_waitq_wait_event(&pipe_buf->rdwq,
-							pipe_buf_can_read(pipe_buf));
-						uk_mutex_lock(&pipe_buf->rdlock);
-					}
-				}
-
-			} else {
-				/* Update bytes read */
-				buf->uio_resid -= read_bytes;
-
-				off += read_bytes;
-
-				/* wake some writers */
-				uk_waitq_wake_up(&pipe_buf->wrwq);
-			}
-		}
+	return error;
+}
 
-		uio_idx++;
-	}
-	uk_mutex_unlock(&pipe_buf->rdlock);
+static int pipe_write(struct vnode *vnode,
+		struct uio *buf, int ioflag)
+{
+	return pipe_do_write(vnode->v_data, buf, ioflag & IO_NDELAY);
+}
 
-	return 0;
+static int pipe_read(struct vnode *vnode,
+		struct vfscore_file *vfscore_file,
+		struct uio *buf, int ioflag __unused)
+{
+	return pipe_do_read(vnode->v_data, buf,
+			    vfscore_file->f_flags & O_NONBLOCK);
 }
 
 static int pipe_close(struct vnode *vnode,
@@ -369,8 +435,14 @@ static int pipe_close(struct vnode *vnode,
 	if (vfscore_file->f_flags & UK_FWRITE)
 		pipe_file->w_refcount--;
 
-	if (!pipe_file->r_refcount && !pipe_file->w_refcount)
+	if (!pipe_file->r_refcount && !pipe_file->w_refcount) {
 		pipe_file_free(pipe_file);
+		return 0;
+	}
+
+	/* Let pollers on the other end see the hang up */
+	uk_waitq_wake_up(&pipe_file->buf->rdwq);
+	uk_waitq_wake_up(&pipe_file->buf->wrwq);
 
 	return 0;
 }
@@ -379,8 +451,7 @@ static int pipe_seek(struct vnode *vnode __unused,
 			struct vfscore_file *vfscore_file __unused,
 			off_t off1 __unused, off_t off2 __unused)
 {
-	errno = ESPIPE;
-	return -1;
+	return ESPIPE;
 }
 
 static int pipe_ioctl(struct vnode *vnode,
@@ -396,9 +467,39 @@ static int pipe_ioctl(struct vnode *vnode,
 		*((int *) data) = pipe_buf_get_available(pipe_buf);
 		uk_mutex_unlock(&pipe_buf->rdlock);
 		return 0;
+	case FIONBIO:
+		/* O_NONBLOCK is taken from the file flags */
+		return 0;
 	default:
-		return -EINVAL;
+		return EINVAL;
+	}
+}
+
+static int pipe_poll(struct vnode *vnode,
+		struct vfscore_file *vfscore_file,
+		struct vfscore_poll_table *pt)
+{
+	struct pipe_file *pipe_file = vnode->v_data;
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	int mask = 0;
+
+	if (vfscore_file->f_flags & UK_FREAD) {
+		vfscore_poll_wait(pt, &pipe_buf->rdwq);
+		if (pipe_buf_can_read(pipe_buf))
+			mask |= POLLIN | POLLRDNORM;
+		if (!pipe_file->w_refcount)
+			mask |= POLLHUP;
+	}
+
+	if (vfscore_file->f_flags & UK_FWRITE) {
+		vfscore_poll_wait(pt, &pipe_buf->wrwq);
+		if (pipe_buf_can_write(pipe_buf))
+			mask |= POLLOUT | POLLWRNORM;
+		if (!pipe_file->r_refcount)
+			mask |= POLLERR;
 	}
+
+	return mask;
 }
 
 #define pipe_open        ((vnop_open_t) vfscore_vop_einval)
@@ -443,7 +544,8 @@ static struct vnops pipe_vnops = {
 	.vop_cache     = pipe_cache,
 	.vop_fallocate = pipe_fallocate,
 	.vop_readlink  = pipe_readlink,
-	.vop_symlink   = pipe_symlink
+	.vop_symlink   = pipe_symlink,
+	.vop_poll      = pipe_poll
 };
 
 #define pipe_vget  ((vfsop_vget_t) vfscore_vop_nullop)
@@ -541,7 +643,7 @@ int pipe(int pipefd[2])
 	struct pipe_file *pipe_file;
 
 	/* Allocate pipe internal structure. */
-	pipe_file = pipe_file_alloc(PIPE_MAX_SIZE, 0);
+	pipe_file = pipe_file_alloc(PIPE_DEFAULT_SIZE, 0);
 	if (!pipe_file) {
 		ret = -ENOMEM;
 		goto ERR_EXIT;
@@ -597,3 +699,315 @@ int mkfifo(const char *path __unused, mode_t mode __unused)
 	errno = ENOTSUP;
 	return -1;
 }
+
+int pipe_fcntl(struct vfscore_file *vfscore_file, int cmd, int arg, int *ret)
+{
+	struct pipe_file *pipe_file = pipe_file_get(vfscore_file);
+	struct pipe_buf *pipe_buf;
+	unsigned long capacity;
+	int error = 0;
+
+	if (!pipe_file)
+		return EBADF;
+
+	pipe_buf = pipe_file->buf;
+
+	switch (cmd) {
+	case F_GETPIPE_SZ:
+		*ret = pipe_buf->capacity;
+		break;
+	case F_SETPIPE_SZ:
+		if (arg < 0 || (unsigned long) arg > PIPE_MAX_SIZE)
+			return EINVAL;
+
+		capacity = PIPE_MIN_SIZE;
+		while (capacity < (unsigned long) arg)
+			capacity <<= 1;
+
+		uk_mutex_lock(&pipe_buf->rdlock);
+		uk_mutex_lock(&pipe_buf->wrlock);
+		error = pipe_buf_resize(pipe_buf, capacity);
+		uk_mutex_unlock(&pipe_buf->wrlock);
+		uk_mutex_unlock(&pipe_buf->rdlock);
+
+		if (error)
+			return error;
+
+		uk_waitq_wake_up(&pipe_buf->wrwq);
+		*ret = capacity;
+		break;
+	default:
+		return EINVAL;
+	}
+
+	return 0;
+}
+
+static bool splice_nonblocking(struct vfscore_file *pipe_fp,
+		unsigned int flags)
+{
+	return (flags & SPLICE_F_NONBLOCK) || (pipe_fp->f_flags & O_NONBLOCK);
+}
+
+/*
+ * The splice helpers hand the ring segments of the pipe to the other
+ * file's read or write operation, so the data is copied once between
+ * the pipe and the file without going through a bounce buffer.
+ */
+static ssize_t splice_from_pipe(struct pipe_file *pipe_file,
+		struct vfscore_file *out, off_t *off_out, size_t len,
+		bool nonblocking)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	struct iovec seg[2];
+	struct uio uio;
+	ssize_t moved = 0;
+	int error, nseg;
+
+	uk_mutex_lock(&pipe_buf->rdlock);
+	error = pipe_wait_readable(pipe_file, nonblocking);
+	if (error)
+		goto out;
+
+	nseg = pipe_buf_segments(pipe_buf, true, len, seg);
+	if (!nseg)
+		goto out; /* No writers left */
+
+	uio.uio_iov = seg;
+	uio.uio_iovcnt = nseg;
+	uio.uio_offset = off_out ? *off_out : 0;
+	uio.uio_resid = seg[0].iov_len + (nseg > 1 ? seg[1].iov_len : 0);
+	uio.uio_rw = UIO_WRITE;
+
+	moved = uio.uio_resid;
+	error = vfs_write(out, &uio, off_out ? FOF_OFFSET : 0);
+	moved -= uio.uio_resid;
+
+	if (moved) {
+		error = 0;
+		pipe_buf->cons += moved;
+		if (off_out)
+			*off_out += moved;
+		uk_waitq_wake_up(&pipe_buf->wrwq);
+	}
+
+out:
+	uk_mutex_unlock(&pipe_buf->rdlock);
+	return error ? -error : moved;
+}
+
+static ssize_t splice_to_pipe(struct vfscore_file *in, off_t *off_in,
+		struct pipe_file *pipe_file, size_t len, bool nonblocking)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	struct iovec seg[2];
+	struct uio uio;
+	ssize_t moved = 0;
+	int error, nseg;
+
+	uk_mutex_lock(&pipe_buf->wrlock);
+	error = pipe_wait_writable(pipe_file, 1, nonblocking);
+	if (error)
+		goto out;
+
+	nseg = pipe_buf_segments(pipe_buf, false, len, seg);
+	UK_ASSERT(nseg);
+
+	uio.uio_iov = seg;
+	uio.uio_iovcnt = nseg;
+	uio.uio_offset = off_in ? *off_in : 0;
+	uio.uio_resid = seg[0].iov_len + (nseg > 1 ? seg[1].iov_len : 0);
+	uio.uio_rw = UIO_READ;
+
+	moved = uio.uio_resid;
+	error = vfs_read(in, &uio, off_in ? FOF_OFFSET : 0);
+	moved -= uio.uio_resid;
+
+	if (moved) {
+		error = 0;
+		pipe_buf->prod += moved;
+		if (off_in)
+			*off_in += moved;
+		uk_waitq_wake_up(&pipe_buf->rdwq);
+	}
+
+out:
+	uk_mutex_unlock(&pipe_buf->wrlock);
+	return error ? -error : moved;
+}
+
+static ssize_t splice_pipe_to_pipe(struct pipe_file *ipipe,
+		struct pipe_file *opipe, size_t len, bool nonblocking)
+{
+	struct pipe_buf *ibuf = ipipe->buf, *obuf = opipe->buf;
+	struct iovec seg[2];
+	struct uio uio;
+	ssize_t moved = 0;
+	int error, nseg;
+
+	uk_mutex_lock(&ibuf->rdlock);
+	error = pipe_wait_readable(ipipe, nonblocking);
+	if (error)
+		goto out_unlock_in;
+
+	nseg = pipe_buf_segments(ibuf, true, len, seg);
+	if (!nseg)
+		goto out_unlock_in;
+
+	uk_mutex_lock(&obuf->wrlock);
+	error = pipe_wait_writable(opipe, 1, nonblocking);
+	if (error)
+		goto out_unlock_out;
+
+	uio.uio_iov = seg;
+	uio.uio_iovcnt = nseg;
+	uio.uio_offset = 0;
+	uio.uio_resid = seg[0].iov_len + (nseg > 1 ? seg[1].iov_len : 0);
+	uio.uio_rw = UIO_WRITE;
+
+	moved = pipe_buf_write(obuf, &uio);
+	ibuf->cons += moved;
+	uk_waitq_wake_up(&obuf->rdwq);
+	uk_waitq_wake_up(&ibuf->wrwq);
+
+out_unlock_out:
+	uk_mutex_unlock(&obuf->wrlock);
+out_unlock_in:
+	uk_mutex_unlock(&ibuf->rdlock);
+	return error ? -error : moved;
+}
+
+UK_SYSCALL_R_DEFINE(ssize_t, splice, int, fd_in, off_t *, off_in,
+		    int, fd_out, off_t *, off_out, size_t, len,
+		    unsigned int, flags)
+{
+	struct vfscore_file *in, *out;
+	struct pipe_file *ipipe, *opipe;
+	ssize_t ret;
+
+	in = vfscore_get_file(fd_in);
+	if (!in)
+		return -EBADF;
+
+	out = vfscore_get_file(fd_out);
+	if (!out) {
+		ret = -EBADF;
+		goto out_drop_in;
+	}
+
+	if (!(in->f_flags & UK_FREAD) || !(out->f_flags & UK_FWRITE)) {
+		ret = -EBADF;
+		goto out_drop_out;
+	}
+
+	ipipe = pipe_file_get(in);
+	opipe = pipe_file_get(out);
+
+	if ((ipipe && off_in) || (opipe && off_out)) {
+		ret = -ESPIPE;
+		goto out_drop_out;
+	}
+
+	if (!len) {
+		ret = 0;
+		goto out_drop_out;
+	}
+
+	if (ipipe && opipe) {
+		if (ipipe == opipe)
+			ret = -EINVAL;
+		else
+			ret = splice_pipe_to_pipe(ipipe, opipe, len,
+				splice_nonblocking(in, flags) ||
+				splice_nonblocking(out, flags));
+	} else if (ipipe) {
+		ret = splice_from_pipe(ipipe, out, off_out, len,
+				       splice_nonblocking(in, flags));
+	} else if (opipe) {
+		ret = splice_to_pipe(in, off_in, opipe, len,
+				     splice_nonblocking(out, flags));
+	} else {
+		ret = -EINVAL;
+	}
+
+out_drop_out:
+	fdrop(out);
+out_drop_in:
+	fdrop(in);
+	return ret;
+}
+
+/*
+ * There are no user pages to map into the pipe, so vmsplice() copies
+ * like writev() (write end) or readv() (read end).
+ */
+UK_SYSCALL_R_DEFINE(ssize_t, vmsplice, int, fd, const struct iovec *, iov,
+		    size_t, nr_segs, unsigned int, flags)
+{
+	struct vfscore_file *vfscore_file;
+	struct pipe_file *pipe_file;
+	struct iovec *copy_iov = NULL;
+	struct uio uio;
+	ssize_t total = 0;
+	ssize_t ret;
+	bool nonblocking;
+	size_t i;
+
+	if (nr_segs > UIO_MAXIOV)
+		return -EINVAL;
+
+	vfscore_file = vfscore_get_file(fd);
+	if (!vfscore_file)
+		return -EBADF;
+
+	pipe_file = pipe_file_get(vfscore_file);
+	if (!pipe_file) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	for (i = 0; i < nr_segs; i++) {
+		if (iov[i].iov_len > (size_t) (IOSIZE_MAX - total)) {
+			ret = -EINVAL;
+			goto out;
+		}
+		total += iov[i].iov_len;
+	}
+
+	if (!total) {
+		ret = 0;
+		goto out;
+	}
+
+	/* uiomove() consumes the iovecs */
+	copy_iov = malloc(nr_segs * sizeof(*copy_iov));
+	if (!copy_iov) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memcpy(copy_iov, iov, nr_segs * sizeof(*copy_iov));
+
+	uio.uio_iov = copy_iov;
+	uio.uio_iovcnt = nr_segs;
+	uio.uio_offset = 0;
+	uio.uio_resid = total;
+
+	nonblocking = splice_nonblocking(vfscore_file, flags);
+	if (vfscore_file->f_flags & UK_FWRITE) {
+		uio.uio_rw = UIO_WRITE;
+		ret = pipe_do_write(pipe_file, &uio, nonblocking);
+	} else {
+		uio.uio_rw = UIO_READ;
+		ret = pipe_do_read(pipe_file, &uio, nonblocking);
+	}
+
+	if (!ret)
+		ret = total - uio.uio_resid;
+	else
+		ret = -ret;
+
+	free(copy_iov);
+out:
+	fdrop(vfscore_file);
+	return ret;
+}
@@ -0,0 +1,454 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/plat/lcpu.h>
+#include <uk/plat/time.h>
+#include <uk/thread.h>
+#include <uk/wait.h>
+#include <uk/syscall.h>
+#include <vfscore/file.h>
+#include <vfscore/vnode.h>
+#include <vfscore/poll.h>
+
+/* Wait queue registrations kept on the stack before falling back to malloc */
+#define POLL_INLINE_ENTRIES	16
+#define POLL_CHUNK_ENTRIES	32
+
+/* Number of pollfds that select() translates on the stack */
+#define SELECT_STACK_FDS	32
+
+struct poll_entry {
+	struct uk_waitq *wq;
+	struct uk_waitq_entry wait;
+	struct vfscore_file *fp;
+};
+
+struct poll_chunk {
+	struct poll_chunk *next;
+	unsigned int count;
+	struct poll_entry entries[POLL_CHUNK_ENTRIES];
+};
+
+struct poll_wqueues {
+	struct vfscore_poll_table pt;
+	struct uk_thread *thread;
+	/* File that is currently being polled */
+	struct vfscore_file *fp;
+	int error;
+	unsigned int inline_count;
+	struct poll_entry inline_entries[POLL_INLINE_ENTRIES];
+	struct poll_chunk *chunks;
+};
+
+static struct poll_entry *poll_get_entry(struct poll_wqueues *p)
+{
+	struct poll_chunk *chunk;
+
+	if (p->inline_count < POLL_INLINE_ENTRIES)
+		return &p->inline_entries[p->inline_count++];
+
+	chunk = p->chunks;
+	if (!chunk || chunk->count == POLL_CHUNK_ENTRIES) {
+		chunk = malloc(sizeof(*chunk));
+		if (!chunk)
+			return NULL;
+
+		chunk->count = 0;
+		chunk->next = p->chunks;
+		p->chunks = chunk;
+	}
+
+	return &chunk->entries[chunk->count++];
+}
+
+static void poll_queue(struct vfscore_poll_table *pt, struct uk_waitq *wq)
+{
+	struct poll_wqueues *p = __containerof(pt, struct poll_wqueues, pt);
+	struct poll_entry *entry;
+	unsigned long flags;
+
+	entry = poll_get_entry(p);
+	if (!entry) {
+		p->error = -ENOMEM;
+		return;
+	}
+
+	/* The wait queue lives as long as the file, keep it open */
+	fhold(p->fp);
+	entry->fp = p->fp;
+	entry->wq = wq;
+	uk_waitq_entry_init(&entry->wait, p->thread);
+
+	flags = ukplat_lcpu_save_irqf();
+	uk_waitq_add(wq, &entry->wait);
+	ukplat_lcpu_restore_irqf(flags);
+}
+
+static void poll_initwait(struct poll_wqueues *p)
+{
+	p->pt.queue = poll_queue;
+	p->thread = uk_thread_current();
+	p->fp = NULL;
+	p->error = 0;
+	p->inline_count = 0;
+	p->chunks = NULL;
+}
+
+static void poll_free_entry(struct poll_entry *entry)
+{
+	unsigned long flags;
+
+	flags = ukplat_lcpu_save_irqf();
+	uk_waitq_remove(entry->wq, &entry->wait);
+	ukplat_lcpu_restore_irqf(flags);
+
+	fdrop(entry->fp);
+}
+
+static void poll_freewait(struct poll_wqueues *p)
+{
+	struct poll_chunk *chunk, *next;
+	unsigned int i;
+
+	for (i = 0; i < p->inline_count; i++)
+		poll_free_entry(&p->inline_entries[i]);
+
+	for (chunk = p->chunks; chunk; chunk = next) {
+		for (i = 0; i < chunk->count; i++)
+			poll_free_entry(&chunk->entries[i]);
+		next = chunk->next;
+		free(chunk);
+	}
+}
+
+static int poll_one(struct pollfd *pfd, struct poll_wqueues *p, int queue)
+{
+	struct vfscore_file *fp;
+	int mask;
+
+	if (pfd->fd < 0) {
+		pfd->revents = 0;
+		return 0;
+	}
+
+	fp = vfscore_get_file(pfd->fd);
+	if (!fp) {
+		pfd->revents = POLLNVAL;
+		return POLLNVAL;
+	}
+
+	p->fp = fp;
+	mask = vfscore_poll(fp, queue ? &p->pt : NULL);
+	p->fp = NULL;
+	fdrop(fp);
+
+	/* Errors and hang ups are reported even if not requested */
+	mask &= pfd->events | POLLERR | POLLHUP;
+	pfd->revents = mask;
+	return mask;
+}
+
+/*
+ * Polls all descriptors and, unless a descriptor is ready already or
+ * `block` is not set, sleeps until one of the registered wait queues
+ * is woken up or the deadline (0 = infinite) passes. Like
+ * uk_waitq_wait_event(), the thread is marked blocked before the
+ * readiness is checked, so that wake ups in between are not lost.
+ */
+static int do_poll(struct pollfd *fds, nfds_t nfds, __nsec deadline,
+		   int block)
+{
+	struct uk_thread *current = uk_thread_current();
+	struct poll_wqueues table;
+	unsigned long flags;
+	int queue = block;
+	int count;
+	nfds_t i;
+
+	poll_initwait(&table);
+
+	for (;;) {
+		if (block) {
+			flags = ukplat_lcpu_save_irqf();
+			current->wakeup_time = deadline;
+			clear_runnable(current);
+			uk_sched_thread_blocked(current->sched, current);
+			ukplat_lcpu_restore_irqf(flags);
+		}
+
+		count = 0;
+		for (i = 0; i < nfds; i++) {
+			if (poll_one(&fds[i], &table, queue))
+				count++;
+		}
+
+		/* Wait queues only need to be registered once */
+		queue = 0;
+
+		if (count || !block || table.error)
+			break;
+		if (deadline && ukplat_monotonic_clock() >= deadline)
+			break;
+
+		uk_sched_yield();
+	}
+
+	if (block) {
+		flags = ukplat_lcpu_save_irqf();
+		uk_thread_wake(current);
+		ukplat_lcpu_restore_irqf(flags);
+	}
+
+	poll_freewait(&table);
+
+	if (!count && table.error)
+		return table.error;
+
+	return count;
+}
+
+static int timespec_to_deadline(const struct timespec *ts, __nsec *deadline,
+				int *block)
+{
+	if (!ts) {
+		*deadline = 0;
+		*block = 1;
+		return 0;
+	}
+
+	if (ts->tv_sec < 0 || ts->tv_nsec < 0 ||
+	    (unsigned long) ts->tv_nsec >= UKARCH_NSEC_PER_SEC)
+		return -EINVAL;
+
+	if (!ts->tv_sec && !ts->tv_nsec) {
+		*deadline = 0;
+		*block = 0;
+		return 0;
+	}
+
+	*deadline = ukplat_monotonic_clock() +
+		ukarch_time_sec_to_nsec((__nsec) ts->tv_sec) + ts->tv_nsec;
+	*block = 1;
+	return 0;
+}
+
+UK_SYSCALL_R_DEFINE(int, poll, struct pollfd *, fds, nfds_t, nfds,
+		    int, timeout)
+{
+	__nsec deadline = 0;
+
+	if (nfds > FDTABLE_MAX_FILES)
+		return -EINVAL;
+	if (nfds && !fds)
+		return -EFAULT;
+
+	if (timeout > 0)
+		deadline = ukplat_monotonic_clock() +
+			ukarch_time_msec_to_nsec((__nsec) timeout);
+
+	return do_poll(fds, nfds, deadline, timeout != 0);
+}
+
+/* Signal masks are not supported and ignored */
+UK_SYSCALL_R_DEFINE(int, ppoll, struct pollfd *, fds, nfds_t, nfds,
+		    const struct timespec *, tmo_p,
+		    const sigset_t *, sigmask)
+{
+	__nsec deadline;
+	int block;
+	int ret;
+
+	if (nfds > FDTABLE_MAX_FILES)
+		return -EINVAL;
+	if (nfds && !fds)
+		return -EFAULT;
+
+	ret = timespec_to_deadline(tmo_p, &deadline, &block);
+	if (ret)
+		return ret;
+
+	return do_poll(fds, nfds, deadline, block);
+}
+
+/*
+ * select() is implemented on top of do_poll(): the descriptor sets are
+ * translated to a pollfd array and the results back into the sets.
+ */
+static int do_select(int nfds, fd_set *readfds, fd_set *writefds,
+		     fd_set *exceptfds, __nsec deadline, int block)
+{
+	struct pollfd stack_fds[SELECT_STACK_FDS];
+	struct pollfd *fds = stack_fds;
+	nfds_t n = 0, i;
+	int fd, ret;
+	short events;
+
+	if (nfds < 0 || nfds > FD_SETSIZE)
+		return -EINVAL;
+
+	if (nfds > SELECT_STACK_FDS) {
+		fds = malloc(nfds * sizeof(*fds));
+		if (!fds)
+			return -ENOMEM;
+	}
+
+	for (fd = 0; fd < nfds; fd++) {
+		events = 0;
+		if (readfds && FD_ISSET(fd, readfds))
+			events |= POLLIN | POLLRDNORM;
+		if (writefds && FD_ISSET(fd, writefds))
+			events |= POLLOUT | POLLWRNORM;
+		if (exceptfds && FD_ISSET(fd, exceptfds))
+			events |= POLLPRI;
+		if (!events)
+			continue;
+
+		fds[n].fd = fd;
+		fds[n].events = events;
+		fds[n].revents = 0;
+		n++;
+	}
+
+	ret = do_poll(fds, n, deadline, block);
+	if (ret < 0)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		if (fds[i].revents & POLLNVAL) {
+			ret = -EBADF;
+			goto out;
+		}
+	}
+
+	if (readfds)
+		FD_ZERO(readfds);
+	if (writefds)
+		FD_ZERO(writefds);
+	if (exceptfds)
+		FD_ZERO(exceptfds);
+
+	ret = 0;
+	for (i = 0; i < n; i++) {
+		fd = fds[i].fd;
+		if (readfds && (fds[i].events & POLLIN) &&
+		    (fds[i].revents & (POLLIN | POLLRDNORM | POLLHUP |
+				       POLLERR))) {
+			FD_SET(fd, readfds);
+			ret++;
+		}
+		if (writefds && (fds[i].events & POLLOUT) &&
+		    (fds[i].revents & (POLLOUT | POLLWRNORM | POLLERR))) {
+			FD_SET(fd, writefds);
+			ret++;
+		}
+		if (exceptfds && (fds[i].events & POLLPRI) &&
+		    (fds[i].revents & POLLPRI)) {
+			FD_SET(fd, exceptfds);
+			ret++;
+		}
+	}
+
+out:
+	if (fds != stack_fds)
+		free(fds);
+	return ret;
+}
+
+UK_SYSCALL_R_DEFINE(int, select, int, nfds, fd_set *, readfds,
+		    fd_set *, writefds, fd_set *, exceptfds,
+		    struct timeval *, timeout)
+{
+	__nsec deadline = 0;
+	int block = 1;
+
+	if (timeout) {
+		if (timeout->tv_sec < 0 || timeout->tv_usec < 0 ||
+		    timeout->tv_usec >= 1000000)
+			return -EINVAL;
+
+		if (!timeout->tv_sec && !timeout->tv_usec)
+			block = 0;
+		else
+			deadline = ukplat_monotonic_clock() +
+				ukarch_time_sec_to_nsec(
+					(__nsec) timeout->tv_sec) +
+				ukarch_time_usec_to_nsec(
+					(__nsec) timeout->tv_usec);
+	}
+
+	return do_select(nfds, readfds, writefds, exceptfds, deadline, block);
+}
+
+/*
+ * The last argument of the raw system call points to a
+ * {sigset_t *, size_t} pair. Signal masks are not supported and ignored.
+ */
+UK_LLSYSCALL_R_DEFINE(int, pselect6, int, nfds, fd_set *, readfds,
+		      fd_set *, writefds, fd_set *, exceptfds,
+		      const struct timespec *, timeout, void *, sig)
+{
+	__nsec deadline;
+	int block;
+	int ret;
+
+	ret = timespec_to_deadline(timeout, &deadline, &block);
+	if (ret)
+		return ret;
+
+	return do_select(nfds, readfds, writefds, exceptfds, deadline, block);
+}
+
+#if UK_LIBC_SYSCALLS
+int pselect(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+	    const struct timespec *timeout, const sigset_t *sigmask __unused)
+{
+	__nsec deadline;
+	int block;
+	int ret;
+
+	ret = timespec_to_deadline(timeout, &deadline, &block);
+	if (!ret)
+		ret = do_select(nfds, readfds, writefds, exceptfds,
+				deadline, block);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+	return ret;
+}
+#endif /* UK_LIBC_SYSCALLS */
@@ -33,13 +33,19 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#define _GNU_SOURCE
 #include <errno.h>
+#include <string.h>
 #include <uk/config.h>
 #include <uk/arch/types.h>
 #include <uk/libparam.h>
 #include <sys/stat.h>
 #include <sys/mount.h>
 #include <uk/init.h>
+#if CONFIG_LIBVFSCORE_ROOTFS_INITRD
+#include <uk/plat/memory.h>
+#include "vfs.h"
+#endif
 
 static const char *rootfs   = CONFIG_LIBVFSCORE_ROOTFS;
 
@@ -66,6 +72,39 @@ UK_LIB_PARAM_STR(rootdev);
 UK_LIB_PARAM_STR(rootopts);
 UK_LIB_PARAM(rootflags, __u64);
 
+#if CONFIG_LIBVFSCORE_ROOTFS_INITRD
+/*
+ * Mounts a ramfs to '/' and extracts the cpio archive found as first
+ * initrd module to it. File data is referenced in place, the initrd
+ * memory is never handed over to the allocator.
+ */
+static int vfscore_rootfs_initrd(void)
+{
+	struct ukplat_memregion_desc mrd;
+	int error;
+
+	if (ukplat_memregion_find_initrd0(&mrd) < 0) {
+		uk_pr_crit("Could not find an initrd\n");
+		return -1;
+	}
+
+	uk_pr_info("Mount ramfs to /...\n");
+	if (mount("", "/", "ramfs", rootflags, rootopts) != 0) {
+		uk_pr_crit("Failed to mount /: %d\n", errno);
+		return -1;
+	}
+
+	uk_pr_info("Extract initrd (%"__PRIsz" bytes) to /...\n", mrd.len);
+	error = vfscore_cpio_extract("/", mrd.base, mrd.len);
+	if (error) {
+		uk_pr_crit("Failed to extract initrd to /: %d\n", error);
+		return -1;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_LIBVFSCORE_ROOTFS_INITRD */
+
 static int vfscore_rootfs(void)
 {
 	/*
@@ -78,17 +117,17 @@ static int vfscore_rootfs(void)
 		return -1;
 	}
 
+#if CONFIG_LIBVFSCORE_ROOTFS_INITRD
+	if (strcmp(rootfs, "initrd") == 0)
+		return vfscore_rootfs_initrd();
+#endif
+
 	uk_pr_info("Mount %s to /...\n", rootfs);
 	if (mount(rootdev, "/", rootfs, rootflags, rootopts) != 0) {
 		uk_pr_crit("Failed to mount /: %d\n", errno);
 		return -1;
 	}
 
-	/*
-	 * TODO: Alternatively we could extract an archive found
-	 * as initrd to a ramfs '/' if we have got fsname 'initrd'
-	 */
-
 	return 0;
 }
 
@@ -42,9 +42,15 @@
 #include <vfscore/vnode.h>
 #include <vfscore/mount.h>
 
+#if CONFIG_LIBVFSCORE_STDIO_DEBUG_CONSOLE
+#define stdio_cout ukplat_coutd
+#else
+#define stdio_cout ukplat_coutk
+#endif
+
 static int __write_fn(void *dst __unused, void *src, size_t *cnt)
 {
-	int ret = ukplat_coutk(src, *cnt);
+	int ret = stdio_cout(src, *cnt);
 
 	if (ret < 0)
 		/* TODO: remove -1 when vfscore switches to negative
@@ -182,6 +188,7 @@ static struct vnops stdio_vnops = {
 	stdio_fallocate,	/* fallocate */
 	stdio_readlink,		/* read link */
 	stdio_symlink,		/* symbolic link */
+	(vnop_poll_t) NULL,	/* poll */
 };
 
 static struct vnode stdio_vnode = {
@@ -131,6 +131,7 @@ sys_open(char *path, int flags, mode_t mode, struct vfscore_file **fpp)
 			}
 			mode &= ~S_IFMT;
 			mode |= S_IFREG;
+			vn_neg_purge(ddp->d_vnode, filename);
 			error = VOP_CREATE(ddp->d_vnode, filename, mode);
 			vn_unlock(ddp->d_vnode);
 			drele(ddp);
@@ -222,6 +223,7 @@ sys_open(char *path, int flags, mode_t mode, struct vfscore_file **fpp)
 		// returned so cannot be in use, and because it wasn't opened
 		// it cannot be close()ed.
 		drele(fp->f_dentry);
+		uk_mutex_fini(&fp->f_lock);
 		free(fp);
 		return error;
 	}
@@ -579,6 +581,7 @@ sys_mkdir(char *path, mode_t mode)
 	mode &= ~S_IFMT;
 	mode |= S_IFDIR;
 
+	vn_neg_purge(ddp->d_vnode, name);
 	error = VOP_MKDIR(ddp->d_vnode, name, mode);
  out:
 	vn_unlock(ddp->d_vnode);
@@ -665,6 +668,7 @@ sys_mknod(char *path, mode_t mode)
 	vn_lock(ddp->d_vnode);
 	if ((error = vn_access(ddp->d_vnode, VWRITE)) != 0)
 		goto out;
+	vn_neg_purge(ddp->d_vnode, name);
 	if (S_ISDIR(mode))
 		error = VOP_MKDIR(ddp->d_vnode, name, mode);
 	else
@@ -834,6 +838,7 @@ sys_rename(char *src, char *dest)
 		goto err3;
 	}
 
+	vn_neg_purge(dvp2, dname);
 	error = VOP_RENAME(dvp1, vp1, sname, dvp2, vp2, dname);
 	if (error)
 		goto err3;
@@ -911,6 +916,7 @@ sys_symlink(const char *oldpath, const char *newpath)
 		error = ENAMETOOLONG;
 		goto out;
 	}
+	vn_neg_purge(newdirdp->d_vnode, name);
 	error = VOP_SYMLINK(newdirdp->d_vnode, name, op);
 
 out:
@@ -973,6 +979,7 @@ sys_link(char *oldpath, char *newpath)
 		goto out1;
 	}
 
+	vn_neg_purge(newdirdp->d_vnode, name);
 	error = VOP_LINK(newdirdp->d_vnode, vp, name);
  out1:
 	vn_unlock(newdirdp->d_vnode);
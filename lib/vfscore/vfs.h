@@ -145,6 +145,10 @@ int vfs_stat(struct vfscore_file *fp, struct stat *st);
 int fget(int fd, struct vfscore_file **out_fp);
 int fdalloc(struct vfscore_file *fp, int *newfd);
 
+int pipe_fcntl(struct vfscore_file *fp, int cmd, int arg, int *ret);
+
+int vfscore_cpio_extract(const char *dest, const void *archive, size_t len);
+
 #ifdef DEBUG_VFS
 void	 vnode_dump(void);
 void	 vfscore_mount_dump(void);
@@ -44,6 +44,7 @@
 #include <errno.h>
 #include <sys/stat.h>
 
+#include <uk/arch/atomic.h>
 #include <vfscore/prex.h>
 #include <vfscore/dentry.h>
 #include <vfscore/vnode.h>
@@ -73,28 +74,24 @@ int vttoif_tab[10] = {
  * vrele      -1        *
  */
 
-#define VNODE_BUCKETS 32		/* size of vnode hash table */
+#define VNODE_BUCKETS 128		/* size of vnode hash table */
 
 /*
  * vnode table.
  * All active (opened) vnodes are stored on this hash table.
  * They can be accessed by its path name.
+ *
+ * Each bucket has its own lock, protecting the chain and the transition
+ * of a hashed vnode's reference count from and to zero. Other reference
+ * count updates are atomic and do not need any lock. If a vnode is already
+ * locked, there is no need to lock its bucket to access internal data.
  */
-static struct uk_list_head vnode_table[VNODE_BUCKETS];
-
-/*
- * Global lock to access all vnodes and vnode table.
- * If a vnode is already locked, there is no need to
- * lock this global lock to access internal data.
- */
-static struct uk_mutex vnode_lock = UK_MUTEX_INITIALIZER(vnode_lock);
-#define VNODE_LOCK()	uk_mutex_lock(&vnode_lock)
-#define VNODE_UNLOCK()	uk_mutex_unlock(&vnode_lock)
-
-/* TODO: implement mutex_owned */
-#define VNODE_OWNED()	(1)
-/* #define VNODE_OWNED()	mutex_owned(&vnode_lock) */
+struct vnode_bucket {
+	struct uk_list_head head;
+	struct uk_mutex lock;
+};
 
+static struct vnode_bucket vnode_table[VNODE_BUCKETS];
 
 /*
  * Get the hash value from the mount point and path name.
@@ -102,31 +99,47 @@ static struct uk_mutex vnode_lock = UK_MUTEX_INITIALIZER(vnode_lock);
  */
 static unsigned int vn_hash(struct mount *mp, uint64_t ino)
 {
-	return (ino ^ (unsigned long)mp) & (VNODE_BUCKETS - 1);
+	return (ino ^ ((unsigned long)mp >> 4)) & (VNODE_BUCKETS - 1);
 }
 
 /*
- * Returns locked vnode for specified mount point and path.
- * vn_lock() will increment the reference count of vnode.
+ * Find a vnode in a bucket and take a reference to it.
  *
- * Locking: VNODE_LOCK must be held.
+ * Locking: the bucket lock must be held.
  */
-struct vnode *
-vn_lookup(struct mount *mp, uint64_t ino)
+static struct vnode *
+__vn_lookup(struct vnode_bucket *b, struct mount *mp, uint64_t ino)
 {
 	struct vnode *vp;
 
-	UK_ASSERT(VNODE_OWNED());
-	uk_list_for_each_entry(vp, &vnode_table[vn_hash(mp, ino)], v_link) {
+	uk_list_for_each_entry(vp, &b->head, v_link) {
 		if (vp->v_mount == mp && vp->v_ino == ino) {
-			vp->v_refcnt++;
-			uk_mutex_lock(&vp->v_lock);
+			ukarch_inc(&vp->v_refcnt);
 			return vp;
 		}
 	}
 	return NULL;		/* not found */
 }
 
+/*
+ * Returns locked vnode for specified mount point and path.
+ * vn_lock() will increment the reference count of vnode.
+ */
+struct vnode *
+vn_lookup(struct mount *mp, uint64_t ino)
+{
+	struct vnode_bucket *b = &vnode_table[vn_hash(mp, ino)];
+	struct vnode *vp;
+
+	uk_mutex_lock(&b->lock);
+	vp = __vn_lookup(b, mp, ino);
+	uk_mutex_unlock(&b->lock);
+
+	if (vp)
+		uk_mutex_lock(&vp->v_lock);
+	return vp;
+}
+
 #ifdef DEBUG_VFS
 static const char *
 vn_path(struct vnode *vp)
@@ -175,6 +188,7 @@ vn_unlock(struct vnode *vp)
 int
 vfscore_vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 {
+	struct vnode_bucket *b = &vnode_table[vn_hash(mp, ino)];
 	struct vnode *vp;
 	int error;
 
@@ -182,22 +196,24 @@ vfscore_vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 
 	DPRINTF(VFSDB_VNODE, ("vfscore_vget %llu\n", (unsigned long long) ino));
 
-	VNODE_LOCK();
+	uk_mutex_lock(&b->lock);
 
-	vp = vn_lookup(mp, ino);
+	vp = __vn_lookup(b, mp, ino);
 	if (vp) {
-		VNODE_UNLOCK();
+		uk_mutex_unlock(&b->lock);
+		uk_mutex_lock(&vp->v_lock);
 		*vpp = vp;
 		return 1;
 	}
 
 	vp = calloc(1, sizeof(*vp));
 	if (!vp) {
-		VNODE_UNLOCK();
+		uk_mutex_unlock(&b->lock);
 		return 0;
 	}
 
 	UK_INIT_LIST_HEAD(&vp->v_names);
+	UK_INIT_LIST_HEAD(&vp->v_negnames);
 	vp->v_ino = ino;
 	vp->v_mount = mp;
 	vp->v_refcnt = 1;
@@ -207,21 +223,56 @@ vfscore_vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 	 * Request to allocate fs specific data for vnode.
 	 */
 	if ((error = VFS_VGET(mp, vp)) != 0) {
-		VNODE_UNLOCK();
+		uk_mutex_unlock(&b->lock);
+		uk_mutex_fini(&vp->v_lock);
 		free(vp);
 		return 0;
 	}
 	vfs_busy(vp->v_mount);
 	uk_mutex_lock(&vp->v_lock);
 
-	uk_list_add(&vp->v_link, &vnode_table[vn_hash(mp, ino)]);
-	VNODE_UNLOCK();
+	uk_list_add(&vp->v_link, &b->head);
+	uk_mutex_unlock(&b->lock);
 
 	*vpp = vp;
 
 	return 0;
 }
 
+/*
+ * Drop a reference to the vnode. Returns 1 if this was the last one,
+ * in which case the vnode has been removed from the vnode table.
+ */
+static int
+vn_release(struct vnode *vp)
+{
+	struct vnode_bucket *b;
+	int old, last;
+
+	/* Fast path: this is not the last reference */
+	for (;;) {
+		old = ukarch_load_n(&vp->v_refcnt);
+		UK_ASSERT(old > 0);
+		if (old == 1)
+			break;
+		if (ukarch_compare_exchange_sync(&vp->v_refcnt, old, old - 1)
+		    == old - 1)
+			return 0;
+	}
+
+	/*
+	 * Possibly the last reference: serialize with lookups on the
+	 * bucket, which may revive the vnode in the meantime.
+	 */
+	b = &vnode_table[vn_hash(vp->v_mount, vp->v_ino)];
+	uk_mutex_lock(&b->lock);
+	last = (ukarch_dec(&vp->v_refcnt) == 1);
+	if (last)
+		uk_list_del(&vp->v_link);
+	uk_mutex_unlock(&b->lock);
+	return last;
+}
+
 /*
  * Unlock vnode and decrement its reference count.
  */
@@ -232,15 +283,10 @@ vput(struct vnode *vp)
 	UK_ASSERT(vp->v_refcnt > 0);
 	DPRINTF(VFSDB_VNODE, ("vput: ref=%d %s\n", vp->v_refcnt, vn_path(vp)));
 
-	VNODE_LOCK();
-	vp->v_refcnt--;
-	if (vp->v_refcnt > 0) {
-	    VNODE_UNLOCK();
+	if (!vn_release(vp)) {
 		vn_unlock(vp);
 		return;
 	}
-	uk_list_del(&vp->v_link);
-	VNODE_UNLOCK();
 
 	/*
 	 * Deallocate fs specific vnode data
@@ -248,7 +294,9 @@ vput(struct vnode *vp)
 	if (vp->v_op->vop_inactive)
 		VOP_INACTIVE(vp);
 	vfs_unbusy(vp->v_mount);
+	vn_neg_purge(vp, NULL);
 	uk_mutex_unlock(&vp->v_lock);
+	uk_mutex_fini(&vp->v_lock);
 	free(vp);
 }
 
@@ -261,10 +309,8 @@ vref(struct vnode *vp)
 	UK_ASSERT(vp);
 	UK_ASSERT(vp->v_refcnt > 0);	/* Need vfscore_vget */
 
-	VNODE_LOCK();
 	DPRINTF(VFSDB_VNODE, ("vref: ref=%d\n", vp->v_refcnt));
-	vp->v_refcnt++;
-	VNODE_UNLOCK();
+	ukarch_inc(&vp->v_refcnt);
 }
 
 /*
@@ -279,21 +325,17 @@ vrele(struct vnode *vp)
 	UK_ASSERT(vp);
 	UK_ASSERT(vp->v_refcnt > 0);
 
-	VNODE_LOCK();
 	DPRINTF(VFSDB_VNODE, ("vrele: ref=%d\n", vp->v_refcnt));
-	vp->v_refcnt--;
-	if (vp->v_refcnt > 0) {
-		VNODE_UNLOCK();
+	if (!vn_release(vp))
 		return;
-	}
-	uk_list_del(&vp->v_link);
-	VNODE_UNLOCK();
 
 	/*
 	 * Deallocate fs specific vnode data
 	 */
 	VOP_INACTIVE(vp);
 	vfs_unbusy(vp->v_mount);
+	vn_neg_purge(vp, NULL);
+	uk_mutex_fini(&vp->v_lock);
 	free(vp);
 }
 
@@ -452,14 +494,13 @@ vnode_dump(void)
 	char type[][6] = { "VNON ", "VREG ", "VDIR ", "VBLK ", "VCHR ",
 			   "VLNK ", "VSOCK", "VFIFO" };
 
-	VNODE_LOCK();
-
 	uk_pr_debug("Dump vnode\n");
 	uk_pr_debug(" vnode            mount            type  refcnt path\n");
 	uk_pr_debug(" ---------------- ---------------- ----- ------ ------------------------------\n");
 
 	for (i = 0; i < VNODE_BUCKETS; i++) {
-		uk_list_for_each_entry(vp, &vnode_table[i], v_link) {
+		uk_mutex_lock(&vnode_table[i].lock);
+		uk_list_for_each_entry(vp, &vnode_table[i].head, v_link) {
 			mp = vp->v_mount;
 
 
@@ -470,9 +511,9 @@ vnode_dump(void)
 				    (strlen(mp->m_path) == 1) ? "\0" : mp->m_path,
 				    vn_path(vp));
 		}
+		uk_mutex_unlock(&vnode_table[i].lock);
 	}
 	uk_pr_debug("\n");
-	VNODE_UNLOCK();
 }
 #endif
 
@@ -509,8 +550,10 @@ vnode_init(void)
 {
 	int i;
 
-	for (i = 0; i < VNODE_BUCKETS; i++)
-		UK_INIT_LIST_HEAD(&vnode_table[i]);
+	for (i = 0; i < VNODE_BUCKETS; i++) {
+		UK_INIT_LIST_HEAD(&vnode_table[i].head);
+		uk_mutex_init(&vnode_table[i].lock);
+	}
 }
 
 void vn_add_name(struct vnode *vp __unused, struct dentry *dp)
@@ -529,3 +572,122 @@ void vn_del_name(struct vnode *vp __unused, struct dentry *dp)
 	uk_list_del(&dp->d_names_link);
 }
 
+
+/*
+ * Negative name cache.
+ *
+ * Directory vnodes remember a few names that VOP_LOOKUP() recently failed
+ * to find, so that repeatedly looking up missing files does not reach
+ * the filesystem. Entries are only kept for mounts flagged MNT_LOCAL, whose
+ * contents cannot change behind the back of vfscore. Any operation that
+ * adds a name to a directory must call vn_neg_purge() for that name.
+ *
+ * Locking: the directory vnode must be locked.
+ */
+struct vn_negname {
+	struct uk_list_head link;
+	size_t len;
+	char name[];
+};
+
+static inline int
+vn_neg_enabled(struct vnode *dvp)
+{
+	return CONFIG_LIBVFSCORE_NEGATIVE_DENTRIES > 0
+		&& dvp->v_type == VDIR && dvp->v_mount
+		&& (dvp->v_mount->m_flags & MNT_LOCAL);
+}
+
+static struct vn_negname *
+__vn_neg_find(struct vnode *dvp, const char *name, size_t len)
+{
+	struct vn_negname *nn;
+
+	uk_list_for_each_entry(nn, &dvp->v_negnames, link) {
+		if (nn->len == len && !memcmp(nn->name, name, len))
+			return nn;
+	}
+	return NULL;
+}
+
+/*
+ * Returns 1 if @name is known not to exist in directory @dvp.
+ */
+int
+vn_neg_lookup(struct vnode *dvp, const char *name)
+{
+	struct vn_negname *nn;
+
+	if (!dvp->v_nnegnames)
+		return 0;
+
+	nn = __vn_neg_find(dvp, name, strlen(name));
+	if (!nn)
+		return 0;
+
+	/* Keep recently used entries at the head */
+	uk_list_del(&nn->link);
+	uk_list_add(&nn->link, &dvp->v_negnames);
+	return 1;
+}
+
+/*
+ * Remember that @name does not exist in directory @dvp.
+ */
+void
+vn_neg_enter(struct vnode *dvp, const char *name)
+{
+	struct vn_negname *nn;
+	size_t len = strlen(name);
+
+	if (!vn_neg_enabled(dvp) || len == 0 || len >= NAME_MAX)
+		return;
+	if (__vn_neg_find(dvp, name, len))
+		return;
+
+	if (dvp->v_nnegnames >= CONFIG_LIBVFSCORE_NEGATIVE_DENTRIES) {
+		/* Recycle the least recently used entry */
+		nn = uk_list_last_entry(&dvp->v_negnames,
+					struct vn_negname, link);
+		uk_list_del(&nn->link);
+		dvp->v_nnegnames--;
+		free(nn);
+	}
+
+	nn = malloc(sizeof(*nn) + len);
+	if (!nn)
+		return;
+	nn->len = len;
+	memcpy(nn->name, name, len);
+	uk_list_add(&nn->link, &dvp->v_negnames);
+	dvp->v_nnegnames++;
+}
+
+/*
+ * Forget that @name does not exist in directory @dvp, or forget about
+ * all missing names if @name is NULL.
+ */
+void
+vn_neg_purge(struct vnode *dvp, const char *name)
+{
+	struct vn_negname *nn, *tmp;
+
+	if (!dvp->v_nnegnames)
+		return;
+
+	if (name) {
+		nn = __vn_neg_find(dvp, name, strlen(name));
+		if (nn) {
+			uk_list_del(&nn->link);
+			dvp->v_nnegnames--;
+			free(nn);
+		}
+		return;
+	}
+
+	uk_list_for_each_entry_safe(nn, tmp, &dvp->v_negnames, link) {
+		uk_list_del(&nn->link);
+		free(nn);
+	}
+	dvp->v_nnegnames = 0;
+}
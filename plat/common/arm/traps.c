@@ -24,6 +24,7 @@
 #include <uk/print.h>
 #include <uk/assert.h>
 #include <gic/gic-v2.h>
+#include <arm/cpu.h>
 
 static const char *exception_modes[]= {
 	"Synchronous Abort",
@@ -64,6 +65,13 @@ void invalid_trap_handler(struct __regs *regs, uint32_t el,
 
 void trap_el1_sync(struct __regs *regs, uint64_t far)
 {
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+	/* FP/SIMD access is disabled after a lazy context switch */
+	if (ESR_EC(regs->esr_el1) == ESR_EC_FP_ASIMD
+	    && sw_ctx_extregs_trap() == 0)
+		return;
+#endif
+
 	uk_pr_crit("Unikraft: EL1 sync trap caught\n");
 
 	dump_registers(regs, far);
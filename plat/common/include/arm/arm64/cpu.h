@@ -164,6 +164,33 @@ static inline void save_extregs(struct sw_ctx *ctx)
 	fpsimd_save_state(ctx->extregs);
 }
 
+#define CPACR_EL1_FPEN		(3UL << 20)
+
+#define ESR_EC_SHIFT		26
+#define ESR_EC_MASK		0x3fUL
+#define ESR_EC_FP_ASIMD		0x07UL	/* Trapped FP/SIMD access */
+#define ESR_EC(esr)		(((esr) >> ESR_EC_SHIFT) & ESR_EC_MASK)
+
+/* Allow access to the FP/SIMD registers */
+static inline void arch_extregs_enable(void)
+{
+	unsigned long cpacr;
+
+	__asm__ __volatile__("mrs %0, cpacr_el1" : "=r"(cpacr));
+	__asm__ __volatile__("msr cpacr_el1, %0\n"
+			     "isb" :: "r"(cpacr | CPACR_EL1_FPEN) : "memory");
+}
+
+/* Trap the next access to the FP/SIMD registers */
+static inline void arch_extregs_disable(void)
+{
+	unsigned long cpacr;
+
+	__asm__ __volatile__("mrs %0, cpacr_el1" : "=r"(cpacr));
+	__asm__ __volatile__("msr cpacr_el1, %0\n"
+			     "isb" :: "r"(cpacr & ~CPACR_EL1_FPEN) : "memory");
+}
+
 static inline void restore_extregs(struct sw_ctx *ctx)
 {
 	fpsimd_restore_state(ctx->extregs);
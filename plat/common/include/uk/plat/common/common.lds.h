@@ -98,9 +98,28 @@
 	uk_inittab_start = .;						\
 	.uk_inittab :							\
 	{								\
-		KEEP(*(SORT_BY_NAME(.uk_inittab[1-6][0-9])))		\
+		uk_inittab1_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab1[0-9])))		\
+		uk_inittab2_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab2[0-9])))		\
+		uk_inittab3_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab3[0-9])))		\
+		uk_inittab4_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab4[0-9])))		\
+		uk_inittab5_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab5[0-9])))		\
+		uk_inittab6_start = .;					\
+		KEEP(*(SORT_BY_NAME(.uk_inittab6[0-9])))		\
 	}								\
-	uk_inittab_end = .;
+	uk_inittab_end = .;						\
+									\
+	. = ALIGN(0x8);							\
+	uk_initjobs_start = .;						\
+	.uk_initjobs :							\
+	{								\
+		KEEP(*(.uk_initjobs))					\
+	}								\
+	uk_initjobs_end = .;
 
 #define TLS_SECTIONS							\
 	. = ALIGN(0x8);							\
@@ -46,6 +46,16 @@ struct sw_ctx {
 };
 
 void sw_ctx_callbacks_init(struct ukplat_ctx_callbacks *ctx_cbs);
+
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+/* Called by the trap handler on a trapped extended register access.
+ * Returns 0 if the trap was caused by lazy context switching and is
+ * resolved, < 0 otherwise.
+ */
+int sw_ctx_extregs_trap(void);
+/* Drops the extended register ownership of a context that goes away */
+void sw_ctx_extregs_release(void *ctx);
+#endif
 #endif
 
 #define OFFSETOF_SW_CTX_SP      0
@@ -110,6 +110,21 @@ static inline void restore_extregs(struct sw_ctx *ctx)
 	}
 }
 
+/* Allow access to the extended registers: clear CR0.TS */
+static inline void arch_extregs_enable(void)
+{
+	asm volatile("clts" ::: "memory");
+}
+
+/* Trap (#NM) on the next use of the extended registers: set CR0.TS */
+static inline void arch_extregs_disable(void)
+{
+	unsigned long cr0;
+
+	asm volatile("mov %%cr0, %0" : "=r"(cr0));
+	asm volatile("mov %0, %%cr0" :: "r"(cr0 | X86_CR0_TS) : "memory");
+}
+
 static inline struct sw_ctx *arch_alloc_sw_ctx(struct uk_alloc *allocator)
 {
 	struct sw_ctx *ctx;
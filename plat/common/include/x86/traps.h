@@ -105,6 +105,13 @@ void do_##name(struct __regs *regs, unsigned long error_code) \
 }
 
 
+#if CONFIG_UKPLAT_STACK_GUARD
+/* Backs guarded thread stacks on demand; returns 0 if the fault was
+ * resolved
+ */
+int stack_guard_fault(unsigned long addr, unsigned long error_code);
+#endif
+
 void traps_init(void);
 void traps_fini(void);
 
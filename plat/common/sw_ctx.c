@@ -37,6 +37,9 @@
 #include <uk/assert.h>
 #include <uk/plat/common/tls.h>
 #include <uk/plat/common/cpu.h>
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+#include <uk/plat/lcpu.h>
+#endif
 
 static void *sw_ctx_create(struct uk_alloc *allocator, unsigned long sp,
 				unsigned long tlsp);
@@ -49,6 +52,57 @@ static void  sw_ctx_switch(void *prevctx, void *nextctx);
  */
 extern void asm_thread_starter(void);
 
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+/*
+ * Extended registers are switched lazily: a context switch only revokes
+ * access to them. The first use afterwards traps and the trap handler
+ * calls sw_ctx_extregs_trap(), which moves the register file from its
+ * previous owner to the running context. Threads that never touch the
+ * FPU/SIMD unit are switched without saving or restoring it.
+ */
+static struct sw_ctx *extregs_owner;	/* context held by the registers */
+static struct sw_ctx *extregs_current;	/* running context */
+static int extregs_enabled = 1;
+
+static inline void extregs_update_access(void)
+{
+	int enable = (extregs_current == extregs_owner);
+
+	if (enable == extregs_enabled)
+		return;
+	if (enable)
+		arch_extregs_enable();
+	else
+		arch_extregs_disable();
+	extregs_enabled = enable;
+}
+
+int sw_ctx_extregs_trap(void)
+{
+	unsigned long flags;
+
+	if (extregs_current == NULL || extregs_enabled)
+		return -1;
+
+	flags = ukplat_lcpu_save_irqf();
+	arch_extregs_enable();
+	extregs_enabled = 1;
+	if (extregs_owner)
+		save_extregs(extregs_owner);
+	restore_extregs(extregs_current);
+	extregs_owner = extregs_current;
+	ukplat_lcpu_restore_irqf(flags);
+
+	return 0;
+}
+
+void sw_ctx_extregs_release(void *ctx)
+{
+	if (extregs_owner == ctx)
+		extregs_owner = NULL;
+}
+#endif /* CONFIG_UKPLAT_LAZY_EXTREGS */
+
 static void *sw_ctx_create(struct uk_alloc *allocator, unsigned long sp,
 				unsigned long tlsp)
 {
@@ -67,7 +121,24 @@ static void *sw_ctx_create(struct uk_alloc *allocator, unsigned long sp,
 	ctx->ip = (unsigned long) asm_thread_starter;
 	arch_init_extregs(ctx);
 
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+	{
+		unsigned long flags;
+
+		/* The register file has to be accessible for saving a valid
+		 * initial layout
+		 */
+		flags = ukplat_lcpu_save_irqf();
+		if (!extregs_enabled)
+			arch_extregs_enable();
+		save_extregs(ctx);
+		if (!extregs_enabled)
+			arch_extregs_disable();
+		ukplat_lcpu_restore_irqf(flags);
+	}
+#else
 	save_extregs(ctx);
+#endif
 
 	return ctx;
 }
@@ -81,6 +152,12 @@ static void sw_ctx_start(void *ctx)
 	UK_ASSERT(sw_ctx != NULL);
 
 	set_tls_pointer(sw_ctx->tlsp);
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+	/* The first thread loads its registers on first use */
+	extregs_current = sw_ctx;
+	extregs_owner = NULL;
+	extregs_update_access();
+#endif
 	/* Switch stacks and run the thread */
 	asm_ctx_start(sw_ctx->sp, sw_ctx->ip);
 
@@ -94,8 +171,17 @@ static void sw_ctx_switch(void *prevctx, void *nextctx)
 	struct sw_ctx *p = prevctx;
 	struct sw_ctx *n = nextctx;
 
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+	/* FPU/SIMD registers are caller-saved, so only the owner of the
+	 * register file needs its state preserved, which happens on demand
+	 */
+	(void) p;
+	extregs_current = n;
+	extregs_update_access();
+#else
 	save_extregs(p);
 	restore_extregs(n);
+#endif
 	set_tls_pointer(n->tlsp);
 	asm_sw_ctx_switch(prevctx, nextctx);
 }
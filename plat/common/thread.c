@@ -41,6 +41,9 @@ void ukplat_thread_ctx_destroy(struct uk_alloc *allocator, void *ctx)
 	UK_ASSERT(allocator != NULL);
 	UK_ASSERT(ctx != NULL);
 
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+	sw_ctx_extregs_release(ctx);
+#endif
 	uk_free(allocator, ctx);
 }
 
@@ -59,7 +59,9 @@ DECLARE_TRAP_EC(int3,              "int3")
 DECLARE_TRAP_EC(overflow,          "overflow")
 DECLARE_TRAP_EC(bounds,            "bounds")
 DECLARE_TRAP_EC(invalid_op,        "invalid opcode")
+#if !CONFIG_UKPLAT_LAZY_EXTREGS
 DECLARE_TRAP_EC(no_device,         "device not available")
+#endif
 DECLARE_TRAP_EC(invalid_tss,       "invalid TSS")
 DECLARE_TRAP_EC(no_segment,        "segment not present")
 DECLARE_TRAP_EC(stack_error,       "stack segment")
@@ -81,6 +83,18 @@ void do_unhandled_trap(int trapnr, char *str, struct __regs *regs,
 	UK_CRASH("Crashing\n");
 }
 
+#if CONFIG_UKPLAT_LAZY_EXTREGS
+void do_no_device(struct __regs *regs, unsigned long error_code)
+{
+	/* CR0.TS is set after a lazy context switch */
+	if (sw_ctx_extregs_trap() == 0)
+		return;
+
+	do_unhandled_trap(TRAP_no_device, "device not available", regs,
+			  error_code);
+}
+#endif
+
 static int handling_fault;
 
 static void fault_prologue(void)
@@ -115,6 +129,11 @@ void do_page_fault(struct __regs *regs, unsigned long error_code)
 {
 	unsigned long addr = read_cr2();
 
+#if CONFIG_UKPLAT_STACK_GUARD
+	if (stack_guard_fault(addr, error_code) == 0)
+		return;
+#endif
+
 	fault_prologue();
 	uk_pr_crit("Page fault at linear address %lx, rip %lx, "
 		   "regs %p, sp %lx, our_sp %p, code %lx\n",
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PLAT_DRV_VIRTIO_CONSOLE_H
+#define __PLAT_DRV_VIRTIO_CONSOLE_H
+#include <uk/config.h>
+#include <uk/arch/types.h>
+
+#include <virtio/virtio_ids.h>
+#include <virtio/virtio_config.h>
+#include <virtio/virtio_types.h>
+
+/* Feature bitmap for virtio console. */
+#define VIRTIO_CONSOLE_F_SIZE		0 /* Console size is valid */
+#define VIRTIO_CONSOLE_F_MULTIPORT	1 /* Multiple ports, control vqs */
+#define VIRTIO_CONSOLE_F_EMERG_WRITE	2 /* Emergency write supported */
+
+/* Virtio console PCI configuration space layout. */
+struct virtio_console_config {
+	__u16 cols;
+	__u16 rows;
+	__u32 max_nr_ports;
+	__u32 emerg_wr;
+} __packed;
+
+/**
+ * Writes to the first virtio console. Data is collected into buffers
+ * that are passed to the host in batches.
+ *
+ * @return
+ *	Number of bytes written, -ENODEV if no virtio console is available
+ */
+int virtio_console_write(const char *buf, unsigned int len);
+
+/**
+ * Hands all buffered output to the host and waits until it is consumed.
+ * Called before the system is shut down.
+ */
+void virtio_console_flush(void);
+
+#endif /* __PLAT_DRV_VIRTIO_CONSOLE_H */
@@ -260,17 +260,6 @@ static int virtio_9p_recv(struct virtqueue *vq, void *priv)
 		 * received, release the reference to the request.
 		 */
 		uk_9preq_receive_cb(req, len);
-
-		/*
-		 * Check for Rerror messages, fixup the error message if
-		 * needed.
-		 */
-		if (req->recv.type == UK_9P_RERROR) {
-			memcpy(req->recv.buf + req->recv.zc_offset,
-			       req->recv.zc_buf,
-			       MIN(req->recv.zc_size, len - UK_9P_HEADER_SIZE));
-		}
-
 		uk_9preq_put(req);
 		handled = 1;
 
@@ -0,0 +1,313 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <uk/alloc.h>
+#include <uk/essentials.h>
+#include <uk/sglist.h>
+#include <virtio/virtio_bus.h>
+#include <virtio/virtio_console.h>
+#include <virtio/virtqueue.h>
+#include <uk/plat/spinlock.h>
+
+#define DRIVER_NAME		"virtio-console"
+#define VIRTIO_CONSOLE_RXQ	0
+#define VIRTIO_CONSOLE_TXQ	1
+#define VIRTIO_CONSOLE_BUFS	CONFIG_VIRTIO_CONSOLE_TXBUFS
+#define VIRTIO_CONSOLE_BUFSIZE	__PAGE_SIZE
+
+static struct uk_alloc *a;
+
+/*
+ * Output is copied into a ring of transmit buffers that are used in
+ * order: `inflight` buffers are owned by the host, followed by the one
+ * that is being filled. While the host is busy, output accumulates in
+ * the fill buffer and is handed over from the completion interrupt, so
+ * that there is one notification per batch instead of one per write.
+ */
+struct virtio_cons_device {
+	/* Virtio device. */
+	struct virtio_dev *vdev;
+	/* Receive and transmit virtqueues. */
+	struct virtqueue *rxq;
+	struct virtqueue *txq;
+	/* Scatter-gather list. */
+	struct uk_sglist sg;
+	struct uk_sglist_seg sgsegs[1];
+	/* Spinlock protecting the transmit state below. */
+	spinlock_t spinlock;
+	/* Transmit buffers. */
+	char *bufs;
+	/* Buffer that is being filled. */
+	unsigned int fill;
+	unsigned int fill_len;
+	/* Number of buffers owned by the host. */
+	unsigned int inflight;
+};
+
+/* Console used for output */
+static struct virtio_cons_device *vcons;
+
+#define TXBUF(d, i) (&(d)->bufs[(i) * VIRTIO_CONSOLE_BUFSIZE])
+
+/* Hands the fill buffer to the host; called with the lock held */
+static int virtio_cons_submit(struct virtio_cons_device *d)
+{
+	int rc;
+
+	uk_sglist_reset(&d->sg);
+	rc = uk_sglist_append(&d->sg, TXBUF(d, d->fill), d->fill_len);
+	if (unlikely(rc < 0))
+		return rc;
+
+	rc = virtqueue_buffer_enqueue(d->txq, TXBUF(d, d->fill), &d->sg,
+				      d->sg.sg_nseg, 0);
+	if (unlikely(rc < 0))
+		return rc;
+
+	d->inflight++;
+	d->fill = (d->fill + 1) % VIRTIO_CONSOLE_BUFS;
+	d->fill_len = 0;
+	return 0;
+}
+
+/* Takes back buffers consumed by the host; called with the lock held */
+static void virtio_cons_reclaim(struct virtio_cons_device *d)
+{
+	void *cookie;
+	__u32 len;
+
+	while (virtqueue_buffer_dequeue(d->txq, &cookie, &len) >= 0) {
+		UK_ASSERT(d->inflight > 0);
+		d->inflight--;
+	}
+}
+
+int virtio_console_write(const char *buf, unsigned int len)
+{
+	struct virtio_cons_device *d = vcons;
+	unsigned int written = 0, n;
+	unsigned long flags;
+	int notify = 0;
+
+	if (!d)
+		return -ENODEV;
+
+	ukplat_spin_lock_irqsave(&d->spinlock, flags);
+	virtio_cons_reclaim(d);
+	while (written < len) {
+		if (d->fill_len == VIRTIO_CONSOLE_BUFSIZE) {
+			if (unlikely(virtio_cons_submit(d) < 0))
+				break;
+			virtqueue_host_notify(d->txq);
+			notify = 0;
+
+			/* All buffers are in flight: wait for the host */
+			while (d->inflight == VIRTIO_CONSOLE_BUFS)
+				virtio_cons_reclaim(d);
+		}
+
+		n = MIN(len - written, VIRTIO_CONSOLE_BUFSIZE - d->fill_len);
+		memcpy(TXBUF(d, d->fill) + d->fill_len, buf + written, n);
+		d->fill_len += n;
+		written += n;
+	}
+
+	/* An idle host gets the data right away, otherwise it is sent when
+	 * the host completes the outstanding buffers
+	 */
+	if (d->inflight == 0 && d->fill_len > 0
+	    && virtio_cons_submit(d) == 0)
+		notify = 1;
+	if (notify)
+		virtqueue_host_notify(d->txq);
+	ukplat_spin_unlock_irqrestore(&d->spinlock, flags);
+
+	return (int) written;
+}
+
+void virtio_console_flush(void)
+{
+	struct virtio_cons_device *d = vcons;
+	unsigned long flags;
+
+	if (!d)
+		return;
+
+	ukplat_spin_lock_irqsave(&d->spinlock, flags);
+	while (d->inflight > 0)
+		virtio_cons_reclaim(d);
+	if (d->fill_len > 0 && virtio_cons_submit(d) == 0) {
+		virtqueue_host_notify(d->txq);
+		while (d->inflight > 0)
+			virtio_cons_reclaim(d);
+	}
+	ukplat_spin_unlock_irqrestore(&d->spinlock, flags);
+}
+
+static int virtio_cons_tx_done(struct virtqueue *vq, void *priv)
+{
+	struct virtio_cons_device *d;
+
+	UK_ASSERT(vq);
+	UK_ASSERT(priv);
+
+	d = priv;
+	UK_ASSERT(vq == d->txq);
+
+	ukarch_spin_lock(&d->spinlock);
+	virtio_cons_reclaim(d);
+	if (d->inflight == 0 && d->fill_len > 0
+	    && virtio_cons_submit(d) == 0)
+		virtqueue_host_notify(d->txq);
+	ukarch_spin_unlock(&d->spinlock);
+
+	return 1;
+}
+
+static int virtio_cons_rx(struct virtqueue *vq __unused, void *priv __unused)
+{
+	/* Input is not supported, no buffers are posted */
+	return 0;
+}
+
+static int virtio_cons_vq_alloc(struct virtio_cons_device *d)
+{
+	__u16 qdesc_size[2];
+	int vq_avail = 0;
+	int rc = 0;
+
+	vq_avail = virtio_find_vqs(d->vdev, 2, qdesc_size);
+	if (unlikely(vq_avail != 2)) {
+		uk_pr_err(DRIVER_NAME": Expected: %d queues, found %d\n",
+			  2, vq_avail);
+		rc = -ENOMEM;
+		goto exit;
+	}
+
+	uk_sglist_init(&d->sg, ARRAY_SIZE(d->sgsegs), &d->sgsegs[0]);
+
+	d->rxq = virtio_vqueue_setup(d->vdev, VIRTIO_CONSOLE_RXQ,
+				     qdesc_size[VIRTIO_CONSOLE_RXQ],
+				     virtio_cons_rx, a);
+	if (unlikely(PTRISERR(d->rxq))) {
+		uk_pr_err(DRIVER_NAME": Failed to set up virtqueue %d\n",
+			  VIRTIO_CONSOLE_RXQ);
+		rc = PTR2ERR(d->rxq);
+		goto exit;
+	}
+	d->rxq->priv = d;
+
+	d->txq = virtio_vqueue_setup(d->vdev, VIRTIO_CONSOLE_TXQ,
+				     qdesc_size[VIRTIO_CONSOLE_TXQ],
+				     virtio_cons_tx_done, a);
+	if (unlikely(PTRISERR(d->txq))) {
+		uk_pr_err(DRIVER_NAME": Failed to set up virtqueue %d\n",
+			  VIRTIO_CONSOLE_TXQ);
+		rc = PTR2ERR(d->txq);
+		goto exit;
+	}
+	d->txq->priv = d;
+
+exit:
+	return rc;
+}
+
+static int virtio_cons_add_dev(struct virtio_dev *vdev)
+{
+	struct virtio_cons_device *d;
+	int rc = 0;
+
+	UK_ASSERT(vdev != NULL);
+
+	if (vcons) {
+		uk_pr_info(DRIVER_NAME": Only the first console is used\n");
+		return 0;
+	}
+
+	d = uk_calloc(a, 1, sizeof(*d));
+	if (!d) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	d->bufs = uk_palloc(a, VIRTIO_CONSOLE_BUFS);
+	if (!d->bufs) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+	ukarch_spin_lock_init(&d->spinlock);
+	d->vdev = vdev;
+
+	/* We use a single port and no size information */
+	d->vdev->features = 0;
+	virtio_feature_set(d->vdev, d->vdev->features);
+
+	rc = virtio_cons_vq_alloc(d);
+	if (rc) {
+		uk_pr_err(DRIVER_NAME": Could not allocate virtqueues\n");
+		virtio_dev_status_update(d->vdev, VIRTIO_CONFIG_STATUS_FAIL);
+		goto out_free_bufs;
+	}
+
+	virtqueue_intr_enable(d->txq);
+	virtio_dev_drv_up(d->vdev);
+
+	vcons = d;
+	uk_pr_info(DRIVER_NAME": started\n");
+out:
+	return rc;
+out_free_bufs:
+	uk_pfree(a, d->bufs, VIRTIO_CONSOLE_BUFS);
+out_free:
+	uk_free(a, d);
+	goto out;
+}
+
+static int virtio_cons_drv_init(struct uk_alloc *drv_allocator)
+{
+	if (!drv_allocator)
+		return -EINVAL;
+
+	a = drv_allocator;
+	return 0;
+}
+
+static const struct virtio_dev_id vcons_dev_id[] = {
+	{VIRTIO_ID_CONSOLE},
+	{VIRTIO_ID_INVALID} /* List Terminator */
+};
+
+static struct virtio_driver vcons_drv = {
+	.dev_ids = vcons_dev_id,
+	.init    = virtio_cons_drv_init,
+	.add_dev = virtio_cons_add_dev
+};
+VIRTIO_BUS_REGISTER_DRIVER(&vcons_drv);
@@ -65,6 +65,14 @@
  */
 #define NET_MAX_FRAGMENTS    ((__U16_MAX >> __PAGE_SHIFT) + 2)
 
+/**
+ * Nr. of fragments embedded in each queue. Packets that need more of them
+ * spill over into the per-queue sglist arena, which holds up to
+ * NET_MAX_FRAGMENTS.
+ */
+#define VTNET_SG_INLINE_SEGS 4
+#define VTNET_SG_ARENA_SIZE  (NET_MAX_FRAGMENTS * sizeof(struct uk_sglist_seg))
+
 #define to_virtionetdev(ndev) \
 	__containerof(ndev, struct virtio_net_device, netdev)
 
@@ -105,9 +113,10 @@ struct uk_netdev_tx_queue {
 	uint8_t intr_enabled;
 	/* Reference to the uk_netdev */
 	struct uk_netdev *ndev;
-	/* The scatter list and its associated fragements */
+	/* The scatter list, its inline fragments and spill-over arena */
 	struct uk_sglist sg;
-	struct uk_sglist_seg sgsegs[NET_MAX_FRAGMENTS];
+	struct uk_sglist_seg sgsegs[VTNET_SG_INLINE_SEGS];
+	struct uk_sglist_arena sgarena;
 };
 
 /**
@@ -131,9 +140,10 @@ struct uk_netdev_rx_queue {
 	void *alloc_rxpkts_argp;
 	/* Reference to the uk_netdev */
 	struct uk_netdev *ndev;
-	/* The scatter list and its associated fragements */
+	/* The scatter list, its inline fragments and spill-over arena */
 	struct uk_sglist sg;
-	struct uk_sglist_seg sgsegs[NET_MAX_FRAGMENTS];
+	struct uk_sglist_seg sgsegs[VTNET_SG_INLINE_SEGS];
+	struct uk_sglist_arena sgarena;
 };
 
 struct virtio_net_device {
@@ -149,6 +159,8 @@ struct virtio_net_device {
 	struct   uk_netdev_rx_queue *rxqs;
 	__u16    tx_vqueue_cnt;
 	struct   uk_netdev_tx_queue *txqs;
+	/* Backing memory of the sglist arenas of all Rx/Tx queues */
+	void *sgmem;
 	/* The netdevice identifier */
 	__u16 uid;
 	/* The max mtu */
@@ -379,7 +391,9 @@ static int virtio_netdev_xmit(struct uk_netdev *dev,
 	/**
 	 * Prepare the sglist and enqueue the buffer to the virtio-ring.
 	 */
-	uk_sglist_reset(&queue->sg);
+	uk_sglist_arena_reset(&queue->sgarena);
+	uk_sglist_init_arena(&queue->sg, ARRAY_SIZE(queue->sgsegs),
+			     &queue->sgsegs[0], &queue->sgarena);
 
 	/**
 	 * According the specification 5.1.6.6, we need to explicitly use
@@ -483,7 +497,9 @@ static int virtio_netdev_rxq_enqueue(struct uk_netdev_rx_queue *rxq,
 	rxhdr = netbuf->data;
 
 	sg = &rxq->sg;
-	uk_sglist_reset(sg);
+	uk_sglist_arena_reset(&rxq->sgarena);
+	uk_sglist_init_arena(sg, ARRAY_SIZE(rxq->sgsegs), &rxq->sgsegs[0],
+			     &rxq->sgarena);
 
 	/* Appending the header buffer to the sglist */
 	uk_sglist_append(sg, rxhdr, sizeof(struct virtio_net_hdr));
@@ -908,7 +924,9 @@ static int virtio_netdev_rxtx_alloc(struct virtio_net_device *vndev,
 	 */
 	vndev->rxqs = uk_malloc(a, sizeof(*vndev->rxqs) * conf->nb_rx_queues);
 	vndev->txqs = uk_malloc(a, sizeof(*vndev->txqs) * conf->nb_tx_queues);
-	if (unlikely(!vndev->rxqs || !vndev->txqs)) {
+	vndev->sgmem = uk_malloc(a, VTNET_SG_ARENA_SIZE *
+				 (conf->nb_rx_queues + conf->nb_tx_queues));
+	if (unlikely(!vndev->rxqs || !vndev->txqs || !vndev->sgmem)) {
 		uk_pr_err("Failed to allocate memory for queue management\n");
 		rc = -ENOMEM;
 		goto err_free_txrx;
@@ -938,10 +956,14 @@ static int virtio_netdev_rxtx_alloc(struct virtio_net_device *vndev,
 		 */
 		vndev->rxqs[i].hwvq_id = 2 * i;
 		vndev->rxqs[i].max_nb_desc = qdesc_size[vndev->rxqs[i].hwvq_id];
-		uk_sglist_init(&vndev->rxqs[i].sg,
-			       (sizeof(vndev->rxqs[i].sgsegs) /
-				sizeof(vndev->rxqs[i].sgsegs[0])),
-			       &vndev->rxqs[i].sgsegs[0]);
+		uk_sglist_arena_init(&vndev->rxqs[i].sgarena,
+				     (char *) vndev->sgmem +
+				     (2 * i) * VTNET_SG_ARENA_SIZE,
+				     VTNET_SG_ARENA_SIZE);
+		uk_sglist_init_arena(&vndev->rxqs[i].sg,
+				     ARRAY_SIZE(vndev->rxqs[i].sgsegs),
+				     &vndev->rxqs[i].sgsegs[0],
+				     &vndev->rxqs[i].sgarena);
 
 		/**
 		 * Initialize the transmit queue with the information received
@@ -949,19 +971,25 @@ static int virtio_netdev_rxtx_alloc(struct virtio_net_device *vndev,
 		 */
 		vndev->txqs[i].hwvq_id = (2 * i) + 1;
 		vndev->txqs[i].max_nb_desc = qdesc_size[vndev->txqs[i].hwvq_id];
-		uk_sglist_init(&vndev->txqs[i].sg,
-			       (sizeof(vndev->txqs[i].sgsegs) /
-				sizeof(vndev->txqs[i].sgsegs[0])),
-			       &vndev->txqs[i].sgsegs[0]);
+		uk_sglist_arena_init(&vndev->txqs[i].sgarena,
+				     (char *) vndev->sgmem +
+				     (2 * i + 1) * VTNET_SG_ARENA_SIZE,
+				     VTNET_SG_ARENA_SIZE);
+		uk_sglist_init_arena(&vndev->txqs[i].sg,
+				     ARRAY_SIZE(vndev->txqs[i].sgsegs),
+				     &vndev->txqs[i].sgsegs[0],
+				     &vndev->txqs[i].sgarena);
 	}
 exit:
 	return rc;
 
 err_free_txrx:
-	if (!vndev->rxqs)
+	if (vndev->rxqs)
 		uk_free(a, vndev->rxqs);
-	if (!vndev->txqs)
+	if (vndev->txqs)
 		uk_free(a, vndev->txqs);
+	if (vndev->sgmem)
+		uk_free(a, vndev->sgmem);
 	goto exit;
 }
 
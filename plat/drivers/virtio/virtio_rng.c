@@ -0,0 +1,219 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inttypes.h>
+#include <uk/alloc.h>
+#include <uk/essentials.h>
+#include <uk/sglist.h>
+#include <uk/swrand.h>
+#include <virtio/virtio_bus.h>
+#include <virtio/virtio_ids.h>
+#include <virtio/virtqueue.h>
+#include <uk/plat/spinlock.h>
+
+#define DRIVER_NAME	"virtio-rng"
+/* Bytes requested from the host per request */
+#define VIRTIO_RNG_BUFSIZE	64
+
+static struct uk_alloc *a;
+
+struct virtio_rng_device {
+	/* Virtio device. */
+	struct virtio_dev *vdev;
+	/* Virtqueue reference. */
+	struct virtqueue *vq;
+	/* Hw queue identifier. */
+	uint16_t hwvq_id;
+	/* Entropy source registered with ukswrand. */
+	struct uk_swrand_source src;
+	/* A request is outstanding on the virtqueue. */
+	int busy;
+	/* Scatter-gather list. */
+	struct uk_sglist sg;
+	struct uk_sglist_seg sgsegs[2];
+	/* Spinlock protecting the sg list, the vq and busy. */
+	spinlock_t spinlock;
+	/* Buffer filled by the host. */
+	__u8 buf[VIRTIO_RNG_BUFSIZE];
+};
+
+/* Called from ukswrand on every reseed */
+static void virtio_rng_request(struct uk_swrand_source *src)
+{
+	struct virtio_rng_device *d;
+	unsigned long flags;
+	int rc;
+
+	d = __containerof(src, struct virtio_rng_device, src);
+
+	ukplat_spin_lock_irqsave(&d->spinlock, flags);
+	if (d->busy)
+		goto out;
+
+	uk_sglist_reset(&d->sg);
+	rc = uk_sglist_append(&d->sg, d->buf, sizeof(d->buf));
+	if (unlikely(rc < 0)) {
+		uk_pr_err(DRIVER_NAME": Failed to append to the sg list\n");
+		goto out;
+	}
+
+	rc = virtqueue_buffer_enqueue(d->vq, d, &d->sg, 0, d->sg.sg_nseg);
+	if (likely(rc >= 0)) {
+		d->busy = 1;
+		virtqueue_host_notify(d->vq);
+	}
+out:
+	ukplat_spin_unlock_irqrestore(&d->spinlock, flags);
+}
+
+static int virtio_rng_recv(struct virtqueue *vq, void *priv)
+{
+	struct virtio_rng_device *d;
+	void *cookie;
+	uint32_t len;
+	int handled = 0;
+
+	UK_ASSERT(vq);
+	UK_ASSERT(priv);
+
+	d = priv;
+	UK_ASSERT(vq == d->vq);
+
+	ukarch_spin_lock(&d->spinlock);
+	while (virtqueue_buffer_dequeue(d->vq, &cookie, &len) >= 0) {
+		len = MIN(len, sizeof(d->buf));
+		/* The host is trusted to return true random data */
+		uk_swrand_add_entropy(d->buf, len, len * 8);
+		d->busy = 0;
+		handled = 1;
+	}
+	ukarch_spin_unlock(&d->spinlock);
+
+	return handled;
+}
+
+static int virtio_rng_vq_alloc(struct virtio_rng_device *d)
+{
+	int vq_avail = 0;
+	int rc = 0;
+	__u16 qdesc_size;
+
+	vq_avail = virtio_find_vqs(d->vdev, 1, &qdesc_size);
+	if (unlikely(vq_avail != 1)) {
+		uk_pr_err(DRIVER_NAME": Expected: %d queues, found %d\n",
+			  1, vq_avail);
+		rc = -ENOMEM;
+		goto exit;
+	}
+
+	d->hwvq_id = 0;
+	uk_sglist_init(&d->sg, ARRAY_SIZE(d->sgsegs), &d->sgsegs[0]);
+
+	d->vq = virtio_vqueue_setup(d->vdev,
+				    d->hwvq_id,
+				    qdesc_size,
+				    virtio_rng_recv,
+				    a);
+	if (unlikely(PTRISERR(d->vq))) {
+		uk_pr_err(DRIVER_NAME": Failed to set up virtqueue %"PRIu16"\n",
+			  d->hwvq_id);
+		rc = PTR2ERR(d->vq);
+		goto exit;
+	}
+
+	d->vq->priv = d;
+
+exit:
+	return rc;
+}
+
+static int virtio_rng_add_dev(struct virtio_dev *vdev)
+{
+	struct virtio_rng_device *d;
+	int rc = 0;
+
+	UK_ASSERT(vdev != NULL);
+
+	d = uk_calloc(a, 1, sizeof(*d));
+	if (!d) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	ukarch_spin_lock_init(&d->spinlock);
+	d->vdev = vdev;
+
+	/* The device has no feature bits */
+	d->vdev->features = 0;
+	virtio_feature_set(d->vdev, d->vdev->features);
+
+	rc = virtio_rng_vq_alloc(d);
+	if (rc) {
+		uk_pr_err(DRIVER_NAME": Could not allocate virtqueue\n");
+		virtio_dev_status_update(d->vdev, VIRTIO_CONFIG_STATUS_FAIL);
+		goto out_free;
+	}
+
+	virtqueue_intr_enable(d->vq);
+	virtio_dev_drv_up(d->vdev);
+
+	d->src.name = DRIVER_NAME;
+	d->src.request = virtio_rng_request;
+	rc = uk_swrand_source_register(&d->src);
+	if (rc)
+		goto out_free;
+
+	uk_pr_info(DRIVER_NAME": started\n");
+out:
+	return rc;
+out_free:
+	uk_free(a, d);
+	goto out;
+}
+
+static int virtio_rng_drv_init(struct uk_alloc *drv_allocator)
+{
+	if (!drv_allocator)
+		return -EINVAL;
+
+	a = drv_allocator;
+	return 0;
+}
+
+static const struct virtio_dev_id vrng_dev_id[] = {
+	{VIRTIO_ID_RNG},
+	{VIRTIO_ID_INVALID} /* List Terminator */
+};
+
+static struct virtio_driver vrng_drv = {
+	.dev_ids = vrng_dev_id,
+	.init    = virtio_rng_drv_init,
+	.add_dev = virtio_rng_add_dev
+};
+VIRTIO_BUS_REGISTER_DRIVER(&vrng_drv);
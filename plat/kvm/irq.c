@@ -36,6 +36,9 @@
 #include <uk/assert.h>
 #include <errno.h>
 #include <uk/bitops.h>
+#if CONFIG_LIBUKSWRAND_ENTROPY_IRQ
+#include <uk/swrand.h>
+#endif
 
 static struct uk_alloc *allocator;
 
@@ -82,6 +85,10 @@ void _ukplat_irq_handle(unsigned long irq)
 {
 	struct irq_handler *h;
 
+#if CONFIG_LIBUKSWRAND_ENTROPY_IRQ
+	uk_swrand_add_irq_timing(irq);
+#endif
+
 	UK_SLIST_FOREACH(h, &irq_handlers[irq], entries) {
 		/* TODO define platform wise macro for timer IRQ number */
 		if (irq != 0)
@@ -26,6 +26,9 @@
 #include <uk/plat/common/irq.h>
 #include <uk/print.h>
 #include <uk/plat/bootstrap.h>
+#if CONFIG_VIRTIO_CONSOLE
+#include <virtio/virtio_console.h>
+#endif
 
 static void cpu_halt(void) __noreturn;
 
@@ -34,6 +37,11 @@ void ukplat_terminate(enum ukplat_gstate request __unused)
 {
 	uk_pr_info("Unikraft halted\n");
 
+#if CONFIG_VIRTIO_CONSOLE
+	/* Output that is still buffered would be lost otherwise */
+	virtio_console_flush();
+#endif
+
 	/* Try to make system off */
 	system_off();
 
@@ -34,6 +34,9 @@
 #if (CONFIG_KVM_DEBUG_SERIAL_CONSOLE || CONFIG_KVM_KERNEL_SERIAL_CONSOLE)
 #include <kvm-x86/serial_console.h>
 #endif
+#if CONFIG_VIRTIO_CONSOLE
+#include <virtio/virtio_console.h>
+#endif
 
 void _libkvmplat_init_console(void)
 {
@@ -48,6 +51,13 @@ void _libkvmplat_init_console(void)
 
 int ukplat_coutd(const char *buf __maybe_unused, unsigned int len)
 {
+#if CONFIG_VIRTIO_CONSOLE
+	int rc = virtio_console_write(buf, len);
+
+	/* Fall back to the other consoles until the device is up */
+	if (rc >= 0)
+		return rc;
+#endif
 	for (unsigned int i = 0; i < len; i++) {
 #if CONFIG_KVM_DEBUG_SERIAL_CONSOLE
 		_libkvmplat_serial_putc(buf[i]);
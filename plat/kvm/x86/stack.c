@@ -0,0 +1,333 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2021, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Guard-page protected, demand-paged thread stacks
+ *
+ * Stacks live in a dedicated virtual window above the 1:1 mapping of the
+ * physical memory. Every stack occupies a slot of __STACK_SIZE bytes that
+ * is aligned to its size, so that uk_thread_current() keeps working:
+ *
+ *   base                                                    base + size
+ *   | thread pointer | guard |  ...  demand-backed stack  ... <- sp |
+ *
+ * The first page is backed on allocation, the guard page is never mapped
+ * and all other pages are mapped by the page fault handler on first use.
+ * Page faults run on their own IST stack, so a fault on the thread stack
+ * can be served. The handler must not call into the allocator (it may
+ * interrupt it); instead it takes zeroed pages from a reserve that is
+ * refilled whenever a stack is allocated or released, and by the scheduler
+ * (ukplat_stack_reserve_refill()) once it runs low.
+ *
+ * A single guard page only catches frames that touch it: a frame larger than
+ * a page could skip over it and write into the thread pointer page. The
+ * build therefore adds -fstack-clash-protection (GCC >= 8), which probes
+ * large frames page by page.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <uk/plat/thread.h>
+#include <uk/arch/limits.h>
+#include <uk/arch/atomic.h>
+#include <uk/alloc.h>
+#include <uk/print.h>
+#include <uk/assert.h>
+#include <uk/essentials.h>
+#include <x86/cpu.h>
+#include <x86/traps.h>
+
+#define STACK_AREA_BASE		0x8000000000UL	/* PML4 slot 1 (512 GiB) */
+#define STACK_AREA_SLOTS	CONFIG_UKPLAT_STACK_GUARD_MAX
+#define STACK_AREA_END		(STACK_AREA_BASE + \
+				 (STACK_AREA_SLOTS * (unsigned long) __STACK_SIZE))
+#define STACK_PAGES		(__STACK_SIZE >> __PAGE_SHIFT)
+/* First page that is backed on demand (after thread pointer and guard) */
+#define STACK_FIRST_DYN		2
+
+#define STACK_RESERVE		CONFIG_UKPLAT_STACK_GUARD_RESERVE
+/* Below this, the scheduler tops up the reserve from thread context */
+#define STACK_RESERVE_LOW	DIV_ROUND_UP(STACK_RESERVE, 2)
+
+#define PTE_PRESENT		0x001UL
+#define PTE_RW			0x002UL
+#define PTE_PSE			0x080UL
+#define PTE_ADDR_MASK		0x000ffffffffff000UL
+
+#define PT_ENTRIES		512
+#define PT_IDX(va, level)	(((va) >> (__PAGE_SHIFT + 9 * (level))) \
+				 & (PT_ENTRIES - 1))
+
+#define X86_PF_EC_PRESENT	0x1UL
+
+UK_CTASSERT(STACK_PAGES > STACK_FIRST_DYN);
+
+static unsigned long stack_slots[DIV_ROUND_UP(STACK_AREA_SLOTS,
+						 sizeof(unsigned long) * 8)];
+
+/* Zeroed pages for the page fault handler, linked through their first
+ * word
+ */
+static void *reserve_head;
+static unsigned long reserve_count;
+
+static inline unsigned long read_cr3(void)
+{
+	unsigned long cr3;
+
+	asm volatile("mov %%cr3, %0" : "=r"(cr3));
+	return cr3;
+}
+
+static void reserve_push(void *page)
+{
+	void *head;
+
+	do {
+		head = ukarch_load_n(&reserve_head);
+		*((void **) page) = head;
+	} while (ukarch_compare_exchange_sync(&reserve_head, head, page)
+		 != page);
+	ukarch_inc(&reserve_count);
+}
+
+/* Lock-free with respect to the page fault handler, which only pops */
+static void *reserve_pop(void)
+{
+	void *head, *next;
+
+	do {
+		head = ukarch_load_n(&reserve_head);
+		if (!head)
+			return NULL;
+		next = *((void **) head);
+	} while (ukarch_compare_exchange_sync(&reserve_head, head, next)
+		 != next);
+	ukarch_dec(&reserve_count);
+
+	*((void **) head) = NULL;
+	return head;
+}
+
+static void reserve_fill(struct uk_alloc *a)
+{
+	void *page;
+
+	while (ukarch_load_n(&reserve_count) < STACK_RESERVE) {
+		page = uk_palloc(a, 1);
+		if (!page)
+			break;
+		memset(page, 0, __PAGE_SIZE);
+		reserve_push(page);
+	}
+}
+
+static void reserve_release(struct uk_alloc *a, void *page)
+{
+	if (ukarch_load_n(&reserve_count) >= 2 * STACK_RESERVE) {
+		uk_pfree(a, page, 1);
+		return;
+	}
+	memset(page, 0, __PAGE_SIZE);
+	reserve_push(page);
+}
+
+/*
+ * Returns the page table entry for `va`. Missing intermediate tables are
+ * allocated from `a`; with `a == NULL` the walk fails instead.
+ * Page tables are 1:1 mapped since they come from the heap.
+ */
+static unsigned long *pt_walk(unsigned long va, struct uk_alloc *a)
+{
+	unsigned long *pt = (unsigned long *) (read_cr3() & PTE_ADDR_MASK);
+	unsigned long *pte;
+	void *new;
+	int level;
+
+	for (level = 3; level > 0; level--) {
+		pte = &pt[PT_IDX(va, level)];
+		if (!(*pte & PTE_PRESENT)) {
+			if (!a)
+				return NULL;
+			new = uk_palloc(a, 1);
+			if (!new)
+				return NULL;
+			memset(new, 0, __PAGE_SIZE);
+			*pte = (unsigned long) new | PTE_PRESENT | PTE_RW;
+		}
+		UK_ASSERT(!(*pte & PTE_PSE));
+		pt = (unsigned long *) (*pte & PTE_ADDR_MASK);
+	}
+	return &pt[PT_IDX(va, 0)];
+}
+
+static inline int slot_used(unsigned long slot)
+{
+	return !!(stack_slots[slot / (sizeof(unsigned long) * 8)]
+		  & (1UL << (slot % (sizeof(unsigned long) * 8))));
+}
+
+static long slot_get(void)
+{
+	unsigned long i, bit;
+
+	for (i = 0; i < ARRAY_SIZE(stack_slots); i++) {
+		if (stack_slots[i] == ~0UL)
+			continue;
+		bit = ukarch_ffsl(~stack_slots[i]);
+		if (i * sizeof(unsigned long) * 8 + bit >= STACK_AREA_SLOTS)
+			break;
+		stack_slots[i] |= 1UL << bit;
+		return i * sizeof(unsigned long) * 8 + bit;
+	}
+	return -1;
+}
+
+static void slot_put(unsigned long slot)
+{
+	stack_slots[slot / (sizeof(unsigned long) * 8)]
+		&= ~(1UL << (slot % (sizeof(unsigned long) * 8)));
+}
+
+void *ukplat_stack_alloc(struct uk_alloc *a)
+{
+	unsigned long base, va;
+	unsigned long *pte;
+	void *page;
+	long slot;
+
+	UK_ASSERT(a);
+
+	slot = slot_get();
+	if (slot < 0) {
+		uk_pr_err("Out of stack slots (%d)\n", STACK_AREA_SLOTS);
+		return NULL;
+	}
+	base = STACK_AREA_BASE + (unsigned long) slot * __STACK_SIZE;
+
+	/* Make sure the page tables of the whole region exist, so that the
+	 * fault handler does not need to allocate any
+	 */
+	for (va = base; va < base + __STACK_SIZE;
+	     va += PT_ENTRIES * __PAGE_SIZE) {
+		if (!pt_walk(va, a))
+			goto err_out;
+	}
+
+	/* The first page holds the thread pointer */
+	page = uk_palloc(a, 1);
+	if (!page)
+		goto err_out;
+	memset(page, 0, __PAGE_SIZE);
+	pte = pt_walk(base, NULL);
+	*pte = (unsigned long) page | PTE_PRESENT | PTE_RW;
+
+	reserve_fill(a);
+	return (void *) base;
+
+err_out:
+	uk_pr_err("Failed to allocate thread stack: Not enough memory\n");
+	slot_put(slot);
+	return NULL;
+}
+
+void ukplat_stack_free(struct uk_alloc *a, void *stack)
+{
+	unsigned long base = (unsigned long) stack;
+	unsigned long *pte;
+	unsigned long i;
+	void *page;
+
+	UK_ASSERT(a);
+	UK_ASSERT(base >= STACK_AREA_BASE && base < STACK_AREA_END);
+	UK_ASSERT(ALIGN_DOWN(base, __STACK_SIZE) == base);
+
+	for (i = 0; i < STACK_PAGES; i++) {
+		pte = pt_walk(base + i * __PAGE_SIZE, NULL);
+		UK_ASSERT(pte);
+		if (!(*pte & PTE_PRESENT))
+			continue;
+
+		page = (void *) (*pte & PTE_ADDR_MASK);
+		*pte = 0;
+		invlpg(base + i * __PAGE_SIZE);
+		if (i == 0)
+			uk_pfree(a, page, 1);
+		else
+			reserve_release(a, page);
+	}
+
+	slot_put((base - STACK_AREA_BASE) / __STACK_SIZE);
+	reserve_fill(a);
+}
+
+void ukplat_stack_reserve_refill(struct uk_alloc *a)
+{
+	if (likely(ukarch_load_n(&reserve_count) >= STACK_RESERVE_LOW))
+		return;
+
+	UK_ASSERT(a);
+	reserve_fill(a);
+}
+
+int stack_guard_fault(unsigned long addr, unsigned long error_code)
+{
+	unsigned long slot, page_idx;
+	unsigned long *pte;
+	void *page;
+
+	if (addr < STACK_AREA_BASE || addr >= STACK_AREA_END)
+		return -1;
+
+	slot = (addr - STACK_AREA_BASE) / __STACK_SIZE;
+	if (!slot_used(slot) || (error_code & X86_PF_EC_PRESENT))
+		return -1;
+
+	page_idx = (addr & (__STACK_SIZE - 1)) >> __PAGE_SHIFT;
+	if (page_idx < STACK_FIRST_DYN) {
+		uk_pr_crit("Stack overflow: access to guard page at %lx "
+			   "(stack %lx)\n", addr,
+			   (unsigned long) (STACK_AREA_BASE
+					    + slot * __STACK_SIZE));
+		return -1;
+	}
+
+	page = reserve_pop();
+	if (!page) {
+		uk_pr_crit("Out of reserved stack pages, increase "
+			   "CONFIG_UKPLAT_STACK_GUARD_RESERVE\n");
+		return -1;
+	}
+
+	pte = pt_walk(addr, NULL);
+	UK_ASSERT(pte);
+	*pte = (unsigned long) page | PTE_PRESENT | PTE_RW;
+	return 0;
+}
@@ -45,26 +45,29 @@ type_void = gdb.lookup_type('void')
 
 PTR_SIZE = type_void.pointer().sizeof
 
-def get_trace_buffer():
+def get_trace_buffer(keyvals):
     inf = gdb.selected_inferior()
 
     try:
-        trace_buff = gdb.parse_and_eval('uk_trace_buffer')
-        trace_buff_size = trace_buff.type.sizeof
-        trace_buff_addr = int(trace_buff.address)
-        trace_buff_writep = int(gdb.parse_and_eval('uk_trace_buffer_writep'))
+        trace_buffs = gdb.parse_and_eval('uk_trace_buffers')
+        nr_buffs = trace_buffs.type.sizeof // trace_buffs[0].type.sizeof
     except gdb.error:
         gdb.write("Error getting the trace buffer. Is tracing enabled?\n")
         raise gdb.error
 
-    if (trace_buff_writep == 0):
-        # This can happen as effect of compile optimization if none of
-        # tracepoints were called
-        used = 0
-    else:
-        used = trace_buff_writep - trace_buff_addr
+    # Produce the same binary export as uk_trace_export() does
+    buffers = []
+    for i in range(nr_buffs):
+        buff = trace_buffs[i]
+        data = bytes(inf.read_memory(int(buff['data'].address),
+                                     buff['data'].type.sizeof))
+        records = parse.linearize_buffer(data, int(buff['head']),
+                                         int(keyvals['chunks']),
+                                         int(keyvals['ring']))
+        buffers.append(parse.trace_buffer(i, int(buff['owner']),
+                                          int(buff['lost']), records))
 
-    return bytes(inf.read_memory(trace_buff_addr, used))
+    return parse.make_export(PTR_SIZE, buffers)
 
 def save_traces(out):
     elf = gdb.current_progspace().filename
@@ -76,7 +79,8 @@ def save_traces(out):
     # least keyvals are always stored first. However, ideally, next
     # versions should just have modifications at the very end to keep
     # compatibility with previously collected data.
-    pickler.dump(parse.get_keyvals(elf))
+    keyvals = parse.get_keyvals(elf)
+    pickler.dump(keyvals)
     pickler.dump(elf)
     pickler.dump(PTR_SIZE)
     # We are saving raw trace buffer here. Another option is to pickle
@@ -84,7 +88,7 @@ def save_traces(out):
     # easier to debug the parser, because python in gdb is not very
     # convenient for development.
     pickler.dump(parse.get_tp_sections(elf))
-    pickler.dump(get_trace_buffer())
+    pickler.dump(get_trace_buffer(keyvals))
 
 class uk(gdb.Command):
     def __init__(self):
@@ -97,9 +101,10 @@ class uk_trace(gdb.Command):
                              gdb.COMMAND_USER, gdb.COMPLETE_COMMAND, True)
     def invoke(self, arg, from_tty):
         elf = gdb.current_progspace().filename
-        samples = parse.sample_parser(parse.get_keyvals(elf),
+        keyvals = parse.get_keyvals(elf)
+        samples = parse.sample_parser(keyvals,
                                       parse.get_tp_sections(elf),
-                                      get_trace_buffer(), PTR_SIZE)
+                                      get_trace_buffer(keyvals), PTR_SIZE)
         for sample in samples:
             print(sample)
 
@@ -36,13 +36,18 @@ import re
 import tempfile
 
 TP_HEADER_MAGIC = 'TRhd'
+TP_PAD_MAGIC = 'TPad'
 TP_DEF_MAGIC = 'TPde'
+EXPORT_MAGIC = 'UKTR'
+EXPORT_BUF_MAGIC = 'UKTB'
+TP_HEADER_FMT = '4sIQQ'
+TP_ALIGN = 8
 UK_TRACE_ARG_INT = 0
 UK_TRACE_ARG_STRING = 1
 # Not sure why gcc aligns data on 32 bytes
 __STRUCT_ALIGNMENT = 32
 
-FORMAT_VERSION = 1
+FORMAT_VERSION = 2
 
 def align_down(v, alignment):
     return v & ~(alignment - 1)
@@ -51,19 +56,27 @@ def align_up(v, alignment):
     return align_down(v + alignment - 1, alignment)
 
 class tp_sample:
-    def __init__(self, tp, time, args):
+    def __init__(self, tp, time, args, buf=0):
         self.tp = tp
         self.args = args
         self.time = time
+        self.buf = buf
     def __str__(self):
-        return (("%016d %s: " % (self.time, self.tp.name)) +
+        return (("%016d %2d %s: " % (self.time, self.buf, self.tp.name)) +
                  (self.tp.fmt % self.args))
     def tabulate_fmt(self):
-        return [self.time, self.tp.name, (self.tp.fmt % self.args)]
+        return [self.time, self.buf, self.tp.name, (self.tp.fmt % self.args)]
 
 class EndOfBuffer(Exception):
     pass
 
+class trace_buffer:
+    def __init__(self, index, owner, lost, data):
+        self.index = index
+        self.owner = owner
+        self.lost = lost
+        self.data = data
+
 # Parsing of trace buffer is designed to be used without gdb. If ever
 # Unikraft will have a bare metal port, it would be complicated to use
 # gdb for fetching and parsing runtime data.
@@ -76,37 +89,130 @@ class EndOfBuffer(Exception):
 # Similar considerations are applied to parsing trace point
 # definitions. We can do that disregarding if it is possible to attach
 # gdb to a running instance or not
+#
+# Since format version 2, trace_buff is the binary export produced by
+# uk_trace_export() (/dev/trace, uk_trace_dump() or the gdb helper).
+# Version 1 trace files contain the raw content of the single buffer.
 class sample_parser:
-    def __init__(self, keyvals, tp_defs_data, trace_buff, ptr_size):
-        if (int(keyvals['format_version']) > FORMAT_VERSION):
+    def __init__(self, keyvals, tp_defs_data, trace_buff, ptr_size=None):
+        version = int(keyvals.get('format_version', FORMAT_VERSION))
+        if (version > FORMAT_VERSION):
             print("Warning: Version of trace format is more recent",
                   file=sys.stderr)
-        self.data = unpacker(trace_buff)
+        if version >= 2:
+            ptr_size, self.buffers = parse_export(trace_buff)
+        else:
+            self.buffers = [trace_buffer(0, 0, 0, trace_buff)]
         self.tps = get_tp_definitions(tp_defs_data, ptr_size)
     def __iter__(self):
-        self.data.pos = 0
-        return self
-    def __next__(self):
+        samples = []
+        for buf in self.buffers:
+            samples += parse_records(self.tps, buf)
+        samples.sort(key=lambda x: x.time)
+        return iter(samples)
+    def lost(self):
+        return sum([buf.lost for buf in self.buffers])
+
+def parse_records(tps, buf):
+    data = unpacker(buf.data)
+    ret = []
+    while True:
+        start = data.pos
         try:
             # TODO: generate format. Cookie can be 4 bytes long on other
             # platforms
-            magic,size,time,cookie = self.data.unpack('4sLQQ')
+            magic,size,time,cookie = data.unpack(TP_HEADER_FMT)
         except EndOfBuffer:
-            raise StopIteration
+            break
 
-        magic = magic.decode()
+        magic = magic.decode(errors='replace')
         if (magic != TP_HEADER_MAGIC):
-            raise StopIteration
+            break
 
-        tp = self.tps[cookie]
+        tp = tps[cookie]
         args = []
-        for i in range(tp.args_nr):
-            if tp.types[i] == UK_TRACE_ARG_STRING:
-                args += [self.data.unpack_string()]
-            else:
-                args += [self.data.unpack_int(tp.sizes[i])]
+        try:
+            for i in range(tp.args_nr):
+                if tp.types[i] == UK_TRACE_ARG_STRING:
+                    args += [data.unpack_string()]
+                else:
+                    args += [data.unpack_int(tp.sizes[i])]
+        except EndOfBuffer:
+            break
+        data.pos = start + struct.calcsize('<' + TP_HEADER_FMT) + size
+
+        ret.append(tp_sample(tp, time, tuple(args), buf.index))
+    return ret
 
-        return tp_sample(tp, time, tuple(args))
+def parse_export(data):
+    """Splits a binary trace export into its buffers"""
+    data = unpacker(data)
+    magic, version, ptr_size, nr_buffers = data.unpack('4sIII')
+    if magic.decode(errors='replace') != EXPORT_MAGIC:
+        raise Exception("Not a trace export")
+
+    buffers = []
+    for i in range(nr_buffers):
+        try:
+            magic, index, owner, lost, length = data.unpack('4sIQQQ')
+        except EndOfBuffer:
+            print("Warning: Trace export is truncated", file=sys.stderr)
+            break
+        if magic.decode(errors='replace') != EXPORT_BUF_MAGIC:
+            raise Exception("Wrong trace buffer magic")
+        records = data.data[data.pos:data.pos + length]
+        data.pos += length
+        buffers.append(trace_buffer(index, owner, lost, records))
+    return ptr_size, buffers
+
+def make_export(ptr_size, buffers):
+    """Builds a binary trace export, like uk_trace_export() does"""
+    ret = struct.pack('<4sIII', EXPORT_MAGIC.encode(), FORMAT_VERSION,
+                      ptr_size, len(buffers))
+    for buf in buffers:
+        ret += struct.pack('<4sIQQQ', EXPORT_BUF_MAGIC.encode(),
+                           buf.index, buf.owner, buf.lost, len(buf.data))
+        ret += buf.data
+    return ret
+
+def linearize_buffer(data, head, chunks, ring):
+    """Extracts the valid records of a raw trace buffer in chronological
+    order, the same way as uk_trace_export() does"""
+    size = len(data)
+    chunk_size = size // chunks
+    hdr_size = struct.calcsize('<' + TP_HEADER_FMT)
+    pos = 0
+    ret = b''
+
+    if ring and head // chunk_size >= chunks:
+        pos = (head // chunk_size - (chunks - 1)) * chunk_size
+
+    while pos < head:
+        off = pos % chunk_size
+        if chunk_size - off < hdr_size:
+            pos += chunk_size - off
+            continue
+        p = pos % size
+        magic, rsize = struct.unpack('<4sI', data[p:p + 8])
+        magic = magic.decode(errors='replace')
+        if magic == TP_PAD_MAGIC or off + hdr_size + rsize > chunk_size:
+            pos += chunk_size - off
+            continue
+        if magic == TP_HEADER_MAGIC:
+            ret += data[p:p + hdr_size + rsize]
+        pos += align_up(hdr_size + rsize, TP_ALIGN)
+    return ret
+
+def read_console_dump(text):
+    """Extracts a trace export printed by uk_trace_dump() from a console
+    log"""
+    ret = b''
+    for line in text.splitlines():
+        idx = line.find('uktrace:')
+        if idx < 0:
+            continue
+        ret += bytes.fromhex(line[idx + len('uktrace:'):].strip())
+    return ret
 
 class unpacker:
     def __init__(self, data):
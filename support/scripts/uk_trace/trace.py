@@ -61,18 +61,41 @@ def parse_tf(trace_file):
 
     return parse.sample_parser(keyvals, tp_defs, trace_buff, ptr_size)
 
+def print_samples(samples, no_tabulate):
+    if not no_tabulate:
+        print_data = [x.tabulate_fmt() for x in samples]
+        print(tabulate(print_data, headers=['time', 'buf', 'tp_name', 'msg']))
+    else:
+        for i in samples:
+            print(i)
+
 @cli.command()
 @click.argument('trace_file', type=click.Path(exists=True), default='tracefile')
 @click.option('--no-tabulate', is_flag=True,
               help='No pretty printing')
 def list(trace_file, no_tabulate):
     """Parse binary trace file fetched from Unikraft"""
-    if not no_tabulate:
-        print_data = [x.tabulate_fmt() for x in parse_tf(trace_file)]
-        print(tabulate(print_data, headers=['time', 'tp_name', 'msg']))
-    else:
-        for i in parse_tf(trace_file):
-            print(i)
+    print_samples(parse_tf(trace_file), no_tabulate)
+
+@cli.command()
+@click.argument('uk_img', type=click.Path(exists=True))
+@click.argument('export', type=click.Path(exists=True))
+@click.option('--console', is_flag=True,
+              help='EXPORT is a console log with uk_trace_dump() output')
+@click.option('--no-tabulate', is_flag=True,
+              help='No pretty printing')
+def decode(uk_img, export, console, no_tabulate):
+    """Decode a trace export read from /dev/trace or the console"""
+    with open(export, 'rb') as f:
+        data = f.read()
+    if console:
+        data = parse.read_console_dump(data.decode(errors='replace'))
+
+    samples = parse.sample_parser(parse.get_keyvals(uk_img),
+                                  parse.get_tp_sections(uk_img), data)
+    print_samples(samples, no_tabulate)
+    if samples.lost():
+        print("%d records were lost" % samples.lost(), file=sys.stderr)
 
 @cli.command()
 @click.argument('uk_img', type=click.Path(exists=True))